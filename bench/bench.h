@@ -0,0 +1,34 @@
+#ifndef _BENCH
+#define _BENCH
+
+// Small helpers shared by the benchmarks in this directory.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Returns a monotonic timestamp in seconds.
+static inline double bench_now(void) {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+// A small xorshift generator so that every run sees the same sequence.
+static inline uint64_t bench_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+// Prints one result line, `seconds` taken for `operations` operations.
+static inline void bench_report(const char *name, double seconds,
+                                uint64_t operations) {
+    printf("%-32s %10.2f ms %10.2f ns/op\n", name, seconds * 1e3,
+           seconds * 1e9 / (double)operations);
+}
+
+#endif
@@ -0,0 +1,92 @@
+#include "bench.h"
+
+#include "compression.h"
+#include "general_buffer.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Decodes the terrain data of a 1024 by 1024 terrain from the scene file
+// encoding and compares it against copying the raw bytes, the time a cold disk
+// would take to read them is printed for reference.
+
+#define WIDTH 1025
+#define COUNT (WIDTH * WIDTH)
+#define ROUNDS 20
+// A rough sequential read speed of a cold SATA SSD
+#define DISK_BYTES_PER_SECOND (500.0 * 1024 * 1024)
+
+static float heights[COUNT];
+static float decoded_heights[COUNT];
+static uint8_t indices[COUNT];
+static uint8_t decoded_indices[COUNT];
+
+// Rolling hills with a bit of noise, painted in large patches.
+static void generate_terrain(void) {
+    uint64_t state = 0x2545f4914f6cdd1d;
+    for (size_t i = 0; i < COUNT; i++) {
+        float x = (float)(i % WIDTH);
+        float y = (float)(i / WIDTH);
+        float noise = (float)(bench_random(&state) % 4) * 0.01f;
+        heights[i] = sinf(x * 0.02f) * cosf(y * 0.03f) * 8.0f + noise;
+        indices[i] = ((i % WIDTH) / 64 + (i / WIDTH) / 64) % 4;
+    }
+}
+
+int main(void) {
+    generate_terrain();
+
+    GeneralBuffer encoded_heights = genbuf_init();
+    GeneralBuffer encoded_indices = genbuf_init();
+    compression_encode_heights(heights, WIDTH, &encoded_heights);
+    compression_rle_encode(indices, COUNT, &encoded_indices);
+
+    size_t raw_size = COUNT * (sizeof(float) + 1);
+    size_t encoded_size =
+        encoded_heights.data_size + encoded_indices.data_size;
+    printf("%d data points, %zu raw bytes, %zu encoded bytes (%.1f%%)\n",
+           COUNT, raw_size, encoded_size,
+           100.0 * (double)encoded_size / (double)raw_size);
+
+    double total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        double start = bench_now();
+        memcpy(decoded_heights, heights, sizeof heights);
+        memcpy(decoded_indices, indices, sizeof indices);
+        total += bench_now() - start;
+    }
+    bench_report("copy raw", total / ROUNDS, COUNT);
+
+    total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        double start = bench_now();
+        compression_decode_heights(encoded_heights.data,
+                                   encoded_heights.data_size,
+                                   decoded_heights, WIDTH);
+        compression_rle_decode(encoded_indices.data,
+                               encoded_indices.data_size, decoded_indices,
+                               COUNT);
+        total += bench_now() - start;
+    }
+    bench_report("decode", total / ROUNDS, COUNT);
+
+    for (size_t i = 0; i < COUNT; i++) {
+        if (fabsf(heights[i] - decoded_heights[i]) >
+                COMPRESSION_HEIGHT_STEP / 2 ||
+            indices[i] != decoded_indices[i]) {
+            printf("ERROR: decoded terrain doesn't match\n");
+            break;
+        }
+    }
+
+    bench_report("disk read raw", (double)raw_size / DISK_BYTES_PER_SECOND,
+                 COUNT);
+    bench_report("disk read encoded",
+                 (double)encoded_size / DISK_BYTES_PER_SECOND, COUNT);
+
+    genbuf_free(&encoded_heights);
+    genbuf_free(&encoded_indices);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "bench.h"
+
+#include "crc32c.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Checksums a buffer the size of a large scene file with the crc32
+// instruction and with the table fallback, next to a plain copy of the same
+// buffer for scale.
+
+#define SIZE (64 * 1024 * 1024)
+#define ROUNDS 10
+
+static uint8_t data[SIZE];
+static uint8_t copy[SIZE];
+
+static void report(const char *name, double seconds) {
+    char label[64] = {0};
+    snprintf(label, sizeof label, "%s %.2f GB/s", name,
+             (double)SIZE / seconds / 1e9);
+    bench_report(label, seconds, SIZE);
+}
+
+int main(void) {
+    uint64_t state = 0x2545f4914f6cdd1d;
+    for (size_t i = 0; i < SIZE; i += 8) {
+        uint64_t value = bench_random(&state);
+        memcpy(data + i, &value, sizeof value);
+    }
+
+    printf("%d MiB, average of %d rounds, crc32 instruction %s\n",
+           SIZE / (1024 * 1024), ROUNDS,
+           crc32c_has_hardware_support() ? "available" : "not available");
+
+    double total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        double start = bench_now();
+        memcpy(copy, data, SIZE);
+        // Keeps the copy from being optimized out
+        __asm__ volatile("" : : "r"(copy) : "memory");
+        total += bench_now() - start;
+    }
+    report("memcpy", total / ROUNDS);
+
+    uint32_t hardware_crc = 0;
+    total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        double start = bench_now();
+        hardware_crc = crc32c_update(0, data, SIZE);
+        total += bench_now() - start;
+    }
+    report("crc32c_update", total / ROUNDS);
+
+    uint32_t software_crc = 0;
+    total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        double start = bench_now();
+        software_crc = crc32c_update_software(0, data, SIZE);
+        total += bench_now() - start;
+    }
+    report("crc32c_update_software", total / ROUNDS);
+
+    if (hardware_crc != software_crc)
+        printf("ERROR: checksums don't match\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "bench.h"
+
+#include "pool.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Allocation churn: a working set of live elements where every operation frees
+// a random one and allocates a replacement.
+
+#define ELEMENT_SIZE 72
+#define LIVE_ELEMENTS 4096
+#define OPERATIONS 10000000
+
+static void *live[LIVE_ELEMENTS];
+
+static void touch(void *element) {
+    *(volatile uint8_t *)element = 1;
+}
+
+static void bench_malloc(void) {
+    uint64_t random_state = 0x9e3779b97f4a7c15;
+    for (size_t i = 0; i < LIVE_ELEMENTS; i++)
+        live[i] = malloc(ELEMENT_SIZE);
+
+    double start = bench_now();
+    for (size_t i = 0; i < OPERATIONS; i++) {
+        size_t slot = bench_random(&random_state) % LIVE_ELEMENTS;
+        free(live[slot]);
+        live[slot] = malloc(ELEMENT_SIZE);
+        touch(live[slot]);
+    }
+    bench_report("malloc/free", bench_now() - start, OPERATIONS);
+
+    for (size_t i = 0; i < LIVE_ELEMENTS; i++)
+        free(live[i]);
+}
+
+static void bench_pool(void) {
+    uint64_t random_state = 0x9e3779b97f4a7c15;
+    Pool pool = pool_init(ELEMENT_SIZE);
+    for (size_t i = 0; i < LIVE_ELEMENTS; i++)
+        live[i] = pool_allocate(&pool);
+
+    double start = bench_now();
+    for (size_t i = 0; i < OPERATIONS; i++) {
+        size_t slot = bench_random(&random_state) % LIVE_ELEMENTS;
+        pool_release(&pool, live[slot]);
+        live[slot] = pool_allocate(&pool);
+        touch(live[slot]);
+    }
+    bench_report("pool_allocate/pool_release", bench_now() - start,
+                 OPERATIONS);
+
+    pool_free(&pool);
+}
+
+static void bench_pool_cache(void) {
+    uint64_t random_state = 0x9e3779b97f4a7c15;
+    Pool pool = pool_init(ELEMENT_SIZE);
+    static _Thread_local PoolCache cache = {0};
+    for (size_t i = 0; i < LIVE_ELEMENTS; i++)
+        live[i] = pool_cache_allocate(&cache, &pool);
+
+    double start = bench_now();
+    for (size_t i = 0; i < OPERATIONS; i++) {
+        size_t slot = bench_random(&random_state) % LIVE_ELEMENTS;
+        pool_cache_release(&cache, &pool, live[slot]);
+        live[slot] = pool_cache_allocate(&cache, &pool);
+        touch(live[slot]);
+    }
+    bench_report("pool_cache_allocate/release", bench_now() - start,
+                 OPERATIONS);
+
+    pool_cache_flush(&cache, &pool);
+    pool_free(&pool);
+}
+
+int main(void) {
+    printf("%d byte elements, %d live, %d operations\n", ELEMENT_SIZE,
+           LIVE_ELEMENTS, OPERATIONS);
+    bench_malloc();
+    bench_pool();
+    bench_pool_cache();
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "bench.h"
+
+#include "radix_sort.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Sorting 100k render keys, radix sort against qsort.
+
+#define COUNT 100000
+#define ROUNDS 50
+
+typedef struct {
+    uint64_t key;
+    uint32_t value;
+} KeyValue;
+
+static uint64_t input[COUNT];
+static uint64_t keys[COUNT];
+static uint32_t values[COUNT];
+static uint64_t keys_scratch[COUNT];
+static uint32_t values_scratch[COUNT];
+static KeyValue pairs[COUNT];
+
+static int compare_pairs(const void *a, const void *b) {
+    uint64_t key_a = ((const KeyValue *)a)->key;
+    uint64_t key_b = ((const KeyValue *)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// Render keys only use a few distinct shaders and textures in the high bits.
+static void generate_render_keys(void) {
+    uint64_t state = 0x2545f4914f6cdd1d;
+    for (size_t i = 0; i < COUNT; i++) {
+        uint64_t shader = bench_random(&state) % 4;
+        uint64_t texture = bench_random(&state) % 64;
+        uint64_t model = bench_random(&state) % 256;
+        uint64_t depth = bench_random(&state) & 0xffffff;
+        input[i] = shader << 56 | texture << 40 | model << 24 | depth;
+    }
+}
+
+static void generate_random_keys(void) {
+    uint64_t state = 0x2545f4914f6cdd1d;
+    for (size_t i = 0; i < COUNT; i++)
+        input[i] = bench_random(&state);
+}
+
+static void run(const char *name) {
+    double total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        memcpy(keys, input, sizeof keys);
+        for (size_t i = 0; i < COUNT; i++)
+            values[i] = i;
+
+        double start = bench_now();
+        radix_sort_u64(keys, values, keys_scratch, values_scratch, COUNT);
+        total += bench_now() - start;
+    }
+    char label[64] = {0};
+    snprintf(label, sizeof label, "radix_sort_u64 %s", name);
+    bench_report(label, total / ROUNDS, COUNT);
+
+    total = 0;
+    for (size_t round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < COUNT; i++)
+            pairs[i] = (KeyValue){.key = input[i], .value = i};
+
+        double start = bench_now();
+        qsort(pairs, COUNT, sizeof(KeyValue), compare_pairs);
+        total += bench_now() - start;
+    }
+    snprintf(label, sizeof label, "qsort %s", name);
+    bench_report(label, total / ROUNDS, COUNT);
+}
+
+int main(void) {
+    printf("%d keys, average of %d rounds\n", COUNT, ROUNDS);
+    generate_render_keys();
+    run("render keys");
+    generate_random_keys();
+    run("random keys");
+    return 0;
+}
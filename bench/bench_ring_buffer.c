@@ -0,0 +1,154 @@
+#include "bench.h"
+
+#include "ring_buffer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Producers push ITEMS_TOTAL items split between them while one consumer pops
+// everything, through the lock-free ring buffer and through a mutex protected
+// queue of the same capacity.
+
+#define ITEMS_TOTAL 4000000
+#define CAPACITY 1024
+#define MAX_PRODUCERS 8
+
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t data[CAPACITY];
+    size_t head;
+    size_t tail;
+} MutexQueue;
+
+typedef struct {
+    void *queue;
+    size_t items;
+    size_t batch_size;
+} ProducerArgs;
+
+static size_t mutex_queue_push_many(MutexQueue *queue, const uint64_t *items,
+                                    size_t count) {
+    pthread_mutex_lock(&queue->lock);
+    size_t pushed = 0;
+    while (pushed < count && queue->tail - queue->head < CAPACITY)
+        queue->data[queue->tail++ % CAPACITY] = items[pushed++];
+    pthread_mutex_unlock(&queue->lock);
+    return pushed;
+}
+
+static size_t mutex_queue_pop_many(MutexQueue *queue, uint64_t *out_items,
+                                   size_t max_count) {
+    pthread_mutex_lock(&queue->lock);
+    size_t popped = 0;
+    while (popped < max_count && queue->head < queue->tail)
+        out_items[popped++] = queue->data[queue->head++ % CAPACITY];
+    pthread_mutex_unlock(&queue->lock);
+    return popped;
+}
+
+static void *produce_ring(void *arg) {
+    ProducerArgs *args = arg;
+    uint64_t batch[64] = {0};
+    size_t sent = 0;
+    while (sent < args->items) {
+        size_t count = args->batch_size;
+        if (count > args->items - sent)
+            count = args->items - sent;
+        for (size_t i = 0; i < count; i++)
+            batch[i] = sent + i;
+
+        size_t pushed = ringbuf_push_many(args->queue, batch, count);
+        if (!pushed)
+            sched_yield();
+        sent += pushed;
+    }
+    return 0;
+}
+
+static void *produce_mutex(void *arg) {
+    ProducerArgs *args = arg;
+    uint64_t batch[64] = {0};
+    size_t sent = 0;
+    while (sent < args->items) {
+        size_t count = args->batch_size;
+        if (count > args->items - sent)
+            count = args->items - sent;
+        for (size_t i = 0; i < count; i++)
+            batch[i] = sent + i;
+
+        size_t pushed = mutex_queue_push_many(args->queue, batch, count);
+        if (!pushed)
+            sched_yield();
+        sent += pushed;
+    }
+    return 0;
+}
+
+static void run(const char *name, int use_ring, size_t producer_count,
+                size_t batch_size) {
+    RingBuffer ring = ringbuf_init(producer_count == 1
+                                       ? RINGBUF_SINGLE_PRODUCER
+                                       : RINGBUF_MULTI_PRODUCER,
+                                   sizeof(uint64_t), CAPACITY);
+    static MutexQueue mutex_queue;
+    memset(&mutex_queue, 0, sizeof mutex_queue);
+    pthread_mutex_init(&mutex_queue.lock, 0);
+
+    pthread_t threads[MAX_PRODUCERS];
+    ProducerArgs args[MAX_PRODUCERS];
+
+    double start = bench_now();
+    for (size_t i = 0; i < producer_count; i++) {
+        args[i] = (ProducerArgs){
+            .queue = use_ring ? (void *)&ring : (void *)&mutex_queue,
+            .items = ITEMS_TOTAL / producer_count,
+            .batch_size = batch_size,
+        };
+        pthread_create(threads + i, 0, use_ring ? produce_ring : produce_mutex,
+                       args + i);
+    }
+
+    uint64_t items[64] = {0};
+    size_t received = 0;
+    size_t expected = ITEMS_TOTAL / producer_count * producer_count;
+    while (received < expected) {
+        size_t popped = use_ring
+                            ? ringbuf_pop_many(&ring, items, batch_size)
+                            : mutex_queue_pop_many(&mutex_queue, items,
+                                                   batch_size);
+        if (!popped)
+            sched_yield();
+        received += popped;
+    }
+
+    for (size_t i = 0; i < producer_count; i++)
+        pthread_join(threads[i], 0);
+
+    char label[64] = {0};
+    snprintf(label, sizeof label, "%s %zup batch %zu", name, producer_count,
+             batch_size);
+    bench_report(label, bench_now() - start, expected);
+
+    pthread_mutex_destroy(&mutex_queue.lock);
+    ringbuf_free(&ring);
+}
+
+int main(void) {
+    printf("%d items, capacity %d\n", ITEMS_TOTAL, CAPACITY);
+
+    size_t producer_counts[] = {1, 2, 4};
+    size_t batch_sizes[] = {1, 32};
+
+    for (size_t p = 0; p < sizeof producer_counts / sizeof *producer_counts;
+         p++) {
+        for (size_t b = 0; b < sizeof batch_sizes / sizeof *batch_sizes; b++) {
+            run("ring", 1, producer_counts[p], batch_sizes[b]);
+            run("mutex", 0, producer_counts[p], batch_sizes[b]);
+        }
+    }
+
+    return 0;
+}
@@ -17,6 +17,8 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include "filesystem.h"
+#include <limits.h>
 #include <raylib.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -50,7 +52,15 @@ static inline Image aseprite_load_unlit_data(ase_t *aseprite_file) {
 }
 
 ImageData aseprite_load(const char *filepath) {
-    ase_t *aseprite_file = cute_aseprite_load_from_file(filepath, 0);
+    // Decoded straight from the mounted bundle if it has the file
+    size_t bundled_size = 0;
+    const void *bundled = filesystem_get_bundled_file(filepath, &bundled_size);
+    ase_t *aseprite_file = 0;
+    if (bundled && bundled_size <= INT_MAX)
+        aseprite_file =
+            cute_aseprite_load_from_memory(bundled, bundled_size, 0);
+    else if (!bundled)
+        aseprite_file = cute_aseprite_load_from_file(filepath, 0);
     if (!aseprite_file || aseprite_file->frame_count == 0)
         return (ImageData){0};
 
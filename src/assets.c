@@ -1,5 +1,6 @@
 #include "assets.h"
 
+#include "common.h"
 #include "filesystem.h"
 #include "string_vector.h"
 #include <assert.h>
@@ -33,6 +34,20 @@ int assets_get_handle(const char *name, AssetHandle *out_handle) {
     return 0;
 }
 
+int assets_get_lod_handle(AssetHandle handle, size_t level,
+                          AssetHandle *out_handle) {
+    char *name = assets_get_name(handle);
+    if (!name)
+        return 1;
+
+    char lod_name[MAX_PATH_LENGTH] = {0};
+    int length = snprintf(lod_name, MAX_PATH_LENGTH, "%s_lod%zu", name, level);
+    if (length < 0 || length >= MAX_PATH_LENGTH)
+        return 1;
+
+    return assets_get_handle(lod_name, out_handle);
+}
+
 size_t assets_get_count(void) {
     return asset_list.indices_used;
 }
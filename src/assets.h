@@ -14,6 +14,10 @@ void assets_fetch_all(const char *asset_directory);
 char *assets_get_name(AssetHandle handle);
 // Gets handle of asset name `name`, returns 1 if there is no such asset.
 int assets_get_handle(const char *name, AssetHandle *out_handle);
+// Gets the handle of level of detail `level` of asset `handle`, which is the
+// asset named "<name>_lod<level>". Returns 1 if there is no such asset.
+int assets_get_lod_handle(AssetHandle handle, size_t level,
+                          AssetHandle *out_handle);
 size_t assets_get_count(void);
 
 #endif
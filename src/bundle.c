@@ -0,0 +1,253 @@
+#include "bundle.h"
+
+#include "common.h"
+#include "crc32c.h"
+#include "general_buffer.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_ALIGNMENT 8
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+static const uint8_t padding[BUNDLE_ALIGNMENT];
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static inline size_t align(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// Writes zeroes up to `aligned_offset`. Returns 1 on error.
+static inline int write_padding(FILE *fp, size_t offset,
+                                size_t aligned_offset) {
+    size_t size = aligned_offset - offset;
+    return size && fwrite(padding, size, 1, fp) != 1;
+}
+
+// Appends the file at `filepath` to `fp`, which has to be exactly `size`
+// bytes. Returns 1 on error.
+static int copy_file(const char *filepath, size_t size, FILE *fp) {
+    FILE *file = fopen(filepath, "rb");
+    if (!file)
+        return 1;
+
+    static uint8_t buffer[COPY_BUFFER_SIZE];
+    size_t copied = 0;
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        copied += read;
+        if (copied > size || fwrite(buffer, read, 1, fp) != 1)
+            break;
+    }
+
+    int result = ferror(file) || copied != size;
+    fclose(file);
+    return result;
+}
+
+int bundle_build(const char *const *filepaths, size_t count, FILE *fp) {
+    if (count > UINT32_MAX)
+        return 1;
+
+    const char **sorted = malloc(max(count, 1) * sizeof(char *));
+    BundleEntry *entries = calloc(max(count, 1), sizeof(BundleEntry));
+    if (!sorted || !entries)
+        abort();
+    if (count > 0)
+        memcpy(sorted, filepaths, count * sizeof(char *));
+    qsort(sorted, count, sizeof(char *), compare_paths);
+
+    // Lays out the file from the sizes of the files, they are copied over
+    // after the header is written
+    int result = 0;
+    GeneralBuffer names = genbuf_init();
+    size_t offset = sizeof(BundleHeader);
+    for (size_t i = 0; i < count; i++) {
+        struct stat file_stat = {0};
+        if ((i > 0 && !strcmp(sorted[i - 1], sorted[i])) ||
+            stat(sorted[i], &file_stat) || !S_ISREG(file_stat.st_mode)) {
+            fprintf(stderr, "ERROR: can't add %s to bundle.\n", sorted[i]);
+            result = 1;
+            goto end;
+        }
+
+        size_t name_length = strlen(sorted[i]);
+        offset = align(offset, BUNDLE_ALIGNMENT);
+        entries[i] = (BundleEntry){
+            .offset = offset,
+            .size = file_stat.st_size,
+            .name_offset = names.data_size,
+            .name_length = name_length,
+        };
+        offset += file_stat.st_size;
+        genbuf_append(&names, (void *)sorted[i], name_length + 1);
+    }
+    if (names.data_size > UINT32_MAX) {
+        result = 1;
+        goto end;
+    }
+
+    size_t index_offset = align(offset, INDEX_ALIGNMENT);
+    size_t index_size = count * sizeof(BundleEntry);
+    BundleHeader header = {
+        .magic = BUNDLE_MAGIC,
+        .version = BUNDLE_VERSION,
+        .header_size = sizeof(BundleHeader),
+        .entry_count = count,
+        .entry_size = sizeof(BundleEntry),
+        .index_offset = index_offset,
+        .names_offset = index_offset + index_size,
+        .names_size = names.data_size,
+        .index_checksum =
+            crc32c_update(crc32c_update(0, entries, index_size), names.data,
+                          names.data_size),
+    };
+
+    if (fwrite(&header, sizeof header, 1, fp) != 1) {
+        result = 1;
+        goto end;
+    }
+    offset = sizeof header;
+    for (size_t i = 0; i < count; i++) {
+        if (write_padding(fp, offset, entries[i].offset) ||
+            copy_file(sorted[i], entries[i].size, fp)) {
+            fprintf(stderr, "ERROR: can't add %s to bundle.\n", sorted[i]);
+            result = 1;
+            goto end;
+        }
+        offset = entries[i].offset + entries[i].size;
+    }
+
+    if (write_padding(fp, offset, index_offset) ||
+        (count && fwrite(entries, index_size, 1, fp) != 1) ||
+        (names.data_size && fwrite(names.data, names.data_size, 1, fp) != 1) ||
+        fflush(fp))
+        result = 1;
+
+end:
+    genbuf_free(&names);
+    free(entries);
+    free(sorted);
+    return result;
+}
+
+static inline const BundleEntry *get_entry(const Bundle *bundle,
+                                           size_t index) {
+    return (const BundleEntry *)(bundle->entries + index * bundle->entry_size);
+}
+
+// Returns 1 if the index of `bundle` points outside of the file or isn't
+// sorted.
+static int check_index(const Bundle *bundle, size_t names_size) {
+    for (size_t i = 0; i < bundle->entry_count; i++) {
+        const BundleEntry *entry = get_entry(bundle, i);
+        if (entry->offset > bundle->size ||
+            entry->size > bundle->size - entry->offset ||
+            entry->name_offset >= names_size ||
+            entry->name_length >= names_size - entry->name_offset ||
+            bundle->names[entry->name_offset + entry->name_length] != 0)
+            return 1;
+        const char *name = bundle_get_name(bundle, i);
+        if (i > 0 && strcmp(bundle_get_name(bundle, i - 1), name) >= 0)
+            return 1;
+    }
+    return 0;
+}
+
+int bundle_open(const char *filepath, Bundle *out_bundle) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0)
+        return 1;
+    struct stat file_stat = {0};
+    if (fstat(fd, &file_stat) ||
+        (size_t)file_stat.st_size < offsetof(BundleHeader, entry_count)) {
+        close(fd);
+        return 1;
+    }
+    size_t size = file_stat.st_size;
+
+    // The mapping stays valid after the file is closed
+    void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 1;
+
+    // Fields added to the header later on are left zero for older bundles
+    BundleHeader header = {0};
+    size_t header_size = ((const BundleHeader *)data)->header_size;
+    memcpy(&header, data, min(min(header_size, sizeof header), size));
+    Bundle bundle = {
+        .data = data,
+        .size = size,
+        .entries = (const uint8_t *)data + header.index_offset,
+        .entry_count = header.entry_count,
+        .entry_size = header.entry_size,
+        .names = (const char *)data + header.names_offset,
+    };
+
+    uint64_t index_size = (uint64_t)header.entry_size * header.entry_count;
+    if (header.magic != BUNDLE_MAGIC ||
+        header.header_size < offsetof(BundleHeader, reserved) ||
+        header.header_size > size ||
+        header.entry_size < sizeof(BundleEntry) ||
+        header.entry_size % INDEX_ALIGNMENT ||
+        header.index_offset % INDEX_ALIGNMENT ||
+        header.index_offset > size || index_size > size - header.index_offset ||
+        header.names_offset > size ||
+        header.names_size > size - header.names_offset ||
+        crc32c_update(crc32c_update(0, bundle.entries, index_size),
+                      bundle.names, header.names_size) !=
+            header.index_checksum ||
+        check_index(&bundle, header.names_size)) {
+        munmap(data, size);
+        return 1;
+    }
+
+    *out_bundle = bundle;
+    return 0;
+}
+
+void bundle_close(Bundle *bundle) {
+    if (bundle->data)
+        munmap((void *)bundle->data, bundle->size);
+    *bundle = (Bundle){0};
+}
+
+const void *bundle_find(const Bundle *bundle, const char *name,
+                        size_t *out_size) {
+    size_t index = bundle_lower_bound(bundle, name);
+    if (index == bundle->entry_count ||
+        strcmp(bundle_get_name(bundle, index), name))
+        return 0;
+
+    const BundleEntry *entry = get_entry(bundle, index);
+    if (out_size)
+        *out_size = entry->size;
+    return bundle->data + entry->offset;
+}
+
+size_t bundle_lower_bound(const Bundle *bundle, const char *name) {
+    size_t low = 0;
+    size_t high = bundle->entry_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (strcmp(bundle_get_name(bundle, middle), name) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+const char *bundle_get_name(const Bundle *bundle, size_t index) {
+    return bundle->names + get_entry(bundle, index)->name_offset;
+}
@@ -0,0 +1,82 @@
+#ifndef _BUNDLE
+#define _BUNDLE
+
+/*
+Asset bundles, many files packed into one that is mapped into memory as a
+whole.
+
+Bundle file structure:
+    - A header, as described by struct `BundleHeader`.
+    - The contents of every file, each starting at a multiple of
+    `BUNDLE_ALIGNMENT`.
+    - The index, a table of `BundleEntry` records sorted by file name.
+    - The names of the files, null-terminated.
+
+Files are found by the path they were added to the bundle under, so add them
+with the paths the game would open them by, such as "assets/tree.glb".
+ */
+
+//  NOTE: IMPORTANT! Never shrink the Bundle structs, only grow.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define BUNDLE_MAGIC 0x4c444e42
+#define BUNDLE_VERSION 0
+#define BUNDLE_ALIGNMENT 64
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t entry_count;
+    uint32_t entry_size;
+    uint64_t index_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    // CRC32C of the index followed by the names
+    uint32_t index_checksum;
+    uint32_t reserved;
+} BundleHeader;
+
+typedef struct {
+    // In bytes from the start of the bundle
+    uint64_t offset;
+    uint64_t size;
+    // In bytes from the start of the names
+    uint32_t name_offset;
+    uint32_t name_length;
+} BundleEntry;
+
+// A bundle file mapped into memory.
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    const uint8_t *entries;
+    size_t entry_count;
+    size_t entry_size;
+    const char *names;
+} Bundle;
+
+// Packs the `count` files at `filepaths` into a bundle written to `fp`, each
+// found in the bundle by its path as given. Returns 1 on error, such as a file
+// that can't be read or the same path given twice.
+int bundle_build(const char *const *filepaths, size_t count, FILE *fp);
+// Maps the bundle at `filepath` into memory and checks its index. Returns 1 on
+// error.
+int bundle_open(const char *filepath, Bundle *out_bundle);
+void bundle_close(Bundle *bundle);
+// Returns the contents of file `name` inside the bundle and writes its size
+// into `out_size`, or returns 0 if the bundle doesn't have it. The contents
+// stay valid until the bundle is closed.
+const void *bundle_find(const Bundle *bundle, const char *name,
+                        size_t *out_size);
+// Returns the index of the first file whose name doesn't sort before `name`,
+// `entry_count` if there is none. Files sharing a prefix are next to each
+// other from there on.
+size_t bundle_lower_bound(const Bundle *bundle, const char *name);
+// Returns the name of file `index` of the index.
+const char *bundle_get_name(const Bundle *bundle, size_t index);
+
+#endif
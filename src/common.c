@@ -2,6 +2,7 @@
 
 #include <math.h>
 #include <raylib.h>
+#include <raymath.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -51,6 +52,177 @@ Matrix matrix_strip_position(Matrix transform) {
     return transform;
 }
 
+void matrix_decompose(Matrix transform, Vector3 *out_position,
+                      Quaternion *out_rotation, Vector3 *out_scale) {
+    Vector3 x_axis = {transform.m0, transform.m1, transform.m2};
+    Vector3 y_axis = {transform.m4, transform.m5, transform.m6};
+    Vector3 z_axis = {transform.m8, transform.m9, transform.m10};
+    Vector3 scale = {Vector3Length(x_axis), Vector3Length(y_axis),
+                     Vector3Length(z_axis)};
+    if (Vector3DotProduct(x_axis, Vector3CrossProduct(y_axis, z_axis)) < 0)
+        scale.x = -scale.x;
+
+    // Rows and columns of the rotation matrix
+    float r[3][3] = {0};
+    Vector3 axes[3] = {x_axis, y_axis, z_axis};
+    float scales[3] = {scale.x, scale.y, scale.z};
+    for (int column = 0; column < 3; column++) {
+        float inverse_scale = scales[column] != 0 ? 1 / scales[column] : 0;
+        r[0][column] = axes[column].x * inverse_scale;
+        r[1][column] = axes[column].y * inverse_scale;
+        r[2][column] = axes[column].z * inverse_scale;
+    }
+
+    // Derived from the largest of the diagonal and trace for precision
+    Quaternion rotation = {0};
+    float trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0) {
+        float s = sqrtf(trace + 1) * 2;
+        rotation = (Quaternion){(r[2][1] - r[1][2]) / s,
+                                (r[0][2] - r[2][0]) / s,
+                                (r[1][0] - r[0][1]) / s, s / 4};
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        float s = sqrtf(1 + r[0][0] - r[1][1] - r[2][2]) * 2;
+        rotation = (Quaternion){s / 4, (r[0][1] + r[1][0]) / s,
+                                (r[0][2] + r[2][0]) / s,
+                                (r[2][1] - r[1][2]) / s};
+    } else if (r[1][1] > r[2][2]) {
+        float s = sqrtf(1 + r[1][1] - r[0][0] - r[2][2]) * 2;
+        rotation = (Quaternion){(r[0][1] + r[1][0]) / s, s / 4,
+                                (r[1][2] + r[2][1]) / s,
+                                (r[0][2] - r[2][0]) / s};
+    } else {
+        float s = sqrtf(1 + r[2][2] - r[0][0] - r[1][1]) * 2;
+        rotation = (Quaternion){(r[0][2] + r[2][0]) / s,
+                                (r[1][2] + r[2][1]) / s, s / 4,
+                                (r[1][0] - r[0][1]) / s};
+    }
+
+    float length = sqrtf(rotation.x * rotation.x + rotation.y * rotation.y +
+                         rotation.z * rotation.z + rotation.w * rotation.w);
+    if (length > 0)
+        rotation = (Quaternion){rotation.x / length, rotation.y / length,
+                                rotation.z / length, rotation.w / length};
+    else
+        rotation = (Quaternion){0, 0, 0, 1};
+
+    *out_position = matrix_get_position(transform);
+    *out_rotation = rotation;
+    *out_scale = scale;
+}
+
+Matrix matrix_compose(Vector3 position, Quaternion rotation, Vector3 scale) {
+    float x = rotation.x;
+    float y = rotation.y;
+    float z = rotation.z;
+    float w = rotation.w;
+
+    return (Matrix){
+        .m0 = (1 - 2 * (y * y + z * z)) * scale.x,
+        .m1 = 2 * (x * y + z * w) * scale.x,
+        .m2 = 2 * (x * z - y * w) * scale.x,
+        .m4 = 2 * (x * y - z * w) * scale.y,
+        .m5 = (1 - 2 * (x * x + z * z)) * scale.y,
+        .m6 = 2 * (y * z + x * w) * scale.y,
+        .m8 = 2 * (x * z + y * w) * scale.z,
+        .m9 = 2 * (y * z - x * w) * scale.z,
+        .m10 = (1 - 2 * (x * x + y * y)) * scale.z,
+        .m12 = position.x,
+        .m13 = position.y,
+        .m14 = position.z,
+        .m15 = 1,
+    };
+}
+
+uint16_t float_to_half(float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof bits);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // Infinity and NaN
+    if (exponent == 0xff)
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+    int32_t half_exponent = exponent - 127 + 15;
+    if (half_exponent >= 0x1f)
+        return sign | 0x7c00;
+
+    uint32_t shift = 13;
+    uint32_t half = 0;
+    if (half_exponent > 0)
+        half = ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+    else {
+        // Subnormal half, the implicit leading bit becomes part of the
+        // mantissa
+        if (half_exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        shift = 14 - half_exponent;
+        half = mantissa >> shift;
+    }
+
+    // A carry out of the mantissa correctly moves to the next exponent
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+        half++;
+    return sign | half;
+}
+
+float half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0) {
+        // Zero or subnormal, exact in single precision
+        float value = mantissa * (1.0f / (1 << 24));
+        return sign ? -value : value;
+    }
+
+    uint32_t bits = sign | (mantissa << 13);
+    if (exponent == 0x1f)
+        bits |= 0x7f800000;
+    else
+        bits |= (exponent + 127 - 15) << 23;
+
+    float value = 0;
+    memcpy(&value, &bits, sizeof value);
+    return value;
+}
+
+BoundingBox bounding_box_transform(BoundingBox box, Matrix transform) {
+    const float rows[3][4] = {
+        {transform.m0, transform.m4, transform.m8, transform.m12},
+        {transform.m1, transform.m5, transform.m9, transform.m13},
+        {transform.m2, transform.m6, transform.m10, transform.m14},
+    };
+    const float box_min[3] = {box.min.x, box.min.y, box.min.z};
+    const float box_max[3] = {box.max.x, box.max.y, box.max.z};
+    float out_min[3] = {0};
+    float out_max[3] = {0};
+
+    // Each output axis is the translation plus the smaller and larger end of
+    // every input axis scaled by the matrix
+    for (int i = 0; i < 3; i++) {
+        out_min[i] = rows[i][3];
+        out_max[i] = rows[i][3];
+        for (int j = 0; j < 3; j++) {
+            float a = rows[i][j] * box_min[j];
+            float b = rows[i][j] * box_max[j];
+            out_min[i] += minf(a, b);
+            out_max[i] += maxf(a, b);
+        }
+    }
+
+    return (BoundingBox){
+        .min = {out_min[0], out_min[1], out_min[2]},
+        .max = {out_max[0], out_max[1], out_max[2]},
+    };
+}
+
 void strip_filename(char *filepath, size_t n) {
     size_t last_slash = 0;
     size_t length = 0;
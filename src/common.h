@@ -25,6 +25,23 @@ Matrix matrix_strip_position(Matrix transform);
 // Sets the position part of `transform` matrix.
 void matrix_set_position(Matrix *transform, Vector3 position);
 
+// Splits `transform` into a position, a unit rotation quaternion and a scale,
+// assuming it has no shear. A mirroring transform gets a negative x scale.
+void matrix_decompose(Matrix transform, Vector3 *out_position,
+                      Quaternion *out_rotation, Vector3 *out_scale);
+// Builds a transform scaling, then rotating and then moving to `position`, the
+// inverse of `matrix_decompose`.
+Matrix matrix_compose(Vector3 position, Quaternion rotation, Vector3 scale);
+
+// Converts `value` to an IEEE half precision float, rounding to nearest even.
+// Values too large for a half become infinite.
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+
+// Returns the axis-aligned box enclosing `box` after it is transformed by
+// `transform`.
+BoundingBox bounding_box_transform(BoundingBox box, Matrix transform);
+
 // Adds a null-terminator after the location of the last '/' in `filepath`, with
 // `n` as a max limit for iteration.
 void strip_filename(char *filepath, size_t n);
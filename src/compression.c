@@ -0,0 +1,339 @@
+#include "compression.h"
+
+#include "common.h"
+#include "general_buffer.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xffff
+#define LZ_HASH_BITS 12
+// Largest length that fits in half of a token byte, longer ones continue in a
+// varint
+#define LZ_TOKEN_MAX 15
+
+void compression_write_varint(GeneralBuffer *buf, size_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        genbuf_append(buf, &byte, 1);
+    } while (value);
+}
+
+size_t compression_read_varint(const uint8_t **cursor, const uint8_t *end) {
+    size_t value = 0;
+    for (size_t shift = 0; *cursor < end && shift < 64; shift += 7) {
+        uint8_t byte = *(*cursor)++;
+        value |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    return value;
+}
+
+static inline uint32_t read_u32(const uint8_t *data) {
+    uint32_t value = 0;
+    memcpy(&value, data, sizeof value);
+    return value;
+}
+
+static inline size_t hash_u32(uint32_t value) {
+    return (value * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Writes `literal_count` literals followed by a match, a `match_length` of 0
+// marks the last sequence which only has literals.
+static void write_sequence(GeneralBuffer *out, const uint8_t *literals,
+                           size_t literal_count, size_t offset,
+                           size_t match_length) {
+    size_t match_code = match_length ? match_length - LZ_MIN_MATCH : 0;
+    uint8_t token = min(literal_count, LZ_TOKEN_MAX) << 4 |
+                    min(match_code, LZ_TOKEN_MAX);
+    genbuf_append(out, &token, 1);
+    if (literal_count >= LZ_TOKEN_MAX)
+        compression_write_varint(out, literal_count - LZ_TOKEN_MAX);
+    if (literal_count)
+        genbuf_append(out, (void *)literals, literal_count);
+
+    if (!match_length)
+        return;
+
+    uint8_t offset_bytes[2] = {offset & 0xff, offset >> 8};
+    genbuf_append(out, offset_bytes, sizeof offset_bytes);
+    if (match_code >= LZ_TOKEN_MAX)
+        compression_write_varint(out, match_code - LZ_TOKEN_MAX);
+}
+
+void compression_lz_compress(const uint8_t *data, size_t size,
+                             GeneralBuffer *out) {
+    // Last position + 1 of each hashed 4 byte sequence, 0 if none
+    size_t table[1 << LZ_HASH_BITS] = {0};
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while (i + LZ_MIN_MATCH <= size) {
+        uint32_t sequence = read_u32(data + i);
+        size_t hash = hash_u32(sequence);
+        size_t candidate = table[hash];
+        table[hash] = i + 1;
+
+        if (!candidate || i - (candidate - 1) > LZ_MAX_OFFSET ||
+            read_u32(data + candidate - 1) != sequence) {
+            i++;
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t length = LZ_MIN_MATCH;
+        while (i + length < size && data[match + length] == data[i + length])
+            length++;
+
+        write_sequence(out, data + anchor, i - anchor, i - match, length);
+        i += length;
+        anchor = i;
+    }
+
+    write_sequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+int compression_lz_decompress(const uint8_t *encoded, size_t encoded_size,
+                              uint8_t *out, size_t out_size) {
+    const uint8_t *cursor = encoded;
+    const uint8_t *end = encoded + encoded_size;
+    size_t written = 0;
+
+    while (cursor < end) {
+        uint8_t token = *cursor++;
+
+        size_t literal_count = token >> 4;
+        if (literal_count == LZ_TOKEN_MAX)
+            literal_count += compression_read_varint(&cursor, end);
+        if (literal_count > (size_t)(end - cursor) ||
+            literal_count > out_size - written)
+            return 1;
+        memcpy(out + written, cursor, literal_count);
+        cursor += literal_count;
+        written += literal_count;
+
+        if (cursor == end)
+            break;
+        if (end - cursor < 2)
+            return 1;
+
+        size_t offset = cursor[0] | (size_t)cursor[1] << 8;
+        cursor += 2;
+        size_t length = token & LZ_TOKEN_MAX;
+        if (length == LZ_TOKEN_MAX)
+            length += compression_read_varint(&cursor, end);
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > written || length > out_size - written)
+            return 1;
+
+        uint8_t *target = out + written;
+        const uint8_t *match = target - offset;
+        if (offset >= length)
+            memcpy(target, match, length);
+        else {
+            // Overlapping match, repeats the last `offset` bytes
+            for (size_t j = 0; j < length; j++)
+                target[j] = match[j];
+        }
+        written += length;
+    }
+
+    return written != out_size;
+}
+
+// Predicts the value at `x`, `y` of a `width` wide grid from its already
+// decoded neighbours.
+static inline int32_t predict_height(const int32_t *grid, uint32_t width,
+                                     size_t x, size_t y) {
+    size_t i = y * width + x;
+    if (y == 0)
+        return x ? grid[i - 1] : 0;
+    if (x == 0)
+        return grid[i - width];
+    // Wraps like the differences do, so any int32 grid roundtrips
+    return (int32_t)((uint32_t)grid[i - 1] + (uint32_t)grid[i - width] -
+                     (uint32_t)grid[i - width - 1]);
+}
+
+static inline int32_t quantize_height(float height) {
+    float steps = height / COMPRESSION_HEIGHT_STEP;
+    if (!(steps > INT32_MIN))
+        return INT32_MIN;
+    if (steps >= (float)INT32_MAX)
+        return INT32_MAX;
+    return (int32_t)lrintf(steps);
+}
+
+void compression_encode_heights(const float *heights, uint32_t width,
+                                GeneralBuffer *out) {
+    size_t count = (size_t)width * width;
+    int32_t *grid = malloc(count * sizeof(int32_t));
+    uint8_t *planes = malloc(count * sizeof(int32_t));
+    if ((!grid || !planes) && count > 0)
+        abort();
+
+    for (size_t i = 0; i < count; i++)
+        grid[i] = quantize_height(heights[i]);
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t delta =
+            (uint32_t)grid[i] -
+            (uint32_t)predict_height(grid, width, i % width, i / width);
+        // Zigzag, small negative differences get small codes too
+        uint32_t code = delta << 1 ^ (uint32_t)-(delta >> 31);
+
+        for (size_t byte = 0; byte < sizeof code; byte++)
+            planes[byte * count + i] = code >> (byte * 8);
+    }
+
+    compression_lz_compress(planes, count * sizeof(int32_t), out);
+    free(planes);
+    free(grid);
+}
+
+static inline int32_t read_difference(const uint8_t *planes, size_t count,
+                                      size_t i) {
+    uint32_t code = (uint32_t)planes[i] | (uint32_t)planes[count + i] << 8 |
+                    (uint32_t)planes[count * 2 + i] << 16 |
+                    (uint32_t)planes[count * 3 + i] << 24;
+    return (int32_t)(code >> 1 ^ (uint32_t)-(code & 1));
+}
+
+int compression_decode_heights(const uint8_t *encoded, size_t encoded_size,
+                               float *out_heights, uint32_t width) {
+    size_t count = (size_t)width * width;
+    uint8_t *planes = malloc(count * sizeof(int32_t));
+    // Quantized values of the previous and the current row
+    uint32_t *rows = malloc(width * 2 * sizeof(uint32_t));
+    if ((!planes || !rows) && count > 0)
+        abort();
+
+    if (compression_lz_decompress(encoded, encoded_size, planes,
+                                  count * sizeof(int32_t))) {
+        free(rows);
+        free(planes);
+        return 1;
+    }
+
+    uint32_t *above = rows;
+    uint32_t *row = rows + width;
+    uint32_t value = 0;
+    for (size_t x = 0; x < width; x++) {
+        value += read_difference(planes, count, x);
+        row[x] = value;
+        out_heights[x] = (float)(int32_t)value * COMPRESSION_HEIGHT_STEP;
+    }
+
+    // Same predictions as predict_height, without the branches
+    for (size_t y = 1; y < width; y++) {
+        uint32_t *swap = above;
+        above = row;
+        row = swap;
+
+        size_t i = y * width;
+        row[0] = above[0] + read_difference(planes, count, i);
+        out_heights[i] = (float)(int32_t)row[0] * COMPRESSION_HEIGHT_STEP;
+        for (size_t x = 1; x < width; x++) {
+            row[x] = row[x - 1] + above[x] - above[x - 1] +
+                     read_difference(planes, count, i + x);
+            out_heights[i + x] =
+                (float)(int32_t)row[x] * COMPRESSION_HEIGHT_STEP;
+        }
+    }
+
+    free(rows);
+    free(planes);
+    return 0;
+}
+
+void compression_rle_encode(const uint8_t *data, size_t size,
+                            GeneralBuffer *out) {
+    size_t i = 0;
+    while (i < size) {
+        uint8_t value = data[i];
+        size_t run = 1;
+        while (i + run < size && data[i + run] == value)
+            run++;
+
+        compression_write_varint(out, run);
+        genbuf_append(out, &value, 1);
+        i += run;
+    }
+}
+
+int compression_rle_decode(const uint8_t *encoded, size_t encoded_size,
+                           uint8_t *out, size_t out_size) {
+    const uint8_t *cursor = encoded;
+    const uint8_t *end = encoded + encoded_size;
+    size_t written = 0;
+
+    while (cursor < end) {
+        size_t run = compression_read_varint(&cursor, end);
+        if (cursor == end || run > out_size - written)
+            return 1;
+        memset(out + written, *cursor++, run);
+        written += run;
+    }
+
+    return written != out_size;
+}
+
+#define QUATERNION_MAX_COMPONENT 0.70710678f
+#define QUATERNION_STEPS ((1u << COMPRESSION_QUATERNION_BITS) - 1)
+
+void compression_encode_quaternion(Quaternion rotation,
+                                   uint16_t out_components[3],
+                                   uint8_t *out_largest) {
+    float components[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+    uint8_t largest = 0;
+    for (uint8_t i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largest]))
+            largest = i;
+    }
+
+    // The negated quaternion is the same rotation, negating it when the
+    // largest component is negative means only its magnitude is needed
+    float sign = components[largest] < 0 ? -1 : 1;
+    size_t out_index = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        float normalized = (components[i] * sign + QUATERNION_MAX_COMPONENT) /
+                           (2 * QUATERNION_MAX_COMPONENT);
+        normalized = minf(maxf(normalized, 0), 1);
+        out_components[out_index++] = lroundf(normalized * QUATERNION_STEPS);
+    }
+    *out_largest = largest;
+}
+
+Quaternion compression_decode_quaternion(const uint16_t components[3],
+                                         uint8_t largest) {
+    const float step = 2 * QUATERNION_MAX_COMPONENT / QUATERNION_STEPS;
+    float a = (components[0] & QUATERNION_STEPS) * step -
+              QUATERNION_MAX_COMPONENT;
+    float b = (components[1] & QUATERNION_STEPS) * step -
+              QUATERNION_MAX_COMPONENT;
+    float c = (components[2] & QUATERNION_STEPS) * step -
+              QUATERNION_MAX_COMPONENT;
+    float sum_of_squares = a * a + b * b + c * c;
+    float d = sum_of_squares < 1 ? sqrtf(1 - sum_of_squares) : 0;
+
+    switch (largest & 3) {
+    case 0:
+        return (Quaternion){d, a, b, c};
+    case 1:
+        return (Quaternion){a, d, b, c};
+    case 2:
+        return (Quaternion){a, b, d, c};
+    default:
+        return (Quaternion){a, b, c, d};
+    }
+}
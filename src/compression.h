@@ -0,0 +1,74 @@
+#ifndef _COMPRESSION
+#define _COMPRESSION
+
+/*
+Encodings for scene file sections.
+
+The LZ compressor is a small byte oriented LZ77 variant in the spirit of LZ4:
+a stream of sequences, each a token byte holding a literal length and a match
+length, followed by the literals and a 16-bit match offset. It favors decoding
+speed over ratio.
+
+Heights are quantized to steps of `COMPRESSION_HEIGHT_STEP` and each one is
+stored as the difference to a prediction made from its left, upper and upper
+left neighbours. The bytes of the differences are split into separate planes
+before LZ compression, so the mostly zero high bytes turn into long matches.
+
+Rotations are stored as the three smallest components of a unit quaternion,
+the largest one follows from the quaternion having a length of one. The three
+are within +-1/sqrt(2) and quantized to `COMPRESSION_QUATERNION_BITS` each.
+ */
+
+#include "general_buffer.h"
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Heights decoded with `compression_decode_heights` are within half of this
+// of the original heights.
+#define COMPRESSION_HEIGHT_STEP (1.0f / 1024.0f)
+#define COMPRESSION_QUATERNION_BITS 15
+
+// Appends `value` to `buf` as a LEB128 varint.
+void compression_write_varint(GeneralBuffer *buf, size_t value);
+// Reads a varint at `cursor` and advances it, never reading past `end`.
+size_t compression_read_varint(const uint8_t **cursor, const uint8_t *end);
+
+// Appends the LZ compressed `size` bytes of `data` to `out`.
+void compression_lz_compress(const uint8_t *data, size_t size,
+                             GeneralBuffer *out);
+// Decompresses `encoded` into exactly `out_size` bytes of `out`. Returns 1 if
+// the data is malformed or doesn't decompress to `out_size` bytes.
+int compression_lz_decompress(const uint8_t *encoded, size_t encoded_size,
+                              uint8_t *out, size_t out_size);
+
+// Appends a `width` by `width` grid of quantized, delta coded and LZ
+// compressed heights to `out`.
+void compression_encode_heights(const float *heights, uint32_t width,
+                                GeneralBuffer *out);
+// Decodes a `width` by `width` grid of heights encoded with
+// `compression_encode_heights` into `out_heights`. Returns 1 on error.
+int compression_decode_heights(const uint8_t *encoded, size_t encoded_size,
+                               float *out_heights, uint32_t width);
+
+// Appends `size` bytes of `data` to `out` as runs of a varint length and a
+// byte value.
+void compression_rle_encode(const uint8_t *data, size_t size,
+                            GeneralBuffer *out);
+// Decodes exactly `out_size` bytes of run length encoded data into `out`.
+// Returns 1 on error.
+int compression_rle_decode(const uint8_t *encoded, size_t encoded_size,
+                           uint8_t *out, size_t out_size);
+
+// Quantizes the three smallest components of unit quaternion `rotation` into
+// `out_components`, the index of the dropped largest one is written to
+// `out_largest`.
+void compression_encode_quaternion(Quaternion rotation,
+                                   uint16_t out_components[3],
+                                   uint8_t *out_largest);
+// Rebuilds a unit quaternion from `compression_encode_quaternion` output. The
+// result may be the negation of the original, which is the same rotation.
+Quaternion compression_decode_quaternion(const uint16_t components[3],
+                                         uint8_t largest);
+
+#endif
@@ -0,0 +1,190 @@
+#include "crc32c.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define HAS_SSE42_PATH 1
+#else
+#define HAS_SSE42_PATH 0
+#endif
+
+// Reflected Castagnoli polynomial
+#define POLYNOMIAL 0x82f63b78
+// Block sizes of the three interleaved streams in the hardware version. The
+// crc32 instruction has a latency of 3 cycles but can start one every cycle,
+// so three independent streams keep it busy.
+#define LONG_BLOCK 8192
+#define SHORT_BLOCK 256
+
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static uint32_t table[8][256];
+// Advance a CRC over LONG_BLOCK or SHORT_BLOCK zero bytes
+static uint32_t long_shift_table[4][256];
+static uint32_t short_shift_table[4][256];
+static int is_hardware_supported = 0;
+
+// Multiplies `vector` by the GF(2) 32x32 matrix `matrix`.
+static uint32_t matrix_times(const uint32_t *matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    for (; vector; vector >>= 1, matrix++) {
+        if (vector & 1)
+            sum ^= *matrix;
+    }
+    return sum;
+}
+
+static void matrix_square(uint32_t *out_square, const uint32_t *matrix) {
+    for (int n = 0; n < 32; n++)
+        out_square[n] = matrix_times(matrix, matrix[n]);
+}
+
+// Builds the tables that advance a CRC over `size` zero bytes, by squaring
+// the zeros_operator for one zero bit.
+static void init_shift_table(uint32_t shift_table[4][256], size_t size) {
+    uint32_t even[32] = {0};
+    uint32_t odd[32] = {0};
+
+    odd[0] = POLYNOMIAL;
+    for (int n = 1; n < 32; n++)
+        odd[n] = 1u << (n - 1);
+    // Two, then four zero bits
+    matrix_square(even, odd);
+    matrix_square(odd, even);
+
+    // Each square doubles the zero bits, starting from one byte
+    uint32_t *zeros_operator = odd;
+    do {
+        matrix_square(even, odd);
+        zeros_operator = even;
+        size >>= 1;
+        if (!size)
+            break;
+        matrix_square(odd, even);
+        zeros_operator = odd;
+        size >>= 1;
+    } while (size);
+
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int byte = 0; byte < 4; byte++)
+            shift_table[byte][n] =
+                matrix_times(zeros_operator, n << (byte * 8));
+    }
+}
+
+static inline uint32_t shift(uint32_t shift_table[4][256], uint32_t crc) {
+    return shift_table[0][crc & 0xff] ^ shift_table[1][crc >> 8 & 0xff] ^
+           shift_table[2][crc >> 16 & 0xff] ^ shift_table[3][crc >> 24];
+}
+
+static void init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = crc & 1 ? crc >> 1 ^ POLYNOMIAL : crc >> 1;
+        table[0][i] = crc;
+    }
+    // table[n] advances a byte through n more zero bytes
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int n = 1; n < 8; n++)
+            table[n][i] =
+                table[n - 1][i] >> 8 ^ table[0][table[n - 1][i] & 0xff];
+    }
+
+    init_shift_table(long_shift_table, LONG_BLOCK);
+    init_shift_table(short_shift_table, SHORT_BLOCK);
+
+#if HAS_SSE42_PATH
+    __builtin_cpu_init();
+    is_hardware_supported = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static uint32_t update_software(uint32_t crc, const uint8_t *data,
+                                size_t size) {
+    while (size >= 8) {
+        uint64_t word = 0;
+        memcpy(&word, data, sizeof word);
+        // Little endian only, as is the rest of the scene file code
+        word ^= crc;
+        crc = table[7][word & 0xff] ^ table[6][word >> 8 & 0xff] ^
+              table[5][word >> 16 & 0xff] ^ table[4][word >> 24 & 0xff] ^
+              table[3][word >> 32 & 0xff] ^ table[2][word >> 40 & 0xff] ^
+              table[1][word >> 48 & 0xff] ^ table[0][word >> 56];
+        data += 8;
+        size -= 8;
+    }
+    while (size--)
+        crc = crc >> 8 ^ table[0][(crc ^ *data++) & 0xff];
+    return crc;
+}
+
+#if HAS_SSE42_PATH
+__attribute__((target("sse4.2"))) static inline uint64_t
+crc_word(uint64_t crc, const uint8_t *data) {
+    uint64_t word = 0;
+    memcpy(&word, data, sizeof word);
+    return _mm_crc32_u64(crc, word);
+}
+
+// Runs three streams over consecutive blocks of `block_size` and joins them,
+// while there are enough bytes left.
+__attribute__((target("sse4.2"))) static inline uint32_t
+update_interleaved(uint32_t crc, const uint8_t **data, size_t *size,
+                   size_t block_size, uint32_t shift_table[4][256]) {
+    while (*size >= block_size * 3) {
+        const uint8_t *next = *data;
+        const uint8_t *end = next + block_size;
+        uint64_t crc0 = crc;
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        for (; next < end; next += 8) {
+            crc0 = crc_word(crc0, next);
+            crc1 = crc_word(crc1, next + block_size);
+            crc2 = crc_word(crc2, next + block_size * 2);
+        }
+        crc = shift(shift_table, (uint32_t)crc0) ^ (uint32_t)crc1;
+        crc = shift(shift_table, crc) ^ (uint32_t)crc2;
+        *data += block_size * 3;
+        *size -= block_size * 3;
+    }
+    return crc;
+}
+
+__attribute__((target("sse4.2"))) static uint32_t
+update_hardware(uint32_t crc, const uint8_t *data, size_t size) {
+    crc = update_interleaved(crc, &data, &size, LONG_BLOCK, long_shift_table);
+    crc =
+        update_interleaved(crc, &data, &size, SHORT_BLOCK, short_shift_table);
+
+    uint64_t crc64 = crc;
+    for (; size >= 8; data += 8, size -= 8)
+        crc64 = crc_word(crc64, data);
+    crc = (uint32_t)crc64;
+    while (size--)
+        crc = _mm_crc32_u8(crc, *data++);
+    return crc;
+}
+#endif
+
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t size) {
+    pthread_once(&init_once, init);
+#if HAS_SSE42_PATH
+    if (is_hardware_supported)
+        return ~update_hardware(~crc, data, size);
+#endif
+    return ~update_software(~crc, data, size);
+}
+
+uint32_t crc32c_update_software(uint32_t crc, const void *data, size_t size) {
+    pthread_once(&init_once, init);
+    return ~update_software(~crc, data, size);
+}
+
+int crc32c_has_hardware_support(void) {
+    pthread_once(&init_once, init);
+    return is_hardware_supported;
+}
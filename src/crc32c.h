@@ -0,0 +1,19 @@
+#ifndef _CRC32C
+#define _CRC32C
+
+// CRC-32C (Castagnoli) checksums, computed with the SSE4.2 crc32 instruction
+// when the CPU has it and with a slicing-by-8 table otherwise.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns the checksum of `crc`'s data followed by `size` bytes of `data`.
+// Start with a `crc` of 0, the result of one call can be passed to the next to
+// checksum data in pieces.
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t size);
+// Same as `crc32c_update`, always using the table implementation.
+uint32_t crc32c_update_software(uint32_t crc, const void *data, size_t size);
+// Returns 1 if `crc32c_update` uses the crc32 instruction.
+int crc32c_has_hardware_support(void);
+
+#endif
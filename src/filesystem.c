@@ -1,12 +1,52 @@
 #include "filesystem.h"
 
+#include "bundle.h"
 #include "common.h"
 #include <dirent.h>
 #include <stdio.h>
 #include <string.h>
 
+static Bundle bundle = {0};
+
+// Inserts the files of the mounted bundle directly inside `directory` that end
+// with `suffix` into `destination`. Returns 1 if the bundle doesn't have any
+// files in `directory`.
+static int get_bundled_basenames_with_suffix(const char *directory,
+                                             StringVector *destination,
+                                             const char *suffix) {
+    if (!bundle.data)
+        return 1;
+
+    char prefix[MAX_PATH_LENGTH] = {0};
+    size_t prefix_length = strlen(directory);
+    if (prefix_length + 2 > MAX_PATH_LENGTH)
+        return 1;
+    memcpy(prefix, directory, prefix_length);
+    if (prefix_length > 0 && prefix[prefix_length - 1] != '/')
+        prefix[prefix_length++] = '/';
+
+    // Files in the same directory are next to each other in the sorted index
+    int is_found = 0;
+    for (size_t i = bundle_lower_bound(&bundle, prefix);
+         i < bundle.entry_count; i++) {
+        const char *name = bundle_get_name(&bundle, i);
+        if (strncmp(name, prefix, prefix_length))
+            break;
+        is_found = 1;
+
+        const char *filename = name + prefix_length;
+        if (!strchr(filename, '/') && has_suffix(filename, suffix))
+            stringvec_append(destination, (char *)filename,
+                             strlen(filename) - strlen(suffix));
+    }
+    return !is_found;
+}
+
 void get_basenames_with_suffix(const char *directory, StringVector *destination,
                                const char *suffix) {
+    if (!get_bundled_basenames_with_suffix(directory, destination, suffix))
+        return;
+
     DIR *d;
     struct dirent *dir;
     d = opendir(directory);
@@ -25,3 +65,23 @@ void get_basenames_with_suffix(const char *directory, StringVector *destination,
 
     return;
 }
+
+int filesystem_mount_bundle(const char *filepath) {
+    filesystem_unmount_bundle();
+    if (bundle_open(filepath, &bundle)) {
+        fprintf(stderr, "ERROR: could not open bundle %s\n", filepath);
+        return 1;
+    }
+    return 0;
+}
+
+void filesystem_unmount_bundle(void) {
+    bundle_close(&bundle);
+}
+
+const void *filesystem_get_bundled_file(const char *filepath,
+                                        size_t *out_size) {
+    if (!bundle.data)
+        return 0;
+    return bundle_find(&bundle, filepath, out_size);
+}
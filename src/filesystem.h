@@ -2,10 +2,24 @@
 #define _FILESYSTEM
 
 #include "string_vector.h"
+#include <stddef.h>
 
 // Inserts a list of filenames (without extension) of all files in `directory`
 // that end with `suffix` into the StringVector `destination`.
+// If a bundle is mounted and has files in `directory` they are listed instead.
 void get_basenames_with_suffix(const char *directory, StringVector *destination,
                                const char *suffix);
 
+// Mounts the asset bundle at `filepath` (see bundle.h), files in it are read
+// from the bundle instead of the filesystem until it is unmounted. Mount it
+// before anything is loaded, the mounted bundle is read from worker threads.
+// Returns 1 on error.
+int filesystem_mount_bundle(const char *filepath);
+void filesystem_unmount_bundle(void);
+// Returns the contents of the file at `filepath` in the mounted bundle and
+// writes its size into `out_size`, or returns 0 if there is no such file or no
+// bundle is mounted.
+const void *filesystem_get_bundled_file(const char *filepath,
+                                        size_t *out_size);
+
 #endif
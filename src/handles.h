@@ -4,9 +4,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
-typedef uint16_t LightSourceHandle;
+// Light source and model handles are slot map handles, see slotmap.h.
+typedef uint64_t LightSourceHandle;
 typedef size_t EntityHandle;
-typedef size_t ModelHandle;
+typedef uint64_t ModelHandle;
 typedef size_t AssetHandle;
 typedef size_t SkyboxHandle;
 typedef size_t TerrainTextureHandle;
@@ -0,0 +1,521 @@
+#include "journal.h"
+
+#include "common.h"
+#include "compression.h"
+#include "general_buffer.h"
+#include "lighting.h"
+#include "scene.h"
+#include "terrain.h"
+#include <assert.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STARTING_SIZE 16
+#define GROWTH_FACTOR 2
+#define MATRIX_FIELDS 16
+
+typedef struct {
+    JournalRecordKind kind;
+    uint32_t group;
+    // Size of the whole allocation, data included.
+    size_t size;
+    union {
+        struct {
+            EntityHandle handle;
+            // Id of the entity, records of entities that have since been
+            // removed are skipped.
+            uint64_t id;
+            // Bit i is set if field i of the matrix changed.
+            uint16_t changed_fields;
+        } transform;
+        struct {
+            LightSourceHandle handle;
+        } light;
+        struct {
+            uint32_t x;
+            uint32_t y;
+            uint32_t width;
+            uint32_t height;
+            // Encoded size of the heights, the texture indices follow.
+            size_t heights_size;
+        } terrain;
+    };
+    uint8_t data[];
+} JournalRecord;
+
+// Records form a ring starting from `first`, of which the first `applied` are
+// currently applied and can be undone, and the rest can be redone.
+static JournalRecord **records = 0;
+static size_t records_allocated = 0;
+static size_t records_first = 0;
+static size_t records_count = 0;
+static size_t records_applied = 0;
+
+static size_t memory_used = 0;
+static size_t memory_cap = 0;
+
+static uint32_t next_group = 0;
+static uint32_t current_group = 0;
+static size_t group_depth = 0;
+
+// Terrain data of the rectangle being edited, from journal_begin_terrain_edit.
+static int is_editing_terrain = 0;
+static uint32_t edit_x = 0;
+static uint32_t edit_y = 0;
+static uint32_t edit_width = 0;
+static uint32_t edit_height = 0;
+static float *edit_heights = 0;
+static uint8_t *edit_texture_indices = 0;
+
+static inline JournalRecord **record_at(size_t index) {
+    return records + (records_first + index) % records_allocated;
+}
+
+static void drop_first_record(void) {
+    JournalRecord *record = *record_at(0);
+    memory_used -= record->size;
+    free(record);
+
+    records_first = (records_first + 1) % records_allocated;
+    records_count--;
+    if (records_applied)
+        records_applied--;
+}
+
+static void drop_redo_records(void) {
+    while (records_count > records_applied) {
+        JournalRecord *record = *record_at(records_count - 1);
+        memory_used -= record->size;
+        free(record);
+        records_count--;
+    }
+}
+
+static void push_record(JournalRecord *record) {
+    drop_redo_records();
+
+    if (records_count >= records_allocated) {
+        size_t allocated = records_allocated
+                               ? records_allocated * GROWTH_FACTOR
+                               : STARTING_SIZE;
+        JournalRecord **new_records = malloc(allocated * sizeof(*records));
+        if (!new_records)
+            abort();
+        for (size_t i = 0; i < records_count; i++)
+            new_records[i] = *record_at(i);
+
+        free(records);
+        records = new_records;
+        records_allocated = allocated;
+        records_first = 0;
+    }
+
+    record->group = group_depth ? current_group : next_group++;
+    *record_at(records_count++) = record;
+    records_applied = records_count;
+    memory_used += record->size;
+
+    // The newest record is kept even if it alone is over the cap
+    while (memory_used > memory_cap && records_count > 1)
+        drop_first_record();
+}
+
+static JournalRecord *allocate_record(JournalRecordKind kind,
+                                      size_t data_size) {
+    size_t size = sizeof(JournalRecord) + data_size;
+    JournalRecord *record = malloc(size);
+    if (!record)
+        abort();
+    *record = (JournalRecord){.kind = kind, .size = size};
+    return record;
+}
+
+// Appends `a` XOR `b` to `out`, as pairs of an unchanged byte count and a
+// changed byte count followed by the XOR of the changed bytes. Trailing
+// unchanged bytes are left out.
+static void encode_xor(const uint8_t *a, const uint8_t *b, size_t size,
+                       GeneralBuffer *out) {
+    size_t i = 0;
+    while (i < size) {
+        size_t unchanged = 0;
+        while (i + unchanged < size && a[i + unchanged] == b[i + unchanged])
+            unchanged++;
+        i += unchanged;
+        if (i >= size)
+            break;
+
+        size_t changed = 0;
+        while (i + changed < size && a[i + changed] != b[i + changed])
+            changed++;
+
+        compression_write_varint(out, unchanged);
+        compression_write_varint(out, changed);
+        for (size_t j = 0; j < changed; j++, i++) {
+            uint8_t byte = a[i] ^ b[i];
+            genbuf_append(out, &byte, 1);
+        }
+    }
+}
+
+// XORs data encoded with encode_xor into `target`.
+static void apply_xor(const uint8_t *encoded, size_t encoded_size,
+                      uint8_t *target, size_t target_size) {
+    const uint8_t *cursor = encoded;
+    const uint8_t *end = encoded + encoded_size;
+    size_t i = 0;
+
+    while (cursor < end) {
+        i += compression_read_varint(&cursor, end);
+        size_t changed = compression_read_varint(&cursor, end);
+        for (size_t j = 0; j < changed && cursor < end; j++, i++) {
+            if (i < target_size)
+                target[i] ^= *cursor;
+            cursor++;
+        }
+    }
+}
+
+// Follows entities to their new handles.
+static void on_entities_moved(const EntityHandle *handle_mapping, size_t count,
+                              void *_unused) {
+    (void)_unused;
+    for (size_t i = 0; i < records_count; i++) {
+        JournalRecord *record = *record_at(i);
+        if (record->kind != JOURNAL_RECORD_TRANSFORM)
+            continue;
+        EntityHandle handle = record->transform.handle;
+        record->transform.handle =
+            handle < count ? handle_mapping[handle] : SCENE_ENTITY_HANDLE_NONE;
+    }
+}
+
+static const SceneEntityListener entity_listener = {
+    .entities_moved = on_entities_moved,
+};
+
+void journal_init(size_t cap) {
+    journal_free();
+    memory_cap = cap;
+    int result = scene_add_entity_listener(entity_listener);
+    assert(!result);
+    (void)result;
+}
+
+void journal_clear(void) {
+    records_applied = 0;
+    drop_redo_records();
+    records_first = 0;
+}
+
+void journal_free(void) {
+    scene_remove_entity_listener(entity_listener);
+    journal_clear();
+    free(records);
+    free(edit_heights);
+    free(edit_texture_indices);
+    records = 0;
+    records_allocated = 0;
+    edit_heights = 0;
+    edit_texture_indices = 0;
+    is_editing_terrain = 0;
+    group_depth = 0;
+}
+
+void journal_begin_group(void) {
+    if (group_depth++ == 0)
+        current_group = next_group++;
+}
+
+void journal_end_group(void) {
+    assert(group_depth);
+    group_depth--;
+}
+
+void journal_record_transform(EntityHandle handle, Matrix before,
+                              Matrix after) {
+    uint32_t before_fields[MATRIX_FIELDS] = {0};
+    uint32_t after_fields[MATRIX_FIELDS] = {0};
+    memcpy(before_fields, &before, sizeof(before_fields));
+    memcpy(after_fields, &after, sizeof(after_fields));
+
+    uint16_t changed_fields = 0;
+    size_t changed_count = 0;
+    for (size_t i = 0; i < MATRIX_FIELDS; i++) {
+        if (before_fields[i] != after_fields[i]) {
+            changed_fields |= 1 << i;
+            changed_count++;
+        }
+    }
+    if (!changed_fields)
+        return;
+
+    JournalRecord *record = allocate_record(JOURNAL_RECORD_TRANSFORM,
+                                            changed_count * sizeof(uint32_t));
+    Entity *entity = scene_get_entity(handle);
+    record->transform.handle = handle;
+    record->transform.id = entity ? entity->id : 0;
+    record->transform.changed_fields = changed_fields;
+
+    uint32_t *deltas = (uint32_t *)record->data;
+    for (size_t i = 0; i < MATRIX_FIELDS; i++) {
+        if (changed_fields & (1 << i))
+            *deltas++ = before_fields[i] ^ after_fields[i];
+    }
+
+    push_record(record);
+}
+
+void journal_record_light(LightSourceHandle handle, LightSource before,
+                          LightSource after) {
+    GeneralBuffer encoded = genbuf_init();
+    encode_xor((uint8_t *)&before, (uint8_t *)&after, sizeof(LightSource),
+               &encoded);
+
+    if (encoded.data_size) {
+        JournalRecord *record =
+            allocate_record(JOURNAL_RECORD_LIGHT, encoded.data_size);
+        record->light.handle = handle;
+        memcpy(record->data, encoded.data, encoded.data_size);
+        push_record(record);
+    }
+
+    genbuf_free(&encoded);
+}
+
+// Clamps the rectangle to the terrain, returns 1 if nothing is left of it.
+static int clamp_terrain_rectangle(uint32_t x, uint32_t y, uint32_t *width,
+                                   uint32_t *height) {
+    if (!terrain.heights || x >= terrain.width || y >= terrain.width)
+        return 1;
+    *width = min(*width, terrain.width - x);
+    *height = min(*height, terrain.width - y);
+    return !*width || !*height;
+}
+
+// Copies the terrain data of a rectangle into contiguous arrays, or back into
+// the terrain if `to_terrain` is set.
+static void copy_terrain_rectangle(uint32_t x, uint32_t y, uint32_t width,
+                                   uint32_t height, float *heights,
+                                   uint8_t *texture_indices, int to_terrain) {
+    for (uint32_t row = 0; row < height; row++) {
+        size_t terrain_offset = (size_t)(y + row) * terrain.width + x;
+        size_t offset = (size_t)row * width;
+
+        if (to_terrain) {
+            memcpy(terrain.heights + terrain_offset, heights + offset,
+                   width * sizeof(float));
+            memcpy(terrain.texture_indices + terrain_offset,
+                   texture_indices + offset, width);
+        } else {
+            memcpy(heights + offset, terrain.heights + terrain_offset,
+                   width * sizeof(float));
+            memcpy(texture_indices + offset,
+                   terrain.texture_indices + terrain_offset, width);
+        }
+    }
+}
+
+void journal_begin_terrain_edit(uint32_t x, uint32_t y, uint32_t width,
+                                uint32_t height) {
+    assert(!is_editing_terrain);
+    if (clamp_terrain_rectangle(x, y, &width, &height))
+        return;
+
+    size_t size = (size_t)width * height;
+    edit_heights = realloc(edit_heights, size * sizeof(float));
+    edit_texture_indices = realloc(edit_texture_indices, size);
+    if (!edit_heights || !edit_texture_indices)
+        abort();
+
+    copy_terrain_rectangle(x, y, width, height, edit_heights,
+                           edit_texture_indices, 0);
+    edit_x = x;
+    edit_y = y;
+    edit_width = width;
+    edit_height = height;
+    is_editing_terrain = 1;
+}
+
+void journal_end_terrain_edit(void) {
+    if (!is_editing_terrain)
+        return;
+    is_editing_terrain = 0;
+
+    size_t size = (size_t)edit_width * edit_height;
+    float *heights = malloc(size * sizeof(float));
+    uint8_t *texture_indices = malloc(size);
+    if (!heights || !texture_indices)
+        abort();
+    copy_terrain_rectangle(edit_x, edit_y, edit_width, edit_height, heights,
+                           texture_indices, 0);
+
+    GeneralBuffer encoded = genbuf_init();
+    encode_xor((uint8_t *)edit_heights, (uint8_t *)heights,
+               size * sizeof(float), &encoded);
+    size_t heights_size = encoded.data_size;
+    encode_xor(edit_texture_indices, texture_indices, size, &encoded);
+
+    // Edited in place between begin and end
+    if (encoded.data_size) {
+        terrain_mark_dirty(edit_x, edit_y, edit_width, edit_height);
+        JournalRecord *record =
+            allocate_record(JOURNAL_RECORD_TERRAIN, encoded.data_size);
+        record->terrain.x = edit_x;
+        record->terrain.y = edit_y;
+        record->terrain.width = edit_width;
+        record->terrain.height = edit_height;
+        record->terrain.heights_size = heights_size;
+        memcpy(record->data, encoded.data, encoded.data_size);
+        push_record(record);
+    }
+
+    genbuf_free(&encoded);
+    free(heights);
+    free(texture_indices);
+}
+
+static void apply_transform_record(JournalRecord *record) {
+    Entity *entity = scene_get_entity_by_id(record->transform.handle,
+                                            record->transform.id);
+    if (!entity)
+        return;
+
+    uint32_t fields[MATRIX_FIELDS] = {0};
+    memcpy(fields, &entity->transform, sizeof(fields));
+
+    uint32_t *deltas = (uint32_t *)record->data;
+    for (size_t i = 0; i < MATRIX_FIELDS; i++) {
+        if (record->transform.changed_fields & (1 << i))
+            fields[i] ^= *deltas++;
+    }
+
+    Matrix transform = {0};
+    memcpy(&transform, fields, sizeof(fields));
+    scene_set_entity_transform(record->transform.handle, transform);
+}
+
+static void apply_light_record(JournalRecord *record) {
+    LightSource *light = lighting_scene_get_light(record->light.handle);
+    if (!light)
+        return;
+
+    apply_xor(record->data, record->size - sizeof(JournalRecord),
+              (uint8_t *)light, sizeof(LightSource));
+    lighting_light_update(record->light.handle, Vector3Zero());
+}
+
+static void apply_terrain_record(JournalRecord *record,
+                                 JournalChanges *changes) {
+    uint32_t x = record->terrain.x;
+    uint32_t y = record->terrain.y;
+    uint32_t width = record->terrain.width;
+    uint32_t height = record->terrain.height;
+
+    // Terrain has been resized since
+    uint32_t clamped_width = width;
+    uint32_t clamped_height = height;
+    if (clamp_terrain_rectangle(x, y, &clamped_width, &clamped_height) ||
+        clamped_width != width || clamped_height != height)
+        return;
+
+    size_t size = (size_t)width * height;
+    float *heights = malloc(size * sizeof(float));
+    uint8_t *texture_indices = malloc(size);
+    if (!heights || !texture_indices)
+        abort();
+
+    copy_terrain_rectangle(x, y, width, height, heights, texture_indices, 0);
+    size_t data_size = record->size - sizeof(JournalRecord);
+    apply_xor(record->data, record->terrain.heights_size, (uint8_t *)heights,
+              size * sizeof(float));
+    apply_xor(record->data + record->terrain.heights_size,
+              data_size - record->terrain.heights_size, texture_indices, size);
+    copy_terrain_rectangle(x, y, width, height, heights, texture_indices, 1);
+    terrain_mark_dirty(x, y, width, height);
+
+    free(heights);
+    free(texture_indices);
+
+    if (!changes->is_terrain_changed) {
+        changes->is_terrain_changed = 1;
+        changes->terrain_x = x;
+        changes->terrain_y = y;
+        changes->terrain_width = width;
+        changes->terrain_height = height;
+        return;
+    }
+
+    uint32_t right = max(changes->terrain_x + changes->terrain_width,
+                         x + width);
+    uint32_t bottom = max(changes->terrain_y + changes->terrain_height,
+                          y + height);
+    changes->terrain_x = min(changes->terrain_x, x);
+    changes->terrain_y = min(changes->terrain_y, y);
+    changes->terrain_width = right - changes->terrain_x;
+    changes->terrain_height = bottom - changes->terrain_y;
+}
+
+static void apply_record(JournalRecord *record, JournalChanges *changes) {
+    switch (record->kind) {
+    case JOURNAL_RECORD_TRANSFORM:
+        apply_transform_record(record);
+        break;
+    case JOURNAL_RECORD_LIGHT:
+        apply_light_record(record);
+        break;
+    case JOURNAL_RECORD_TERRAIN:
+        apply_terrain_record(record, changes);
+        break;
+    }
+    changes->records_applied++;
+}
+
+int journal_undo(JournalChanges *out_changes) {
+    if (!records_applied)
+        return 1;
+
+    JournalChanges changes = {0};
+    uint32_t group = (*record_at(records_applied - 1))->group;
+    while (records_applied &&
+           (*record_at(records_applied - 1))->group == group) {
+        apply_record(*record_at(records_applied - 1), &changes);
+        records_applied--;
+    }
+
+    if (out_changes)
+        *out_changes = changes;
+    return 0;
+}
+
+int journal_redo(JournalChanges *out_changes) {
+    if (records_applied >= records_count)
+        return 1;
+
+    JournalChanges changes = {0};
+    uint32_t group = (*record_at(records_applied))->group;
+    while (records_applied < records_count &&
+           (*record_at(records_applied))->group == group) {
+        apply_record(*record_at(records_applied), &changes);
+        records_applied++;
+    }
+
+    if (out_changes)
+        *out_changes = changes;
+    return 0;
+}
+
+size_t journal_get_undo_count(void) {
+    return records_applied;
+}
+
+size_t journal_get_redo_count(void) {
+    return records_count - records_applied;
+}
+
+size_t journal_get_memory_usage(void) {
+    return memory_used;
+}
@@ -0,0 +1,83 @@
+#ifndef _JOURNAL
+#define _JOURNAL
+
+/*
+An undo/redo journal for editor operations. Instead of snapshots every record
+holds the XOR of the state before and after the change, which is its own
+inverse, so the same record is applied for both undo and redo:
+
+    - Entity transforms store a mask of the matrix fields that changed and the
+    XOR of just those fields.
+    - Light sources and terrain rectangles store their XOR with runs of
+    unchanged (zero) bytes collapsed.
+
+Records are kept in a ring bounded by a memory cap, the oldest ones get dropped
+when a new record would exceed it. Undo and redo only touch the data of the
+records they apply.
+
+Transform records remember which entity they belong to, records of entities
+that have been removed since are skipped instead of changing whatever entity
+reused the slot. Handles in records follow entities moved by scene_compact.
+*/
+
+#include "handles.h"
+#include "lighting.h"
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    JOURNAL_RECORD_TRANSFORM,
+    JOURNAL_RECORD_LIGHT,
+    JOURNAL_RECORD_TERRAIN,
+} JournalRecordKind;
+
+// What an undo or redo changed, for updating anything derived from that data.
+typedef struct {
+    int is_terrain_changed;
+    // Rectangle enclosing every changed terrain data point.
+    uint32_t terrain_x;
+    uint32_t terrain_y;
+    uint32_t terrain_width;
+    uint32_t terrain_height;
+    size_t records_applied;
+} JournalChanges;
+
+// Initializes the journal to use at most `memory_cap` bytes for records.
+void journal_init(size_t memory_cap);
+void journal_free(void);
+// Drops all records.
+void journal_clear(void);
+
+// Records written between these two calls are undone and redone together.
+// Groups can be nested, only the outermost one counts.
+void journal_begin_group(void);
+void journal_end_group(void);
+
+// Records the transform of entity `handle` changing from `before` to `after`.
+void journal_record_transform(EntityHandle handle, Matrix before,
+                              Matrix after);
+// Records light source `handle` changing from `before` to `after`.
+void journal_record_light(LightSourceHandle handle, LightSource before,
+                          LightSource after);
+// Remembers the terrain data in the `width` by `height` rectangle of data
+// points starting from `x`, `y`. Edit the terrain within that rectangle and
+// call journal_end_terrain_edit to record the change.
+void journal_begin_terrain_edit(uint32_t x, uint32_t y, uint32_t width,
+                                uint32_t height);
+void journal_end_terrain_edit(void);
+
+// Reverts the latest change, returns 1 if there is nothing to undo. What was
+// changed is written to `out_changes` if it is not NULL.
+int journal_undo(JournalChanges *out_changes);
+// Reapplies the latest undone change, returns 1 if there is nothing to redo.
+int journal_redo(JournalChanges *out_changes);
+
+// Returns the amount of records that can be undone.
+size_t journal_get_undo_count(void);
+// Returns the amount of records that can be redone.
+size_t journal_get_redo_count(void);
+// Returns the amount of memory used by records.
+size_t journal_get_memory_usage(void);
+
+#endif
@@ -9,6 +9,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+SLOTMAP_IMPLEMENT(LightSource, LightSourceSlotMap, lightmap)
+
 static LightingScene lighting_scene = {0};
 
 static inline LightingShader shader_init(const char *vertex,
@@ -48,20 +50,27 @@ static inline LightingShader shader_init(const char *vertex,
     return lighting_shader;
 }
 
+// Updates shader light source `index`, which is the dense index of the light in
+// the lighting scene.
 static inline int
 lighting_shader_update_light_source(LightingShader *lighting_shader,
-                                    LightSourceHandle light_handle,
-                                    Vector3 offset, int full_update) {
-    if (light_handle >= lighting_scene.lights_size && !full_update)
+                                    size_t index, Vector3 offset,
+                                    int full_update) {
+    static const LightSource null_light = {0};
+
+    if (index >= lighting_scene.lights.data_used && !full_update)
         return 1;
 
-    LightSource *light = lighting_scene.lights + light_handle;
+    const LightSource *light = &null_light;
+    if (index < lighting_scene.lights.data_used)
+        light = lighting_scene.lights.data + index;
+
     if (light->type == LIGHT_NULL && !full_update)
         return 1;
 
     int enabled = !light->is_disabled;
     ShaderLightSource *source_locs =
-        lighting_shader->shader_light_sources + light_handle;
+        lighting_shader->shader_light_sources + index;
 
     SetShaderValue(lighting_shader->shader, source_locs->is_enabled_location,
                    &enabled, SHADER_UNIFORM_INT);
@@ -119,6 +128,8 @@ static inline void lighting_shader_update(LightingShader *lighting_shader,
 static inline void lighting_shader_data_update_ex(int full_update) {
     lighting_shader_update(&lighting_scene.base_shader, full_update);
     lighting_shader_update(&lighting_scene.terrain_shader, full_update);
+    if (lighting_scene.instanced_shader.shader.id)
+        lighting_shader_update(&lighting_scene.instanced_shader, full_update);
 }
 
 void lighting_scene_init(Color ambient_color, const char *vert_shader,
@@ -133,17 +144,48 @@ void lighting_scene_init(Color ambient_color, const char *vert_shader,
     return;
 }
 
+void lighting_scene_free(void) {
+    lightmap_free(&lighting_scene.lights);
+
+    LightingShader *shaders[] = {&lighting_scene.base_shader,
+                                 &lighting_scene.terrain_shader,
+                                 &lighting_scene.instanced_shader};
+    for (size_t i = 0; i < sizeof shaders / sizeof shaders[0]; i++) {
+        if (shaders[i]->shader.id)
+            UnloadShader(shaders[i]->shader);
+    }
+
+    lighting_scene = (LightingScene){0};
+}
+
+void lighting_scene_init_instancing(const char *instanced_vert_shader,
+                                    const char *entity_frag_shader) {
+    lighting_scene.instanced_shader =
+        shader_init(instanced_vert_shader, entity_frag_shader);
+
+    Shader *shader = &lighting_scene.instanced_shader.shader;
+    int instance_transform_location =
+        GetShaderLocationAttrib(*shader, "instanceTransform");
+
+    // The attribute location DrawMeshInstanced uses moved in raylib 5.5
+#if RAYLIB_VERSION_MAJOR > 5 ||                                                \
+    (RAYLIB_VERSION_MAJOR == 5 && RAYLIB_VERSION_MINOR >= 5)
+    shader->locs[SHADER_LOC_VERTEX_INSTANCE_TX] = instance_transform_location;
+#else
+    shader->locs[SHADER_LOC_MATRIX_MODEL] = instance_transform_location;
+#endif
+
+    lighting_shader_update(&lighting_scene.instanced_shader, 1);
+}
+
 int lighting_scene_add_light(LightSource light,
                              LightSourceHandle *out_light_source_handle) {
-    if (lighting_scene.lights_size >= LIGHTING_MAX_LIGHTS)
+    if (lighting_scene.lights.data_used >= LIGHTING_MAX_LIGHTS)
         return 1;
 
-    // Connect shader locations
-
+    LightSourceHandle handle = lightmap_insert(&lighting_scene.lights, light);
     if (out_light_source_handle)
-        *out_light_source_handle = lighting_scene.lights_size;
-
-    lighting_scene.lights[lighting_scene.lights_size++] = light;
+        *out_light_source_handle = handle;
 
     lighting_shader_data_update();
 
@@ -151,16 +193,10 @@ int lighting_scene_add_light(LightSource light,
 }
 
 void lighting_scene_remove_light(LightSourceHandle handle) {
-    if (lighting_scene.lights_size == 0)
+    if (lightmap_remove(&lighting_scene.lights, handle))
         return;
 
-    if (handle < lighting_scene.lights_size - 1) {
-        lighting_scene.lights[handle] =
-            lighting_scene.lights[lighting_scene.lights_size - 1];
-    }
-
-    lighting_scene.lights[--lighting_scene.lights_size] = (LightSource){0};
-
+    // The last light was moved into the removed one's shader slot
     lighting_shader_data_update_ex(1);
 }
 
@@ -172,10 +208,20 @@ Shader lighting_scene_get_terrain_shader(void) {
     return lighting_scene.terrain_shader.shader;
 }
 
+Shader lighting_scene_get_instanced_shader(void) {
+    return lighting_scene.instanced_shader.shader;
+}
+
 LightSource *lighting_scene_get_light(LightSourceHandle light_handle) {
-    if (light_handle >= lighting_scene.lights_size)
-        return 0;
-    return lighting_scene.lights + light_handle;
+    return lightmap_get(&lighting_scene.lights, light_handle);
+}
+
+size_t lighting_scene_get_light_count(void) {
+    return lighting_scene.lights.data_used;
+}
+
+LightSourceHandle lighting_scene_get_light_handle(size_t index) {
+    return lightmap_dense_handle(&lighting_scene.lights, index);
 }
 
 void lighting_scene_set_enabled(uint32_t enabled) {
@@ -188,10 +234,17 @@ void lighting_shader_data_update(void) {
 }
 
 void lighting_light_update(LightSourceHandle light_handle, Vector3 offset) {
-    lighting_shader_update_light_source(&lighting_scene.base_shader,
-                                        light_handle, offset, 0);
-    lighting_shader_update_light_source(&lighting_scene.terrain_shader,
-                                        light_handle, offset, 0);
+    size_t index = 0;
+    if (lightmap_dense_index(&lighting_scene.lights, light_handle, &index))
+        return;
+
+    lighting_shader_update_light_source(&lighting_scene.base_shader, index,
+                                        offset, 0);
+    lighting_shader_update_light_source(&lighting_scene.terrain_shader, index,
+                                        offset, 0);
+    if (lighting_scene.instanced_shader.shader.id)
+        lighting_shader_update_light_source(&lighting_scene.instanced_shader,
+                                            index, offset, 0);
 }
 
 void lighting_scene_set_ambient_color(Color color) {
@@ -4,6 +4,7 @@
 // Handling of light sources and associated vertex lighting shaders.
 
 #include "scene.h"
+#include "slotmap.h"
 #include <raylib.h>
 #include <stdalign.h>
 #include <stddef.h>
@@ -28,6 +29,8 @@ typedef struct {
     Color color;
 } LightSource;
 
+SLOTMAP_DECLARE(LightSource, LightSourceSlotMap, lightmap)
+
 typedef struct {
     uint32_t is_enabled_location;
     uint32_t intensity_location;
@@ -46,12 +49,15 @@ typedef struct {
 } LightingShader;
 
 typedef struct {
-    LightSource lights[LIGHTING_MAX_LIGHTS];
-    size_t lights_size;
+    // Light sources are packed densely, the dense index of a light is also its
+    // index in the shader light array.
+    LightSourceSlotMap lights;
     int is_deleted;
     int is_shading_disabled;
     LightingShader base_shader;
     LightingShader terrain_shader;
+    // Only loaded by lighting_scene_init_instancing.
+    LightingShader instanced_shader;
     Color ambient_color;
 } LightingScene;
 
@@ -60,23 +66,45 @@ void lighting_scene_init(Color ambient_color, const char *vert_shader,
                          const char *entity_frag_shader,
                          const char *terrain_frag_shader);
 
+// Removes every light source and unloads the shaders of the lighting scene,
+// call this together with scene_free. lighting_scene_init has to be called
+// again before the lighting scene is used.
+void lighting_scene_free(void);
+
+// Loads the instanced variant of the entity shader, used for drawing many
+// entities sharing a model with one draw call. `instanced_vert_shader` must
+// read the model matrix of each instance from vertex attribute
+// "instanceTransform".
+void lighting_scene_init_instancing(const char *instanced_vert_shader,
+                                    const char *entity_frag_shader);
+
 // Adds a `light` source to the lighting scene. Handle of the added light source
 // will be written to `out_light_source_handle`.
 int lighting_scene_add_light(LightSource light,
                              LightSourceHandle *out_light_source_handle);
-// Removes light `handle` from the lighting scene.
+// Removes light `handle` from the lighting scene. Handles of other lights stay
+// valid.
 void lighting_scene_remove_light(LightSourceHandle handle);
 
 // Get lighting scene shader
 Shader lighting_scene_get_base_shader(void);
 // Get lighting scene terrain shader
 Shader lighting_scene_get_terrain_shader(void);
+// Get lighting scene instanced entity shader, its id is 0 if instancing has not
+// been initialized.
+Shader lighting_scene_get_instanced_shader(void);
 
 // Sets whether or not lighting calculations are enabled in the lighting scene.
 // If enabled is 0, the scene will be unlit.
 void lighting_scene_set_enabled(uint32_t enabled);
-// Get a pointer to a LightSource by its handle `light_handle`.
+// Get a pointer to a LightSource by its handle `light_handle`, returns 0 if the
+// light has been removed.
 LightSource *lighting_scene_get_light(LightSourceHandle light_handle);
+// Returns the number of light sources in the scene.
+size_t lighting_scene_get_light_count(void);
+// Returns the handle of the `index`th light source, for iterating over all
+// light sources together with lighting_scene_get_light_count.
+LightSourceHandle lighting_scene_get_light_handle(size_t index);
 
 // Updates shader light calculation data for the whole scene.
 void lighting_shader_data_update(void);
@@ -0,0 +1,147 @@
+#include "pool.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BLOCKS_STARTING_SIZE 4
+#define BLOCKS_GROWTH_FACTOR 2
+#define MIN_ELEMENTS_PER_BLOCK 8
+#define BLOCK_ALIGNMENT 16
+
+Pool pool_init(size_t element_size) {
+    // Every element has to be able to hold a free list node and stay aligned
+    // for whatever is put into it.
+    size_t alignment =
+        element_size >= BLOCK_ALIGNMENT ? BLOCK_ALIGNMENT : sizeof(PoolFreeNode);
+    if (element_size < sizeof(PoolFreeNode))
+        element_size = sizeof(PoolFreeNode);
+    element_size = (element_size + alignment - 1) / alignment * alignment;
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0)
+        page_size = 4096;
+
+    size_t block_size = page_size;
+    while (block_size / element_size < MIN_ELEMENTS_PER_BLOCK)
+        block_size += page_size;
+
+    return (Pool){
+        .element_size = element_size,
+        .elements_per_block = block_size / element_size,
+        .block_size = block_size,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+    };
+}
+
+void pool_free(Pool *pool) {
+    for (size_t i = 0; i < pool->blocks_used; i++)
+        free(pool->blocks[i]);
+
+    if (pool->blocks) {
+        free(pool->blocks);
+        pool->blocks = 0;
+    }
+
+    pool->blocks_used = 0;
+    pool->blocks_allocated = 0;
+    pool->block_elements_used = 0;
+    pool->free_list = 0;
+}
+
+static inline void add_block(Pool *pool) {
+    if (pool->blocks_used >= pool->blocks_allocated) {
+        pool->blocks_allocated = pool->blocks_allocated
+                                     ? pool->blocks_allocated *
+                                           BLOCKS_GROWTH_FACTOR
+                                     : BLOCKS_STARTING_SIZE;
+        pool->blocks =
+            realloc(pool->blocks, pool->blocks_allocated * sizeof(void *));
+        if (!pool->blocks)
+            abort();
+    }
+
+    void *block = aligned_alloc(BLOCK_ALIGNMENT, pool->block_size);
+    if (!block)
+        abort();
+
+    pool->blocks[pool->blocks_used++] = block;
+    pool->block_elements_used = 0;
+}
+
+void *pool_allocate(Pool *pool) {
+    if (pool->free_list) {
+        PoolFreeNode *node = pool->free_list;
+        pool->free_list = node->next;
+        return node;
+    }
+
+    if (!pool->blocks_used ||
+        pool->block_elements_used >= pool->elements_per_block)
+        add_block(pool);
+
+    uint8_t *block = pool->blocks[pool->blocks_used - 1];
+    return block + pool->element_size * pool->block_elements_used++;
+}
+
+void pool_release(Pool *pool, void *element) {
+    assert(element);
+    PoolFreeNode *node = element;
+    node->next = pool->free_list;
+    pool->free_list = node;
+}
+
+void *pool_cache_allocate(PoolCache *cache, Pool *pool) {
+    if (!cache->free_list) {
+        pthread_mutex_lock(&pool->lock);
+        for (size_t i = 0; i < POOL_CACHE_SIZE / 2; i++) {
+            PoolFreeNode *node = pool_allocate(pool);
+            node->next = cache->free_list;
+            cache->free_list = node;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        cache->count = POOL_CACHE_SIZE / 2;
+    }
+
+    PoolFreeNode *node = cache->free_list;
+    cache->free_list = node->next;
+    cache->count--;
+    return node;
+}
+
+// Hands the first `count` elements of the cache back to the pool in one go.
+static inline void cache_return(PoolCache *cache, Pool *pool, size_t count) {
+    if (!count)
+        return;
+
+    PoolFreeNode *first = cache->free_list;
+    PoolFreeNode *last = first;
+    for (size_t i = 1; i < count; i++)
+        last = last->next;
+
+    cache->free_list = last->next;
+    cache->count -= count;
+
+    pthread_mutex_lock(&pool->lock);
+    last->next = pool->free_list;
+    pool->free_list = first;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_cache_release(PoolCache *cache, Pool *pool, void *element) {
+    assert(element);
+    if (cache->count >= POOL_CACHE_SIZE)
+        cache_return(cache, pool, POOL_CACHE_SIZE / 2);
+
+    PoolFreeNode *node = element;
+    node->next = cache->free_list;
+    cache->free_list = node;
+    cache->count++;
+}
+
+void pool_cache_flush(PoolCache *cache, Pool *pool) {
+    cache_return(cache, pool, cache->count);
+}
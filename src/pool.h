@@ -0,0 +1,71 @@
+#ifndef _POOL
+#define _POOL
+
+/*
+A fixed-size object pool.
+
+Elements are carved out of page-sized blocks which are never moved or freed
+before pool_free, so the address of an element stays valid for as long as it is
+allocated, unlike with the realloc-backed vectors in vec.h. Released elements
+are kept on an intrusive free list threaded through the elements themselves and
+handed out again before any new space is used.
+
+A pool by itself is not thread-safe. When several threads share a pool each of
+them should go through its own PoolCache, which exchanges elements with the pool
+in batches of POOL_CACHE_SIZE while holding the pool lock. The cache is meant to
+be thread-local, for example:
+
+    static _Thread_local PoolCache cache = {0};
+    void *element = pool_cache_allocate(&cache, &pool);
+*/
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define POOL_CACHE_SIZE 32
+
+typedef struct PoolFreeNode {
+    struct PoolFreeNode *next;
+} PoolFreeNode;
+
+typedef struct {
+    size_t element_size;
+    size_t elements_per_block;
+    size_t block_size;
+    void **blocks;
+    size_t blocks_used;
+    size_t blocks_allocated;
+    // Elements handed out from the newest block so far.
+    size_t block_elements_used;
+    PoolFreeNode *free_list;
+    pthread_mutex_t lock;
+} Pool;
+
+typedef struct {
+    PoolFreeNode *free_list;
+    size_t count;
+} PoolCache;
+
+// Initializes a pool for elements of `element_size` bytes. No memory is
+// allocated until the first element is.
+Pool pool_init(size_t element_size);
+// Frees all blocks of the pool, every element allocated from it becomes
+// invalid.
+void pool_free(Pool *pool);
+
+// Returns an uninitialized element from `pool`.
+void *pool_allocate(Pool *pool);
+// Returns `element` to `pool` so that it can be handed out again.
+void pool_release(Pool *pool, void *element);
+
+// Like pool_allocate but takes the element from `cache`, refilling it from
+// `pool` when it runs empty.
+void *pool_cache_allocate(PoolCache *cache, Pool *pool);
+// Like pool_release but puts the element into `cache`, handing half of the
+// cache back to `pool` when it runs full.
+void pool_cache_release(PoolCache *cache, Pool *pool, void *element);
+// Returns all elements in `cache` to `pool`. Call this before the owning
+// thread exits.
+void pool_cache_flush(PoolCache *cache, Pool *pool);
+
+#endif
@@ -0,0 +1,65 @@
+#include "radix_sort.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DIGIT_BITS 8
+#define DIGIT_COUNT (64 / DIGIT_BITS)
+#define BUCKET_COUNT (1 << DIGIT_BITS)
+
+void radix_sort_u64(uint64_t *keys, uint32_t *values, uint64_t *keys_scratch,
+                    uint32_t *values_scratch, size_t count) {
+    if (count < 2)
+        return;
+
+    // Histograms for every digit in a single pass
+    size_t histograms[DIGIT_COUNT][BUCKET_COUNT];
+    memset(histograms, 0, sizeof histograms);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = keys[i];
+        for (size_t digit = 0; digit < DIGIT_COUNT; digit++)
+            histograms[digit][(key >> (digit * DIGIT_BITS)) &
+                              (BUCKET_COUNT - 1)]++;
+    }
+
+    uint64_t *keys_from = keys;
+    uint32_t *values_from = values;
+    uint64_t *keys_to = keys_scratch;
+    uint32_t *values_to = values_scratch;
+
+    for (size_t digit = 0; digit < DIGIT_COUNT; digit++) {
+        size_t *histogram = histograms[digit];
+        size_t shift = digit * DIGIT_BITS;
+
+        // Every key has the same value for this digit, nothing would move
+        if (histogram[(keys_from[0] >> shift) & (BUCKET_COUNT - 1)] == count)
+            continue;
+
+        size_t offset = 0;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+            size_t bucket_size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_size;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            size_t destination =
+                histogram[(keys_from[i] >> shift) & (BUCKET_COUNT - 1)]++;
+            keys_to[destination] = keys_from[i];
+            values_to[destination] = values_from[i];
+        }
+
+        uint64_t *keys_swap = keys_from;
+        keys_from = keys_to;
+        keys_to = keys_swap;
+        uint32_t *values_swap = values_from;
+        values_from = values_to;
+        values_to = values_swap;
+    }
+
+    if (keys_from != keys) {
+        memcpy(keys, keys_from, count * sizeof(uint64_t));
+        memcpy(values, values_from, count * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef _RADIX_SORT
+#define _RADIX_SORT
+
+// LSD radix sort for 64-bit keys with an attached 32-bit value per key.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sorts `keys` in ascending order, moving `values` along with them. The sort
+// is stable. `keys_scratch` and `values_scratch` must have room for `count`
+// elements each, their contents are overwritten.
+void radix_sort_u64(uint64_t *keys, uint32_t *values, uint64_t *keys_scratch,
+                    uint32_t *values_scratch, size_t count);
+
+#endif
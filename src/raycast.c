@@ -13,10 +13,21 @@ ObjectRaycastResult raycast_scene_objects(Ray ray) {
     Entity *entity = {0};
     size_t i = 0;
     while ((entity = scene_get_entity(i++))) {
-        if (entity->is_destroyed)
+        if (entity->is_destroyed || entity->ignore_raycast)
             continue;
 
-        Model *model = scene_entity_get_model(entity);
+        // Broad phase
+        BoundingBox bounds = scene_entity_get_world_bounds(entity);
+        RayCollision bounds_collision = GetRayCollisionBox(ray, bounds);
+        if (!bounds_collision.hit)
+            continue;
+        // Nothing inside the box can be closer than the box itself
+        if (object_result.result.hit &&
+            bounds_collision.distance > object_result.result.distance)
+            continue;
+
+        // Full detail model regardless of level of detail
+        Model *model = scene_get_model(entity->model_handle);
 
         collision =
             GetRayCollisionMesh(ray, model->meshes[0], entity->transform);
@@ -0,0 +1,204 @@
+#include "render_queue.h"
+
+#include "common.h"
+#include "lighting.h"
+#include "radix_sort.h"
+#include "scene.h"
+#include "scene_stats.h"
+#include "slotmap.h"
+#include "static_batch.h"
+#include <raylib.h>
+#include <raymath.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ITEMS_STARTING_SIZE 64
+#define ITEMS_GROWTH_FACTOR 2
+
+#define DEPTH_BITS 24
+#define MODEL_BITS 16
+#define TEXTURE_BITS 16
+#define SHADER_BITS 8
+
+static RenderQueue render_queue = {0};
+
+uint64_t render_queue_make_key(uint32_t shader_id, uint32_t texture_id,
+                               ModelHandle model_handle, float depth) {
+    uint64_t max_bucket = (1 << DEPTH_BITS) - 1;
+    uint64_t depth_bucket =
+        minf(maxf(depth, 0) / RENDER_QUEUE_MAX_DEPTH, 1) * max_bucket;
+    uint64_t model_slot = slotmap_handle_slot(model_handle);
+
+    uint64_t key = 0;
+    key |= (uint64_t)(shader_id & ((1 << SHADER_BITS) - 1));
+    key <<= TEXTURE_BITS;
+    key |= (uint64_t)(texture_id & ((1 << TEXTURE_BITS) - 1));
+    key <<= MODEL_BITS;
+    key |= model_slot & ((1 << MODEL_BITS) - 1);
+    key <<= DEPTH_BITS;
+    key |= depth_bucket;
+    return key;
+}
+
+static inline void reserve(size_t count) {
+    if (count <= render_queue.items_allocated)
+        return;
+
+    if (!render_queue.items_allocated)
+        render_queue.items_allocated = ITEMS_STARTING_SIZE;
+    while (render_queue.items_allocated < count)
+        render_queue.items_allocated *= ITEMS_GROWTH_FACTOR;
+
+    size_t size = render_queue.items_allocated;
+    render_queue.keys = realloc(render_queue.keys, size * sizeof(uint64_t));
+    render_queue.entities =
+        realloc(render_queue.entities, size * sizeof(uint32_t));
+    render_queue.keys_scratch =
+        realloc(render_queue.keys_scratch, size * sizeof(uint64_t));
+    render_queue.entities_scratch =
+        realloc(render_queue.entities_scratch, size * sizeof(uint32_t));
+
+    if (!render_queue.keys || !render_queue.entities ||
+        !render_queue.keys_scratch || !render_queue.entities_scratch)
+        abort();
+}
+
+void render_queue_build(Camera3D camera) {
+    render_queue.items_used = 0;
+
+    EntityHandle handle = 0;
+    Entity *entity = 0;
+    while ((entity = scene_get_entity(handle++))) {
+        if (entity->is_destroyed)
+            continue;
+        // Drawn by static_batch_draw
+        if (entity->is_static && static_batch_is_enabled())
+            continue;
+
+        Model *model = scene_entity_get_model(entity);
+        if (!model || !model->meshCount || !model->materialCount)
+            continue;
+
+        Material *material = model->materials;
+        float depth = Vector3Distance(camera.position,
+                                      matrix_get_position(entity->transform));
+
+        reserve(render_queue.items_used + 1);
+        render_queue.keys[render_queue.items_used] = render_queue_make_key(
+            material->shader.id,
+            material->maps ? material->maps[MATERIAL_MAP_DIFFUSE].texture.id
+                           : 0,
+            scene_entity_get_model_handle(entity), depth);
+        render_queue.entities[render_queue.items_used] = handle - 1;
+        render_queue.items_used++;
+    }
+
+    radix_sort_u64(render_queue.keys, render_queue.entities,
+                   render_queue.keys_scratch, render_queue.entities_scratch,
+                   render_queue.items_used);
+}
+
+const RenderQueue *render_queue_get(void) {
+    return &render_queue;
+}
+
+static inline void draw_entity(Entity *entity) {
+    Model *model = scene_entity_get_model(entity);
+    if (!model)
+        return;
+
+    Matrix transform = MatrixMultiply(model->transform, entity->transform);
+    for (int mesh = 0; mesh < model->meshCount; mesh++)
+        DrawMesh(model->meshes[mesh],
+                 model->materials[model->meshMaterial[mesh]], transform);
+    scene_stats_add_draw_calls(model->meshCount);
+}
+
+void render_queue_draw(void) {
+    for (size_t i = 0; i < render_queue.items_used; i++) {
+        Entity *entity = scene_get_entity(render_queue.entities[i]);
+        if (!entity || entity->is_destroyed)
+            continue;
+
+        draw_entity(entity);
+    }
+}
+
+// Draws the run of `count` entities starting at queue position `start`, which
+// all share `model_handle`, with one instanced draw call per mesh.
+static inline void draw_instanced_run(size_t start, size_t count,
+                                      ModelHandle model_handle,
+                                      Shader instanced_shader) {
+    Model *model = scene_get_model(model_handle);
+    if (!model)
+        return;
+
+    if (count > render_queue.transforms_allocated) {
+        render_queue.transforms_allocated = count;
+        render_queue.transforms =
+            realloc(render_queue.transforms, count * sizeof(Matrix));
+        if (!render_queue.transforms)
+            abort();
+    }
+
+    size_t instances = 0;
+    for (size_t i = start; i < start + count; i++) {
+        Entity *entity = scene_get_entity(render_queue.entities[i]);
+        if (!entity || entity->is_destroyed)
+            continue;
+        render_queue.transforms[instances++] =
+            MatrixMultiply(model->transform, entity->transform);
+    }
+
+    for (int mesh = 0; mesh < model->meshCount; mesh++) {
+        Material material = model->materials[model->meshMaterial[mesh]];
+        material.shader = instanced_shader;
+        DrawMeshInstanced(model->meshes[mesh], material,
+                          render_queue.transforms, instances);
+    }
+    scene_stats_add_draw_calls(model->meshCount);
+}
+
+void render_queue_draw_instanced(void) {
+    Shader instanced_shader = lighting_scene_get_instanced_shader();
+    if (!instanced_shader.id) {
+        render_queue_draw();
+        return;
+    }
+
+    size_t i = 0;
+    while (i < render_queue.items_used) {
+        Entity *entity = scene_get_entity(render_queue.entities[i]);
+        if (!entity || entity->is_destroyed) {
+            i++;
+            continue;
+        }
+
+        // Find the run of entities sharing this model
+        ModelHandle model_handle = scene_entity_get_model_handle(entity);
+        size_t run_end = i + 1;
+        while (run_end < render_queue.items_used) {
+            Entity *next = scene_get_entity(render_queue.entities[run_end]);
+            if (next && scene_entity_get_model_handle(next) != model_handle)
+                break;
+            run_end++;
+        }
+
+        if (run_end - i < RENDER_QUEUE_MIN_INSTANCES)
+            draw_entity(entity);
+        else
+            draw_instanced_run(i, run_end - i, model_handle, instanced_shader);
+
+        i = run_end;
+    }
+}
+
+void render_queue_free(void) {
+    free(render_queue.keys);
+    free(render_queue.entities);
+    free(render_queue.keys_scratch);
+    free(render_queue.entities_scratch);
+    free(render_queue.transforms);
+    render_queue = (RenderQueue){0};
+}
@@ -0,0 +1,65 @@
+#ifndef _RENDER_QUEUE
+#define _RENDER_QUEUE
+
+/*
+Sorted draw submission for scene entities.
+
+Every visible entity gets a 64-bit sort key, from the most to the least
+significant bits:
+    - 8 bits of shader id
+    - 16 bits of diffuse texture id
+    - 16 bits of model handle slot
+    - 24 bits of camera distance bucket
+
+Sorting the keys groups draws by shader, then texture, then model, to cut GPU
+state changes between draws, and orders draws sharing a model front-to-back.
+
+Since entities sharing a model end up next to each other, the queue can also be
+drawn with instancing: each run of entities with the same model has its
+transforms packed into one buffer and is drawn with one DrawMeshInstanced call
+per mesh.
+*/
+
+#include "handles.h"
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Distances past this all fall into the last depth bucket.
+#define RENDER_QUEUE_MAX_DEPTH 4096.0f
+// Runs of entities sharing a model shorter than this are drawn one by one even
+// when drawing instanced.
+#define RENDER_QUEUE_MIN_INSTANCES 2
+
+typedef struct {
+    uint64_t *keys;
+    uint32_t *entities;
+    uint64_t *keys_scratch;
+    uint32_t *entities_scratch;
+    size_t items_used;
+    size_t items_allocated;
+    // Per-instance transforms of the run being drawn instanced.
+    Matrix *transforms;
+    size_t transforms_allocated;
+} RenderQueue;
+
+// Builds a sort key from the draw state of one entity.
+uint64_t render_queue_make_key(uint32_t shader_id, uint32_t texture_id,
+                               ModelHandle model_handle, float depth);
+
+// Collects all entities of the scene into the render queue and sorts them
+// relative to `camera`.
+void render_queue_build(Camera3D camera);
+// Gets the queue made by the last render_queue_build.
+const RenderQueue *render_queue_get(void);
+// Draws the entities collected by the last render_queue_build in sorted order.
+// Call this between BeginMode3D and EndMode3D.
+void render_queue_draw(void);
+// Like render_queue_draw but draws entities sharing a model with instancing,
+// using the shader loaded by lighting_scene_init_instancing. Falls back to
+// render_queue_draw if instancing has not been initialized.
+void render_queue_draw_instanced(void);
+
+void render_queue_free(void);
+
+#endif
@@ -0,0 +1,180 @@
+#include "ring_buffer.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+RingBuffer ringbuf_init(RingBufferKind kind, size_t element_size,
+                        size_t capacity) {
+    size_t rounded_capacity = 1;
+    while (rounded_capacity < capacity)
+        rounded_capacity *= 2;
+
+    RingBuffer buf = {
+        .data = malloc(rounded_capacity * element_size),
+        .element_size = element_size,
+        .capacity = rounded_capacity,
+        .kind = kind,
+    };
+    atomic_init(&buf.head, 0);
+    atomic_init(&buf.tail, 0);
+
+    if (kind == RINGBUF_MULTI_PRODUCER) {
+        buf.sequences = malloc(rounded_capacity * sizeof(atomic_size_t));
+        if (!buf.sequences) {
+            free(buf.data);
+            buf.data = 0;
+            return buf;
+        }
+        for (size_t i = 0; i < rounded_capacity; i++)
+            atomic_init(buf.sequences + i, 0);
+    }
+
+    return buf;
+}
+
+void ringbuf_free(RingBuffer *buf) {
+    if (buf->data) {
+        free(buf->data);
+        buf->data = 0;
+    }
+    if (buf->sequences) {
+        free(buf->sequences);
+        buf->sequences = 0;
+    }
+}
+
+// Copies `count` elements from `elements` to the buffer starting at position
+// `position`, wrapping around the end.
+static inline void copy_in(RingBuffer *buf, size_t position,
+                           const uint8_t *elements, size_t count) {
+    size_t start = position & (buf->capacity - 1);
+    size_t first = buf->capacity - start;
+    if (first > count)
+        first = count;
+
+    memcpy(buf->data + start * buf->element_size, elements,
+           first * buf->element_size);
+    memcpy(buf->data, elements + first * buf->element_size,
+           (count - first) * buf->element_size);
+}
+
+// Copies `count` elements starting at position `position` out of the buffer,
+// wrapping around the end.
+static inline void copy_out(RingBuffer *buf, size_t position,
+                            uint8_t *out_elements, size_t count) {
+    size_t start = position & (buf->capacity - 1);
+    size_t first = buf->capacity - start;
+    if (first > count)
+        first = count;
+
+    memcpy(out_elements, buf->data + start * buf->element_size,
+           first * buf->element_size);
+    memcpy(out_elements + first * buf->element_size, buf->data,
+           (count - first) * buf->element_size);
+}
+
+static inline size_t push_single_producer(RingBuffer *buf,
+                                          const void *elements, size_t count) {
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+
+    size_t free_count = buf->capacity - (tail - head);
+    if (count > free_count)
+        count = free_count;
+    if (!count)
+        return 0;
+
+    copy_in(buf, tail, elements, count);
+    atomic_store_explicit(&buf->tail, tail + count, memory_order_release);
+    return count;
+}
+
+static inline size_t push_multi_producer(RingBuffer *buf, const void *elements,
+                                         size_t count) {
+    // Head has to be read before tail so that tail - head can not underflow.
+    size_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_relaxed);
+    size_t reserved = 0;
+
+    while (1) {
+        size_t free_count = buf->capacity - (tail - head);
+        reserved = count > free_count ? free_count : count;
+        if (!reserved)
+            return 0;
+
+        if (atomic_compare_exchange_weak_explicit(
+                &buf->tail, &tail, tail + reserved, memory_order_relaxed,
+                memory_order_relaxed))
+            break;
+
+        head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    }
+
+    copy_in(buf, tail, elements, reserved);
+
+    for (size_t i = 0; i < reserved; i++) {
+        size_t position = tail + i;
+        atomic_store_explicit(buf->sequences + (position & (buf->capacity - 1)),
+                              position + 1, memory_order_release);
+    }
+
+    return reserved;
+}
+
+size_t ringbuf_push_many(RingBuffer *buf, const void *elements, size_t count) {
+    assert(buf->data);
+    if (buf->kind == RINGBUF_MULTI_PRODUCER)
+        return push_multi_producer(buf, elements, count);
+    return push_single_producer(buf, elements, count);
+}
+
+size_t ringbuf_pop_many(RingBuffer *buf, void *out_elements,
+                        size_t max_count) {
+    assert(buf->data);
+    size_t head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+    size_t count = 0;
+
+    if (buf->kind == RINGBUF_MULTI_PRODUCER) {
+        // Producers can finish out of order, stop at the first element that
+        // is reserved but not yet written.
+        while (count < max_count) {
+            size_t position = head + count;
+            size_t sequence = atomic_load_explicit(
+                buf->sequences + (position & (buf->capacity - 1)),
+                memory_order_acquire);
+            if (sequence != position + 1)
+                break;
+            count++;
+        }
+    } else {
+        size_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+        count = tail - head;
+        if (count > max_count)
+            count = max_count;
+    }
+
+    if (!count)
+        return 0;
+
+    copy_out(buf, head, out_elements, count);
+    atomic_store_explicit(&buf->head, head + count, memory_order_release);
+    return count;
+}
+
+int ringbuf_push(RingBuffer *buf, const void *element) {
+    return ringbuf_push_many(buf, element, 1) != 1;
+}
+
+int ringbuf_pop(RingBuffer *buf, void *out_element) {
+    return ringbuf_pop_many(buf, out_element, 1) != 1;
+}
+
+size_t ringbuf_count(RingBuffer *buf) {
+    size_t head = atomic_load_explicit(&buf->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&buf->tail, memory_order_acquire);
+    return tail - head;
+}
@@ -0,0 +1,67 @@
+#ifndef _RING_BUFFER
+#define _RING_BUFFER
+
+/*
+A bounded lock-free ring buffer of fixed-size elements for passing data from one
+or more producer threads to a single consumer thread.
+
+RINGBUF_SINGLE_PRODUCER: exactly one thread pushes and one thread pops. Both
+sides only publish their own position, no atomic read-modify-write is needed.
+
+RINGBUF_MULTI_PRODUCER: any number of threads push and one thread pops.
+Producers reserve space by advancing the tail with a compare-and-swap and then
+publish every element through a per-element sequence number, so the consumer
+never reads an element that is still being written.
+
+Capacity is rounded up to a power of two. Batch operations move as many elements
+as fit in one go and return how many were moved.
+*/
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RINGBUF_CACHE_LINE 64
+
+typedef enum {
+    RINGBUF_SINGLE_PRODUCER,
+    RINGBUF_MULTI_PRODUCER,
+} RingBufferKind;
+
+typedef struct {
+    // Next position to be written, advanced by producers.
+    alignas(RINGBUF_CACHE_LINE) atomic_size_t tail;
+    // Next position to be read, advanced by the consumer.
+    alignas(RINGBUF_CACHE_LINE) atomic_size_t head;
+    alignas(RINGBUF_CACHE_LINE) uint8_t *data;
+    // Only used by RINGBUF_MULTI_PRODUCER. The element at position `p` is
+    // readable once its sequence number is `p + 1`.
+    atomic_size_t *sequences;
+    size_t element_size;
+    size_t capacity;
+    RingBufferKind kind;
+} RingBuffer;
+
+// Initializes a ring buffer for at least `capacity` elements of `element_size`
+// bytes. Returns a ring buffer with null `data` if allocation fails.
+RingBuffer ringbuf_init(RingBufferKind kind, size_t element_size,
+                        size_t capacity);
+void ringbuf_free(RingBuffer *buf);
+
+// Pushes one element, returns 1 if the buffer is full.
+int ringbuf_push(RingBuffer *buf, const void *element);
+// Pops one element into `out_element`, returns 1 if the buffer is empty.
+int ringbuf_pop(RingBuffer *buf, void *out_element);
+
+// Pushes up to `count` elements from `elements`, returns the amount pushed.
+size_t ringbuf_push_many(RingBuffer *buf, const void *elements, size_t count);
+// Pops up to `max_count` elements into `out_elements`, returns the amount
+// popped. Only to be called from the consumer thread.
+size_t ringbuf_pop_many(RingBuffer *buf, void *out_elements, size_t max_count);
+
+// Returns the amount of elements currently in the buffer. Only a snapshot when
+// other threads are pushing or popping.
+size_t ringbuf_count(RingBuffer *buf);
+
+#endif
@@ -2,148 +2,834 @@
 
 #include "assets.h"
 #include "common.h"
+#include "filesystem.h"
 #include "firewatch.h"
 #include "handles.h"
 #include "lighting.h"
+#include "scene_stats.h"
 #include "skyboxes.h"
+#include "static_batch.h"
 #include "texture_load.h"
+#include "worker_pool.h"
 #include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
 #include <raylib.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define ENTITIES_STARTING_SIZE 4
 #define ENTITIES_GROWTH_FACTOR 2
+#define FINISHED_LOADS_CAPACITY 256
+
+SLOTMAP_IMPLEMENT(SceneModel, ModelSlotMap, modelmap)
+
+// Files of one model read on a worker thread.
+typedef struct {
+    ModelHandle model_handle;
+    char model_filepath[MAX_PATH_LENGTH];
+    char texture_filepath[MAX_PATH_LENGTH];
+    unsigned char *model_data;
+    int model_data_size;
+    ImageData image_data;
+} LoadJob;
 
 static Scene scene = {0};
+// Kept apart from the scene so they survive scene_init.
+static SceneEntityListener entity_listeners[SCENE_MAX_ENTITY_LISTENERS];
+static size_t entity_listener_count = 0;
+static uint64_t next_entity_id = 1;
+// Set for assets whose files are watched for hot reloading. Watches can't be
+// removed, so each asset is only watched once however often its model is
+// evicted and loaded again, and the watch finds the model by asset.
+static uint8_t *watched_assets = 0;
+static size_t watched_assets_allocated = 0;
 static Model skybox_model = {0};
+static Model placeholder_model = {0};
+// The load job being finished, its model file is handed to raylib by
+// load_prefetched_file_data.
+static LoadJob *finishing_job = 0;
+
+// Reads the whole file at `filepath` into a buffer raylib can free, returns 0
+// on error. Files in the mounted bundle are copied out of it.
+static unsigned char *read_file(const char *filepath, int *out_size) {
+    *out_size = 0;
+    size_t bundled_size = 0;
+    const void *bundled = filesystem_get_bundled_file(filepath, &bundled_size);
+    if (bundled) {
+        if (bundled_size == 0 || bundled_size > INT_MAX)
+            return 0;
+        unsigned char *data = malloc(bundled_size);
+        if (!data)
+            return 0;
+        memcpy(data, bundled, bundled_size);
+        *out_size = bundled_size;
+        return data;
+    }
+
+    FILE *fp = fopen(filepath, "rb");
+    if (!fp)
+        return 0;
+
+    unsigned char *data = 0;
+    if (fseek(fp, 0, SEEK_END))
+        goto end;
+    long size = ftell(fp);
+    if (size <= 0 || fseek(fp, 0, SEEK_SET))
+        goto end;
+
+    data = malloc(size);
+    if (!data)
+        goto end;
+    if (fread(data, 1, size, fp) != (size_t)size) {
+        free(data);
+        data = 0;
+        goto end;
+    }
+    *out_size = size;
+
+end:
+    fclose(fp);
+    return data;
+}
+
+// Serves the model file read by the worker thread to LoadModel. Other files,
+// like external glTF buffers, are read with read_file.
+static unsigned char *load_prefetched_file_data(const char *filepath,
+                                                int *out_size) {
+    if (finishing_job && finishing_job->model_data &&
+        !strcmp(filepath, finishing_job->model_filepath)) {
+        unsigned char *data = finishing_job->model_data;
+        *out_size = finishing_job->model_data_size;
+        finishing_job->model_data = 0;
+        return data;
+    }
+
+    return read_file(filepath, out_size);
+}
+
+// Recalculates the memory estimate of `scene_model` after its files have been
+// (re)loaded.
+static void update_memory_usage(SceneModel *scene_model) {
+    Model *model = &scene_model->model;
+    scene.model_cpu_bytes -= scene_model->cpu_bytes;
+    scene.model_gpu_bytes -= scene_model->gpu_bytes;
+
+    size_t mesh_bytes = 0;
+    for (int i = 0; i < model->meshCount; i++) {
+        size_t vertex_bytes = 0;
+        size_t index_bytes = 0;
+        scene_stats_get_mesh_bytes(model->meshes + i, &vertex_bytes,
+                                   &index_bytes);
+        mesh_bytes += vertex_bytes + index_bytes;
+    }
+    size_t texture_bytes = scene_stats_get_model_texture_bytes(model);
+
+    // raylib keeps the mesh data around on the CPU side after uploading
+    scene_model->cpu_bytes = mesh_bytes;
+    scene_model->gpu_bytes = mesh_bytes + texture_bytes;
+    scene.model_cpu_bytes += scene_model->cpu_bytes;
+    scene.model_gpu_bytes += scene_model->gpu_bytes;
+}
+
+static void unload_scene_model(SceneModel *scene_model) {
+    Model *model = &scene_model->model;
+    if (!model->meshes)
+        return;
+
+    // UnloadModel leaves textures alone as they could be shared
+    if (model->materialCount) {
+        Texture texture =
+            model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture;
+        Texture unlit_texture =
+            model->materials[0].maps[MATERIAL_MAP_DIFFUSE + 1].texture;
+        if (scene_stats_get_texture_bytes(texture))
+            UnloadTexture(texture);
+        if (scene_stats_get_texture_bytes(unlit_texture))
+            UnloadTexture(unlit_texture);
+    }
+
+    UnloadModel(*model);
+    *model = (Model){0};
+}
+
+static inline int is_unused_model(ModelHandle handle, SceneModel *scene_model) {
+    return scene_model->lru_previous || scene.unused_models_first == handle;
+}
+
+static void unused_models_unlink(ModelHandle handle, SceneModel *scene_model) {
+    SceneModel *previous =
+        modelmap_get(&scene.models, scene_model->lru_previous);
+    SceneModel *next = modelmap_get(&scene.models, scene_model->lru_next);
+
+    if (previous)
+        previous->lru_next = scene_model->lru_next;
+    else if (scene.unused_models_first == handle)
+        scene.unused_models_first = scene_model->lru_next;
+
+    if (next)
+        next->lru_previous = scene_model->lru_previous;
+    else if (scene.unused_models_last == handle)
+        scene.unused_models_last = scene_model->lru_previous;
+
+    scene_model->lru_previous = SLOTMAP_HANDLE_NULL;
+    scene_model->lru_next = SLOTMAP_HANDLE_NULL;
+}
+
+static void unused_models_push(ModelHandle handle, SceneModel *scene_model) {
+    SceneModel *last = modelmap_get(&scene.models, scene.unused_models_last);
+    scene_model->lru_previous = scene.unused_models_last;
+    scene_model->lru_next = SLOTMAP_HANDLE_NULL;
+
+    if (last)
+        last->lru_next = handle;
+    else
+        scene.unused_models_first = handle;
+    scene.unused_models_last = handle;
+}
+
+static inline void reference_model(ModelHandle handle) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    if (!scene_model)
+        return;
+    if (scene_model->reference_count++ == 0 &&
+        is_unused_model(handle, scene_model))
+        unused_models_unlink(handle, scene_model);
+}
+
+static inline void release_model(ModelHandle handle) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    if (!scene_model || !scene_model->reference_count)
+        return;
+    if (--scene_model->reference_count == 0)
+        unused_models_push(handle, scene_model);
+}
+
+// Unloads unused models, least recently used first, until the memory budget
+// is met or no unused models are left.
+static void evict_unused_models(void) {
+    while ((scene.model_cpu_bytes > scene.model_cpu_budget ||
+            scene.model_gpu_bytes > scene.model_gpu_budget) &&
+           scene.unused_models_first) {
+        ModelHandle handle = scene.unused_models_first;
+        SceneModel *scene_model = modelmap_get(&scene.models, handle);
+        assert(scene_model);
+        unused_models_unlink(handle, scene_model);
+
+        scene.model_cpu_bytes -= scene_model->cpu_bytes;
+        scene.model_gpu_bytes -= scene_model->gpu_bytes;
+        unload_scene_model(scene_model);
+
+        // Next entity of this asset will load it again
+        if (scene_model->asset_handle < scene.asset_models_allocated &&
+            scene.asset_models[scene_model->asset_handle] == handle)
+            scene.asset_models[scene_model->asset_handle] =
+                SLOTMAP_HANDLE_NULL;
+        modelmap_remove(&scene.models, handle);
+    }
+}
+
+// Calculates the bounds of `scene_model` after (re)loading its meshes and bumps
+// its revision so that cached entity bounds get recalculated.
+static void update_model_bounds(SceneModel *scene_model) {
+    Model *model = &scene_model->model;
+    Vector3 min = {FLT_MAX, FLT_MAX, FLT_MAX};
+    Vector3 max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    size_t vertex_count = 0;
+
+    for (int i = 0; i < model->meshCount; i++) {
+        Mesh *mesh = model->meshes + i;
+        for (int j = 0; j < mesh->vertexCount; j++) {
+            Vector3 vertex = Vector3Transform(
+                ((Vector3 *)mesh->vertices)[j], model->transform);
+            min = Vector3Min(min, vertex);
+            max = Vector3Max(max, vertex);
+        }
+        vertex_count += mesh->vertexCount;
+    }
+
+    if (!vertex_count) {
+        min = Vector3Zero();
+        max = Vector3Zero();
+    }
+
+    Vector3 center = Vector3Scale(Vector3Add(min, max), 0.5);
+    float radius_squared = 0;
+    for (int i = 0; i < model->meshCount; i++) {
+        Mesh *mesh = model->meshes + i;
+        for (int j = 0; j < mesh->vertexCount; j++) {
+            Vector3 vertex = Vector3Transform(
+                ((Vector3 *)mesh->vertices)[j], model->transform);
+            radius_squared =
+                maxf(radius_squared, Vector3DistanceSqr(center, vertex));
+        }
+    }
+
+    scene_model->bounds = (BoundingBox){.min = min, .max = max};
+    scene_model->bounding_sphere_center = center;
+    scene_model->bounding_sphere_radius = sqrtf(radius_squared);
+
+    if (!++scene_model->revision)
+        scene_model->revision = 1;
+}
 
 static inline void load_model(const char *filepath, ModelHandle handle) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    // Hot reload requests can outlive their model, models still loading in the
+    // background will pick up the newest file anyway.
+    if (!scene_model || scene_model->is_loading)
+        return;
+    Model *model = &scene_model->model;
+
     // Preserve textures
     Texture texture = {0};
     Texture unlit_texture = {0};
-    if (scene.models.data[handle].materialCount) {
-        texture = scene.models.data[handle]
-                      .materials[0]
-                      .maps[MATERIAL_MAP_DIFFUSE]
-                      .texture;
-        unlit_texture = scene.models.data[handle]
-                            .materials[0]
-                            .maps[MATERIAL_MAP_DIFFUSE + 1]
-                            .texture;
+    if (model->materialCount) {
+        texture = model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture;
+        unlit_texture =
+            model->materials[0].maps[MATERIAL_MAP_DIFFUSE + 1].texture;
     }
 
-    if (scene.models.data[handle].meshes)
-        UnloadModel(scene.models.data[handle]);
+    if (model->meshes)
+        UnloadModel(*model);
 
-    scene.models.data[handle] = LoadModel(filepath);
-    assert(scene.models.data[handle].meshes);
-    scene.models.data[handle].materials[0].shader =
-        lighting_scene_get_base_shader();
+    SetLoadFileDataCallback(load_prefetched_file_data);
+    *model = LoadModel(filepath);
+    SetLoadFileDataCallback(0);
+    assert(model->meshes);
+    model->materials[0].shader = lighting_scene_get_base_shader();
 
     // Load old textures
-    scene.models.data[handle].materials[0].maps[MATERIAL_MAP_DIFFUSE].texture =
-        texture;
-    scene.models.data[handle]
-        .materials[0]
-        .maps[MATERIAL_MAP_DIFFUSE + 1]
-        .texture = unlit_texture;
+    model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;
+    model->materials[0].maps[MATERIAL_MAP_DIFFUSE + 1].texture = unlit_texture;
+
+    update_model_bounds(scene_model);
+    update_memory_usage(scene_model);
+    static_batch_mark_model_dirty(handle);
 }
 
 static inline void load_texture(const char *filepath, ModelHandle handle) {
-    Model *model = modelvec_get(&scene.models, handle);
-    assert(model);
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    if (!scene_model || scene_model->is_loading)
+        return;
+    Model *model = &scene_model->model;
     assert(model->materialCount);
     assert(model->meshCount);
     texture_load_model_texture(filepath, model);
+    update_memory_usage(scene_model);
+    static_batch_mark_model_dirty(handle);
 }
 
 void scene_init(void) {
     scene = (Scene){
-        .models = modelvec_init(),
+        .models = modelmap_init(),
         .entities = malloc(ENTITIES_STARTING_SIZE * sizeof(Entity)),
         .entities_allocated = ENTITIES_STARTING_SIZE,
+        .lod_distances = {25.0, 50.0, 100.0},
+        .model_cpu_budget = SIZE_MAX,
+        .model_gpu_budget = SIZE_MAX,
+        .load_jobs = pool_init(sizeof(LoadJob)),
+        .finished_loads = ringbuf_init(RINGBUF_MULTI_PRODUCER,
+                                       sizeof(LoadJob *),
+                                       FINISHED_LOADS_CAPACITY),
     };
 }
 
-int scene_add(Entity entity, EntityHandle *out_entity_handle,
-              const char *asset_directory) {
+// Runs on a worker thread.
+static void read_load_job_files(void *argument) {
+    LoadJob *job = argument;
+    job->model_data = read_file(job->model_filepath, &job->model_data_size);
+    job->image_data = aseprite_load(job->texture_filepath);
+
+    while (ringbuf_push(&scene.finished_loads, &job))
+        sched_yield();
+}
+
+// Creates the model and textures of a load job whose files have been read.
+static void finish_load_job(LoadJob *job) {
+    SceneModel *scene_model = modelmap_get(&scene.models, job->model_handle);
+    if (scene_model) {
+        scene_model->is_loading = 0;
+
+        finishing_job = job;
+        load_model(job->model_filepath, job->model_handle);
+        finishing_job = 0;
+
+        texture_load_model_texture_from_image_data(&job->image_data,
+                                                   &scene_model->model);
+        update_memory_usage(scene_model);
+        static_batch_mark_model_dirty(job->model_handle);
+    }
+
+    if (job->model_data)
+        free(job->model_data);
+    aseprite_image_data_free(&job->image_data);
+    pool_release(&scene.load_jobs, job);
+    scene.pending_loads--;
+}
+
+void scene_set_model_memory_budget(size_t cpu_bytes, size_t gpu_bytes) {
+    scene.model_cpu_budget = cpu_bytes;
+    scene.model_gpu_budget = gpu_bytes;
+    evict_unused_models();
+}
 
-    if (scene.entities_used >= scene.entities_allocated) {
-        // Grow buffer
-        scene.entities_allocated *= ENTITIES_GROWTH_FACTOR;
-        scene.entities =
-            realloc(scene.entities, scene.entities_allocated * sizeof(Entity));
-        if (!scene.entities)
-            return 1;
-    }
-
-    char *asset_name = assets_get_name(entity.asset_handle);
-    assert(asset_name);
-
-    // Check if model of entity already loaded, connect index
-    size_t i = 0;
-    Entity *scene_entity = 0;
-    int match_found = 0;
-    while ((scene_entity = scene_get_entity(i++))) {
-        char *scene_entity_asset_name =
-            assets_get_name(scene_entity->asset_handle);
-        assert(scene_entity_asset_name);
-
-        if (!strcmp(asset_name, scene_entity_asset_name)) {
-            Model *model_data =
-                modelvec_get(&scene.models, scene_entity->model_handle);
-            assert(model_data);
-
-            entity.model_handle = scene_entity->model_handle;
-            match_found = 1;
+void scene_get_model_memory_usage(size_t *out_cpu_bytes,
+                                  size_t *out_gpu_bytes) {
+    if (out_cpu_bytes)
+        *out_cpu_bytes = scene.model_cpu_bytes;
+    if (out_gpu_bytes)
+        *out_gpu_bytes = scene.model_gpu_bytes;
+}
+
+void scene_set_lod_distances(const float *distances, size_t count) {
+    for (size_t i = 0; i < SCENE_MAX_LOD_LEVELS - 1; i++)
+        scene.lod_distances[i] = i < count ? distances[i] : FLT_MAX;
+}
+
+void scene_set_async_loading(int enabled) {
+    assert(!enabled || worker_pool_is_running());
+    scene.is_async_loading = enabled;
+
+    if (enabled && !placeholder_model.meshCount) {
+        placeholder_model = LoadModelFromMesh(GenMeshCube(1.0, 1.0, 1.0));
+        placeholder_model.materials[0].shader =
+            lighting_scene_get_base_shader();
+    }
+}
+
+int scene_is_async_loading(void) {
+    return scene.is_async_loading;
+}
+
+void scene_process_pending_loads(double time_budget) {
+    double start_time = GetTime();
+    LoadJob *job = 0;
+
+    do {
+        if (ringbuf_pop(&scene.finished_loads, &job))
             break;
-        }
+        finish_load_job(job);
+    } while (GetTime() - start_time < time_budget);
+}
+
+void scene_finish_pending_loads(void) {
+    while (scene.pending_loads) {
+        if (!ringbuf_count(&scene.finished_loads))
+            sched_yield();
+        scene_process_pending_loads(1.0);
     }
+}
+
+size_t scene_get_pending_load_count(void) {
+    return scene.pending_loads;
+}
 
-    // If not, load model
-    if (!match_found) {
-        entity.model_handle = modelvec_append(&scene.models, (Model){0});
+// Makes room for at least `count` entities. Returns 1 on error.
+static inline int reserve_entities(size_t count) {
+    if (count <= scene.entities_allocated)
+        return 0;
 
-        char *asset_filename = assets_get_name(entity.asset_handle);
-        assert(asset_filename);
+    size_t entities_allocated = scene.entities_allocated;
+    if (!entities_allocated)
+        entities_allocated = ENTITIES_STARTING_SIZE;
+    while (entities_allocated < count)
+        entities_allocated *= ENTITIES_GROWTH_FACTOR;
 
-        char texture_filepath[MAX_PATH_LENGTH] = {0};
-        char model_filepath[MAX_PATH_LENGTH] = {0};
+    Entity *entities =
+        realloc(scene.entities, entities_allocated * sizeof(Entity));
+    if (!entities)
+        return 1;
 
-        strcpy(texture_filepath, asset_directory);
-        strcat(texture_filepath, asset_filename);
-        strcpy(model_filepath, asset_directory);
-        strcat(model_filepath, asset_filename);
+    scene.entities = entities;
+    scene.entities_allocated = entities_allocated;
+    return 0;
+}
 
-        strcat(model_filepath, ".glb");
-        strcat(texture_filepath, ".aseprite");
+// Starts watching the files of asset `asset_handle` for changes unless they
+// are watched already.
+static void watch_asset_files(AssetHandle asset_handle,
+                              const char *model_filepath,
+                              const char *texture_filepath) {
+    if (asset_handle >= watched_assets_allocated) {
+        size_t allocated = max(asset_handle + 1, watched_assets_allocated * 2);
+        watched_assets = realloc(watched_assets, allocated);
+        if (!watched_assets)
+            abort();
+        memset(watched_assets + watched_assets_allocated, 0,
+               allocated - watched_assets_allocated);
+        watched_assets_allocated = allocated;
+    }
+    if (watched_assets[asset_handle])
+        return;
+    watched_assets[asset_handle] = 1;
+
+    firewatch_new_file_ex(model_filepath, 0, asset_handle, LOAD_KIND_MODEL);
+    firewatch_new_file_ex(texture_filepath, 0, asset_handle,
+                          LOAD_KIND_TEXTURE);
+}
+
+// Loads the model and texture of asset `asset_handle` into a new model slot.
+static inline ModelHandle load_asset_model(AssetHandle asset_handle,
+                                           const char *asset_directory) {
+    ModelHandle model_handle = modelmap_insert(
+        &scene.models, (SceneModel){.is_loading = scene.is_async_loading,
+                                    .asset_handle = asset_handle,
+                                    .lod_assets = {asset_handle},
+                                    .lod_count = 1});
+    SceneModel *scene_model = modelmap_get(&scene.models, model_handle);
+    while (scene_model->lod_count < SCENE_MAX_LOD_LEVELS &&
+           !assets_get_lod_handle(
+               asset_handle, scene_model->lod_count,
+               scene_model->lod_assets + scene_model->lod_count))
+        scene_model->lod_count++;
+
+    char *asset_filename = assets_get_name(asset_handle);
+    assert(asset_filename);
+
+    char texture_filepath[MAX_PATH_LENGTH] = {0};
+    char model_filepath[MAX_PATH_LENGTH] = {0};
+
+    strcpy(texture_filepath, asset_directory);
+    strcat(texture_filepath, asset_filename);
+    strcpy(model_filepath, asset_directory);
+    strcat(model_filepath, asset_filename);
+
+    strcat(model_filepath, ".glb");
+    strcat(texture_filepath, ".aseprite");
 
 #ifndef NO_HOT_RELOAD
-        firewatch_new_file_ex(model_filepath, 0, entity.model_handle,
-                              LOAD_KIND_MODEL);
-        firewatch_new_file_ex(texture_filepath, 0, entity.model_handle,
-                              LOAD_KIND_TEXTURE);
+    watch_asset_files(asset_handle, model_filepath, texture_filepath);
 #endif
 
-        load_model(model_filepath, entity.model_handle);
-        load_texture(texture_filepath, entity.model_handle);
+    if (scene.is_async_loading) {
+        LoadJob *job = pool_allocate(&scene.load_jobs);
+        *job = (LoadJob){.model_handle = model_handle};
+        strcpy(job->model_filepath, model_filepath);
+        strcpy(job->texture_filepath, texture_filepath);
+
+        scene.pending_loads++;
+        worker_pool_submit(read_load_job_files, job);
+    } else {
+        load_model(model_filepath, model_handle);
+        load_texture(texture_filepath, model_handle);
+    }
+
+    scene_check_for_model_file_updates();
 
-        scene_check_for_model_file_updates();
+    return model_handle;
+}
+
+// Returns the model of asset `asset_handle`, loading it first if no entity has
+// used that asset yet.
+static inline ModelHandle get_asset_model(AssetHandle asset_handle,
+                                          const char *asset_directory) {
+    if (asset_handle >= scene.asset_models_allocated) {
+        size_t asset_models_allocated =
+            max(asset_handle + 1, scene.asset_models_allocated * 2);
+        scene.asset_models = realloc(
+            scene.asset_models, asset_models_allocated * sizeof(ModelHandle));
+        if (!scene.asset_models)
+            abort();
+
+        for (size_t i = scene.asset_models_allocated;
+             i < asset_models_allocated; i++)
+            scene.asset_models[i] = SLOTMAP_HANDLE_NULL;
+        scene.asset_models_allocated = asset_models_allocated;
     }
 
-    scene.entities[scene.entities_used++] = entity;
+    ModelHandle model_handle = scene.asset_models[asset_handle];
+    if (modelmap_get(&scene.models, model_handle))
+        return model_handle;
 
-    if (out_entity_handle)
-        *out_entity_handle = scene.entities_used - 1;
+    model_handle = load_asset_model(asset_handle, asset_directory);
+    scene.asset_models[asset_handle] = model_handle;
+    return model_handle;
+}
 
+int scene_add(Entity entity, EntityHandle *out_entity_handle,
+              const char *asset_directory) {
+    return scene_add_many(&entity, 1, out_entity_handle, asset_directory);
+}
+
+int scene_add_many(Entity *entities, size_t count,
+                   EntityHandle *out_entity_handles,
+                   const char *asset_directory) {
+    size_t reused_slots = min(count, scene.free_entities_used);
+    if (reserve_entities(scene.entities_used + count - reused_slots))
+        return 1;
+
+    for (size_t i = 0; i < count; i++) {
+        Entity entity = entities[i];
+        entity.id = next_entity_id++;
+        entity.lod_level = 0;
+        entity.lod_model_handle = SLOTMAP_HANDLE_NULL;
+        entity.world_bounds_revision = 0;
+        entity.model_handle =
+            get_asset_model(entity.asset_handle, asset_directory);
+        reference_model(entity.model_handle);
+
+        // Reuse slots of destroyed entities first
+        EntityHandle handle = scene.entities_used;
+        if (scene.free_entities_used)
+            handle = scene.free_entities[--scene.free_entities_used];
+        else
+            scene.entities_used++;
+
+        scene.entities[handle] = entity;
+        if (entity.is_static)
+            static_batch_add_entity(handle,
+                                    matrix_get_position(entity.transform));
+        if (out_entity_handles)
+            out_entity_handles[i] = handle;
+    }
+
+    evict_unused_models();
     return 0;
 }
 
 void scene_remove(EntityHandle handle) {
-    if (handle < scene.entities_used)
-        scene.entities[handle].is_destroyed = 1;
+    if (handle >= scene.entities_used || scene.entities[handle].is_destroyed)
+        return;
+
+    scene.entities[handle].is_destroyed = 1;
+    if (scene.entities[handle].is_static)
+        static_batch_remove_entity(
+            handle, matrix_get_position(scene.entities[handle].transform));
+    release_model(scene.entities[handle].model_handle);
+    release_model(scene.entities[handle].lod_model_handle);
+
+    if (scene.free_entities_used >= scene.free_entities_allocated) {
+        scene.free_entities_allocated =
+            scene.free_entities_allocated
+                ? scene.free_entities_allocated * ENTITIES_GROWTH_FACTOR
+                : ENTITIES_STARTING_SIZE;
+        scene.free_entities =
+            realloc(scene.free_entities,
+                    scene.free_entities_allocated * sizeof(EntityHandle));
+        if (!scene.free_entities)
+            abort();
+    }
+    scene.free_entities[scene.free_entities_used++] = handle;
+
+    for (size_t i = 0; i < entity_listener_count; i++) {
+        if (entity_listeners[i].entity_removed)
+            entity_listeners[i].entity_removed(handle,
+                                               entity_listeners[i].user_data);
+    }
+
+    evict_unused_models();
+}
+
+size_t scene_compact(EntityHandle *out_handle_mapping) {
+    size_t old_count = scene.entities_used;
+    size_t new_count = 0;
+
+    // Listeners need the mapping even if the caller doesn't
+    EntityHandle *handle_mapping = out_handle_mapping;
+    if (!handle_mapping && entity_listener_count) {
+        handle_mapping = malloc(max(old_count, 1) * sizeof(EntityHandle));
+        if (!handle_mapping)
+            abort();
+    }
+
+    for (size_t i = 0; i < old_count; i++) {
+        if (scene.entities[i].is_destroyed) {
+            if (handle_mapping)
+                handle_mapping[i] = SCENE_ENTITY_HANDLE_NONE;
+            continue;
+        }
+
+        if (handle_mapping)
+            handle_mapping[i] = new_count;
+        if (new_count != i)
+            scene.entities[new_count] = scene.entities[i];
+        new_count++;
+    }
+
+    scene.entities_used = new_count;
+    scene.free_entities_used = 0;
+
+    for (size_t i = 0; i < entity_listener_count; i++) {
+        if (entity_listeners[i].entities_moved)
+            entity_listeners[i].entities_moved(handle_mapping, old_count,
+                                               entity_listeners[i].user_data);
+    }
+    if (handle_mapping != out_handle_mapping)
+        free(handle_mapping);
+
+    return old_count - new_count;
+}
+
+size_t scene_get_entity_count(void) {
+    return scene.entities_used;
+}
+
+int scene_add_entity_listener(SceneEntityListener listener) {
+    if (entity_listener_count >= SCENE_MAX_ENTITY_LISTENERS)
+        return 1;
+    entity_listeners[entity_listener_count++] = listener;
+    return 0;
+}
+
+void scene_remove_entity_listener(SceneEntityListener listener) {
+    for (size_t i = 0; i < entity_listener_count; i++) {
+        SceneEntityListener *other = entity_listeners + i;
+        if (other->entity_removed != listener.entity_removed ||
+            other->entities_moved != listener.entities_moved ||
+            other->user_data != listener.user_data)
+            continue;
+
+        entity_listeners[i] = entity_listeners[--entity_listener_count];
+        return;
+    }
+}
+
+// Moves `level` up or down to match `distance`, only moving back once the
+// distance is clearly past the threshold.
+static inline size_t select_lod_level(size_t level, float distance,
+                                      size_t level_count) {
+    if (level >= level_count)
+        level = level_count - 1;
+
+    const float grow = 1.0f + SCENE_LOD_HYSTERESIS;
+    const float shrink = 1.0f - SCENE_LOD_HYSTERESIS;
+
+    while (level + 1 < level_count &&
+           distance > scene.lod_distances[level] * grow)
+        level++;
+    while (level > 0 && distance < scene.lod_distances[level - 1] * shrink)
+        level--;
+
+    return level;
+}
+
+void scene_update_lods(Camera3D camera, const char *asset_directory) {
+    for (size_t i = 0; i < scene.entities_used; i++) {
+        Entity *entity = scene.entities + i;
+        if (entity->is_destroyed)
+            continue;
+
+        SceneModel *scene_model =
+            modelmap_get(&scene.models, entity->model_handle);
+        if (!scene_model)
+            continue;
+
+        size_t level = 0;
+        if (scene_model->lod_count > 1) {
+            float distance = Vector3Distance(
+                camera.position, matrix_get_position(entity->transform));
+            level = select_lod_level(entity->lod_level, distance,
+                                     scene_model->lod_count);
+        }
+        if (level == entity->lod_level)
+            continue;
+
+        AssetHandle lod_asset = scene_model->lod_assets[level];
+        release_model(entity->lod_model_handle);
+        entity->lod_model_handle = SLOTMAP_HANDLE_NULL;
+        entity->lod_level = level;
+
+        if (level) {
+            entity->lod_model_handle =
+                get_asset_model(lod_asset, asset_directory);
+            reference_model(entity->lod_model_handle);
+        }
+    }
+
+    evict_unused_models();
+}
+
+void scene_set_entity_transform(EntityHandle handle, Matrix transform) {
+    Entity *entity = scene_get_entity(handle);
+    if (!entity)
+        return;
+
+    // Both the region it leaves and the one it enters change
+    if (entity->is_static && !entity->is_destroyed) {
+        static_batch_remove_entity(handle,
+                                   matrix_get_position(entity->transform));
+        static_batch_add_entity(handle, matrix_get_position(transform));
+    }
+    entity->transform = transform;
+    scene_entity_get_world_bounds(entity);
+}
+
+void scene_set_entity_static(EntityHandle handle, int is_static) {
+    Entity *entity = scene_get_entity(handle);
+    if (!entity || entity->is_static == is_static)
+        return;
+
+    entity->is_static = is_static;
+    if (entity->is_destroyed)
+        return;
+    if (is_static)
+        static_batch_add_entity(handle, matrix_get_position(entity->transform));
+    else
+        static_batch_remove_entity(handle,
+                                   matrix_get_position(entity->transform));
+}
+
+int scene_get_model_bounds(ModelHandle handle, BoundingBox *out_box,
+                           Vector3 *out_sphere_center,
+                           float *out_sphere_radius) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    if (!scene_model || !scene_model->revision)
+        return 1;
+
+    if (out_box)
+        *out_box = scene_model->bounds;
+    if (out_sphere_center)
+        *out_sphere_center = scene_model->bounding_sphere_center;
+    if (out_sphere_radius)
+        *out_sphere_radius = scene_model->bounding_sphere_radius;
+    return 0;
+}
+
+BoundingBox scene_entity_get_world_bounds(Entity *entity) {
+    SceneModel *scene_model = modelmap_get(&scene.models, entity->model_handle);
+    if (!scene_model)
+        return (BoundingBox){0};
+
+    // Not cached as the placeholder is only around for a moment
+    if (!scene_model->revision)
+        return bounding_box_transform(GetModelBoundingBox(placeholder_model),
+                                      entity->transform);
+
+    // Callers may write the transform directly, so compare it as well
+    if (entity->world_bounds_revision != scene_model->revision ||
+        memcmp(&entity->world_bounds_transform, &entity->transform,
+               sizeof(Matrix))) {
+        entity->world_bounds =
+            bounding_box_transform(scene_model->bounds, entity->transform);
+        entity->world_bounds_transform = entity->transform;
+        entity->world_bounds_revision = scene_model->revision;
+    }
+    return entity->world_bounds;
+}
+
+size_t scene_get_model_count(void) {
+    return scene.models.data_used;
+}
+
+ModelHandle scene_get_model_handle(size_t index) {
+    return modelmap_dense_handle(&scene.models, index);
+}
+
+AssetHandle scene_get_model_asset(ModelHandle handle) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    if (!scene_model)
+        return 0;
+    return scene_model->asset_handle;
+}
+
+int scene_is_model_loading(ModelHandle handle) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    return scene_model && scene_model->is_loading;
 }
 
 Entity *scene_get_entity(EntityHandle handle) {
@@ -152,15 +838,27 @@ Entity *scene_get_entity(EntityHandle handle) {
     return scene.entities + handle;
 }
 
+Entity *scene_get_entity_by_id(EntityHandle handle, uint64_t id) {
+    Entity *entity = scene_get_entity(handle);
+    if (!entity || entity->is_destroyed || entity->id != id)
+        return 0;
+    return entity;
+}
+
 void scene_check_for_model_file_updates(void) {
     static LoadRequest request = {0};
     while (firewatch_request_stack_pop(&request)) {
+        // Watches are made per asset, its model may be evicted meanwhile
+        ModelHandle handle = SLOTMAP_HANDLE_NULL;
+        if (request.cookie < scene.asset_models_allocated)
+            handle = scene.asset_models[request.cookie];
+
         switch (request.kind) {
         case LOAD_KIND_MODEL:
-            load_model(request.filepath, request.cookie);
+            load_model(request.filepath, handle);
             break;
         case LOAD_KIND_TEXTURE:
-            load_texture(request.filepath, request.cookie);
+            load_texture(request.filepath, handle);
             break;
         default:
             break;
@@ -169,22 +867,63 @@ void scene_check_for_model_file_updates(void) {
 }
 
 void scene_free(void) {
-    size_t i = 0;
-    Model *model = 0;
-    while ((model = modelvec_get(&scene.models, i++)))
-        UnloadModel(*model);
+    // Throw away loads still in flight
+    LoadJob *job = 0;
+    while (scene.pending_loads) {
+        if (ringbuf_pop(&scene.finished_loads, &job)) {
+            sched_yield();
+            continue;
+        }
+        if (job->model_data)
+            free(job->model_data);
+        aseprite_image_data_free(&job->image_data);
+        scene.pending_loads--;
+    }
+    pool_free(&scene.load_jobs);
+    ringbuf_free(&scene.finished_loads);
+
+    for (size_t i = 0; i < scene.models.data_used; i++)
+        unload_scene_model(scene.models.data + i);
+    if (placeholder_model.meshCount)
+        UnloadModel(placeholder_model);
+    placeholder_model = (Model){0};
 
-    modelvec_free(&scene.models);
+    modelmap_free(&scene.models);
     if (scene.entities)
         free(scene.entities);
+    if (scene.asset_models)
+        free(scene.asset_models);
+    if (scene.free_entities)
+        free(scene.free_entities);
+    scene = (Scene){0};
 }
 
 Model *scene_entity_get_model(Entity *entity) {
-    return modelvec_get(&scene.models, entity->model_handle);
+    return scene_get_model(scene_entity_get_model_handle(entity));
+}
+
+ModelHandle scene_entity_get_model_handle(Entity *entity) {
+    // Full detail is drawn until the level of detail model has loaded
+    SceneModel *lod_model =
+        modelmap_get(&scene.models, entity->lod_model_handle);
+    if (lod_model && !lod_model->is_loading)
+        return entity->lod_model_handle;
+    return entity->model_handle;
+}
+
+Model *scene_get_model(ModelHandle handle) {
+    SceneModel *scene_model = modelmap_get(&scene.models, handle);
+    if (!scene_model)
+        return 0;
+    if (scene_model->is_loading)
+        return &placeholder_model;
+    return &scene_model->model;
 }
 
 void scene_skybox_init(const char *skybox_model_path) {
+    SetLoadFileDataCallback(load_prefetched_file_data);
     skybox_model = LoadModel(skybox_model_path);
+    SetLoadFileDataCallback(0);
 }
 
 void scene_load_selected_skybox(const char *skybox_directory) {
@@ -216,5 +955,6 @@ SkyboxHandle scene_get_skybox(void) {
 void scene_render_skybox(Camera3D camera) {
     BeginMode3D(camera);
     DrawModel(skybox_model, camera.position, 1.0, WHITE);
+    scene_stats_add_draw_calls(skybox_model.meshCount);
     EndMode3D();
 }
@@ -2,43 +2,232 @@
 #define _SCENE
 
 #include "handles.h"
-#include "model_vector.h"
+#include "pool.h"
+#include "ring_buffer.h"
+#include "slotmap.h"
 #include <raylib.h>
 #include <raymath.h>
 #include <stddef.h>
 #include <stdint.h>
 
+// Levels of detail per model, the full detail model included.
+#define SCENE_MAX_LOD_LEVELS 4
+// How far past a level of detail threshold the camera has to move, as a
+// fraction of the threshold, before the level changes back. Keeps entities
+// sitting right at a threshold from flickering between levels.
+#define SCENE_LOD_HYSTERESIS 0.1f
+
+// Marks a removed entity in the handle mapping written by scene_compact.
+#define SCENE_ENTITY_HANDLE_NONE SIZE_MAX
+// Most entity listeners that can be added at once.
+#define SCENE_MAX_ENTITY_LISTENERS 8
+
 // Base entity data
 typedef struct {
+    // Set by scene_add, never shared by two entities even if one reuses the
+    // slot of the other.
+    uint64_t id;
     AssetHandle asset_handle;
     ModelHandle model_handle;
     Matrix transform;
     int is_destroyed;
     int ignore_raycast;
+    // Static entities are drawn as part of merged static batches, change their
+    // transform only with scene_set_entity_transform.
+    int is_static;
+    // Level of detail picked by scene_update_lods, 0 being full detail.
+    size_t lod_level;
+    // Model drawn in place of `model_handle` at `lod_level` above 0.
+    ModelHandle lod_model_handle;
+    // Cached by scene_entity_get_world_bounds, valid while
+    // `world_bounds_revision` matches the revision of the model and
+    // `world_bounds_transform` matches `transform`.
+    BoundingBox world_bounds;
+    Matrix world_bounds_transform;
+    uint32_t world_bounds_revision;
 } Entity;
 
+typedef struct {
+    Model model;
+    // Set while the files of the model are being read on a worker thread, a
+    // placeholder model is drawn in its place until then.
+    int is_loading;
+    // Bumped every time the model is (re)loaded, 0 until the first load.
+    uint32_t revision;
+    // Bounds in model space, model transform included.
+    BoundingBox bounds;
+    Vector3 bounding_sphere_center;
+    float bounding_sphere_radius;
+    AssetHandle asset_handle;
+    // Assets of each level of detail, found by name next to the model file.
+    // The first one is `asset_handle` itself.
+    AssetHandle lod_assets[SCENE_MAX_LOD_LEVELS];
+    size_t lod_count;
+    // Amount of living entities using the model.
+    size_t reference_count;
+    // Estimated memory used by the model and its textures.
+    size_t cpu_bytes;
+    size_t gpu_bytes;
+    // Neighbours in the list of unreferenced models, SLOTMAP_HANDLE_NULL at
+    // either end.
+    ModelHandle lru_previous;
+    ModelHandle lru_next;
+} SceneModel;
+
+SLOTMAP_DECLARE(SceneModel, ModelSlotMap, modelmap)
+
+// Lets code that holds on to entity handles follow removals and compaction.
+// Either callback may be NULL.
+typedef struct {
+    // Called by scene_remove before the slot of `handle` can be reused.
+    void (*entity_removed)(EntityHandle handle, void *user_data);
+    // Called by scene_compact with the new handle of each of the `count` old
+    // handles, SCENE_ENTITY_HANDLE_NONE for dropped entities.
+    void (*entities_moved)(const EntityHandle *handle_mapping, size_t count,
+                           void *user_data);
+    void *user_data;
+} SceneEntityListener;
+
 typedef struct {
     Entity *entities;
     size_t entities_used;
     size_t entities_allocated;
-    ModelVector models;
+    // Slots of destroyed entities, reused by scene_add before growing.
+    EntityHandle *free_entities;
+    size_t free_entities_used;
+    size_t free_entities_allocated;
+    ModelSlotMap models;
+    // Model of each asset indexed by AssetHandle, SLOTMAP_HANDLE_NULL for
+    // assets that no entity has used yet.
+    ModelHandle *asset_models;
+    size_t asset_models_allocated;
     SkyboxHandle skybox_handle;
+    // Camera distance at which each level of detail past the first begins.
+    float lod_distances[SCENE_MAX_LOD_LEVELS - 1];
+    // Estimated memory used by all loaded models.
+    size_t model_cpu_bytes;
+    size_t model_gpu_bytes;
+    size_t model_cpu_budget;
+    size_t model_gpu_budget;
+    // Models no entity uses, least recently used first. These get unloaded
+    // when the memory budget is exceeded.
+    ModelHandle unused_models_first;
+    ModelHandle unused_models_last;
+    int is_async_loading;
+    // Background loads whose files are still being read or that have not yet
+    // been finished by scene_process_pending_loads.
+    size_t pending_loads;
+    Pool load_jobs;
+    // Load jobs whose files have been read, pushed by the worker threads.
+    RingBuffer finished_loads;
 } Scene;
 
 void scene_init(void);
 void scene_free(void);
 
-// Adds a new entity to the scene. Assumes a raylib context is already
-// initialized. Returns 1 on error.
+// Adds a new entity to the scene, reusing the slot of a destroyed entity if
+// there is one. Assumes a raylib context is already initialized. Returns 1 on
+// error.
 int scene_add(Entity entity, EntityHandle *out_entity_handle,
               const char *asset_directory);
-// Removes an entity from the scene by `handle`.
+// Adds `count` entities to the scene at once, loading the model of each unique
+// asset only once. Handles of the added entities are written to
+// `out_entity_handles` if it is not NULL. Returns 1 on error.
+int scene_add_many(Entity *entities, size_t count,
+                   EntityHandle *out_entity_handles,
+                   const char *asset_directory);
+// Removes an entity from the scene by `handle`. The slot of the entity will be
+// reused by a later scene_add, so `handle` must not be used afterwards.
 void scene_remove(EntityHandle handle);
+// Drops destroyed entities from the scene and moves the remaining ones down to
+// close the gaps, which changes their handles. If `out_handle_mapping` is not
+// NULL it must have room for scene_get_entity_count() handles, the new handle
+// of each old handle is written to it, SCENE_ENTITY_HANDLE_NONE for destroyed
+// entities. Entity listeners are given the mapping either way. Returns the
+// amount of entities dropped.
+size_t scene_compact(EntityHandle *out_handle_mapping);
+// Returns the amount of entity slots in use, destroyed entities included.
+size_t scene_get_entity_count(void);
+// Adds a listener that is told about every entity removal and compaction from
+// then on. Listeners outlive scene_free. Returns 1 if there are already
+// SCENE_MAX_ENTITY_LISTENERS listeners.
+int scene_add_entity_listener(SceneEntityListener listener);
+// Removes a listener added with the same callbacks and `user_data`.
+void scene_remove_entity_listener(SceneEntityListener listener);
+// Sets how much memory loaded models may use in total. Models no entity uses
+// anymore are unloaded in least recently used order while over budget, and
+// loaded again when an entity needs them. Referenced models are never unloaded,
+// so the budget can still be exceeded. Both are unlimited by default.
+void scene_set_model_memory_budget(size_t cpu_bytes, size_t gpu_bytes);
+// Gets the estimated memory used by loaded models.
+void scene_get_model_memory_usage(size_t *out_cpu_bytes,
+                                  size_t *out_gpu_bytes);
+
+// Sets the camera distances at which each level of detail past the full detail
+// model begins, in increasing order. Levels past `count` are never used.
+void scene_set_lod_distances(const float *distances, size_t count);
+// Picks the level of detail of every entity based on its distance to `camera`,
+// loading the models of newly used levels from `asset_directory`. Models with
+// no "<name>_lod<n>" assets are always drawn at full detail.
+void scene_update_lods(Camera3D camera, const char *asset_directory);
+
+// Makes scene_add read and decode the files of new assets on worker threads
+// instead of stalling the caller, worker_pool_init must be called before
+// enabling this. Entities of assets that are still loading use a placeholder
+// model. Assumes a raylib context is already initialized.
+void scene_set_async_loading(int enabled);
+// Returns 1 if async loading is enabled.
+int scene_is_async_loading(void);
+// Uploads models and textures read in the background to the GPU until
+// `time_budget` seconds have passed, finishing at least one load per call if
+// any are ready. Call this every frame while loads are pending.
+void scene_process_pending_loads(double time_budget);
+// Blocks until every background load has been finished.
+void scene_finish_pending_loads(void);
+// Returns the amount of models still being loaded in the background.
+size_t scene_get_pending_load_count(void);
+
+// Sets the transform of entity `handle`, rebuilding the static batches it is
+// part of.
+void scene_set_entity_transform(EntityHandle handle, Matrix transform);
+// Marks entity `handle` as static or not.
+void scene_set_entity_static(EntityHandle handle, int is_static);
+// Gets the model space bounding box and bounding sphere of model `handle`,
+// computed once per load. Returns 1 if the model does not exist or is still
+// loading.
+int scene_get_model_bounds(ModelHandle handle, BoundingBox *out_box,
+                           Vector3 *out_sphere_center,
+                           float *out_sphere_radius);
+// Gets the world space bounding box of `entity` at full detail. The box is
+// cached along with the transform it was calculated from, and recalculated
+// once the transform, however it was set, or the model of the entity has
+// changed.
+BoundingBox scene_entity_get_world_bounds(Entity *entity);
+// Returns the amount of loaded models, models still loading included.
+size_t scene_get_model_count(void);
+// Returns the handle of the `index`th model, for iterating over all models
+// together with scene_get_model_count.
+ModelHandle scene_get_model_handle(size_t index);
+// Gets the asset model `handle` was loaded from.
+AssetHandle scene_get_model_asset(ModelHandle handle);
+// Returns 1 while the model of `handle` is being loaded in the background.
+int scene_is_model_loading(ModelHandle handle);
+
 // Gets entity of `scene` by `id`, returns 0 when no entity for that index
 // exists.
 Entity *scene_get_entity(EntityHandle handle);
-// Gets the model of an entity.
+// Gets entity `handle` only if it is alive and still the entity `id` was given
+// to, returns 0 once it has been removed or its slot reused.
+Entity *scene_get_entity_by_id(EntityHandle handle, uint64_t id);
+// Gets the model of an entity at its current level of detail, returns 0 if the
+// model no longer exists. Returns the placeholder model while the model is
+// loading.
 Model *scene_entity_get_model(Entity *entity);
+// Gets the handle of the model of an entity at its current level of detail.
+ModelHandle scene_entity_get_model_handle(Entity *entity);
+// Gets a model by `handle`, returns 0 if the model no longer exists. Returns
+// the placeholder model while the model is loading.
+Model *scene_get_model(ModelHandle handle);
 
 // Initializes the skybox, call this before any other skybox functions.
 void scene_skybox_init(const char *skybox_model_path);
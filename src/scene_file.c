@@ -2,34 +2,296 @@
 
 #include "assets.h"
 #include "common.h"
+#include "compression.h"
+#include "crc32c.h"
 #include "general_buffer.h"
 #include "handles.h"
 #include "lighting.h"
 #include "scene.h"
 #include "skyboxes.h"
+#include "streaming.h"
+#include "string_vector.h"
 #include "terrain.h"
 #include "terrain_textures.h"
+#include "worker_pool.h"
 #include <assert.h>
+#include <math.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
+static int is_terrain_compressed = 0;
+static int is_entities_compact = 0;
+
+// Entity slot of handles that have no entity in the saved scene.
+#define SAVED_SLOT_NONE UINT64_MAX
+#define JOURNAL_ALIGNMENT 8
+// Largest difference between a transform and its compact entity, relative to
+// the length of each axis.
+#define COMPACT_ENTITY_TOLERANCE 1e-3f
+
+typedef struct {
+    // Index in the entity table of the file, SAVED_SLOT_NONE if none
+    uint64_t slot;
+    SceneFileEntity record;
+} SavedEntity;
+
+// What was last written to the scene file, incremental saves write the
+// difference between this and the current scene.
+typedef struct {
+    int is_valid;
+    // Where the next journal record goes
+    size_t file_size;
+    uint32_t section_table_checksum;
+    // Indexed by entity handle
+    SavedEntity *entities;
+    size_t entity_count;
+    size_t entities_allocated;
+    // Slots in the entity table of the file, removed entities included
+    uint64_t slot_count;
+    // Set if the file has entities held back by streaming, which have no
+    // handle to be tracked by
+    int has_streamed_entities;
+    StringVector asset_names;
+    // A SceneFileLightingScene followed by the light sources
+    GeneralBuffer lighting;
+    SceneFileSkybox skybox;
+    SceneFileTerrainInfo terrain_info;
+} SavedScene;
+
+static SavedScene saved = {0};
+
+// Everything needed to write a full scene file, captured on the main thread so
+// that the file can be written on a worker thread.
+typedef struct {
+    // Sections before the terrain data
+    GeneralBuffer content;
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT];
+    size_t section_count;
+    SceneFileHeader header;
+    int is_terrain_compressed;
+    // Copied if the snapshot is written on a worker thread, borrowed from the
+    // terrain otherwise
+    float *heights;
+    uint8_t *texture_indices;
+    uint32_t terrain_width;
+    int owns_terrain_data;
+} Snapshot;
+
+// A compaction started by scene_file_compact.
+typedef struct {
+    Snapshot snapshot;
+    char *filepath;
+    size_t file_size;
+    int has_failed;
+} Compaction;
+
+static Compaction *compaction = 0;
+static atomic_int is_compacting = 0;
+
+// Moves the saved entities to their handles after scene_compact. Entities
+// dropped while their slot is still in the file would be left there, so the
+// next incremental save writes a full snapshot instead.
+static void on_entities_moved(const EntityHandle *handle_mapping, size_t count,
+                              void *_unused) {
+    (void)_unused;
+    size_t entity_count = 0;
+    for (size_t old = 0; old < saved.entity_count; old++) {
+        SavedEntity *saved_entity = &saved.entities[old];
+        EntityHandle handle =
+            old < count ? handle_mapping[old] : SCENE_ENTITY_HANDLE_NONE;
+        if (handle == SCENE_ENTITY_HANDLE_NONE) {
+            if (saved_entity->slot != SAVED_SLOT_NONE)
+                saved.is_valid = 0;
+            continue;
+        }
+
+        // Entities only move down, so nothing unread is overwritten
+        saved.entities[handle] = *saved_entity;
+        entity_count = handle + 1;
+    }
+    saved.entity_count = entity_count;
+}
+
+// Starts following entity handles, the saved entities are indexed by them.
+static void track_entity_handles(void) {
+    static int is_tracking = 0;
+    if (is_tracking)
+        return;
+    is_tracking = !scene_add_entity_listener(
+        (SceneEntityListener){.entities_moved = on_entities_moved});
+    assert(is_tracking);
+}
+
+static void reserve_saved_entities(size_t count) {
+    if (count > saved.entities_allocated) {
+        size_t allocated = max(saved.entities_allocated * 2, count);
+        saved.entities =
+            realloc(saved.entities, allocated * sizeof(SavedEntity));
+        if (!saved.entities)
+            abort();
+        saved.entities_allocated = allocated;
+    }
+    for (size_t i = saved.entity_count; i < count; i++)
+        saved.entities[i].slot = SAVED_SLOT_NONE;
+}
+
+// Writes the record of `entity` with padding zeroed, so that records can be
+// compared with memcmp.
+static inline void make_file_entity(const Entity *entity, uint32_t asset_index,
+                                    SceneFileEntity *out_entity) {
+    memset(out_entity, 0, sizeof(SceneFileEntity));
+    out_entity->transform = entity->transform;
+    out_entity->asset_index = asset_index;
+    out_entity->ignore_raycast = entity->ignore_raycast;
+    out_entity->is_static = entity->is_static;
+}
+
+static inline void read_compact_entity(const SceneFileCompactEntity *entity,
+                                       SceneFileEntity *out_entity) {
+    Quaternion rotation = compression_decode_quaternion(
+        entity->rotation, entity->rotation_largest);
+    Vector3 scale = {
+        half_to_float(entity->scale[0]),
+        half_to_float(entity->scale[1]),
+        half_to_float(entity->scale[2]),
+    };
+
+    memset(out_entity, 0, sizeof(SceneFileEntity));
+    out_entity->transform = matrix_compose(entity->position, rotation, scale);
+    out_entity->asset_index = entity->asset_index;
+    out_entity->ignore_raycast =
+        (entity->flags & SCENE_FILE_ENTITY_IGNORE_RAYCAST) != 0;
+    out_entity->is_static = (entity->flags & SCENE_FILE_ENTITY_STATIC) != 0;
+}
+
+// Returns 1 if `a` and `b` differ by more than COMPACT_ENTITY_TOLERANCE.
+static int is_transform_different(Matrix a, Matrix b) {
+    const float a_axes[3][4] = {
+        {a.m0, a.m1, a.m2, a.m3},
+        {a.m4, a.m5, a.m6, a.m7},
+        {a.m8, a.m9, a.m10, a.m11},
+    };
+    const float b_axes[3][4] = {
+        {b.m0, b.m1, b.m2, b.m3},
+        {b.m4, b.m5, b.m6, b.m7},
+        {b.m8, b.m9, b.m10, b.m11},
+    };
+
+    for (int axis = 0; axis < 3; axis++) {
+        const float *a_axis = a_axes[axis];
+        float length = sqrtf(a_axis[0] * a_axis[0] + a_axis[1] * a_axis[1] +
+                             a_axis[2] * a_axis[2]);
+        // Also true for NaNs
+        for (int i = 0; i < 4; i++) {
+            if (!(fabsf(a_axis[i] - b_axes[axis][i]) <=
+                  COMPACT_ENTITY_TOLERANCE * length))
+                return 1;
+        }
+    }
+    return a.m12 != b.m12 || a.m13 != b.m13 || a.m14 != b.m14 ||
+           a.m15 != b.m15;
+}
+
+// Returns 1 if the transform of `entity` can't be represented by a compact
+// entity.
+static int make_compact_entity(const SceneFileEntity *entity,
+                               SceneFileCompactEntity *out_entity) {
+    Vector3 position = {0};
+    Quaternion rotation = {0};
+    Vector3 scale = {0};
+    matrix_decompose(entity->transform, &position, &rotation, &scale);
+
+    memset(out_entity, 0, sizeof(SceneFileCompactEntity));
+    out_entity->position = position;
+    out_entity->asset_index = entity->asset_index;
+    compression_encode_quaternion(rotation, out_entity->rotation,
+                                  &out_entity->rotation_largest);
+    out_entity->scale[0] = float_to_half(scale.x);
+    out_entity->scale[1] = float_to_half(scale.y);
+    out_entity->scale[2] = float_to_half(scale.z);
+    if (entity->ignore_raycast)
+        out_entity->flags |= SCENE_FILE_ENTITY_IGNORE_RAYCAST;
+    if (entity->is_static)
+        out_entity->flags |= SCENE_FILE_ENTITY_STATIC;
+
+    SceneFileEntity decoded = {0};
+    read_compact_entity(out_entity, &decoded);
+    return is_transform_different(entity->transform, decoded.transform);
+}
+
+// Strings of a string table section, each stored once.
+typedef struct {
+    GeneralBuffer data;
+    // Open addressing hash table of string offsets plus one, 0 if empty
+    uint32_t *slots;
+    size_t slot_count;
+} StringTable;
+
+// Initializes a string table with room for `max_strings` unique strings.
+static StringTable string_table_init(size_t max_strings) {
+    size_t slot_count = 16;
+    while (slot_count < max_strings * 2)
+        slot_count *= 2;
+
+    StringTable table = {
+        .data = genbuf_init(),
+        .slots = calloc(slot_count, sizeof(uint32_t)),
+        .slot_count = slot_count,
+    };
+    if (!table.slots)
+        abort();
+    return table;
+}
+
+static void string_table_free(StringTable *table) {
+    genbuf_free(&table->data);
+    free(table->slots);
+}
+
+// Returns the offset of `string` in the table, adding it if it isn't there
+// yet. Strings are cut to NAME_MAX_LENGTH - 1 characters.
+static uint32_t string_table_add(StringTable *table, const char *string) {
+    size_t length = strnlen(string, NAME_MAX_LENGTH - 1);
+    size_t mask = table->slot_count - 1;
+    size_t slot = crc32c_update(0, string, length) & mask;
+    for (; table->slots[slot]; slot = (slot + 1) & mask) {
+        const char *existing =
+            (const char *)table->data.data + table->slots[slot] - 1;
+        if (!strncmp(existing, string, length) && existing[length] == 0)
+            return table->slots[slot] - 1;
+    }
+
+    uint32_t offset = table->data.data_size;
+    genbuf_append(&table->data, (void *)string, length);
+    genbuf_allocate(&table->data, 1);
+    table->slots[slot] = offset + 1;
+    return offset;
+}
+
+// Also remembers the names in the saved scene.
 static inline void
-serialize_asset_data_into_buf(GeneralBuffer *buf,
-                              size_t *out_asset_table_entries) {
+serialize_asset_names_into_buf(GeneralBuffer *buf, StringTable *strings,
+                               size_t *out_asset_table_entries) {
     size_t asset_table_entries = assets_get_count();
-    char *asset_table =
-        genbuf_allocate(buf, sizeof(SceneFileAsset) * asset_table_entries);
+    if (saved.asset_names.data)
+        stringvec_truncate(&saved.asset_names);
+    else
+        saved.asset_names = stringvec_init();
 
-    AssetHandle asset_handle = 0;
-    char *asset_name = 0;
-    while ((asset_name = assets_get_name(asset_handle)) &&
-           asset_handle < asset_table_entries) {
-        strncpy(asset_table + asset_handle * sizeof(SceneFileAsset), asset_name,
-                NAME_MAX_LENGTH);
-        asset_handle++;
+    for (AssetHandle handle = 0; handle < asset_table_entries; handle++) {
+        char *asset_name = assets_get_name(handle);
+        uint32_t offset = string_table_add(strings, asset_name);
+        genbuf_append(buf, &offset, sizeof offset);
+        stringvec_append(&saved.asset_names, asset_name,
+                         strnlen(asset_name, NAME_MAX_LENGTH - 1));
     }
 
     if (out_asset_table_entries)
@@ -45,12 +307,14 @@ serialize_lighting_data_into_buf(GeneralBuffer *buf,
     genbuf_append(buf, &file_lighting_scene, sizeof(SceneFileLightingScene));
 
     // Light sources
-    LightSource *light = 0;
-    LightSourceHandle light_handle = 0;
     uint16_t lighting_group_table_entries = 0;
     size_t light_source_table_entries = 0;
 
-    while ((light = lighting_scene_get_light(light_handle++))) {
+    for (size_t i = 0; i < lighting_scene_get_light_count(); i++) {
+        LightSource *light =
+            lighting_scene_get_light(lighting_scene_get_light_handle(i));
+        assert(light);
+
         SceneFileLightSource scene_file_light = {
             .light_group_index = lighting_group_table_entries,
             .color = light->color,
@@ -69,27 +333,70 @@ serialize_lighting_data_into_buf(GeneralBuffer *buf,
         *out_light_source_table_entries = light_source_table_entries;
 }
 
+// Also remembers the slot and record of every entity in the saved scene. The
+// records are written as `SceneFileCompactEntity`s if `out_is_compact` is set
+// on return.
 static inline void
 serialize_entity_data_into_buf(GeneralBuffer *buf,
-                               size_t *out_entity_table_entries) {
+                               size_t *out_entity_table_entries,
+                               int *out_is_compact) {
+    size_t start = buf->data_size;
+    saved.entity_count = 0;
+    reserve_saved_entities(scene_get_entity_count());
+
     EntityHandle entity_handle = 0;
     Entity *entity = 0;
     size_t entity_table_entries = 0;
-    while ((entity = scene_get_entity(entity_handle++))) {
+    for (; (entity = scene_get_entity(entity_handle)); entity_handle++) {
+        SavedEntity *saved_entity = &saved.entities[entity_handle];
+        saved_entity->slot = SAVED_SLOT_NONE;
         if (entity->is_destroyed)
             continue;
-        SceneFileEntity scene_file_entity = {
-            .transform = entity->transform,
-            .ignore_raycast = entity->ignore_raycast,
-            .asset_index = entity->asset_handle,
 
-        };
-        genbuf_append(buf, &scene_file_entity, sizeof(SceneFileEntity));
+        make_file_entity(entity, entity->asset_handle, &saved_entity->record);
+        saved_entity->slot = entity_table_entries++;
+        genbuf_append(buf, &saved_entity->record, sizeof(SceneFileEntity));
+    }
+
+    saved.entity_count = entity_handle;
+
+    // Entities in cells that aren't loaded are only kept by streaming
+    saved.has_streamed_entities = 0;
+    for (size_t i = 0; i < streaming_get_entity_count(); i++) {
+        const Entity *held_entity = streaming_get_held_entity(i);
+        if (!held_entity)
+            continue;
+
+        SceneFileEntity record = {0};
+        make_file_entity(held_entity, held_entity->asset_handle, &record);
+        genbuf_append(buf, &record, sizeof record);
         entity_table_entries++;
+        saved.has_streamed_entities = 1;
     }
+    saved.slot_count = entity_table_entries;
+
+    // Replaces the full records, unless one of them doesn't fit
+    int is_compact = is_entities_compact;
+    GeneralBuffer compact = genbuf_init();
+    for (size_t i = 0; is_compact && i < entity_table_entries; i++) {
+        SceneFileEntity record = {0};
+        memcpy(&record, buf->data + start + i * sizeof(SceneFileEntity),
+               sizeof record);
+        SceneFileCompactEntity *compact_entity =
+            genbuf_allocate(&compact, sizeof(SceneFileCompactEntity));
+        is_compact = !make_compact_entity(&record, compact_entity);
+    }
+    if (is_compact) {
+        buf->data_size = start;
+        if (compact.data_size > 0)
+            genbuf_append(buf, compact.data, compact.data_size);
+    }
+    genbuf_free(&compact);
 
     if (out_entity_table_entries)
         *out_entity_table_entries = entity_table_entries;
+    if (out_is_compact)
+        *out_is_compact = is_compact;
 }
 
 //  NOTE: Currently we are only storing one skybox, good to have futureproofing
@@ -106,13 +413,11 @@ serialize_skybox_data_into_buf(GeneralBuffer *buf,
         *out_skybox_entry_count = 1;
 }
 
-static inline void serialize_terrain_data_into_buf(GeneralBuffer *buf,
-                                                   size_t *out_heights_size,
-                                                   size_t *out_indices_size) {
-    SceneFileTerrainInfo terrain_info = {
-        .top_left_world_pos = terrain.top_left_world_pos,
-        .width = terrain.width,
-    };
+static inline void serialize_terrain_info_into_buf(GeneralBuffer *buf) {
+    SceneFileTerrainInfo *terrain_info =
+        genbuf_allocate(buf, sizeof(SceneFileTerrainInfo));
+    terrain_info->top_left_world_pos = terrain.top_left_world_pos;
+    terrain_info->width = terrain.width;
 
     // Texture names
     for (size_t i = 0; i < TERRAIN_MAX_TEXTURES; i++) {
@@ -120,169 +425,1461 @@ static inline void serialize_terrain_data_into_buf(GeneralBuffer *buf,
         char *texture_name = terrain_textures_get_name(handle);
         if (!texture_name)
             continue;
-        strncpy((char *)(terrain_info.texture_names + i), texture_name,
+        strncpy((char *)(terrain_info->texture_names + i), texture_name,
                 NAME_MAX_LENGTH - 1);
     }
+}
+
+// Encodes the terrain data of `snapshot`.
+static inline void serialize_terrain_data_into_buf(GeneralBuffer *buf,
+                                                   const Snapshot *snapshot,
+                                                   size_t *out_heights_size,
+                                                   size_t *out_indices_size) {
+    uint32_t width = snapshot->terrain_width;
+    size_t terrain_size = (size_t)width * width;
+    int is_compressed = snapshot->is_terrain_compressed;
+
+    size_t start = buf->data_size;
+    if (is_compressed)
+        compression_encode_heights(snapshot->heights, width, buf);
+    else if (terrain_size > 0)
+        genbuf_append(buf, snapshot->heights, terrain_size * sizeof(float));
+    size_t heights_size = buf->data_size - start;
 
-    genbuf_append(buf, &terrain_info, (sizeof terrain_info));
-    genbuf_append(buf, terrain.heights, terrain.size * sizeof(float));
-    genbuf_append(buf, terrain.texture_indices, terrain.size);
+    start = buf->data_size;
+    if (is_compressed)
+        compression_rle_encode(snapshot->texture_indices, terrain_size, buf);
+    else if (terrain_size > 0)
+        genbuf_append(buf, snapshot->texture_indices, terrain_size);
+    size_t indices_size = buf->data_size - start;
 
     if (out_heights_size)
-        *out_heights_size = terrain.size * sizeof(float);
+        *out_heights_size = heights_size;
     if (out_indices_size)
-        *out_indices_size = terrain.size;
+        *out_indices_size = indices_size;
 }
 
-void scene_file_store(FILE *fp) {
-    printf("INFO: saving scene file.\n");
+static inline void add_section(SceneFileSection *sections,
+                               size_t *section_count, SceneFileSectionType type,
+                               size_t offset, size_t size, size_t count,
+                               size_t record_size) {
+    sections[(*section_count)++] = (SceneFileSection){
+        .type = type,
+        .offset = offset,
+        .size = size,
+        .count = count,
+        .record_size = record_size,
+    };
+}
 
-    GeneralBuffer content = genbuf_init();
+// Serializes everything but the terrain data, which is copied if
+// `copy_terrain_data` is set, and makes the current scene the saved one.
+static void capture_snapshot(Snapshot *out_snapshot, int copy_terrain_data) {
+    track_entity_handles();
+    *out_snapshot = (Snapshot){
+        .content = genbuf_init(),
+        .is_terrain_compressed = is_terrain_compressed,
+    };
+    GeneralBuffer *content = &out_snapshot->content;
+    SceneFileSection *sections = out_snapshot->sections;
+    size_t *section_count = &out_snapshot->section_count;
+
+    StringTable strings =
+        string_table_init(assets_get_count() + 1 + TERRAIN_MAX_TEXTURES);
 
     size_t asset_table_entries = 0;
-    serialize_asset_data_into_buf(&content, &asset_table_entries);
+    serialize_asset_names_into_buf(content, &strings, &asset_table_entries);
+    add_section(sections, section_count, SCENE_FILE_SECTION_ASSET_NAMES, 0,
+                content->data_size, asset_table_entries, sizeof(uint32_t));
 
+    size_t offset = content->data_size;
     size_t light_source_table_entries = 0;
-    serialize_lighting_data_into_buf(&content, &light_source_table_entries);
+    serialize_lighting_data_into_buf(content, &light_source_table_entries);
+    add_section(sections, section_count, SCENE_FILE_SECTION_LIGHTING_SCENE,
+                offset, sizeof(SceneFileLightingScene), 1,
+                sizeof(SceneFileLightingScene));
+    add_section(sections, section_count, SCENE_FILE_SECTION_LIGHT_SOURCES,
+                offset + sizeof(SceneFileLightingScene),
+                content->data_size - offset - sizeof(SceneFileLightingScene),
+                light_source_table_entries, sizeof(SceneFileLightSource));
+
+    genbuf_free(&saved.lighting);
+    saved.lighting = genbuf_init();
+    genbuf_append(&saved.lighting, content->data + offset,
+                  content->data_size - offset);
 
+    offset = content->data_size;
     size_t entity_table_entries = 0;
-    serialize_entity_data_into_buf(&content, &entity_table_entries);
+    int is_compact = 0;
+    serialize_entity_data_into_buf(content, &entity_table_entries,
+                                   &is_compact);
+    if (is_compact)
+        add_section(sections, section_count,
+                    SCENE_FILE_SECTION_COMPACT_ENTITIES, offset,
+                    content->data_size - offset, entity_table_entries,
+                    sizeof(SceneFileCompactEntity));
+    else
+        add_section(sections, section_count, SCENE_FILE_SECTION_ENTITIES,
+                    offset, content->data_size - offset, entity_table_entries,
+                    sizeof(SceneFileEntity));
 
+    // Names are moved to the string table
+    GeneralBuffer records = genbuf_init();
     size_t skybox_entry_count = 0;
-    serialize_skybox_data_into_buf(&content, &skybox_entry_count);
+    serialize_skybox_data_into_buf(&records, &skybox_entry_count);
+    memcpy(&saved.skybox, records.data, sizeof(SceneFileSkybox));
+    offset = content->data_size;
+    uint32_t name_offset = string_table_add(&strings, saved.skybox.name);
+    genbuf_append(content, &name_offset, sizeof name_offset);
+    add_section(sections, section_count, SCENE_FILE_SECTION_SKYBOX_NAMES,
+                offset, sizeof(uint32_t), skybox_entry_count,
+                sizeof(uint32_t));
 
-    size_t heights_size = 0;
-    size_t indices_size = 0;
-    serialize_terrain_data_into_buf(&content, &heights_size, &indices_size);
+    records.data_size = 0;
+    serialize_terrain_info_into_buf(&records);
+    memcpy(&saved.terrain_info, records.data, sizeof(SceneFileTerrainInfo));
+    genbuf_free(&records);
+    size_t info_size = offsetof(SceneFileTerrainInfo, texture_names);
+    offset = content->data_size;
+    genbuf_append(content, &saved.terrain_info, info_size);
+    add_section(sections, section_count, SCENE_FILE_SECTION_TERRAIN_INFO,
+                offset, info_size, 1, info_size);
+
+    offset = content->data_size;
+    for (size_t i = 0; i < TERRAIN_MAX_TEXTURES; i++) {
+        name_offset = string_table_add(&strings,
+                                       saved.terrain_info.texture_names[i]);
+        genbuf_append(content, &name_offset, sizeof name_offset);
+    }
+    add_section(sections, section_count,
+                SCENE_FILE_SECTION_TERRAIN_TEXTURE_NAMES, offset,
+                content->data_size - offset, TERRAIN_MAX_TEXTURES,
+                sizeof(uint32_t));
+
+    offset = content->data_size;
+    if (strings.data.data_size > 0)
+        genbuf_append(content, strings.data.data, strings.data.data_size);
+    add_section(sections, section_count, SCENE_FILE_SECTION_STRINGS, offset,
+                strings.data.data_size, strings.data.data_size, 1);
+    string_table_free(&strings);
 
-    SceneFileHeader header = {
-        .magic = SCENE_FILE_MAGIC,
+    out_snapshot->terrain_width = terrain.heights ? terrain.width : 0;
+    out_snapshot->heights = terrain.heights;
+    out_snapshot->texture_indices = terrain.texture_indices;
+    if (copy_terrain_data && terrain.heights) {
+        out_snapshot->heights = malloc(terrain.size * sizeof(float));
+        out_snapshot->texture_indices = malloc(terrain.size);
+        if (!out_snapshot->heights || !out_snapshot->texture_indices)
+            abort();
+        memcpy(out_snapshot->heights, terrain.heights,
+               terrain.size * sizeof(float));
+        memcpy(out_snapshot->texture_indices, terrain.texture_indices,
+               terrain.size);
+        out_snapshot->owns_terrain_data = 1;
+    }
+    terrain_clear_dirty_tiles();
 
+    out_snapshot->header = (SceneFileHeader){
         .asset_count = asset_table_entries,
         .light_source_count = light_source_table_entries,
         .entity_count = entity_table_entries,
         .skybox_count = skybox_entry_count,
+    };
+}
+
+// Encodes the terrain data of the snapshot and writes the file to `fp`. Can
+// run on a worker thread if the snapshot owns its terrain data. Returns 1 on
+// error.
+static int write_snapshot(Snapshot *snapshot, FILE *fp,
+                          size_t *out_file_size) {
+    GeneralBuffer *content = &snapshot->content;
+    SceneFileSection *sections = snapshot->sections;
+    size_t *section_count = &snapshot->section_count;
+    int is_compressed = snapshot->is_terrain_compressed;
+
+    size_t offset = content->data_size;
+    size_t heights_size = 0;
+    size_t indices_size = 0;
+    serialize_terrain_data_into_buf(content, snapshot, &heights_size,
+                                    &indices_size);
+    // Compressed sections are described as plain bytes
+    size_t heights_record_size = is_compressed ? 1 : sizeof(float);
+    add_section(sections, section_count, SCENE_FILE_SECTION_TERRAIN_HEIGHTS,
+                offset, heights_size, heights_size / heights_record_size,
+                heights_record_size);
+    offset += heights_size;
+    add_section(sections, section_count,
+                SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES, offset,
+                indices_size, indices_size, 1);
+
+    // Section offsets so far are relative to the start of the content
+    size_t content_offset =
+        sizeof(SceneFileHeader) + sizeof(SceneFileSection) * *section_count;
+    for (size_t i = 0; i < *section_count; i++) {
+        sections[i].checksum = crc32c_update(
+            0, content->data + sections[i].offset, sections[i].size);
+        sections[i].offset += content_offset;
+    }
 
-        .header_size = sizeof(SceneFileHeader),
-        .asset_size = sizeof(SceneFileAsset),
-        .lighting_scene_size = sizeof(SceneFileLightingScene),
-        .light_source_size = sizeof(SceneFileLightSource),
-        .entity_size = sizeof(SceneFileEntity),
-        .skybox_size = sizeof(SceneFileSkybox),
-        .terrain_info_size = sizeof(SceneFileTerrainInfo),
-        .terrain_heights_size = heights_size,
-        .terrain_texture_indices_size = indices_size,
+    SceneFileHeader *header = &snapshot->header;
+    header->magic = SCENE_FILE_MAGIC;
+    header->version = SCENE_FILE_VERSION;
+    header->flags = (SceneFileFlags){
+        .compressed_terrain = is_compressed,
+        .has_checksums = 1,
     };
 
-    fwrite(&header, (sizeof header), 1, fp);
-    fwrite(content.data, content.data_size, 1, fp);
-    genbuf_free(&content);
+    header->header_size = sizeof(SceneFileHeader);
+    header->asset_size = sizeof(SceneFileAsset);
+    header->lighting_scene_size = sizeof(SceneFileLightingScene);
+    header->light_source_size = sizeof(SceneFileLightSource);
+    header->entity_size = sizeof(SceneFileEntity);
+    header->skybox_size = sizeof(SceneFileSkybox);
+    header->terrain_info_size = sizeof(SceneFileTerrainInfo);
+    header->terrain_heights_size = heights_size;
+    header->terrain_texture_indices_size = indices_size;
+
+    header->section_size = sizeof(SceneFileSection);
+    header->section_count = *section_count;
+    header->section_table_offset = sizeof(SceneFileHeader);
+    header->section_table_checksum =
+        crc32c_update(0, sections, sizeof(SceneFileSection) * *section_count);
+
+    if (fwrite(header, sizeof(SceneFileHeader), 1, fp) != 1 ||
+        fwrite(sections, sizeof(SceneFileSection), *section_count, fp) !=
+            *section_count ||
+        fwrite(content->data, content->data_size, 1, fp) != 1 || fflush(fp))
+        return 1;
+
+    *out_file_size = content_offset + content->data_size;
+    return 0;
 }
 
-//  TODO: chop up
-int scene_file_load(FILE *fp, const char *skybox_directory,
-                    const char *asset_directory) {
-    printf("INFO: loading scene file.\n");
+static void free_snapshot(Snapshot *snapshot) {
+    genbuf_free(&snapshot->content);
+    if (snapshot->owns_terrain_data) {
+        free(snapshot->heights);
+        free(snapshot->texture_indices);
+    }
+}
+
+void scene_file_store(FILE *fp) {
+    printf("INFO: saving scene file.\n");
+    scene_file_finish_compaction();
+
+    Snapshot snapshot = {0};
+    capture_snapshot(&snapshot, 0);
+    size_t file_size = 0;
+    saved.is_valid = !write_snapshot(&snapshot, fp, &file_size);
+    saved.file_size = file_size;
+    saved.section_table_checksum = snapshot.header.section_table_checksum;
+    free_snapshot(&snapshot);
+}
 
-    fseek(fp, 0, SEEK_END);
-    size_t file_size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+void scene_file_set_terrain_compression(int enabled) {
+    is_terrain_compressed = enabled;
+}
+
+void scene_file_set_compact_entities(int enabled) {
+    is_entities_compact = enabled;
+}
+
+// Returns 1 if `fp` is the file the saved scene was last written to, as far
+// as can be told from its size and section table.
+static int is_saved_file(FILE *fp) {
+    struct stat file_stat = {0};
+    SceneFileHeader header = {0};
+    if (!saved.is_valid || fstat(fileno(fp), &file_stat) ||
+        (size_t)file_stat.st_size != saved.file_size ||
+        fseek(fp, 0, SEEK_SET) || fread(&header, sizeof header, 1, fp) != 1)
+        return 0;
+    return header.magic == SCENE_FILE_MAGIC &&
+           header.section_table_checksum == saved.section_table_checksum;
+}
+
+// Starts a journal record, returns its offset in `journal` for end_record.
+static inline size_t begin_record(GeneralBuffer *journal) {
+    size_t offset = journal->data_size;
+    genbuf_allocate(journal, sizeof(SceneFileJournalRecord));
+    return offset;
+}
+
+// Finishes the record started at `offset`, its data being everything appended
+// to `journal` since.
+static void end_record(GeneralBuffer *journal, size_t offset,
+                       SceneFileJournalRecordType type, size_t record_size) {
+    size_t data_offset = offset + sizeof(SceneFileJournalRecord);
+    size_t size = journal->data_size - data_offset;
+    SceneFileJournalRecord record = {
+        .type = type,
+        .size = size,
+        .record_size = record_size,
+        .checksum = crc32c_update(0, journal->data + data_offset, size),
+    };
+    memcpy(journal->data + offset, &record, sizeof record);
+    genbuf_allocate(journal, -size & (JOURNAL_ALIGNMENT - 1));
+}
+
+static void append_record(GeneralBuffer *journal,
+                          SceneFileJournalRecordType type, const void *data,
+                          size_t size, size_t record_size) {
+    size_t offset = begin_record(journal);
+    if (size > 0)
+        genbuf_append(journal, (void *)data, size);
+    end_record(journal, offset, type, record_size);
+}
 
-    if (file_size < sizeof(SceneFileHeader))
+// Returns the index of asset `handle` in the asset table of the file, adding
+// the asset to `new_assets` if the file doesn't have it yet.
+static uint32_t get_saved_asset_index(uint32_t *asset_indices,
+                                      AssetHandle handle,
+                                      GeneralBuffer *new_assets) {
+    if (asset_indices[handle] != UINT32_MAX)
+        return asset_indices[handle];
+
+    char *name = assets_get_name(handle);
+    int64_t index = stringvec_index_of(&saved.asset_names, name);
+    if (index < 0) {
+        SceneFileAsset *asset =
+            genbuf_allocate(new_assets, sizeof(SceneFileAsset));
+        strncpy(asset->name, name, NAME_MAX_LENGTH - 1);
+        stringvec_append(&saved.asset_names, asset->name, strlen(asset->name));
+        index = stringvec_count(&saved.asset_names) - 1;
+    }
+
+    asset_indices[handle] = index;
+    return index;
+}
+
+static void append_entity_records(GeneralBuffer *journal) {
+    GeneralBuffer new_assets = genbuf_init();
+    GeneralBuffer changes = genbuf_init();
+
+    // Asset table index of every asset handle, looked up on first use
+    size_t asset_count = assets_get_count();
+    uint32_t *asset_indices = malloc(asset_count * sizeof(uint32_t));
+    if (!asset_indices && asset_count > 0)
+        abort();
+    memset(asset_indices, 0xff, asset_count * sizeof(uint32_t));
+
+    size_t entity_count = max(scene_get_entity_count(), saved.entity_count);
+    reserve_saved_entities(entity_count);
+    saved.entity_count = entity_count;
+
+    for (EntityHandle handle = 0; handle < entity_count; handle++) {
+        Entity *entity = scene_get_entity(handle);
+        SavedEntity *saved_entity = &saved.entities[handle];
+        SceneFileJournalEntity change;
+        memset(&change, 0, sizeof change);
+
+        if (!entity || entity->is_destroyed) {
+            if (saved_entity->slot == SAVED_SLOT_NONE)
+                continue;
+            change.slot = saved_entity->slot;
+            change.is_removed = 1;
+            saved_entity->slot = SAVED_SLOT_NONE;
+            genbuf_append(&changes, &change, sizeof change);
+            continue;
+        }
+
+        assert(entity->asset_handle < asset_count);
+        uint32_t asset_index = get_saved_asset_index(
+            asset_indices, entity->asset_handle, &new_assets);
+        make_file_entity(entity, asset_index, &change.entity);
+        if (saved_entity->slot != SAVED_SLOT_NONE &&
+            !memcmp(&saved_entity->record, &change.entity,
+                    sizeof(SceneFileEntity)))
+            continue;
+
+        // Entities added since are appended to the entity table
+        if (saved_entity->slot == SAVED_SLOT_NONE)
+            saved_entity->slot = saved.slot_count++;
+        saved_entity->record = change.entity;
+        change.slot = saved_entity->slot;
+        genbuf_append(&changes, &change, sizeof change);
+    }
+
+    // Entities may refer to the new assets
+    if (new_assets.data_size > 0)
+        append_record(journal, SCENE_FILE_JOURNAL_ASSETS, new_assets.data,
+                      new_assets.data_size, sizeof(SceneFileAsset));
+    if (changes.data_size > 0)
+        append_record(journal, SCENE_FILE_JOURNAL_ENTITIES, changes.data,
+                      changes.data_size, sizeof(SceneFileJournalEntity));
+
+    free(asset_indices);
+    genbuf_free(&changes);
+    genbuf_free(&new_assets);
+}
+
+static void append_lighting_records(GeneralBuffer *journal) {
+    GeneralBuffer lighting = genbuf_init();
+    serialize_lighting_data_into_buf(&lighting, 0);
+
+    size_t scene_size = sizeof(SceneFileLightingScene);
+    if (memcmp(lighting.data, saved.lighting.data, scene_size))
+        append_record(journal, SCENE_FILE_JOURNAL_LIGHTING_SCENE, lighting.data,
+                      scene_size, scene_size);
+
+    // Light sources have no identity of their own, so the whole table is
+    // written if any of them changed
+    if (lighting.data_size != saved.lighting.data_size ||
+        memcmp(lighting.data + scene_size, saved.lighting.data + scene_size,
+               lighting.data_size - scene_size))
+        append_record(journal, SCENE_FILE_JOURNAL_LIGHT_SOURCES,
+                      lighting.data + scene_size,
+                      lighting.data_size - scene_size,
+                      sizeof(SceneFileLightSource));
+
+    genbuf_free(&saved.lighting);
+    saved.lighting = lighting;
+}
+
+static void append_skybox_and_terrain_info_records(GeneralBuffer *journal) {
+    GeneralBuffer buf = genbuf_init();
+    serialize_skybox_data_into_buf(&buf, 0);
+    if (memcmp(buf.data, &saved.skybox, sizeof(SceneFileSkybox))) {
+        memcpy(&saved.skybox, buf.data, sizeof(SceneFileSkybox));
+        append_record(journal, SCENE_FILE_JOURNAL_SKYBOXES, &saved.skybox,
+                      sizeof(SceneFileSkybox), sizeof(SceneFileSkybox));
+    }
+
+    buf.data_size = 0;
+    serialize_terrain_info_into_buf(&buf);
+    if (memcmp(buf.data, &saved.terrain_info, sizeof(SceneFileTerrainInfo))) {
+        memcpy(&saved.terrain_info, buf.data, sizeof(SceneFileTerrainInfo));
+        append_record(journal, SCENE_FILE_JOURNAL_TERRAIN_INFO,
+                      &saved.terrain_info, sizeof(SceneFileTerrainInfo),
+                      sizeof(SceneFileTerrainInfo));
+    }
+    genbuf_free(&buf);
+}
+
+static void append_terrain_region_record(GeneralBuffer *journal, uint32_t x,
+                                         uint32_t y, uint32_t width,
+                                         uint32_t height) {
+    size_t offset = begin_record(journal);
+    SceneFileJournalTerrainRegion region = {
+        .x = x,
+        .y = y,
+        .width = width,
+        .height = height,
+    };
+    genbuf_append(journal, &region, sizeof region);
+
+    for (uint32_t row = y; row < y + height; row++) {
+        size_t start = (size_t)row * terrain.width + x;
+        genbuf_append(journal, terrain.heights + start, width * sizeof(float));
+    }
+    for (uint32_t row = y; row < y + height; row++) {
+        size_t start = (size_t)row * terrain.width + x;
+        genbuf_append(journal, terrain.texture_indices + start, width);
+    }
+
+    end_record(journal, offset, SCENE_FILE_JOURNAL_TERRAIN_REGION, 1);
+}
+
+// Writes a record for every run of dirty tiles in each row of tiles.
+static void append_terrain_records(GeneralBuffer *journal) {
+    uint32_t width = terrain.width;
+    uint32_t tile_size = TERRAIN_DIRTY_TILE_SIZE;
+    for (uint32_t y = 0; y < width; y += tile_size) {
+        uint32_t height = min(tile_size, width - y);
+        uint32_t run_x = 0;
+        uint32_t run_width = 0;
+        for (uint32_t x = 0; x < width; x += tile_size) {
+            uint32_t tile_width = min(tile_size, width - x);
+            if (terrain_is_tile_dirty(x / tile_size, y / tile_size)) {
+                if (run_width == 0)
+                    run_x = x;
+                run_width = x + tile_width - run_x;
+                continue;
+            }
+            if (run_width > 0)
+                append_terrain_region_record(journal, run_x, y, run_width,
+                                             height);
+            run_width = 0;
+        }
+        if (run_width > 0)
+            append_terrain_region_record(journal, run_x, y, run_width, height);
+    }
+    terrain_clear_dirty_tiles();
+}
+
+// Writes a full snapshot to the file at `filepath`. Returns 1 on error.
+static int store_snapshot(const char *filepath) {
+    FILE *fp = fopen(filepath, "wb");
+    if (!fp)
         return 1;
+    scene_file_store(fp);
+    if (fclose(fp))
+        saved.is_valid = 0;
+    return !saved.is_valid;
+}
+
+int scene_file_store_incremental(const char *filepath) {
+    scene_file_finish_compaction();
+
+    // Entities held back by streaming can't be told apart between saves, so
+    // they are written out in full every time
+    FILE *fp = fopen(filepath, "r+b");
+    if (!fp || !is_saved_file(fp) || streaming_is_enabled() ||
+        saved.has_streamed_entities ||
+        terrain.width != saved.terrain_info.width) {
+        if (fp)
+            fclose(fp);
+        return store_snapshot(filepath);
+    }
+
+    printf("INFO: appending changes to scene file.\n");
+
+    GeneralBuffer journal = genbuf_init();
+    append_entity_records(&journal);
+    append_lighting_records(&journal);
+    append_skybox_and_terrain_info_records(&journal);
+    append_terrain_records(&journal);
+    if (journal.data_size > 0)
+        append_record(&journal, SCENE_FILE_JOURNAL_COMMIT, 0, 0, 0);
+
+    int result = 0;
+    if (journal.data_size > 0)
+        result = fseek(fp, saved.file_size, SEEK_SET) ||
+                 fwrite(journal.data, journal.data_size, 1, fp) != 1;
+    if (fclose(fp))
+        result = 1;
+
+    // The saved scene is ahead of the file now, start over with a snapshot
+    if (result) {
+        fprintf(stderr, "ERROR: could not append to scene file %s.\n",
+                filepath);
+        saved.is_valid = 0;
+    } else
+        saved.file_size += journal.data_size;
+
+    genbuf_free(&journal);
+    return result;
+}
+
+// Runs on a worker thread.
+static void compact_job(void *argument) {
+    Compaction *job = argument;
+    const char suffix[] = ".compact";
+    size_t path_length = strlen(job->filepath);
+    char *temporary_path = malloc(path_length + sizeof suffix);
+    if (!temporary_path)
+        abort();
+    memcpy(temporary_path, job->filepath, path_length);
+    memcpy(temporary_path + path_length, suffix, sizeof suffix);
+
+    // Replaced only once the new file is complete, so that an interrupted
+    // compaction leaves the old file as is
+    FILE *fp = fopen(temporary_path, "wb");
+    job->has_failed =
+        !fp || write_snapshot(&job->snapshot, fp, &job->file_size);
+    if (fp && fclose(fp))
+        job->has_failed = 1;
+    if (!job->has_failed && rename(temporary_path, job->filepath))
+        job->has_failed = 1;
+
+    if (job->has_failed) {
+        fprintf(stderr, "ERROR: could not compact scene file %s.\n",
+                job->filepath);
+        remove(temporary_path);
+    }
+    free(temporary_path);
+    atomic_store(&is_compacting, 0);
+}
+
+int scene_file_compact(const char *filepath) {
+    scene_file_finish_compaction();
+    printf("INFO: compacting scene file.\n");
+
+    Compaction *job = malloc(sizeof(Compaction));
+    size_t path_size = strlen(filepath) + 1;
+    char *filepath_copy = malloc(path_size);
+    if (!job || !filepath_copy)
+        abort();
+    memcpy(filepath_copy, filepath, path_size);
+    *job = (Compaction){.filepath = filepath_copy};
+
+    capture_snapshot(&job->snapshot, 1);
+    compaction = job;
+    atomic_store(&is_compacting, 1);
+
+    if (worker_pool_is_running()) {
+        worker_pool_submit(compact_job, job);
+        return 0;
+    }
+    compact_job(job);
+    return scene_file_finish_compaction();
+}
+
+int scene_file_finish_compaction(void) {
+    if (!compaction)
+        return 0;
+    while (atomic_load(&is_compacting))
+        sched_yield();
+
+    int result = compaction->has_failed;
+    saved.is_valid = !result;
+    saved.file_size = compaction->file_size;
+    saved.section_table_checksum =
+        compaction->snapshot.header.section_table_checksum;
 
-    uint8_t *file_buffer = malloc(file_size);
-    assert(file_buffer);
+    free_snapshot(&compaction->snapshot);
+    free(compaction->filepath);
+    free(compaction);
+    compaction = 0;
+    return result;
+}
 
-    uint8_t *offset = file_buffer;
+// Contents of a scene file, mapped into memory or read into a buffer if it
+// can't be mapped.
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    int is_mapped;
+} FileView;
 
-    if (!fread(file_buffer, file_size, 1, fp)) {
-        free(file_buffer);
+// Returns 1 on error.
+static int file_view_open(FILE *fp, FileView *out_view) {
+    int fd = fileno(fp);
+    struct stat file_stat = {0};
+    if (fd < 0 || fstat(fd, &file_stat) || file_stat.st_size <= 0)
         return 1;
+    size_t size = file_stat.st_size;
+
+    void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+        // The file is read front to back once
+        madvise(data, size, MADV_SEQUENTIAL);
+        *out_view = (FileView){.data = data, .size = size, .is_mapped = 1};
+        return 0;
     }
 
-    SceneFileHeader *header_ptr = (SceneFileHeader *)file_buffer;
-    if (header_ptr->magic != SCENE_FILE_MAGIC) {
-        free(file_buffer);
+    uint8_t *buffer = malloc(size);
+    if (!buffer)
+        return 1;
+    if (fseek(fp, 0, SEEK_SET) || !fread(buffer, size, 1, fp)) {
+        free(buffer);
+        return 1;
+    }
+    *out_view = (FileView){.data = buffer, .size = size};
+    return 0;
+}
+
+static void file_view_close(FileView *view) {
+    if (view->is_mapped)
+        munmap(view->data, view->size);
+    else
+        free(view->data);
+    *view = (FileView){0};
+}
+
+// Returns record `index` of a table of `file_record_size` sized records. The
+// record is used in place if its layout in the file matches `struct_size` and
+// it is aligned, otherwise it is copied into `scratch` with fields missing
+// from older files zeroed.
+static inline const void *get_record(const uint8_t *table, size_t index,
+                                     size_t file_record_size, void *scratch,
+                                     size_t struct_size, size_t alignment) {
+    const uint8_t *record = table + index * file_record_size;
+    if (file_record_size == struct_size && (uintptr_t)record % alignment == 0)
+        return record;
+
+    memset(scratch, 0, struct_size);
+    memcpy(scratch, record, min(file_record_size, struct_size));
+    return scratch;
+}
+
+#define GET_RECORD(type, table, index, file_record_size, scratch)              \
+    ((const type *)get_record((table), (index), (file_record_size), (scratch), \
+                              sizeof(type), _Alignof(type)))
+
+// Copies record `index` of a table into `out`.
+#define GET_RECORD_INTO(type, table, index, file_record_size, out)             \
+    do {                                                                       \
+        type *out_record_ = (out);                                             \
+        *out_record_ = *GET_RECORD(type, table, index, file_record_size,       \
+                                   out_record_);                               \
+    } while (0)
+
+// Header and known sections of a scene file. Sections missing from the file
+// have a type of 0. Sections replaced by journal records point to the data of
+// the latest record.
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    SceneFileHeader header;
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT];
+    // Where the journal starts, the end of the file if there is none
+    size_t journal_offset;
+    // Where the last complete save in the journal ends
+    size_t journal_end;
+    // Tables with the journal applied, used in place of the sections if set
+    SceneFileAsset *assets;
+    size_t asset_count;
+    SceneFileEntity *entities;
+    uint8_t *is_entity_removed;
+    size_t entity_count;
+    size_t entities_allocated;
+    // Data of the terrain region records in the order they were written
+    const uint8_t **terrain_regions;
+    size_t terrain_region_count;
+} SceneFileToc;
+
+static void toc_free(SceneFileToc *toc) {
+    free(toc->assets);
+    free(toc->entities);
+    free(toc->is_entity_removed);
+    free(toc->terrain_regions);
+}
+
+// Returns 1 if `section` doesn't fit in the file or is too small for its
+// records.
+static inline int check_section(const SceneFileSection *section,
+                                size_t file_size) {
+    if (section->offset > file_size ||
+        section->size > file_size - section->offset)
         return 1;
+    if (section->count > 0 &&
+        (section->record_size == 0 ||
+         section->count > section->size / section->record_size))
+        return 1;
+    return 0;
+}
+
+// Builds the section table of a version 0 file from the sizes in its header.
+// Returns 1 on error.
+static int synthesize_sections(SceneFileToc *toc) {
+    SceneFileHeader *header = &toc->header;
+    struct {
+        SceneFileSectionType type;
+        size_t count;
+        size_t record_size;
+    } layout[] = {
+        {SCENE_FILE_SECTION_ASSETS, header->asset_count, header->asset_size},
+        {SCENE_FILE_SECTION_LIGHTING_SCENE, 1, header->lighting_scene_size},
+        {SCENE_FILE_SECTION_LIGHT_SOURCES, header->light_source_count,
+         header->light_source_size},
+        {SCENE_FILE_SECTION_ENTITIES, header->entity_count,
+         header->entity_size},
+        {SCENE_FILE_SECTION_SKYBOXES, header->skybox_count,
+         header->skybox_size},
+        {SCENE_FILE_SECTION_TERRAIN_INFO, 1, header->terrain_info_size},
+        {SCENE_FILE_SECTION_TERRAIN_HEIGHTS,
+         header->terrain_heights_size / sizeof(float), sizeof(float)},
+        {SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES,
+         header->terrain_texture_indices_size, 1},
     };
 
+    size_t offset = header->header_size;
+    for (size_t i = 0; i < ARRAY_LENGTH(layout); i++) {
+        size_t size = layout[i].count * layout[i].record_size;
+        toc->sections[layout[i].type] = (SceneFileSection){
+            .type = layout[i].type,
+            .offset = offset,
+            .size = size,
+            .count = layout[i].count,
+            .record_size = layout[i].record_size,
+        };
+        offset += size;
+    }
+
+    if (toc->size != offset)
+        return 1;
+    toc->journal_offset = offset;
+    return 0;
+}
+
+// Section replaced by each of the `SceneFileJournalRecordType`s, 0 for those
+// that don't replace a section.
+static const SceneFileSectionType replaced_sections[] = {
+    [SCENE_FILE_JOURNAL_LIGHTING_SCENE] = SCENE_FILE_SECTION_LIGHTING_SCENE,
+    [SCENE_FILE_JOURNAL_LIGHT_SOURCES] = SCENE_FILE_SECTION_LIGHT_SOURCES,
+    [SCENE_FILE_JOURNAL_SKYBOXES] = SCENE_FILE_SECTION_SKYBOXES,
+    [SCENE_FILE_JOURNAL_TERRAIN_INFO] = SCENE_FILE_SECTION_TERRAIN_INFO,
+};
+
+// Returns the section of `type` or 0 if the file doesn't have it.
+static inline const SceneFileSection *get_section(const SceneFileToc *toc,
+                                                  SceneFileSectionType type) {
+    const SceneFileSection *section = &toc->sections[type];
+    if (section->type != type)
+        return 0;
+    return section;
+}
+
+// Copies the string at `offset` of the string table into `out_string`. Returns
+// 1 if the string table doesn't have it.
+static int get_string(const SceneFileToc *toc, uint32_t offset,
+                      char out_string[NAME_MAX_LENGTH]) {
+    memset(out_string, 0, NAME_MAX_LENGTH);
+    const SceneFileSection *section =
+        get_section(toc, SCENE_FILE_SECTION_STRINGS);
+    if (!section || offset >= section->size)
+        return 1;
+
+    const char *string = (const char *)toc->data + section->offset + offset;
+    size_t length = strnlen(string, min(section->size - offset,
+                                        NAME_MAX_LENGTH - 1));
+    memcpy(out_string, string, length);
+    return 0;
+}
+
+// Copies the name at `index` of a section of string table offsets into
+// `out_name`. Returns 1 if there is no such name.
+static int get_section_name(const SceneFileToc *toc,
+                            const SceneFileSection *section, size_t index,
+                            char out_name[NAME_MAX_LENGTH]) {
+    uint32_t scratch = 0;
+    if (index >= section->count)
+        return 1;
+    const uint32_t *offset = GET_RECORD(uint32_t, toc->data + section->offset,
+                                        index, section->record_size, &scratch);
+    return get_string(toc, *offset, out_name);
+}
+
+static size_t get_asset_count(const SceneFileToc *toc) {
+    const SceneFileSection *names =
+        get_section(toc, SCENE_FILE_SECTION_ASSET_NAMES);
+    const SceneFileSection *assets =
+        get_section(toc, SCENE_FILE_SECTION_ASSETS);
+    if (toc->assets)
+        return toc->asset_count;
+    if (names)
+        return names->count;
+    return assets ? assets->count : 0;
+}
+
+// Copies the name of asset `index` of the asset table into `out_name`.
+static void get_asset_name(const SceneFileToc *toc, size_t index,
+                           char out_name[NAME_MAX_LENGTH]) {
+    const SceneFileSection *names =
+        get_section(toc, SCENE_FILE_SECTION_ASSET_NAMES);
+    const SceneFileSection *assets =
+        get_section(toc, SCENE_FILE_SECTION_ASSETS);
+    if (toc->assets) {
+        memcpy(out_name, toc->assets[index].name, NAME_MAX_LENGTH);
+        out_name[NAME_MAX_LENGTH - 1] = 0;
+    } else if (names)
+        get_section_name(toc, names, index, out_name);
+    else {
+        const uint8_t *record =
+            toc->data + assets->offset + index * assets->record_size;
+        memset(out_name, 0, NAME_MAX_LENGTH);
+        memcpy(out_name, record, min(assets->record_size, NAME_MAX_LENGTH - 1));
+    }
+}
+
+static size_t get_entity_count(const SceneFileToc *toc) {
+    const SceneFileSection *compact =
+        get_section(toc, SCENE_FILE_SECTION_COMPACT_ENTITIES);
+    const SceneFileSection *entities =
+        get_section(toc, SCENE_FILE_SECTION_ENTITIES);
+    if (toc->entities)
+        return toc->entity_count;
+    if (compact)
+        return compact->count;
+    return entities ? entities->count : 0;
+}
+
+// Reads entity `index` of the entity table into `out_entity`.
+static void get_entity(const SceneFileToc *toc, size_t index,
+                       SceneFileEntity *out_entity) {
+    const SceneFileSection *compact =
+        get_section(toc, SCENE_FILE_SECTION_COMPACT_ENTITIES);
+    const SceneFileSection *entities =
+        get_section(toc, SCENE_FILE_SECTION_ENTITIES);
+    if (toc->entities)
+        *out_entity = toc->entities[index];
+    else if (compact) {
+        SceneFileCompactEntity scratch = {0};
+        read_compact_entity(GET_RECORD(SceneFileCompactEntity,
+                                       toc->data + compact->offset, index,
+                                       compact->record_size, &scratch),
+                            out_entity);
+    } else
+        GET_RECORD_INTO(SceneFileEntity, toc->data + entities->offset, index,
+                        entities->record_size, out_entity);
+}
+
+// Appends asset records to the asset table, copying the table out of the file
+// the first time.
+static void apply_journal_assets(SceneFileToc *toc, const uint8_t *data,
+                                 const SceneFileJournalRecord *record) {
+    if (!toc->assets) {
+        size_t base_count = get_asset_count(toc);
+        SceneFileAsset *assets = malloc(base_count * sizeof(SceneFileAsset));
+        if (!assets && base_count > 0)
+            abort();
+        for (size_t i = 0; i < base_count; i++)
+            get_asset_name(toc, i, assets[i].name);
+        toc->assets = assets;
+        toc->asset_count = base_count;
+    }
+
+    size_t count = record->size / record->record_size;
+    toc->assets = realloc(toc->assets, max(toc->asset_count + count, 1) *
+                                           sizeof(SceneFileAsset));
+    if (!toc->assets)
+        abort();
+    for (size_t i = 0; i < count; i++)
+        GET_RECORD_INTO(SceneFileAsset, data, i, record->record_size,
+                        toc->assets + toc->asset_count++);
+}
+
+static void reserve_toc_entities(SceneFileToc *toc, size_t count) {
+    if (count <= toc->entities_allocated)
+        return;
+    size_t allocated = max(toc->entities_allocated * 2, count);
+    toc->entities =
+        realloc(toc->entities, allocated * sizeof(SceneFileEntity));
+    toc->is_entity_removed = realloc(toc->is_entity_removed, allocated);
+    if (!toc->entities || !toc->is_entity_removed)
+        abort();
+    toc->entities_allocated = allocated;
+}
+
+// Applies entity records to the entity table, copying the table out of the
+// file the first time. Returns 1 if a record refers past the end of the table.
+static int apply_journal_entities(SceneFileToc *toc, const uint8_t *data,
+                                  const SceneFileJournalRecord *record) {
+    if (!toc->entities) {
+        size_t base_count = get_entity_count(toc);
+        SceneFileEntity *entities =
+            malloc(max(base_count, 1) * sizeof(SceneFileEntity));
+        uint8_t *is_entity_removed = calloc(max(base_count, 1), 1);
+        if (!entities || !is_entity_removed)
+            abort();
+        for (size_t i = 0; i < base_count; i++)
+            get_entity(toc, i, entities + i);
+
+        toc->entities = entities;
+        toc->is_entity_removed = is_entity_removed;
+        toc->entity_count = base_count;
+        toc->entities_allocated = max(base_count, 1);
+    }
+
+    size_t count = record->size / record->record_size;
+    for (size_t i = 0; i < count; i++) {
+        SceneFileJournalEntity change = {0};
+        GET_RECORD_INTO(SceneFileJournalEntity, data, i, record->record_size,
+                        &change);
+        if (change.slot > toc->entity_count)
+            return 1;
+        if (change.slot == toc->entity_count) {
+            reserve_toc_entities(toc, toc->entity_count + 1);
+            toc->entity_count++;
+        }
+        toc->entities[change.slot] = change.entity;
+        toc->is_entity_removed[change.slot] = change.is_removed != 0;
+    }
+    return 0;
+}
+
+// Returns 1 if the terrain region record doesn't hold the data of its region.
+static int check_terrain_region(const uint8_t *data, size_t size) {
+    SceneFileJournalTerrainRegion region = {0};
+    if (size < sizeof region)
+        return 1;
+    memcpy(&region, data, sizeof region);
+    uint64_t point_count = (uint64_t)region.width * region.height;
+    return size != sizeof region + point_count * (sizeof(float) + 1);
+}
+
+// Reads the journal record at `*offset` and moves `offset` past it. Returns 1
+// if there is no intact record there.
+static int next_journal_record(const SceneFileToc *toc, size_t *offset,
+                               SceneFileJournalRecord *out_record) {
+    if (toc->size - *offset < sizeof(SceneFileJournalRecord))
+        return 1;
+    memcpy(out_record, toc->data + *offset, sizeof(SceneFileJournalRecord));
+    size_t data_offset = *offset + sizeof(SceneFileJournalRecord);
+    if (out_record->size > toc->size - data_offset ||
+        crc32c_update(0, toc->data + data_offset, out_record->size) !=
+            out_record->checksum)
+        return 1;
+
+    size_t padding = -(size_t)out_record->size & (JOURNAL_ALIGNMENT - 1);
+    *offset = min(data_offset + out_record->size + padding, toc->size);
+    return 0;
+}
+
+// Returns where the last complete save in the journal ends.
+static size_t find_journal_end(const SceneFileToc *toc) {
+    size_t offset = toc->journal_offset;
+    size_t end = offset;
+    SceneFileJournalRecord record = {0};
+    while (!next_journal_record(toc, &offset, &record)) {
+        if (record.type == SCENE_FILE_JOURNAL_COMMIT)
+            end = offset;
+    }
+
+    // Left over by an interrupted save
+    if (end != toc->size)
+        fprintf(stderr, "WARNING: ignoring incomplete scene file journal "
+                        "records.\n");
+    return end;
+}
+
+// Applies the journal records of the complete saves following the sections.
+// Returns 1 on error.
+static int read_journal(SceneFileToc *toc) {
+    size_t end = find_journal_end(toc);
+    toc->journal_end = end;
+    size_t offset = toc->journal_offset;
+    while (offset < end) {
+        SceneFileJournalRecord record = {0};
+        const uint8_t *data =
+            toc->data + offset + sizeof(SceneFileJournalRecord);
+        next_journal_record(toc, &offset, &record);
+
+        if (record.type < ARRAY_LENGTH(replaced_sections) &&
+            replaced_sections[record.type]) {
+            SceneFileSectionType type = replaced_sections[record.type];
+            toc->sections[type] = (SceneFileSection){
+                .type = type,
+                .offset = data - toc->data,
+                .size = record.size,
+                .count = record.record_size ? record.size / record.record_size
+                                            : 0,
+                .record_size = record.record_size,
+                .checksum = record.checksum,
+            };
+            continue;
+        }
+
+        if (record.type == SCENE_FILE_JOURNAL_TERRAIN_REGION) {
+            if (check_terrain_region(data, record.size))
+                return 1;
+            toc->terrain_regions =
+                realloc(toc->terrain_regions, (toc->terrain_region_count + 1) *
+                                                  sizeof(uint8_t *));
+            if (!toc->terrain_regions)
+                abort();
+            toc->terrain_regions[toc->terrain_region_count++] = data;
+            continue;
+        }
+
+        // Records of unknown types are skipped
+        if (record.type != SCENE_FILE_JOURNAL_ASSETS &&
+            record.type != SCENE_FILE_JOURNAL_ENTITIES)
+            continue;
+        if (record.record_size == 0)
+            return 1;
+        if (record.type == SCENE_FILE_JOURNAL_ASSETS)
+            apply_journal_assets(toc, data, &record);
+        else if (apply_journal_entities(toc, data, &record))
+            return 1;
+    }
+    return 0;
+}
+
+// Returns 1 on error.
+static int read_toc(const FileView *view, SceneFileToc *out_toc) {
+    *out_toc = (SceneFileToc){.data = view->data, .size = view->size};
+
+    if (view->size < sizeof(uint16_t) * 3)
+        return 1;
+
+    SceneFileHeader *header_ptr = (SceneFileHeader *)view->data;
+    if (header_ptr->magic != SCENE_FILE_MAGIC ||
+        header_ptr->header_size > view->size)
+        return 1;
+
     //  NOTE: In case a struct has more stuff added onto it later on,
     //  this way we can still read old files and just have the new fields be
     //  zero (we're assuming zero is initialization for new struct fields).
-    SceneFileHeader header = {0};
-    memcpy(&header, file_buffer, header_ptr->header_size);
-    offset += header.header_size;
-
-    size_t assumed_file_size =
-        header.header_size + header.asset_size * header.asset_count +
-        header.lighting_scene_size +
-        header.light_source_size * header.light_source_count +
-        header.entity_size * header.entity_count + header.terrain_info_size +
-        header.terrain_heights_size + header.terrain_texture_indices_size +
-        header.skybox_size * header.skybox_count;
-
-    if (file_size != assumed_file_size) {
-        free(file_buffer);
+    SceneFileHeader *header = &out_toc->header;
+    memcpy(header, view->data,
+           min(header_ptr->header_size, sizeof(SceneFileHeader)));
+
+    if (header->version == 0) {
+        header->flags.has_checksums = 0;
+        return synthesize_sections(out_toc);
+    }
+
+    SceneFileSection table = {
+        .offset = header->section_table_offset,
+        .size = (uint64_t)header->section_size * header->section_count,
+        .count = header->section_count,
+        .record_size = header->section_size,
+    };
+    if (check_section(&table, view->size))
+        return 1;
+
+    const uint8_t *table_data = view->data + table.offset;
+    if (header->flags.has_checksums &&
+        crc32c_update(0, table_data, table.size) !=
+            header->section_table_checksum)
         return 1;
+
+    // The journal follows whatever comes last
+    out_toc->journal_offset = table.offset + table.size;
+    for (size_t i = 0; i < header->section_count; i++) {
+        SceneFileSection scratch = {0};
+        const SceneFileSection *section = GET_RECORD(
+            SceneFileSection, table_data, i, header->section_size, &scratch);
+
+        if (section->offset > view->size ||
+            section->size > view->size - section->offset)
+            return 1;
+        out_toc->journal_offset =
+            max(out_toc->journal_offset, section->offset + section->size);
+
+        // Written by a newer version, nothing we know how to read
+        if (section->type == 0 ||
+            section->type >= SCENE_FILE_SECTION_TYPE_COUNT)
+            continue;
+        if (check_section(section, view->size))
+            return 1;
+        out_toc->sections[section->type] = *section;
+    }
+
+    return read_journal(out_toc);
+}
+
+#define SCENE_FILE_SECTION_BIT(type) (1u << (type))
+
+// Section types needed to load each of the `SceneFileLoadParts`.
+static const uint32_t part_sections[] = {
+    [0] = SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_LIGHTING_SCENE) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_LIGHT_SOURCES),
+    [1] = SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_ASSETS) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_ASSET_NAMES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_ENTITIES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_COMPACT_ENTITIES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_STRINGS),
+    [2] = SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_SKYBOXES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_SKYBOX_NAMES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_STRINGS),
+    [3] = SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_TERRAIN_INFO) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_TERRAIN_HEIGHTS) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_TERRAIN_TEXTURE_NAMES) |
+          SCENE_FILE_SECTION_BIT(SCENE_FILE_SECTION_STRINGS),
+};
+
+// Returns the seconds passed since `*time` and sets it to the current time.
+static double lap(double *time) {
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+    double elapsed = seconds - *time;
+    *time = seconds;
+    return elapsed;
+}
+
+// State of one load shared with the jobs it hands to worker threads.
+typedef struct {
+    const SceneFileToc *toc;
+    // Written by the phases of the load as they finish
+    SceneFileLoadTimings *timings;
+    SceneFileTerrainInfo terrain_info;
+    int build_terrain_mesh;
+    Mesh terrain_mesh;
+    // Jobs that haven't finished yet
+    atomic_size_t running_jobs;
+    atomic_int has_failed;
+} LoadPipeline;
+
+typedef struct {
+    LoadPipeline *pipeline;
+    const SceneFileSection *section;
+} ChecksumJob;
+
+// Runs `function` on a worker thread, or right away if the worker pool isn't
+// running. The job must call finish_job when done.
+static void run_job(LoadPipeline *pipeline, WorkerFunction function,
+                    void *argument) {
+    atomic_fetch_add(&pipeline->running_jobs, 1);
+    if (worker_pool_is_running())
+        worker_pool_submit(function, argument);
+    else
+        function(argument);
+}
+
+static inline void finish_job(LoadPipeline *pipeline, int has_failed) {
+    if (has_failed)
+        atomic_store(&pipeline->has_failed, 1);
+    atomic_fetch_sub(&pipeline->running_jobs, 1);
+}
+
+// Blocks until the jobs of `pipeline` have finished, uploading models read in
+// the background meanwhile.
+static void wait_for_jobs(LoadPipeline *pipeline) {
+    while (atomic_load(&pipeline->running_jobs)) {
+        scene_process_pending_loads(0);
+        sched_yield();
     }
+}
+
+// Returns 1 if the data of `section` doesn't match its checksum.
+static inline int is_section_corrupted(const SceneFileToc *toc,
+                                       const SceneFileSection *section) {
+    return crc32c_update(0, toc->data + section->offset, section->size) !=
+           section->checksum;
+}
 
-    char *asset_table = (char *)offset;
+// Runs on a worker thread.
+static void verify_checksum_job(void *argument) {
+    ChecksumJob *job = argument;
+    const SceneFileSection *section = job->section;
+    int is_corrupted = is_section_corrupted(job->pipeline->toc, section);
+    if (is_corrupted)
+        fprintf(stderr, "ERROR: scene file section %u is corrupted.\n",
+                section->type);
+    finish_job(job->pipeline, is_corrupted);
+}
 
-    offset += header.asset_size * header.asset_count;
+// Returns 1 if any of the sections needed for `parts` doesn't match its
+// checksum.
+static int verify_checksums(LoadPipeline *pipeline, uint32_t parts) {
+    const SceneFileToc *toc = pipeline->toc;
+    if (!toc->header.flags.has_checksums)
+        return 0;
 
-    SceneFileLightingScene file_lighting_scene = {0};
-    memcpy(&file_lighting_scene, offset, header.lighting_scene_size);
-    lighting_scene_set_ambient_color(file_lighting_scene.ambient_color);
+    uint32_t types = 0;
+    for (size_t i = 0; i < ARRAY_LENGTH(part_sections); i++) {
+        if (parts & 1 << i)
+            types |= part_sections[i];
+    }
 
-    offset += header.lighting_scene_size;
+    ChecksumJob jobs[SCENE_FILE_SECTION_TYPE_COUNT] = {0};
+    for (uint32_t type = 1; type < SCENE_FILE_SECTION_TYPE_COUNT; type++) {
+        const SceneFileSection *section = &toc->sections[type];
+        if (!(types & SCENE_FILE_SECTION_BIT(type)) || section->type != type)
+            continue;
+        jobs[type] = (ChecksumJob){.pipeline = pipeline, .section = section};
+        run_job(pipeline, verify_checksum_job, jobs + type);
+    }
 
-    for (size_t i = 0; i < header.light_source_count; i++) {
+    wait_for_jobs(pipeline);
+    return atomic_load(&pipeline->has_failed);
+}
 
-        SceneFileLightSource light = {0};
-        memcpy(&light, offset + i * header.light_source_size,
-               header.light_source_size);
+static void load_lights(const SceneFileToc *toc) {
+    const SceneFileSection *section =
+        get_section(toc, SCENE_FILE_SECTION_LIGHTING_SCENE);
+    if (section && section->count > 0) {
+        SceneFileLightingScene file_lighting_scene = {0};
+        memcpy(&file_lighting_scene, toc->data + section->offset,
+               min(section->record_size, sizeof(SceneFileLightingScene)));
+        lighting_scene_set_ambient_color(file_lighting_scene.ambient_color);
+    }
+
+    section = get_section(toc, SCENE_FILE_SECTION_LIGHT_SOURCES);
+    if (!section)
+        return;
+
+    const uint8_t *table = toc->data + section->offset;
+    for (size_t i = 0; i < section->count; i++) {
+        SceneFileLightSource scratch = {0};
+        const SceneFileLightSource *light = GET_RECORD(
+            SceneFileLightSource, table, i, section->record_size, &scratch);
 
         lighting_scene_add_light(
             (LightSource){
-                .is_disabled = light.is_disabled,
-                .intensity = light.intensity,
-                .intensity_granular = light.intensity_granular,
-                .intensity_cap = light.intensity_cap,
+                .is_disabled = light->is_disabled,
+                .intensity = light->intensity,
+                .intensity_granular = light->intensity_granular,
+                .intensity_cap = light->intensity_cap,
                 .type = LIGHT_POINT,
-                .position = light.position,
-                .color = light.color,
+                .position = light->position,
+                .color = light->color,
             },
             0);
     }
+}
 
-    offset += header.light_source_size * header.light_source_count;
+static inline int is_inside_box(Vector3 point, BoundingBox box) {
+    return point.x >= box.min.x && point.x <= box.max.x &&
+           point.y >= box.min.y && point.y <= box.max.y &&
+           point.z >= box.min.z && point.z <= box.max.z;
+}
 
-    for (size_t i = 0; i < header.entity_count; i++) {
+// An entry of the file's asset table, resolved to a runtime handle the first
+// time an entity uses it.
+typedef struct {
+    AssetHandle handle;
+    uint8_t is_resolved;
+    uint8_t is_missing;
+    uint8_t is_shader_set;
+} FileAsset;
 
+// Returns 1 if the asset at `index` of the asset table doesn't exist anymore.
+static int resolve_asset(FileAsset *file_assets, const SceneFileAsset *assets,
+                         size_t index) {
+    FileAsset *file_asset = &file_assets[index];
+    if (file_asset->is_resolved)
+        return file_asset->is_missing;
+
+    file_asset->is_resolved = 1;
+    if (assets_get_handle(assets[index].name, &file_asset->handle)) {
+        fprintf(stderr, "WARNING: Asset %s no longer exists.\n",
+                assets[index].name);
+        file_asset->is_missing = 1;
+    }
+    return file_asset->is_missing;
+}
+
+// Reads the asset table of the file. Free the result with free.
+static SceneFileAsset *decode_assets(const SceneFileToc *toc) {
+    size_t asset_count = get_asset_count(toc);
+    SceneFileAsset *assets =
+        malloc(max(asset_count, 1) * sizeof(SceneFileAsset));
+    if (!assets)
+        abort();
+    for (size_t i = 0; i < asset_count; i++)
+        get_asset_name(toc, i, assets[i].name);
+    return assets;
+}
+
+// Entities of the file that are to be loaded.
+typedef struct {
+    // Their asset handles are left to be resolved from `asset_indices`
+    Entity *entities;
+    // Index into the asset table and slot in the entity table of every entity
+    uint32_t *asset_indices;
+    uint64_t *slots;
+    size_t count;
+} DecodedEntities;
+
+static void decoded_entities_free(DecodedEntities *decoded) {
+    free(decoded->entities);
+    free(decoded->asset_indices);
+    free(decoded->slots);
+    *decoded = (DecodedEntities){0};
+}
+
+// Decodes the entities of the file selected by `options`. Free the result with
+// decoded_entities_free. Returns 1 if an entity refers to an asset that isn't
+// in the asset table.
+static int decode_entities(const SceneFileToc *toc,
+                           const SceneFileLoadOptions *options,
+                           DecodedEntities *out_decoded) {
+    size_t asset_count = get_asset_count(toc);
+    size_t entity_count = get_entity_count(toc);
+    size_t allocated = max(entity_count, 1);
+    DecodedEntities decoded = {
+        .entities = malloc(allocated * sizeof(Entity)),
+        .asset_indices = malloc(allocated * sizeof(uint32_t)),
+        .slots = malloc(allocated * sizeof(uint64_t)),
+    };
+    if (!decoded.entities || !decoded.asset_indices || !decoded.slots)
+        abort();
+
+    int result = 0;
+    for (size_t i = 0; i < entity_count; i++) {
+        if (toc->entities && toc->is_entity_removed[i])
+            continue;
         SceneFileEntity entity = {0};
-        memcpy(&entity, offset + i * header.entity_size, header.entity_size);
+        get_entity(toc, i, &entity);
+
+        if (options->use_entity_range &&
+            !is_inside_box(matrix_get_position(entity.transform),
+                           options->entity_range))
+            continue;
 
-        char *asset_name = asset_table + entity.asset_index * header.asset_size;
+        if (entity.asset_index >= asset_count) {
+            result = 1;
+            break;
+        }
+
+        decoded.entities[decoded.count] = (Entity){
+            .transform = entity.transform,
+            .ignore_raycast = entity.ignore_raycast,
+            .is_static = entity.is_static,
+        };
+        decoded.asset_indices[decoded.count] = entity.asset_index;
+        decoded.slots[decoded.count++] = i;
+    }
 
-        AssetHandle asset_handle = 0;
-        if (assets_get_handle(asset_name, &asset_handle)) {
-            fprintf(stderr, "WARNING: Asset %s no longer exists.\n",
-                    asset_name);
+    *out_decoded = decoded;
+    return result;
+}
+
+// Remembers entity `handle` as loaded from `slot` of the entity table, with
+// its record made from the entity as it is now.
+static void remember_saved_entity(EntityHandle handle, uint64_t slot,
+                                  uint32_t asset_index) {
+    if (handle >= saved.entity_count) {
+        reserve_saved_entities(handle + 1);
+        saved.entity_count = handle + 1;
+    }
+    SavedEntity *saved_entity = &saved.entities[handle];
+    saved_entity->slot = slot;
+    make_file_entity(scene_get_entity(handle), asset_index,
+                     &saved_entity->record);
+}
+
+// Adds the entities of the file to the scene, remembering them in the saved
+// scene if `is_remembered` is set. Returns 1 on error.
+static int load_entities(LoadPipeline *pipeline,
+                         const SceneFileLoadOptions *options,
+                         const char *asset_directory, int is_remembered) {
+    const SceneFileToc *toc = pipeline->toc;
+    if (get_entity_count(toc) == 0)
+        return 0;
+
+    double time = 0;
+    lap(&time);
+    SceneFileAsset *assets = decode_assets(toc);
+    pipeline->timings->decode_assets = lap(&time);
+    DecodedEntities decoded = {0};
+    int result = decode_entities(toc, options, &decoded);
+    pipeline->timings->decode_entities = lap(&time);
+
+    size_t asset_count = get_asset_count(toc);
+    FileAsset *file_assets = calloc(max(asset_count, 1), sizeof(FileAsset));
+    if (!file_assets)
+        abort();
+
+    // Entities of missing assets are dropped, the rest are moved down
+    size_t new_entity_count = 0;
+    for (size_t i = 0; !result && i < decoded.count; i++) {
+        uint32_t asset_index = decoded.asset_indices[i];
+        if (resolve_asset(file_assets, assets, asset_index))
+            continue;
+
+        Entity new_entity = decoded.entities[i];
+        new_entity.asset_handle = file_assets[asset_index].handle;
+
+        // Added to the scene once their cell gets loaded
+        if (streaming_is_enabled()) {
+            streaming_add_entity(new_entity);
             continue;
         }
 
-        EntityHandle entity_handle = 0;
-        if (scene_add(
-                (Entity){
-                    .asset_handle = asset_handle,
-                    .transform = entity.transform,
-                    .ignore_raycast = entity.ignore_raycast,
-                },
-                &entity_handle, asset_directory))
-            return 1;
+        decoded.asset_indices[new_entity_count] = asset_index;
+        decoded.slots[new_entity_count] = decoded.slots[i];
+        decoded.entities[new_entity_count++] = new_entity;
+    }
 
-        Entity *added_entity = scene_get_entity(entity_handle);
+    if (result || new_entity_count == 0)
+        goto end;
+
+    EntityHandle *entity_handles =
+        malloc(new_entity_count * sizeof(EntityHandle));
+    if (!entity_handles)
+        abort();
+
+    result = scene_add_many(decoded.entities, new_entity_count, entity_handles,
+                            asset_directory);
+
+    for (size_t i = 0; !result && is_remembered && i < new_entity_count; i++)
+        remember_saved_entity(entity_handles[i], decoded.slots[i],
+                              decoded.asset_indices[i]);
+
+    // Entities of the same asset share a model
+    for (size_t i = 0; !result && i < new_entity_count; i++) {
+        FileAsset *file_asset = &file_assets[decoded.asset_indices[i]];
+        if (file_asset->is_shader_set)
+            continue;
+        file_asset->is_shader_set = 1;
+
+        Entity *added_entity = scene_get_entity(entity_handles[i]);
         assert(added_entity);
         Model *model = scene_entity_get_model(added_entity);
         assert(model->meshCount);
@@ -290,55 +1887,504 @@ int scene_file_load(FILE *fp, const char *skybox_directory,
         model->materials[0].shader = lighting_scene_get_base_shader();
     }
 
-    offset += header.entity_size * header.entity_count;
+    free(entity_handles);
 
-    if (header.skybox_count > 0) {
-        SceneFileSkybox skybox = {0};
-        memcpy(&skybox, offset, header.skybox_size);
+end:
+    decoded_entities_free(&decoded);
+    free(file_assets);
+    free(assets);
+    return result;
+}
 
-        SkyboxHandle skybox_handle = 0;
-        if (!skyboxes_get_handle(skybox.name, &skybox_handle)) {
-            scene_set_skybox(skybox_handle, skybox_directory);
-        } else
-            fprintf(stderr, "WARNING: Skybox %s no longer exists.\n",
-                    skybox.name);
-    }
+// Reads the first skybox of the file. Returns 1 if it has none.
+static int read_skybox(const SceneFileToc *toc, SceneFileSkybox *out_skybox) {
+    const SceneFileSection *section =
+        get_section(toc, SCENE_FILE_SECTION_SKYBOXES);
+    const SceneFileSection *names =
+        get_section(toc, SCENE_FILE_SECTION_SKYBOX_NAMES);
 
-    offset += header.skybox_size * header.skybox_count;
+    *out_skybox = (SceneFileSkybox){0};
+    if (section && section->count > 0)
+        memcpy(out_skybox, toc->data + section->offset,
+               min(section->record_size, sizeof(SceneFileSkybox)));
+    else if (!names || get_section_name(toc, names, 0, out_skybox->name))
+        return 1;
+    out_skybox->name[NAME_MAX_LENGTH - 1] = 0;
+    return 0;
+}
 
-    SceneFileTerrainInfo terrain_info = {0};
-    memcpy(&terrain_info, offset, header.terrain_info_size);
-    offset += header.terrain_info_size;
+static void load_skybox(const SceneFileToc *toc,
+                        const char *skybox_directory) {
+    SceneFileSkybox skybox = {0};
+    if (read_skybox(toc, &skybox))
+        return;
 
-    if (terrain_info.width * terrain_info.width !=
-            header.terrain_heights_size / sizeof(float) ||
-        terrain_info.width * terrain_info.width !=
-            header.terrain_texture_indices_size)
-        return 1;
+    SkyboxHandle skybox_handle = 0;
+    if (!skyboxes_get_handle(skybox.name, &skybox_handle)) {
+        scene_set_skybox(skybox_handle, skybox_directory);
+    } else
+        fprintf(stderr, "WARNING: Skybox %s no longer exists.\n", skybox.name);
+}
+
+// Reads the terrain info into the pipeline and checks the terrain data of the
+// file against it. Returns 1 on error.
+static int read_terrain_info(LoadPipeline *pipeline, int *out_has_terrain) {
+    const SceneFileToc *toc = pipeline->toc;
+    const SceneFileSection *info_section =
+        get_section(toc, SCENE_FILE_SECTION_TERRAIN_INFO);
+    const SceneFileSection *heights_section =
+        get_section(toc, SCENE_FILE_SECTION_TERRAIN_HEIGHTS);
+    const SceneFileSection *indices_section =
+        get_section(toc, SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES);
+    *out_has_terrain = 0;
+    if (!info_section || info_section->count == 0)
+        return 0;
+
+    SceneFileTerrainInfo *terrain_info = &pipeline->terrain_info;
+    memcpy(terrain_info, toc->data + info_section->offset,
+           min(info_section->record_size, sizeof(SceneFileTerrainInfo)));
+
+    // Records without the names have them in the string table
+    const SceneFileSection *names =
+        get_section(toc, SCENE_FILE_SECTION_TERRAIN_TEXTURE_NAMES);
+    if (names &&
+        info_section->record_size <=
+            offsetof(SceneFileTerrainInfo, texture_names)) {
+        for (size_t i = 0; i < TERRAIN_MAX_TEXTURES; i++)
+            get_section_name(toc, names, i, terrain_info->texture_names[i]);
+    }
 
-    if (terrain_info.width == 0)
+    if (terrain_info->width == 0)
         return 0;
 
-    terrain_resize(terrain_info.width - 1);
+    size_t terrain_size = (size_t)terrain_info->width * terrain_info->width;
+    if (!heights_section || !indices_section)
+        return 1;
+    if (!toc->header.flags.compressed_terrain &&
+        (heights_section->size != terrain_size * sizeof(float) ||
+         indices_section->size != terrain_size))
+        return 1;
 
-    memcpy(terrain.heights, offset, header.terrain_heights_size);
-    offset += header.terrain_heights_size;
-    memcpy(terrain.texture_indices, offset,
-           header.terrain_texture_indices_size);
-    offset += header.terrain_texture_indices_size;
+    *out_has_terrain = 1;
+    return 0;
+}
+
+// Copies the data of the terrain region records over the terrain data of
+// `width` by `width` points. Returns 1 if a region doesn't fit in it.
+static int apply_terrain_regions(const SceneFileToc *toc, uint32_t width,
+                                 float *out_heights,
+                                 uint8_t *out_texture_indices) {
+    for (size_t i = 0; i < toc->terrain_region_count; i++) {
+        const uint8_t *data = toc->terrain_regions[i];
+        SceneFileJournalTerrainRegion region = {0};
+        memcpy(&region, data, sizeof region);
+        if (region.x > width || region.width > width - region.x ||
+            region.y > width || region.height > width - region.y)
+            return 1;
+
+        size_t row_size = region.width;
+        const uint8_t *heights = data + sizeof region;
+        const uint8_t *texture_indices =
+            heights + row_size * region.height * sizeof(float);
+        for (uint32_t row = 0; row < region.height; row++) {
+            size_t start = (size_t)(region.y + row) * width + region.x;
+            memcpy(out_heights + start,
+                   heights + row * row_size * sizeof(float),
+                   row_size * sizeof(float));
+            memcpy(out_texture_indices + start,
+                   texture_indices + row * row_size, row_size);
+        }
+    }
+    return 0;
+}
 
-    // Terrain textures
+// Decodes the terrain data of the file, `width` by `width` points as read by
+// read_terrain_info, into `out_heights` and `out_texture_indices`. Returns 1 on
+// error.
+static int decode_terrain(const SceneFileToc *toc, uint32_t width,
+                          float *out_heights, uint8_t *out_texture_indices) {
+    const SceneFileSection *heights_section =
+        get_section(toc, SCENE_FILE_SECTION_TERRAIN_HEIGHTS);
+    const SceneFileSection *indices_section =
+        get_section(toc, SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES);
+    const uint8_t *heights = toc->data + heights_section->offset;
+    const uint8_t *texture_indices = toc->data + indices_section->offset;
+    size_t size = (size_t)width * width;
+
+    if (toc->header.flags.compressed_terrain) {
+        if (compression_decode_heights(heights, heights_section->size,
+                                       out_heights, width) ||
+            compression_rle_decode(texture_indices, indices_section->size,
+                                   out_texture_indices, size))
+            return 1;
+    } else {
+        // Copied straight from the file, no resizing
+        memcpy(out_heights, heights, size * sizeof(float));
+        memcpy(out_texture_indices, texture_indices, size);
+    }
+
+    return apply_terrain_regions(toc, width, out_heights,
+                                 out_texture_indices);
+}
+
+// Decodes the terrain data straight into the terrain. Runs on a worker thread.
+static void decode_terrain_job(void *argument) {
+    LoadPipeline *pipeline = argument;
+    double time = 0;
+    lap(&time);
+    int has_failed = decode_terrain(pipeline->toc, terrain.width,
+                                    terrain.heights, terrain.texture_indices);
+    pipeline->timings->decode_terrain = lap(&time);
+    if (has_failed) {
+        finish_job(pipeline, 1);
+        return;
+    }
+
+    if (pipeline->build_terrain_mesh) {
+        uint32_t width_cells = terrain.width - 1;
+        pipeline->terrain_mesh =
+            terrain_build_region_mesh(0, 0, width_cells, width_cells);
+    }
+    finish_job(pipeline, 0);
+}
+
+static void load_terrain_textures(const SceneFileTerrainInfo *terrain_info) {
     for (size_t i = 0; i < TERRAIN_MAX_TEXTURES; i++) {
         TerrainTextureHandle texture_handle = 0;
-        if (terrain_textures_get_handle(terrain_info.texture_names[i],
+        if (terrain_textures_get_handle(terrain_info->texture_names[i],
                                         &texture_handle)) {
             printf("WARNING: terrain texture %s no longer exists\n",
-                   terrain_info.texture_names[i]);
+                   terrain_info->texture_names[i]);
             continue;
         }
         terrain_textures_load_into_slot(texture_handle, i, 0);
     }
+}
+
+// Makes the loaded scene the saved one, so that the next incremental save
+// appends to the file it was loaded from.
+static void remember_loaded_scene(const SceneFileToc *toc, int has_terrain) {
+    saved.file_size = toc->size;
+    saved.section_table_checksum = toc->header.section_table_checksum;
+    saved.slot_count = get_entity_count(toc);
+
+    if (saved.asset_names.data)
+        stringvec_truncate(&saved.asset_names);
+    else
+        saved.asset_names = stringvec_init();
+    for (size_t i = 0; i < get_asset_count(toc); i++) {
+        char name[NAME_MAX_LENGTH] = {0};
+        get_asset_name(toc, i, name);
+        stringvec_append(&saved.asset_names, name,
+                         strnlen(name, NAME_MAX_LENGTH - 1));
+    }
+
+    genbuf_free(&saved.lighting);
+    saved.lighting = genbuf_init();
+    serialize_lighting_data_into_buf(&saved.lighting, 0);
+
+    // The skybox as named in the file, it may no longer exist
+    read_skybox(toc, &saved.skybox);
+
+    GeneralBuffer records = genbuf_init();
+    serialize_terrain_info_into_buf(&records);
+    memcpy(&saved.terrain_info, records.data, sizeof(SceneFileTerrainInfo));
+    genbuf_free(&records);
+
+    // A file without terrain doesn't match whatever terrain there is
+    if (!has_terrain)
+        saved.terrain_info.width = 0;
+    else
+        terrain_clear_dirty_tiles();
+
+    saved.is_valid = 1;
+}
+
+static int load_from_toc(const SceneFileToc *toc,
+                         const char *skybox_directory,
+                         const char *asset_directory,
+                         const SceneFileLoadOptions *options,
+                         SceneFileLoadTimings *timings) {
+    LoadPipeline pipeline = {
+        .toc = toc,
+        .timings = timings,
+        .build_terrain_mesh =
+            options->build_terrain_mesh && !streaming_is_enabled(),
+    };
+
+    double time = 0;
+    lap(&time);
+    uint32_t parts = options->parts ? options->parts : SCENE_FILE_LOAD_ALL;
+    if (options->verify_checksums && verify_checksums(&pipeline, parts))
+        return 1;
+    timings->verify_checksums = lap(&time);
+
+    // Only a whole file loaded into the scene can be appended to later, the
+    // journal of version 0 files is never read and an incomplete save at the
+    // end would have to be overwritten first
+    int is_remembered = (parts & SCENE_FILE_LOAD_ALL) == SCENE_FILE_LOAD_ALL &&
+                        !options->use_entity_range && !streaming_is_enabled() &&
+                        toc->header.version > 0 &&
+                        toc->journal_end == toc->size;
+
+    int has_terrain = 0;
+    if (parts & SCENE_FILE_LOAD_TERRAIN &&
+        read_terrain_info(&pipeline, &has_terrain))
+        return 1;
+    if (has_terrain) {
+        // Filled in by decode_terrain_job
+        terrain_load_data(pipeline.terrain_info.width, 0, 0);
+        run_job(&pipeline, decode_terrain_job, &pipeline);
+    }
 
-    free(file_buffer);
+    // Files of new assets are read and decoded on the worker threads
+    // meanwhile, and uploaded while waiting for the rest
+    int was_async_loading = scene_is_async_loading();
+    if (worker_pool_is_running())
+        scene_set_async_loading(1);
+
+    int result = 0;
+    if (parts & SCENE_FILE_LOAD_LIGHTS)
+        load_lights(toc);
+    if (parts & SCENE_FILE_LOAD_ENTITIES)
+        result =
+            load_entities(&pipeline, options, asset_directory, is_remembered);
+    if (parts & SCENE_FILE_LOAD_SKYBOX)
+        load_skybox(toc, skybox_directory);
+
+    wait_for_jobs(&pipeline);
+    if (atomic_load(&pipeline.has_failed))
+        result = 1;
+
+    if (has_terrain && !result) {
+        load_terrain_textures(&pipeline.terrain_info);
+        if (pipeline.build_terrain_mesh)
+            terrain_upload_mesh(pipeline.terrain_mesh);
+    } else if (pipeline.terrain_mesh.vertexCount)
+        UnloadMesh(pipeline.terrain_mesh);
+
+    scene_finish_pending_loads();
+    scene_set_async_loading(was_async_loading);
+
+    if (!result && is_remembered)
+        remember_loaded_scene(toc, has_terrain);
+    return result;
+}
+
+static int load_from_view(FileView *view, const char *skybox_directory,
+                          const char *asset_directory,
+                          const SceneFileLoadOptions *options,
+                          SceneFileLoadTimings *timings) {
+    double time = 0;
+    lap(&time);
+    SceneFileToc toc = {0};
+    int result = read_toc(view, &toc);
+    timings->read_toc = lap(&time);
+    if (!result)
+        result = load_from_toc(&toc, skybox_directory, asset_directory,
+                               options, timings);
+    toc_free(&toc);
+    return result;
+}
+
+int scene_file_load_ex(FILE *fp, const char *skybox_directory,
+                       const char *asset_directory,
+                       const SceneFileLoadOptions *options) {
+    printf("INFO: loading scene file.\n");
+
+    // Whatever was saved before has nothing to do with the scene anymore
+    scene_file_finish_compaction();
+    track_entity_handles();
+    saved.is_valid = 0;
+    saved.entity_count = 0;
+    saved.has_streamed_entities = 0;
+
+    SceneFileLoadTimings timings = {0};
+    double time = 0;
+    lap(&time);
+    FileView view = {0};
+    if (file_view_open(fp, &view))
+        return 1;
+    timings.open = lap(&time);
+
+    int result = load_from_view(&view, skybox_directory, asset_directory,
+                                options, &timings);
+    file_view_close(&view);
+    if (options->timings)
+        *options->timings = timings;
+    return result;
+}
+
+int scene_file_load(FILE *fp, const char *skybox_directory,
+                    const char *asset_directory) {
+    SceneFileLoadOptions options = {
+        .parts = SCENE_FILE_LOAD_ALL,
+        .verify_checksums = 1,
+    };
+    return scene_file_load_ex(fp, skybox_directory, asset_directory, &options);
+}
+
+int scene_file_read_sections(FILE *fp, SceneFileSection *out_sections,
+                             size_t max_sections, size_t *out_section_count) {
+    FileView view = {0};
+    if (file_view_open(fp, &view))
+        return 1;
+
+    SceneFileToc toc = {0};
+    int result = read_toc(&view, &toc);
+    size_t section_count = 0;
+    for (size_t i = 1; !result && i < SCENE_FILE_SECTION_TYPE_COUNT; i++) {
+        const SceneFileSection *section = get_section(&toc, i);
+        if (section && section_count < max_sections)
+            out_sections[section_count++] = *section;
+    }
+
+    toc_free(&toc);
+    file_view_close(&view);
+    if (out_section_count)
+        *out_section_count = section_count;
+    return result;
+}
+
+int scene_file_inspect(FILE *fp, SceneFileInspection *out_inspection) {
+    FileView view = {0};
+    if (file_view_open(fp, &view))
+        return 1;
+
+    SceneFileToc toc = {0};
+    if (read_toc(&view, &toc)) {
+        toc_free(&toc);
+        file_view_close(&view);
+        return 1;
+    }
+
+    SceneFileInspection *inspection = out_inspection;
+    *inspection = (SceneFileInspection){
+        .header = toc.header,
+        .file_size = toc.size,
+        .journal_size = toc.size - toc.journal_offset,
+    };
+    memcpy(inspection->sections, toc.sections, sizeof toc.sections);
+    for (uint32_t type = 1; type < SCENE_FILE_SECTION_TYPE_COUNT; type++) {
+        const SceneFileSection *section = get_section(&toc, type);
+        if (section && toc.header.flags.has_checksums)
+            inspection->is_section_corrupted[type] =
+                is_section_corrupted(&toc, section);
+    }
+
+    // Records after the last commit record are ignored by the loader
+    size_t offset = toc.journal_offset;
+    size_t end = offset;
+    size_t record_count = 0;
+    SceneFileJournalRecord record = {0};
+    while (!next_journal_record(&toc, &offset, &record)) {
+        record_count++;
+        if (record.type == SCENE_FILE_JOURNAL_COMMIT) {
+            end = offset;
+            inspection->journal_record_count = record_count;
+        }
+    }
+    inspection->incomplete_journal_size = toc.size - end;
+
+    size_t asset_count = get_asset_count(&toc);
+    inspection->asset_count = asset_count;
+    inspection->assets = malloc(max(asset_count, 1) * sizeof(SceneFileAsset));
+    inspection->asset_entity_counts = calloc(max(asset_count, 1),
+                                             sizeof(size_t));
+    if (!inspection->assets || !inspection->asset_entity_counts)
+        abort();
+    for (size_t i = 0; i < asset_count; i++)
+        get_asset_name(&toc, i, inspection->assets[i].name);
+
+    size_t entity_count = get_entity_count(&toc);
+    for (size_t i = 0; i < entity_count; i++) {
+        if (toc.entities && toc.is_entity_removed[i])
+            continue;
+        SceneFileEntity entity = {0};
+        get_entity(&toc, i, &entity);
+
+        inspection->entity_count++;
+        inspection->static_entity_count += entity.is_static != 0;
+        inspection->ignore_raycast_entity_count += entity.ignore_raycast != 0;
+        if (entity.asset_index < asset_count)
+            inspection->asset_entity_counts[entity.asset_index]++;
+        else
+            inspection->invalid_entity_count++;
+    }
+
+    const SceneFileSection *info_section =
+        get_section(&toc, SCENE_FILE_SECTION_TERRAIN_INFO);
+    if (info_section && info_section->count > 0) {
+        SceneFileTerrainInfo terrain_info = {0};
+        memcpy(&terrain_info, toc.data + info_section->offset,
+               min(info_section->record_size, sizeof terrain_info));
+        inspection->terrain_width = terrain_info.width;
+    }
+
+    toc_free(&toc);
+    file_view_close(&view);
     return 0;
 }
+
+void scene_file_inspection_free(SceneFileInspection *inspection) {
+    free(inspection->assets);
+    free(inspection->asset_entity_counts);
+    *inspection = (SceneFileInspection){0};
+}
+
+int scene_file_time_load(FILE *fp, SceneFileLoadTimings *out_timings) {
+    SceneFileLoadTimings *timings = out_timings;
+    *timings = (SceneFileLoadTimings){0};
+    double time = 0;
+    lap(&time);
+
+    FileView view = {0};
+    if (file_view_open(fp, &view))
+        return 1;
+    timings->open = lap(&time);
+
+    SceneFileToc toc = {0};
+    int result = read_toc(&view, &toc);
+    timings->read_toc = lap(&time);
+    if (result)
+        goto end;
+
+    LoadPipeline pipeline = {.toc = &toc, .timings = timings};
+    result = verify_checksums(&pipeline, SCENE_FILE_LOAD_ALL);
+    timings->verify_checksums = lap(&time);
+    if (result)
+        goto end;
+
+    free(decode_assets(&toc));
+    timings->decode_assets = lap(&time);
+
+    SceneFileLoadOptions options = {0};
+    DecodedEntities decoded = {0};
+    result = decode_entities(&toc, &options, &decoded);
+    timings->decode_entities = lap(&time);
+    decoded_entities_free(&decoded);
+    if (result)
+        goto end;
+
+    // Decoded into scratch buffers, the terrain is left alone
+    int has_terrain = 0;
+    lap(&time);
+    result = read_terrain_info(&pipeline, &has_terrain);
+    if (!result && has_terrain) {
+        uint32_t width = pipeline.terrain_info.width;
+        size_t size = (size_t)width * width;
+        float *heights = malloc(size * sizeof(float));
+        uint8_t *texture_indices = malloc(size);
+        if (!heights || !texture_indices)
+            abort();
+        result = decode_terrain(&toc, width, heights, texture_indices);
+        free(heights);
+        free(texture_indices);
+    }
+    timings->decode_terrain = lap(&time);
+
+end:
+    toc_free(&toc);
+    file_view_close(&view);
+    return result;
+}
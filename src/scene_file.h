@@ -5,12 +5,27 @@
 Functions for storing a scene as a file.
 
 Scene file structure:
-    - A header, as described by struct `SceneFileHeader`, which will specify the
-    sizes (amount of entries) of the following sections.
-    - A table of asset names
-    - A table of light groups
-    - A table of light sources
-    - A table of entities
+    - A header, as described by struct `SceneFileHeader`.
+    - A section table of `SceneFileSection` records, giving the type, offset
+    and size of every section in the file. Sections of an unknown type are
+    skipped by the loader.
+    - The sections: asset names, lighting scene, light sources, entities,
+    skyboxes, terrain info, terrain heights and terrain texture indices.
+
+Files of version 0 have no section table, their sections follow the header in
+the order above and are located by summing the sizes given in the header.
+
+Since version 2 names are kept in a string table section of null-terminated
+strings, each name stored once, and referred to by their offset in it. Asset,
+skybox and terrain texture names have a section of offsets each, the terrain
+info records end before their names. Entities are written as
+`SceneFileCompactEntity`s unless a transform can't be represented by one.
+
+Incremental saves append a journal after the last section, a sequence of
+`SceneFileJournalRecord`s each followed by its data padded to 8 bytes. The
+loader applies the records on top of the sections in order. The records of each
+save end with a commit record, records after the last intact commit record are
+left by an interrupted save and ignored.
  */
 
 //  NOTE: IMPORTANT! Never shrink the SceneFileWhatever structs, only grow.
@@ -25,12 +40,18 @@ Scene file structure:
 #include <stdio.h>
 
 #define SCENE_FILE_MAGIC 0x1273
-#define SCENE_FILE_VERSION 0
+#define SCENE_FILE_VERSION 2
 
 #include <stdint.h>
 
 typedef struct {
-    uint16_t reserved : 16;
+    // Terrain heights and texture indices are encoded with
+    // `compression_encode_heights` and `compression_rle_encode`, heights are
+    // quantized to `COMPRESSION_HEIGHT_STEP`.
+    uint16_t compressed_terrain : 1;
+    // The section table and every section have a CRC32C checksum.
+    uint16_t has_checksums : 1;
+    uint16_t reserved : 14;
 } SceneFileFlags;
 
 typedef struct {
@@ -53,8 +74,48 @@ typedef struct {
     uint16_t terrain_info_size;
     uint32_t terrain_heights_size;
     uint32_t terrain_texture_indices_size;
+
+    // Version 0 files end here
+    uint16_t version;
+    uint16_t section_size;
+    uint32_t section_count;
+    uint64_t section_table_offset;
+    uint32_t section_table_checksum;
+    uint32_t reserved;
 } SceneFileHeader;
 
+typedef enum {
+    SCENE_FILE_SECTION_ASSETS = 1,
+    SCENE_FILE_SECTION_LIGHTING_SCENE,
+    SCENE_FILE_SECTION_LIGHT_SOURCES,
+    SCENE_FILE_SECTION_ENTITIES,
+    SCENE_FILE_SECTION_SKYBOXES,
+    SCENE_FILE_SECTION_TERRAIN_INFO,
+    SCENE_FILE_SECTION_TERRAIN_HEIGHTS,
+    SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES,
+    // Null-terminated strings
+    SCENE_FILE_SECTION_STRINGS,
+    // uint32_t offsets into the string table
+    SCENE_FILE_SECTION_ASSET_NAMES,
+    SCENE_FILE_SECTION_COMPACT_ENTITIES,
+    // uint32_t offsets into the string table
+    SCENE_FILE_SECTION_SKYBOX_NAMES,
+    // uint32_t offsets into the string table, one per terrain texture slot
+    SCENE_FILE_SECTION_TERRAIN_TEXTURE_NAMES,
+    SCENE_FILE_SECTION_TYPE_COUNT,
+} SceneFileSectionType;
+
+typedef struct {
+    uint32_t type;
+    uint32_t flags;
+    // In bytes from the start of the file
+    uint64_t offset;
+    uint64_t size;
+    uint64_t count;
+    uint32_t record_size;
+    uint32_t checksum;
+} SceneFileSection;
+
 typedef struct {
     char name[NAME_MAX_LENGTH];
 } SceneFileAsset;
@@ -79,9 +140,28 @@ typedef struct {
     uint32_t asset_index;
     uint32_t light_group_index;
     uint8_t ignore_raycast;
-    uint8_t : 8;
+    uint8_t is_static;
 } SceneFileEntity;
 
+typedef enum {
+    SCENE_FILE_ENTITY_IGNORE_RAYCAST = 1 << 0,
+    SCENE_FILE_ENTITY_STATIC = 1 << 1,
+} SceneFileCompactEntityFlags;
+
+// An entity with its transform split into a position, rotation and scale.
+typedef struct {
+    Vector3 position;
+    uint32_t asset_index;
+    // Quaternion encoded with `compression_encode_quaternion`
+    uint16_t rotation[3];
+    // Half precision floats
+    uint16_t scale[3];
+    uint8_t rotation_largest;
+    // SceneFileCompactEntityFlags
+    uint8_t flags;
+    uint16_t reserved;
+} SceneFileCompactEntity;
+
 typedef struct {
     char name[NAME_MAX_LENGTH];
 } SceneFileSkybox;
@@ -92,13 +172,178 @@ typedef struct {
     char texture_names[TERRAIN_MAX_TEXTURES][NAME_MAX_LENGTH];
 } SceneFileTerrainInfo;
 
-// Stores the current scene into a file.
+typedef enum {
+    // `SceneFileAsset`s appended to the asset table
+    SCENE_FILE_JOURNAL_ASSETS = 1,
+    // `SceneFileJournalEntity`s
+    SCENE_FILE_JOURNAL_ENTITIES,
+    // The rest replace the section of the same kind
+    SCENE_FILE_JOURNAL_LIGHTING_SCENE,
+    SCENE_FILE_JOURNAL_LIGHT_SOURCES,
+    SCENE_FILE_JOURNAL_SKYBOXES,
+    SCENE_FILE_JOURNAL_TERRAIN_INFO,
+    // A `SceneFileJournalTerrainRegion` followed by the heights and then the
+    // texture indices of the region, row by row
+    SCENE_FILE_JOURNAL_TERRAIN_REGION,
+    // Ends the records of one save, with no data
+    SCENE_FILE_JOURNAL_COMMIT,
+} SceneFileJournalRecordType;
+
+typedef struct {
+    uint32_t type;
+    // Of the data following this record, without padding
+    uint32_t size;
+    uint32_t record_size;
+    // CRC32C of the data
+    uint32_t checksum;
+} SceneFileJournalRecord;
+
+typedef struct {
+    // Index in the entity table, slots past its end append an entity
+    uint64_t slot;
+    uint32_t is_removed;
+    uint32_t reserved;
+    SceneFileEntity entity;
+} SceneFileJournalEntity;
+
+typedef struct {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} SceneFileJournalTerrainRegion;
+
+// Parts of a scene file to load, see `SceneFileLoadOptions`.
+typedef enum {
+    SCENE_FILE_LOAD_LIGHTS = 1 << 0,
+    SCENE_FILE_LOAD_ENTITIES = 1 << 1,
+    SCENE_FILE_LOAD_SKYBOX = 1 << 2,
+    SCENE_FILE_LOAD_TERRAIN = 1 << 3,
+    SCENE_FILE_LOAD_ALL = 0xf,
+} SceneFileLoadParts;
+
+// Seconds spent in each phase of loading a scene file, see
+// `SceneFileLoadOptions` and `scene_file_time_load`.
+typedef struct {
+    // Mapping or reading the file
+    double open;
+    // Header, section table and journal
+    double read_toc;
+    double verify_checksums;
+    double decode_assets;
+    double decode_entities;
+    double decode_terrain;
+} SceneFileLoadTimings;
+
+typedef struct {
+    // Combination of `SceneFileLoadParts`, 0 loads everything.
+    uint32_t parts;
+    // If set, only entities positioned inside `entity_range` are loaded.
+    int use_entity_range;
+    BoundingBox entity_range;
+    // Checks the sections to be loaded against their checksums first, nothing
+    // is loaded if one of them doesn't match. The small section table is
+    // always checked.
+    int verify_checksums;
+    // Also generates the terrain mesh, overlapping with the rest of the load.
+    // Ignored while streaming is enabled, streaming makes its own meshes.
+    int build_terrain_mesh;
+    // If set, receives the time spent in each phase of the load. Terrain
+    // decoding runs on a worker thread if the worker pool is running, so it
+    // overlaps with the other phases.
+    SceneFileLoadTimings *timings;
+} SceneFileLoadOptions;
+
+// What `scene_file_inspect` found in a scene file.
+typedef struct {
+    SceneFileHeader header;
+    size_t file_size;
+    // Sections the loader knows of indexed by their type, missing ones have a
+    // type of 0. Sections replaced by journal records describe the record.
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT];
+    // Set for sections whose data doesn't match their checksum
+    uint8_t is_section_corrupted[SCENE_FILE_SECTION_TYPE_COUNT];
+    size_t journal_size;
+    size_t journal_record_count;
+    // Left over by an interrupted save, ignored when loading
+    size_t incomplete_journal_size;
+    // Counts with the journal applied
+    size_t asset_count;
+    size_t entity_count;
+    size_t static_entity_count;
+    size_t ignore_raycast_entity_count;
+    // Entities referring to an asset that isn't in the asset table
+    size_t invalid_entity_count;
+    // Asset table and the number of entities using each asset
+    SceneFileAsset *assets;
+    size_t *asset_entity_counts;
+    uint32_t terrain_width;
+} SceneFileInspection;
+
+// Stores the current scene into a file. With streaming enabled, entities held
+// back by streaming are stored along with the ones in the scene.
 void scene_file_store(FILE *fp);
+// Sets whether `scene_file_store` compresses terrain data, disabled by
+// default. Compressed heights are quantized to `COMPRESSION_HEIGHT_STEP`, so
+// they no longer load back bit for bit.
+void scene_file_set_terrain_compression(int enabled);
+// Sets whether `scene_file_store` writes entities as `SceneFileCompactEntity`s,
+// disabled by default. Their scale is rounded to half precision and rotation to
+// `COMPRESSION_QUATERNION_BITS` per component, so transforms no longer load
+// back bit for bit. Full records are written instead if any transform can't be
+// represented within a small tolerance.
+void scene_file_set_compact_entities(int enabled);
+// Appends the changes made since the last `scene_file_store`,
+// `scene_file_store_incremental` or `scene_file_compact`, or since the file was
+// loaded as a whole, to the file at `filepath` as journal records, only the
+// entities, lights and terrain regions that changed are written. Finding them
+// compares the scene against a copy of what was last written, which includes
+// the terrain data.
+// Writes a full snapshot instead if there is nothing to append to, such as
+// for the first save of a session or after the terrain was resized, and
+// always while streaming is enabled.
+// Returns 1 on error.
+int scene_file_store_incremental(const char *filepath);
+// Writes a fresh snapshot of the current scene to the file at `filepath`,
+// dropping its journal. The terrain is encoded and the file written on a
+// worker thread if the worker pool is running, the file is replaced once the
+// new one is complete. Returns 1 on error.
+int scene_file_compact(const char *filepath);
+// Blocks until a compaction started with `scene_file_compact` is done. Returns
+// 1 if it failed. Called by the store functions before they write anything.
+int scene_file_finish_compaction(void);
 // Loads scene information from a file and applies it to the current scene. An
 // empty scene along with lighting groups needs to be initalized before calling
 // this function.
 // Currently assumes there is only one light group and it's handle is 0.
+// If streaming is enabled, entities are handed to streaming_add_entity instead
+// of being added to the scene right away.
 int scene_file_load(FILE *fp, const char *skybox_directory,
                     const char *asset_directory);
+// Same as `scene_file_load`, but only loads the parts of the file selected by
+// `options`. Sections that are not needed are never read.
+// If the worker pool is running, checksums, terrain decoding and terrain mesh
+// generation run on worker threads, and so does reading and decoding the
+// files of new assets (see `scene_set_async_loading`). Meanwhile the calling
+// thread creates lights and entities and uploads finished models. Everything
+// has been loaded by the time this returns.
+int scene_file_load_ex(FILE *fp, const char *skybox_directory,
+                       const char *asset_directory,
+                       const SceneFileLoadOptions *options);
+// Reads the section table of a scene file into `out_sections`, at most
+// `max_sections` of them. For version 0 files the table is built from the
+// header. Returns 1 on error.
+int scene_file_read_sections(FILE *fp, SceneFileSection *out_sections,
+                             size_t max_sections, size_t *out_section_count);
+// Reads a scene file without loading it, checking every section against its
+// checksum. Free the result with `scene_file_inspection_free`. Returns 1 if the
+// file can't be read, in which case there is nothing to free.
+int scene_file_inspect(FILE *fp, SceneFileInspection *out_inspection);
+void scene_file_inspection_free(SceneFileInspection *inspection);
+// Runs the phases of `scene_file_load` that don't need a window one after the
+// other, timing each of them. Nothing is loaded into the scene, entities and
+// terrain data are decoded into scratch buffers that are thrown away. Returns 1
+// on error.
+int scene_file_time_load(FILE *fp, SceneFileLoadTimings *out_timings);
 
 #endif
@@ -0,0 +1,148 @@
+#include "scene_stats.h"
+
+#include "lighting.h"
+#include "scene.h"
+#include "streaming.h"
+#include "terrain.h"
+#include <raylib.h>
+#include <rlgl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static size_t draw_calls_this_frame = 0;
+static size_t draw_calls_last_frame = 0;
+
+void scene_stats_get_mesh_bytes(Mesh *mesh, size_t *out_vertex_bytes,
+                                size_t *out_index_bytes) {
+    size_t vertex_count = mesh->vertexCount;
+    size_t vertex_bytes = 0;
+    if (mesh->vertices)
+        vertex_bytes += vertex_count * 3 * sizeof(float);
+    if (mesh->texcoords)
+        vertex_bytes += vertex_count * 2 * sizeof(float);
+    if (mesh->texcoords2)
+        vertex_bytes += vertex_count * 2 * sizeof(float);
+    if (mesh->normals)
+        vertex_bytes += vertex_count * 3 * sizeof(float);
+    if (mesh->tangents)
+        vertex_bytes += vertex_count * 4 * sizeof(float);
+    if (mesh->colors)
+        vertex_bytes += vertex_count * 4 * sizeof(unsigned char);
+
+    size_t index_bytes = 0;
+    if (mesh->indices)
+        index_bytes = (size_t)mesh->triangleCount * 3 * sizeof(unsigned short);
+
+    if (out_vertex_bytes)
+        *out_vertex_bytes = vertex_bytes;
+    if (out_index_bytes)
+        *out_index_bytes = index_bytes;
+}
+
+size_t scene_stats_get_texture_bytes(Texture texture) {
+    if (!texture.id || texture.id == rlGetTextureIdDefault())
+        return 0;
+    return GetPixelDataSize(texture.width, texture.height, texture.format);
+}
+
+size_t scene_stats_get_model_texture_bytes(Model *model) {
+    if (!model->materialCount || !model->materials[0].maps)
+        return 0;
+
+    MaterialMap *maps = model->materials[0].maps;
+    Texture texture = maps[MATERIAL_MAP_DIFFUSE].texture;
+    Texture unlit_texture = maps[MATERIAL_MAP_DIFFUSE + 1].texture;
+    return scene_stats_get_texture_bytes(texture) +
+           scene_stats_get_texture_bytes(unlit_texture);
+}
+
+static SceneModelStats get_model_stats(ModelHandle handle, Model *model) {
+    SceneModelStats stats = {
+        .handle = handle,
+        .texture_bytes = scene_stats_get_model_texture_bytes(model),
+    };
+
+    for (int i = 0; i < model->meshCount; i++) {
+        size_t vertex_bytes = 0;
+        size_t index_bytes = 0;
+        scene_stats_get_mesh_bytes(model->meshes + i, &vertex_bytes,
+                                   &index_bytes);
+        stats.vertex_bytes += vertex_bytes;
+        stats.index_bytes += index_bytes;
+    }
+
+    return stats;
+}
+
+SceneStats scene_stats_get(void) {
+    SceneStats stats = {
+        .lights = lighting_scene_get_light_count(),
+        .draw_calls_last_frame = draw_calls_last_frame,
+    };
+
+    EntityHandle handle = 0;
+    Entity *entity = 0;
+    while ((entity = scene_get_entity(handle++))) {
+        if (entity->is_destroyed)
+            stats.entities_destroyed++;
+        else
+            stats.entities_live++;
+    }
+
+    stats.models = scene_get_model_count();
+    for (size_t i = 0; i < stats.models; i++) {
+        ModelHandle model_handle = scene_get_model_handle(i);
+        if (scene_is_model_loading(model_handle)) {
+            stats.models_loading++;
+            continue;
+        }
+
+        SceneModelStats model_stats =
+            get_model_stats(model_handle, scene_get_model(model_handle));
+        stats.model_vertex_bytes += model_stats.vertex_bytes;
+        stats.model_index_bytes += model_stats.index_bytes;
+        stats.texture_bytes += model_stats.texture_bytes;
+    }
+
+    if (terrain.mesh.vertexCount) {
+        size_t vertex_bytes = 0;
+        size_t index_bytes = 0;
+        scene_stats_get_mesh_bytes(&terrain.mesh, &vertex_bytes, &index_bytes);
+        stats.terrain_mesh_bytes += vertex_bytes + index_bytes;
+    }
+    stats.terrain_mesh_bytes += streaming_get_terrain_mesh_bytes();
+    if (terrain.heights)
+        stats.terrain_data_bytes = terrain.size * sizeof(float);
+    if (terrain.texture_indices)
+        stats.terrain_data_bytes += terrain.size * sizeof(uint8_t);
+
+    return stats;
+}
+
+size_t scene_stats_get_models(SceneModelStats *out_stats, size_t max_count) {
+    size_t written = 0;
+    size_t model_count = scene_get_model_count();
+
+    for (size_t i = 0; i < model_count && written < max_count; i++) {
+        ModelHandle model_handle = scene_get_model_handle(i);
+        if (scene_is_model_loading(model_handle))
+            continue;
+
+        out_stats[written] =
+            get_model_stats(model_handle, scene_get_model(model_handle));
+        out_stats[written].asset_handle =
+            scene_get_model_asset(model_handle);
+        written++;
+    }
+
+    return written;
+}
+
+void scene_stats_add_draw_calls(size_t count) {
+    draw_calls_this_frame += count;
+}
+
+void scene_stats_end_frame(void) {
+    draw_calls_last_frame = draw_calls_this_frame;
+    draw_calls_this_frame = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef _SCENE_STATS
+#define _SCENE_STATS
+
+/*
+Reports what the current scene costs in entities, memory and draw calls. Byte
+counts are estimates from mesh and texture dimensions, not measured driver
+allocations. Works without a window, as long as nothing is drawn.
+*/
+
+#include "handles.h"
+#include <raylib.h>
+#include <stddef.h>
+
+typedef struct {
+    size_t entities_live;
+    size_t entities_destroyed;
+    // Unique models loaded, models still loading in the background included.
+    size_t models;
+    size_t models_loading;
+    size_t model_vertex_bytes;
+    size_t model_index_bytes;
+    size_t texture_bytes;
+    // Terrain meshes on the GPU, streamed terrain chunks included.
+    size_t terrain_mesh_bytes;
+    // Height and texture index data of the terrain.
+    size_t terrain_data_bytes;
+    size_t lights;
+    size_t draw_calls_last_frame;
+} SceneStats;
+
+typedef struct {
+    ModelHandle handle;
+    AssetHandle asset_handle;
+    size_t vertex_bytes;
+    size_t index_bytes;
+    size_t texture_bytes;
+} SceneModelStats;
+
+// Takes a snapshot of the current scene.
+SceneStats scene_stats_get(void);
+// Writes the stats of at most `max_count` loaded models to `out_stats`, returns
+// the amount written.
+size_t scene_stats_get_models(SceneModelStats *out_stats, size_t max_count);
+
+// Counts draw calls issued this frame, called by the drawing code.
+void scene_stats_add_draw_calls(size_t count);
+// Call this once at the end of every frame.
+void scene_stats_end_frame(void);
+
+// Gets the size of the vertex attribute and index data of `mesh`.
+void scene_stats_get_mesh_bytes(Mesh *mesh, size_t *out_vertex_bytes,
+                                size_t *out_index_bytes);
+// Gets the size of `texture`, 0 for raylib's default texture, which is shared
+// by every material.
+size_t scene_stats_get_texture_bytes(Texture texture);
+// Gets the size of the diffuse and unlit textures of `model`.
+size_t scene_stats_get_model_texture_bytes(Model *model);
+
+#endif
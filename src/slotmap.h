@@ -0,0 +1,219 @@
+#ifndef _SLOTMAP
+#define _SLOTMAP
+
+/*
+This file includes two macros to generate slot map implementations for any
+arbitrary fixed-size datatype, in the same fashion as vec.h.
+
+A slot map stores its elements densely packed in one array, while handing out
+handles that stay valid until that specific element is removed. Each handle
+holds a slot index and a generation. Removing an element bumps the generation
+of its slot, so handles to removed elements are detected instead of silently
+referring to whatever took their place. Insertion, removal and lookup are all
+O(1), removal moves the last element into the hole to keep the array packed.
+
+The zero handle (SLOTMAP_HANDLE_NULL) is never handed out.
+
+SLOTMAP_DECLARE(datatype, name, prefix)
+This will generate the struct and function declarations for the implementation.
+You usually want this in a header file.
+
+SLOTMAP_IMPLEMENT(datatype, name, prefix)
+This will provide implementations for the functions declared using the previous
+macro. You usually want this in a source file.
+
+
+Functions:
+
+{prefix}_init(void)
+Will initialize the datatype. A zero-initialized slot map is also valid.
+
+{prefix}_insert({name} *map, {datatype} data)
+Will insert `data` into the slot map and return its handle.
+
+{prefix}_remove({name} *map, SlotMapHandle handle)
+Will remove the element of `handle`. Returns 1 if `handle` is stale.
+
+{prefix}_get({name} *map, SlotMapHandle handle)
+Will get the element of `handle`. Returns a null pointer if `handle` is stale.
+
+{prefix}_dense_index({name} *map, SlotMapHandle handle, size_t *out_index)
+Will write the current position of the element of `handle` in the dense array
+`map->data` to `out_index`. Returns 1 if `handle` is stale.
+
+{prefix}_dense_handle({name} *map, size_t index)
+Will return the handle of the element at position `index` of the dense array,
+or SLOTMAP_HANDLE_NULL if `index` is out of range.
+
+{prefix}_free({name} *map)
+Will free memory associated with this datatype.
+
+Elements can be iterated densely through `map->data` and `map->data_used`.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint64_t SlotMapHandle;
+
+#define SLOTMAP_HANDLE_NULL 0
+#define SLOTMAP_NO_SLOT UINT32_MAX
+
+static inline SlotMapHandle slotmap_handle_make(uint32_t slot,
+                                                uint32_t generation) {
+    return ((uint64_t)generation << 32) | slot;
+}
+
+static inline uint32_t slotmap_handle_slot(SlotMapHandle handle) {
+    return handle & 0xffffffff;
+}
+
+static inline uint32_t slotmap_handle_generation(SlotMapHandle handle) {
+    return handle >> 32;
+}
+
+#define SLOTMAP_DECLARE(datatype, name, prefix)                                \
+    typedef struct {                                                           \
+        datatype *data;                                                        \
+        uint32_t *data_slots;                                                  \
+        size_t data_allocated;                                                 \
+        size_t data_used;                                                      \
+        /* Dense index of each slot, or the next free slot if unoccupied. */   \
+        uint32_t *slot_indices;                                                \
+        uint32_t *slot_generations;                                            \
+        size_t slots_allocated;                                                \
+        size_t slots_used;                                                     \
+        uint32_t free_slot;                                                    \
+    } name;                                                                    \
+                                                                               \
+    name prefix##_init(void);                                                  \
+    SlotMapHandle prefix##_insert(name *map, datatype data);                   \
+    int prefix##_remove(name *map, SlotMapHandle handle);                      \
+    datatype *prefix##_get(name *map, SlotMapHandle handle);                   \
+    int prefix##_dense_index(name *map, SlotMapHandle handle,                  \
+                             size_t *out_index);                               \
+    SlotMapHandle prefix##_dense_handle(name *map, size_t index);              \
+    void prefix##_free(name *map);
+
+#define SLOTMAP_IMPLEMENT(datatype, name, prefix)                              \
+    name prefix##_init(void) {                                                 \
+        name map = {                                                           \
+            .data = malloc(4 * sizeof(datatype)),                              \
+            .data_slots = malloc(4 * sizeof(uint32_t)),                        \
+            .data_allocated = 4,                                               \
+            .slot_indices = malloc(4 * sizeof(uint32_t)),                      \
+            .slot_generations = malloc(4 * sizeof(uint32_t)),                  \
+            .slots_allocated = 4,                                              \
+            .free_slot = SLOTMAP_NO_SLOT,                                      \
+        };                                                                     \
+        return map;                                                            \
+    }                                                                          \
+                                                                               \
+    /* Returns the slot of `handle`, or SLOTMAP_NO_SLOT if it is stale. */     \
+    static inline uint32_t prefix##_resolve(name *map, SlotMapHandle handle) { \
+        uint32_t slot = slotmap_handle_slot(handle);                           \
+        if (slot >= map->slots_used ||                                         \
+            map->slot_generations[slot] != slotmap_handle_generation(handle))  \
+            return SLOTMAP_NO_SLOT;                                            \
+        return slot;                                                           \
+    }                                                                          \
+                                                                               \
+    SlotMapHandle prefix##_insert(name *map, datatype data) {                  \
+        if (map->data_used >= map->data_allocated) {                           \
+            map->data_allocated =                                              \
+                map->data_allocated ? map->data_allocated * 2 : 4;             \
+            map->data =                                                        \
+                realloc(map->data, map->data_allocated * sizeof(datatype));    \
+            map->data_slots = realloc(map->data_slots,                         \
+                                      map->data_allocated * sizeof(uint32_t)); \
+            if (!map->data || !map->data_slots)                                \
+                abort();                                                       \
+        }                                                                      \
+                                                                               \
+        uint32_t slot = 0;                                                     \
+        /* A zero-initialized map has free_slot 0 but no slots yet */          \
+        if (map->slots_used == 0)                                              \
+            map->free_slot = SLOTMAP_NO_SLOT;                                  \
+        if (map->free_slot != SLOTMAP_NO_SLOT) {                               \
+            slot = map->free_slot;                                             \
+            map->free_slot = map->slot_indices[slot];                          \
+        } else {                                                               \
+            if (map->slots_used >= map->slots_allocated) {                     \
+                map->slots_allocated =                                         \
+                    map->slots_allocated ? map->slots_allocated * 2 : 4;       \
+                map->slot_indices =                                            \
+                    realloc(map->slot_indices,                                 \
+                            map->slots_allocated * sizeof(uint32_t));          \
+                map->slot_generations =                                        \
+                    realloc(map->slot_generations,                             \
+                            map->slots_allocated * sizeof(uint32_t));          \
+                if (!map->slot_indices || !map->slot_generations)              \
+                    abort();                                                   \
+            }                                                                  \
+            slot = map->slots_used++;                                          \
+            map->slot_generations[slot] = 1;                                   \
+        }                                                                      \
+                                                                               \
+        map->slot_indices[slot] = map->data_used;                              \
+        map->data_slots[map->data_used] = slot;                                \
+        map->data[map->data_used++] = data;                                    \
+        return slotmap_handle_make(slot, map->slot_generations[slot]);         \
+    }                                                                          \
+                                                                               \
+    int prefix##_remove(name *map, SlotMapHandle handle) {                     \
+        uint32_t slot = prefix##_resolve(map, handle);                         \
+        if (slot == SLOTMAP_NO_SLOT)                                           \
+            return 1;                                                          \
+                                                                               \
+        /* Move the last element into the hole */                              \
+        uint32_t index = map->slot_indices[slot];                              \
+        size_t last = map->data_used - 1;                                      \
+        if (index != last) {                                                   \
+            map->data[index] = map->data[last];                                \
+            map->data_slots[index] = map->data_slots[last];                    \
+            map->slot_indices[map->data_slots[index]] = index;                 \
+        }                                                                      \
+        map->data_used--;                                                      \
+                                                                               \
+        /* Generation zero is reserved for the null handle */                  \
+        if (++map->slot_generations[slot] == 0)                                \
+            map->slot_generations[slot] = 1;                                   \
+        map->slot_indices[slot] = map->free_slot;                              \
+        map->free_slot = slot;                                                 \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    datatype *prefix##_get(name *map, SlotMapHandle handle) {                  \
+        uint32_t slot = prefix##_resolve(map, handle);                         \
+        if (slot == SLOTMAP_NO_SLOT)                                           \
+            return 0;                                                          \
+        return map->data + map->slot_indices[slot];                            \
+    }                                                                          \
+                                                                               \
+    int prefix##_dense_index(name *map, SlotMapHandle handle,                  \
+                             size_t *out_index) {                              \
+        uint32_t slot = prefix##_resolve(map, handle);                         \
+        if (slot == SLOTMAP_NO_SLOT)                                           \
+            return 1;                                                          \
+        if (out_index)                                                         \
+            *out_index = map->slot_indices[slot];                              \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    SlotMapHandle prefix##_dense_handle(name *map, size_t index) {             \
+        if (index >= map->data_used)                                           \
+            return SLOTMAP_HANDLE_NULL;                                        \
+        uint32_t slot = map->data_slots[index];                                \
+        return slotmap_handle_make(slot, map->slot_generations[slot]);         \
+    }                                                                          \
+                                                                               \
+    void prefix##_free(name *map) {                                            \
+        free(map->data);                                                       \
+        free(map->data_slots);                                                 \
+        free(map->slot_indices);                                               \
+        free(map->slot_generations);                                           \
+        *map = (name){.free_slot = SLOTMAP_NO_SLOT};                           \
+    }
+
+#endif
@@ -0,0 +1,446 @@
+#include "static_batch.h"
+
+#include "common.h"
+#include "handles.h"
+#include "scene.h"
+#include "scene_stats.h"
+#include <assert.h>
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STARTING_SIZE 16
+#define GROWTH_FACTOR 2
+
+// Square area of the world with the static entities inside it.
+typedef struct {
+    uint64_t key;
+    EntityHandle *entities;
+    size_t entities_used;
+    size_t entities_allocated;
+    int is_dirty;
+} Region;
+
+typedef struct {
+    size_t region;
+    Mesh mesh;
+    // Borrowed from the first member model, the batch gets rebuilt whenever
+    // that model is reloaded.
+    Material material;
+} StaticBatch;
+
+// Model used by a static entity in a region.
+typedef struct {
+    size_t region;
+    ModelHandle model_handle;
+} RegionModel;
+
+// One mesh of a static entity, to be merged into the batch of its region and
+// material.
+typedef struct {
+    size_t region;
+    unsigned int shader_id;
+    unsigned int texture_id;
+    unsigned int unlit_texture_id;
+    EntityHandle entity_handle;
+    int mesh_index;
+} BatchItem;
+
+static int is_enabled = 0;
+
+// Regions are never dropped, so batches and model lists can refer to them by
+// index.
+static Region *regions = 0;
+static size_t regions_used = 0;
+static size_t regions_allocated = 0;
+
+static StaticBatch *batches = 0;
+static size_t batches_used = 0;
+static size_t batches_allocated = 0;
+
+static RegionModel *region_models = 0;
+static size_t region_models_used = 0;
+static size_t region_models_allocated = 0;
+
+static size_t *dirty_regions = 0;
+static size_t dirty_regions_used = 0;
+static size_t dirty_regions_allocated = 0;
+
+static BatchItem *items = 0;
+static size_t items_allocated = 0;
+
+// Makes room for at least `count` elements of size `element_size` in `*data`.
+static void reserve(void **data, size_t *allocated, size_t count,
+                    size_t element_size) {
+    if (count <= *allocated)
+        return;
+
+    size_t new_allocated = *allocated ? *allocated : STARTING_SIZE;
+    while (new_allocated < count)
+        new_allocated *= GROWTH_FACTOR;
+
+    *data = realloc(*data, new_allocated * element_size);
+    if (!*data)
+        abort();
+    *allocated = new_allocated;
+}
+
+static inline uint64_t region_key(Vector3 position) {
+    int32_t x = floorf(position.x / STATIC_BATCH_REGION_SIZE);
+    int32_t z = floorf(position.z / STATIC_BATCH_REGION_SIZE);
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+}
+
+// Finds the region with `key`, adding it if `add` is set. Returns
+// regions_used if there is none.
+static size_t find_region(uint64_t key, int add) {
+    for (size_t i = 0; i < regions_used; i++) {
+        if (regions[i].key == key)
+            return i;
+    }
+    if (!add)
+        return regions_used;
+
+    reserve((void **)&regions, &regions_allocated, regions_used + 1,
+            sizeof(Region));
+    regions[regions_used] = (Region){.key = key};
+    return regions_used++;
+}
+
+static inline void mark_region_dirty(size_t region) {
+    if (regions[region].is_dirty)
+        return;
+    regions[region].is_dirty = 1;
+    reserve((void **)&dirty_regions, &dirty_regions_allocated,
+            dirty_regions_used + 1, sizeof(size_t));
+    dirty_regions[dirty_regions_used++] = region;
+}
+
+static void on_entities_moved(const EntityHandle *handle_mapping, size_t count,
+                              void *_unused) {
+    (void)_unused;
+    for (size_t i = 0; i < regions_used; i++) {
+        Region *region = regions + i;
+        size_t j = 0;
+        while (j < region->entities_used) {
+            EntityHandle handle = region->entities[j];
+            if (handle < count)
+                handle = handle_mapping[handle];
+            if (handle == SCENE_ENTITY_HANDLE_NONE) {
+                region->entities[j] =
+                    region->entities[--region->entities_used];
+                continue;
+            }
+            region->entities[j++] = handle;
+        }
+    }
+}
+
+static const SceneEntityListener entity_listener = {
+    .entities_moved = on_entities_moved,
+};
+
+void static_batch_init(void) {
+    if (is_enabled)
+        static_batch_free();
+
+    is_enabled = 1;
+    int result = scene_add_entity_listener(entity_listener);
+    assert(!result);
+    (void)result;
+
+    EntityHandle handle = 0;
+    Entity *entity = 0;
+    while ((entity = scene_get_entity(handle++))) {
+        if (entity->is_static && !entity->is_destroyed)
+            static_batch_add_entity(handle - 1,
+                                    matrix_get_position(entity->transform));
+    }
+}
+
+void static_batch_free(void) {
+    if (is_enabled)
+        scene_remove_entity_listener(entity_listener);
+
+    for (size_t i = 0; i < batches_used; i++)
+        UnloadMesh(batches[i].mesh);
+    for (size_t i = 0; i < regions_used; i++)
+        free(regions[i].entities);
+
+    free(regions);
+    free(batches);
+    free(region_models);
+    free(dirty_regions);
+    free(items);
+    regions = 0;
+    regions_used = 0;
+    regions_allocated = 0;
+    batches = 0;
+    batches_used = 0;
+    batches_allocated = 0;
+    region_models = 0;
+    region_models_used = 0;
+    region_models_allocated = 0;
+    dirty_regions = 0;
+    dirty_regions_used = 0;
+    dirty_regions_allocated = 0;
+    items = 0;
+    items_allocated = 0;
+
+    is_enabled = 0;
+}
+
+int static_batch_is_enabled(void) {
+    return is_enabled;
+}
+
+void static_batch_add_entity(EntityHandle handle, Vector3 position) {
+    if (!is_enabled)
+        return;
+
+    size_t index = find_region(region_key(position), 1);
+    Region *region = regions + index;
+    for (size_t i = 0; i < region->entities_used; i++) {
+        if (region->entities[i] == handle)
+            return;
+    }
+
+    reserve((void **)&region->entities, &region->entities_allocated,
+            region->entities_used + 1, sizeof(EntityHandle));
+    region->entities[region->entities_used++] = handle;
+    mark_region_dirty(index);
+}
+
+void static_batch_remove_entity(EntityHandle handle, Vector3 position) {
+    if (!is_enabled)
+        return;
+
+    size_t index = find_region(region_key(position), 0);
+    if (index == regions_used)
+        return;
+
+    Region *region = regions + index;
+    for (size_t i = 0; i < region->entities_used; i++) {
+        if (region->entities[i] != handle)
+            continue;
+        region->entities[i] = region->entities[--region->entities_used];
+        mark_region_dirty(index);
+        return;
+    }
+}
+
+void static_batch_mark_model_dirty(ModelHandle handle) {
+    for (size_t i = 0; i < region_models_used; i++) {
+        if (region_models[i].model_handle == handle)
+            mark_region_dirty(region_models[i].region);
+    }
+}
+
+static inline void add_region_model(size_t region, ModelHandle handle) {
+    for (size_t i = 0; i < region_models_used; i++) {
+        if (region_models[i].region == region &&
+            region_models[i].model_handle == handle)
+            return;
+    }
+
+    reserve((void **)&region_models, &region_models_allocated,
+            region_models_used + 1, sizeof(RegionModel));
+    region_models[region_models_used++] =
+        (RegionModel){.region = region, .model_handle = handle};
+}
+
+static int compare_items(const void *a, const void *b) {
+    const BatchItem *item_a = a;
+    const BatchItem *item_b = b;
+
+    if (item_a->region != item_b->region)
+        return item_a->region < item_b->region ? -1 : 1;
+    if (item_a->shader_id != item_b->shader_id)
+        return item_a->shader_id < item_b->shader_id ? -1 : 1;
+    if (item_a->texture_id != item_b->texture_id)
+        return item_a->texture_id < item_b->texture_id ? -1 : 1;
+    if (item_a->unlit_texture_id != item_b->unlit_texture_id)
+        return item_a->unlit_texture_id < item_b->unlit_texture_id ? -1 : 1;
+    return 0;
+}
+
+// Drops the batches and model lists of dirty regions.
+static void remove_dirty_regions(void) {
+    size_t i = 0;
+    while (i < batches_used) {
+        if (!regions[batches[i].region].is_dirty) {
+            i++;
+            continue;
+        }
+        UnloadMesh(batches[i].mesh);
+        batches[i] = batches[--batches_used];
+    }
+
+    i = 0;
+    while (i < region_models_used) {
+        if (!regions[region_models[i].region].is_dirty) {
+            i++;
+            continue;
+        }
+        region_models[i] = region_models[--region_models_used];
+    }
+}
+
+// Collects the meshes of the static entities of dirty region `region` into
+// `items` after the first `items_used`, returns the new amount.
+static size_t gather_items(size_t region, size_t items_used) {
+    for (size_t i = 0; i < regions[region].entities_used; i++) {
+        EntityHandle handle = regions[region].entities[i];
+        Entity *entity = scene_get_entity(handle);
+        if (!entity || !entity->is_static || entity->is_destroyed)
+            continue;
+        // Left behind by a scene_init
+        if (region_key(matrix_get_position(entity->transform)) !=
+            regions[region].key)
+            continue;
+
+        // Region gets rebuilt again once a model still loading is done
+        add_region_model(region, entity->model_handle);
+        if (scene_is_model_loading(entity->model_handle))
+            continue;
+
+        Model *model = scene_get_model(entity->model_handle);
+        if (!model)
+            continue;
+
+        reserve((void **)&items, &items_allocated,
+                items_used + model->meshCount, sizeof(BatchItem));
+        for (int mesh = 0; mesh < model->meshCount; mesh++) {
+            Material *material = model->materials + model->meshMaterial[mesh];
+            items[items_used++] = (BatchItem){
+                .region = region,
+                .shader_id = material->shader.id,
+                .texture_id = material->maps[MATERIAL_MAP_DIFFUSE].texture.id,
+                .unlit_texture_id =
+                    material->maps[MATERIAL_MAP_DIFFUSE + 1].texture.id,
+                .entity_handle = handle,
+                .mesh_index = mesh,
+            };
+        }
+    }
+
+    return items_used;
+}
+
+// Batches are not indexed, indexed meshes get expanded.
+static inline size_t get_unindexed_vertex_count(Mesh *mesh) {
+    if (mesh->indices)
+        return (size_t)mesh->triangleCount * 3;
+    return mesh->vertexCount;
+}
+
+// Merges the meshes of `count` items sharing a region and material into one
+// batch.
+static void build_batch(BatchItem *run, size_t count) {
+    size_t vertex_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        Entity *entity = scene_get_entity(run[i].entity_handle);
+        Mesh *mesh =
+            scene_get_model(entity->model_handle)->meshes + run[i].mesh_index;
+        vertex_count += get_unindexed_vertex_count(mesh);
+    }
+    if (!vertex_count)
+        return;
+
+    Mesh batch = {
+        .vertexCount = vertex_count,
+        .triangleCount = vertex_count / 3,
+        .vertices = malloc(vertex_count * 3 * sizeof(float)),
+        .normals = malloc(vertex_count * 3 * sizeof(float)),
+        .texcoords = calloc(vertex_count * 2, sizeof(float)),
+        .colors = malloc(vertex_count * 4 * sizeof(unsigned char)),
+    };
+    if (!batch.vertices || !batch.normals || !batch.texcoords || !batch.colors)
+        abort();
+    memset(batch.colors, 0xff, vertex_count * 4 * sizeof(unsigned char));
+
+    size_t vertex = 0;
+    for (size_t i = 0; i < count; i++) {
+        Entity *entity = scene_get_entity(run[i].entity_handle);
+        Model *model = scene_get_model(entity->model_handle);
+        Mesh *mesh = model->meshes + run[i].mesh_index;
+
+        Matrix transform = MatrixMultiply(model->transform, entity->transform);
+        Matrix normal_matrix = MatrixTranspose(MatrixInvert(transform));
+
+        size_t mesh_vertices = get_unindexed_vertex_count(mesh);
+        for (size_t j = 0; j < mesh_vertices; j++, vertex++) {
+            size_t source = mesh->indices ? mesh->indices[j] : j;
+
+            Vector3 position = Vector3Transform(
+                ((Vector3 *)mesh->vertices)[source], transform);
+            memcpy(batch.vertices + vertex * 3, &position, sizeof(Vector3));
+
+            Vector3 normal = {0, 1, 0};
+            if (mesh->normals)
+                normal = Vector3Normalize(Vector3Transform(
+                    ((Vector3 *)mesh->normals)[source], normal_matrix));
+            memcpy(batch.normals + vertex * 3, &normal, sizeof(Vector3));
+
+            if (mesh->texcoords)
+                memcpy(batch.texcoords + vertex * 2,
+                       mesh->texcoords + source * 2, 2 * sizeof(float));
+            if (mesh->colors)
+                memcpy(batch.colors + vertex * 4, mesh->colors + source * 4,
+                       4 * sizeof(unsigned char));
+        }
+    }
+
+    UploadMesh(&batch, false);
+
+    Entity *first_entity = scene_get_entity(run[0].entity_handle);
+    Model *first_model = scene_get_model(first_entity->model_handle);
+    int material_index = first_model->meshMaterial[run[0].mesh_index];
+
+    reserve((void **)&batches, &batches_allocated, batches_used + 1,
+            sizeof(StaticBatch));
+    batches[batches_used++] = (StaticBatch){
+        .region = run[0].region,
+        .mesh = batch,
+        .material = first_model->materials[material_index],
+    };
+}
+
+void static_batch_update(void) {
+    if (!is_enabled || !dirty_regions_used)
+        return;
+
+    remove_dirty_regions();
+    size_t items_used = 0;
+    for (size_t i = 0; i < dirty_regions_used; i++) {
+        items_used = gather_items(dirty_regions[i], items_used);
+        regions[dirty_regions[i]].is_dirty = 0;
+    }
+    dirty_regions_used = 0;
+
+    qsort(items, items_used, sizeof(BatchItem), compare_items);
+
+    size_t i = 0;
+    while (i < items_used) {
+        size_t run_end = i + 1;
+        while (run_end < items_used &&
+               !compare_items(items + i, items + run_end))
+            run_end++;
+
+        build_batch(items + i, run_end - i);
+        i = run_end;
+    }
+}
+
+void static_batch_draw(void) {
+    for (size_t i = 0; i < batches_used; i++)
+        DrawMesh(batches[i].mesh, batches[i].material, MatrixIdentity());
+    scene_stats_add_draw_calls(batches_used);
+}
+
+size_t static_batch_get_batch_count(void) {
+    return batches_used;
+}
@@ -0,0 +1,39 @@
+#ifndef _STATIC_BATCH
+#define _STATIC_BATCH
+
+/*
+Merges the meshes of static entities into a few large pre-transformed meshes
+so that they can be drawn with one draw call per material per region, without
+relying on instancing support in the shader. The world is split into square
+regions on the XZ plane, each keeping a list of its static entities, and only
+regions where a static entity or its model changed get rebuilt.
+*/
+
+#include "handles.h"
+#include <raylib.h>
+#include <stddef.h>
+
+#define STATIC_BATCH_REGION_SIZE 32.0f
+
+// Enables static batching, static entities are left out of the render queue
+// from then on.
+void static_batch_init(void);
+// Frees all batches and disables static batching.
+void static_batch_free(void);
+int static_batch_is_enabled(void);
+
+// Adds static entity `handle` to the region containing `position`, which gets
+// rebuilt.
+void static_batch_add_entity(EntityHandle handle, Vector3 position);
+// Removes entity `handle` from the region containing `position`, which gets
+// rebuilt.
+void static_batch_remove_entity(EntityHandle handle, Vector3 position);
+// Marks every region with an entity using model `handle` to be rebuilt.
+void static_batch_mark_model_dirty(ModelHandle handle);
+// Rebuilds the batches of changed regions. Call this before drawing each frame.
+void static_batch_update(void);
+// Draws all batches.
+void static_batch_draw(void);
+size_t static_batch_get_batch_count(void);
+
+#endif
@@ -0,0 +1,502 @@
+#include "streaming.h"
+
+#include "common.h"
+#include "scene.h"
+#include "scene_stats.h"
+#include "terrain.h"
+#include <assert.h>
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STARTING_SIZE 16
+#define GROWTH_FACTOR 2
+// Entity handles with no loaded streamed entity.
+#define STREAMED_NONE SIZE_MAX
+
+// Cell within the load radius that is not yet resident.
+typedef struct {
+    StreamingCell cell;
+    float distance;
+} LoadCandidate;
+
+// Entity held back until its cell is loaded.
+typedef struct {
+    // Copied back from the scene on unload, so that edits made while the
+    // entity was loaded are kept.
+    Entity entity;
+    uint64_t cell_key;
+    // Handle and id of the entity in the scene while `is_loaded` is set.
+    EntityHandle handle;
+    uint64_t id;
+    int is_loaded;
+    // Set once the entity has been removed from the scene by anyone but
+    // streaming, it is not loaded again.
+    int is_removed;
+} StreamedEntity;
+
+typedef struct {
+    uint64_t cell_key;
+    Mesh mesh;
+} TerrainChunk;
+
+static StreamingSettings settings = {0};
+static int is_enabled = 0;
+
+static StreamingCell *resident_cells = 0;
+static size_t resident_cells_used = 0;
+static size_t resident_cells_allocated = 0;
+
+static LoadCandidate *candidates = 0;
+static size_t candidates_allocated = 0;
+
+static StreamedEntity *streamed_entities = 0;
+static size_t streamed_entities_used = 0;
+static size_t streamed_entities_allocated = 0;
+// Streamed entities are kept sorted by cell so a cell's entities can be found
+// with a binary search, sorting is deferred until a cell gets loaded.
+static int streamed_entities_sorted = 1;
+// Index in streamed_entities of the loaded streamed entity at each entity
+// handle, STREAMED_NONE if there is none.
+static size_t *loaded_entities = 0;
+static size_t loaded_entities_allocated = 0;
+
+static TerrainChunk *terrain_chunks = 0;
+static size_t terrain_chunks_used = 0;
+static size_t terrain_chunks_allocated = 0;
+
+static char scene_asset_directory[MAX_PATH_LENGTH] = {0};
+// Set while streaming removes entities from the scene itself.
+static int is_unloading_entities = 0;
+
+// Makes room for at least `count` elements of size `element_size` in `*data`.
+static void reserve(void **data, size_t *allocated, size_t count,
+                    size_t element_size) {
+    if (count <= *allocated)
+        return;
+
+    size_t new_allocated = *allocated ? *allocated : STARTING_SIZE;
+    while (new_allocated < count)
+        new_allocated *= GROWTH_FACTOR;
+
+    *data = realloc(*data, new_allocated * element_size);
+    if (!*data)
+        abort();
+    *allocated = new_allocated;
+}
+
+static inline uint64_t cell_key(StreamingCell cell) {
+    return ((uint64_t)(uint32_t)cell.x << 32) | (uint32_t)cell.z;
+}
+
+static inline float cell_distance(StreamingCell cell, Vector3 position) {
+    float center_x = ((float)cell.x + 0.5f) * settings.cell_size;
+    float center_z = ((float)cell.z + 0.5f) * settings.cell_size;
+    return Vector2Distance((Vector2){center_x, center_z},
+                           (Vector2){position.x, position.z});
+}
+
+static int compare_candidates(const void *a, const void *b) {
+    float distance_a = ((const LoadCandidate *)a)->distance;
+    float distance_b = ((const LoadCandidate *)b)->distance;
+    return (distance_a > distance_b) - (distance_a < distance_b);
+}
+
+// Sets the streamed entity loaded at `handle` to the one at `index`.
+static void set_loaded_entity(EntityHandle handle, size_t index) {
+    size_t allocated = loaded_entities_allocated;
+    reserve((void **)&loaded_entities, &loaded_entities_allocated, handle + 1,
+            sizeof(size_t));
+    for (size_t i = allocated; i < loaded_entities_allocated; i++)
+        loaded_entities[i] = STREAMED_NONE;
+    loaded_entities[handle] = index;
+}
+
+// Finds the loaded streamed entity at `handle`, returns 0 if there is none.
+static StreamedEntity *find_loaded_entity(EntityHandle handle) {
+    if (handle >= loaded_entities_allocated ||
+        loaded_entities[handle] == STREAMED_NONE)
+        return 0;
+    return streamed_entities + loaded_entities[handle];
+}
+
+// Unmaps the handle of `streamed` if it is loaded there.
+static void forget_loaded_entity(StreamedEntity *streamed) {
+    if (find_loaded_entity(streamed->handle) == streamed)
+        loaded_entities[streamed->handle] = STREAMED_NONE;
+}
+
+// Maps the handles of loaded streamed entities to their index again, after
+// either has moved.
+static void rebuild_loaded_entities(void) {
+    for (size_t i = 0; i < loaded_entities_allocated; i++)
+        loaded_entities[i] = STREAMED_NONE;
+    for (size_t i = 0; i < streamed_entities_used; i++) {
+        if (streamed_entities[i].is_loaded)
+            set_loaded_entity(streamed_entities[i].handle, i);
+    }
+}
+
+static void on_entity_removed(EntityHandle handle, void *_unused) {
+    (void)_unused;
+    if (is_unloading_entities)
+        return;
+
+    StreamedEntity *streamed = find_loaded_entity(handle);
+    if (!streamed)
+        return;
+    streamed->is_loaded = 0;
+    streamed->is_removed = 1;
+    forget_loaded_entity(streamed);
+}
+
+static void on_entities_moved(const EntityHandle *handle_mapping, size_t count,
+                              void *_unused) {
+    (void)_unused;
+    for (size_t i = 0; i < streamed_entities_used; i++) {
+        StreamedEntity *streamed = streamed_entities + i;
+        if (!streamed->is_loaded)
+            continue;
+        if (streamed->handle < count)
+            streamed->handle = handle_mapping[streamed->handle];
+        if (streamed->handle == SCENE_ENTITY_HANDLE_NONE)
+            streamed->is_loaded = 0;
+    }
+    rebuild_loaded_entities();
+}
+
+static const SceneEntityListener entity_listener = {
+    .entity_removed = on_entity_removed,
+    .entities_moved = on_entities_moved,
+};
+
+void streaming_init(StreamingSettings new_settings) {
+    assert(new_settings.cell_size > 0);
+    assert(new_settings.unload_radius >= new_settings.load_radius);
+
+    if (is_enabled)
+        streaming_free();
+
+    settings = new_settings;
+    is_enabled = 1;
+    int result = scene_add_entity_listener(entity_listener);
+    assert(!result);
+    (void)result;
+}
+
+void streaming_free(void) {
+    if (!is_enabled)
+        return;
+
+    // Cells are no longer resident once unloaded, entities that have moved
+    // into one of them get unloaded with it
+    while (resident_cells_used > 0) {
+        StreamingCell cell = resident_cells[--resident_cells_used];
+        if (settings.unload_cell)
+            settings.unload_cell(cell, settings.user_data);
+    }
+    scene_remove_entity_listener(entity_listener);
+
+    free(resident_cells);
+    free(candidates);
+    free(streamed_entities);
+    free(loaded_entities);
+    free(terrain_chunks);
+    resident_cells = 0;
+    resident_cells_used = 0;
+    resident_cells_allocated = 0;
+    candidates = 0;
+    candidates_allocated = 0;
+    streamed_entities = 0;
+    streamed_entities_used = 0;
+    streamed_entities_allocated = 0;
+    streamed_entities_sorted = 1;
+    loaded_entities = 0;
+    loaded_entities_allocated = 0;
+    terrain_chunks = 0;
+    terrain_chunks_used = 0;
+    terrain_chunks_allocated = 0;
+
+    settings = (StreamingSettings){0};
+    is_enabled = 0;
+}
+
+int streaming_is_enabled(void) {
+    return is_enabled;
+}
+
+StreamingCell streaming_get_cell(Vector3 position) {
+    return (StreamingCell){
+        .x = (int32_t)floorf(position.x / settings.cell_size),
+        .z = (int32_t)floorf(position.z / settings.cell_size),
+    };
+}
+
+int streaming_is_cell_resident(StreamingCell cell) {
+    for (size_t i = 0; i < resident_cells_used; i++) {
+        if (resident_cells[i].x == cell.x && resident_cells[i].z == cell.z)
+            return 1;
+    }
+    return 0;
+}
+
+size_t streaming_get_resident_count(void) {
+    return resident_cells_used;
+}
+
+void streaming_update(Vector3 camera_position) {
+    if (!is_enabled)
+        return;
+
+    // Unload cells that fell out of range
+    size_t i = 0;
+    while (i < resident_cells_used) {
+        StreamingCell cell = resident_cells[i];
+        if (cell_distance(cell, camera_position) <= settings.unload_radius) {
+            i++;
+            continue;
+        }
+
+        resident_cells[i] = resident_cells[--resident_cells_used];
+        if (settings.unload_cell)
+            settings.unload_cell(cell, settings.user_data);
+    }
+
+    // Find cells in range that are not resident yet
+    StreamingCell center = streaming_get_cell(camera_position);
+    int32_t reach = (int32_t)ceilf(settings.load_radius / settings.cell_size);
+    size_t side = 2 * (size_t)reach + 1;
+    reserve((void **)&candidates, &candidates_allocated, side * side,
+            sizeof(LoadCandidate));
+
+    size_t candidates_used = 0;
+    for (int32_t z = center.z - reach; z <= center.z + reach; z++) {
+        for (int32_t x = center.x - reach; x <= center.x + reach; x++) {
+            StreamingCell cell = {x, z};
+            float distance = cell_distance(cell, camera_position);
+            if (distance > settings.load_radius ||
+                streaming_is_cell_resident(cell))
+                continue;
+
+            candidates[candidates_used++] =
+                (LoadCandidate){.cell = cell, .distance = distance};
+        }
+    }
+
+    // Load the closest ones first, within budget
+    qsort(candidates, candidates_used, sizeof(LoadCandidate),
+          compare_candidates);
+    if (settings.max_loads_per_update &&
+        candidates_used > settings.max_loads_per_update)
+        candidates_used = settings.max_loads_per_update;
+
+    reserve((void **)&resident_cells, &resident_cells_allocated,
+            resident_cells_used + candidates_used, sizeof(StreamingCell));
+    for (i = 0; i < candidates_used; i++) {
+        resident_cells[resident_cells_used++] = candidates[i].cell;
+        if (settings.load_cell)
+            settings.load_cell(candidates[i].cell, settings.user_data);
+    }
+}
+
+static int compare_streamed_entities(const void *a, const void *b) {
+    uint64_t key_a = ((const StreamedEntity *)a)->cell_key;
+    uint64_t key_b = ((const StreamedEntity *)b)->cell_key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// Returns the index of the first streamed entity in the cell of `key`.
+static size_t find_streamed_entities(uint64_t key) {
+    if (!streamed_entities_sorted) {
+        qsort(streamed_entities, streamed_entities_used,
+              sizeof(StreamedEntity), compare_streamed_entities);
+        streamed_entities_sorted = 1;
+        rebuild_loaded_entities();
+    }
+
+    size_t low = 0;
+    size_t high = streamed_entities_used;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (streamed_entities[middle].cell_key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+// Generates the terrain mesh of the grid cells whose top left corner is within
+// `cell`.
+static Mesh generate_cell_terrain_mesh(StreamingCell cell) {
+    if (!terrain.heights || terrain.width < 2)
+        return (Mesh){0};
+
+    float left = ((float)cell.x * settings.cell_size -
+                  terrain.top_left_world_pos.x) /
+                 TERRAIN_GRID_DENSITY;
+    float top = ((float)cell.z * settings.cell_size -
+                 terrain.top_left_world_pos.y) /
+                TERRAIN_GRID_DENSITY;
+    float right = left + settings.cell_size / TERRAIN_GRID_DENSITY;
+    float bottom = top + settings.cell_size / TERRAIN_GRID_DENSITY;
+    if (right <= 0 || bottom <= 0)
+        return (Mesh){0};
+
+    uint32_t grid_left = floorf(maxf(left, 0));
+    uint32_t grid_top = floorf(maxf(top, 0));
+    uint32_t grid_right = floorf(right);
+    uint32_t grid_bottom = floorf(bottom);
+    if (grid_right <= grid_left || grid_bottom <= grid_top)
+        return (Mesh){0};
+
+    return terrain_generate_region_mesh(grid_left, grid_top,
+                                        grid_right - grid_left,
+                                        grid_bottom - grid_top);
+}
+
+static void add_to_scene(StreamedEntity *streamed) {
+    if (scene_add(streamed->entity, &streamed->handle, scene_asset_directory))
+        return;
+    streamed->id = scene_get_entity(streamed->handle)->id;
+    streamed->is_loaded = 1;
+    set_loaded_entity(streamed->handle, streamed - streamed_entities);
+}
+
+static void load_scene_cell(StreamingCell cell, void *_unused) {
+    (void)_unused;
+    uint64_t key = cell_key(cell);
+
+    for (size_t i = find_streamed_entities(key);
+         i < streamed_entities_used && streamed_entities[i].cell_key == key;
+         i++) {
+        StreamedEntity *streamed = streamed_entities + i;
+        if (!streamed->is_loaded && !streamed->is_removed)
+            add_to_scene(streamed);
+    }
+
+    Mesh mesh = generate_cell_terrain_mesh(cell);
+    if (!mesh.vertexCount)
+        return;
+
+    reserve((void **)&terrain_chunks, &terrain_chunks_allocated,
+            terrain_chunks_used + 1, sizeof(TerrainChunk));
+    terrain_chunks[terrain_chunks_used++] =
+        (TerrainChunk){.cell_key = key, .mesh = mesh};
+}
+
+static void unload_scene_cell(StreamingCell cell, void *_unused) {
+    (void)_unused;
+    uint64_t key = cell_key(cell);
+    size_t start = find_streamed_entities(key);
+    size_t end = start;
+    while (end < streamed_entities_used &&
+           streamed_entities[end].cell_key == key)
+        end++;
+
+    is_unloading_entities = 1;
+    for (size_t i = start; i < end; i++) {
+        StreamedEntity *streamed = streamed_entities + i;
+        if (!streamed->is_loaded)
+            continue;
+
+        // The slot may have been reused if the scene was cleared without
+        // streaming knowing, the entity is then loaded again as it was
+        Entity *entity = scene_get_entity_by_id(streamed->handle, streamed->id);
+        streamed->is_loaded = 0;
+        if (!entity) {
+            forget_loaded_entity(streamed);
+            continue;
+        }
+        streamed->entity = *entity;
+
+        // Entities moved into another resident cell stay, and belong to that
+        // cell from now on
+        StreamingCell new_cell =
+            streaming_get_cell(matrix_get_position(entity->transform));
+        streamed->cell_key = cell_key(new_cell);
+        if (streamed->cell_key != key)
+            streamed_entities_sorted = 0;
+        if (streamed->cell_key != key && streaming_is_cell_resident(new_cell))
+            streamed->is_loaded = 1;
+        else {
+            forget_loaded_entity(streamed);
+            scene_remove(streamed->handle);
+        }
+    }
+    is_unloading_entities = 0;
+
+    for (size_t i = 0; i < terrain_chunks_used; i++) {
+        if (terrain_chunks[i].cell_key != key)
+            continue;
+        UnloadMesh(terrain_chunks[i].mesh);
+        terrain_chunks[i] = terrain_chunks[--terrain_chunks_used];
+        break;
+    }
+}
+
+StreamingSettings streaming_scene_settings(float cell_size, float load_radius,
+                                           float unload_radius,
+                                           size_t max_loads_per_update,
+                                           const char *asset_directory) {
+    strncpy(scene_asset_directory, asset_directory, MAX_PATH_LENGTH - 1);
+
+    return (StreamingSettings){
+        .cell_size = cell_size,
+        .load_radius = load_radius,
+        .unload_radius = unload_radius,
+        .max_loads_per_update = max_loads_per_update,
+        .load_cell = load_scene_cell,
+        .unload_cell = unload_scene_cell,
+    };
+}
+
+void streaming_add_entity(Entity entity) {
+    assert(is_enabled);
+
+    StreamingCell cell =
+        streaming_get_cell(matrix_get_position(entity.transform));
+
+    reserve((void **)&streamed_entities, &streamed_entities_allocated,
+            streamed_entities_used + 1, sizeof(StreamedEntity));
+    StreamedEntity *streamed = streamed_entities + streamed_entities_used++;
+    *streamed = (StreamedEntity){.entity = entity, .cell_key = cell_key(cell)};
+    streamed_entities_sorted = 0;
+
+    if (settings.load_cell == load_scene_cell &&
+        streaming_is_cell_resident(cell))
+        add_to_scene(streamed);
+}
+
+size_t streaming_get_entity_count(void) {
+    return streamed_entities_used;
+}
+
+const Entity *streaming_get_held_entity(size_t index) {
+    if (index >= streamed_entities_used)
+        return 0;
+    StreamedEntity *streamed = streamed_entities + index;
+    if (streamed->is_loaded || streamed->is_removed)
+        return 0;
+    return &streamed->entity;
+}
+
+void streaming_draw_terrain(void) {
+    for (size_t i = 0; i < terrain_chunks_used; i++)
+        terrain_draw_region_mesh(terrain_chunks[i].mesh);
+}
+
+size_t streaming_get_terrain_mesh_bytes(void) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < terrain_chunks_used; i++) {
+        size_t vertex_bytes = 0;
+        size_t index_bytes = 0;
+        scene_stats_get_mesh_bytes(&terrain_chunks[i].mesh, &vertex_bytes,
+                                   &index_bytes);
+        bytes += vertex_bytes + index_bytes;
+    }
+    return bytes;
+}
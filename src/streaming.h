@@ -0,0 +1,83 @@
+#ifndef _STREAMING
+#define _STREAMING
+
+/*
+Keeps the world loaded only around the camera. The world is split into square
+cells on the XZ plane, cells whose center comes within the load radius of the
+camera get loaded and cells that end up further than the unload radius get
+unloaded. Keeping the unload radius larger than the load radius means a camera
+moving back and forth over a cell border does not keep loading and unloading
+the same cells.
+
+The residency tracking itself only calls the callbacks given in
+StreamingSettings. streaming_scene_settings gives callbacks that move entities
+held back with streaming_add_entity in and out of the scene, and build terrain
+meshes per cell.
+*/
+
+#include "scene.h"
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    int32_t x;
+    int32_t z;
+} StreamingCell;
+
+typedef void (*StreamingCellFunction)(StreamingCell cell, void *user_data);
+
+typedef struct {
+    float cell_size;
+    float load_radius;
+    // Has to be at least `load_radius`.
+    float unload_radius;
+    // Amount of cells loaded per streaming_update at most, 0 for no limit.
+    // Closest cells are loaded first.
+    size_t max_loads_per_update;
+    StreamingCellFunction load_cell;
+    StreamingCellFunction unload_cell;
+    void *user_data;
+} StreamingSettings;
+
+// Enables streaming with `settings`, no cells are resident until the first
+// streaming_update.
+void streaming_init(StreamingSettings settings);
+// Unloads every resident cell and disables streaming.
+void streaming_free(void);
+// Returns 1 if streaming_init has been called.
+int streaming_is_enabled(void);
+
+// Loads and unloads cells around `camera_position`. Call this every frame.
+void streaming_update(Vector3 camera_position);
+// Gets the cell `position` is in.
+StreamingCell streaming_get_cell(Vector3 position);
+int streaming_is_cell_resident(StreamingCell cell);
+size_t streaming_get_resident_count(void);
+
+// Returns settings whose callbacks add the entities of a cell to the scene and
+// generate its terrain mesh, and undo both on unload. Models are loaded from
+// `asset_directory`. With scene_set_async_loading enabled the model files are
+// read in the background.
+StreamingSettings streaming_scene_settings(float cell_size, float load_radius,
+                                           float unload_radius,
+                                           size_t max_loads_per_update,
+                                           const char *asset_directory);
+// Holds `entity` back until the cell it is in gets loaded. Only meaningful with
+// streaming_scene_settings. Changes made to the entity in the scene are kept
+// when its cell is unloaded, and once removed from the scene by anyone else it
+// stays removed.
+void streaming_add_entity(Entity entity);
+// Returns the amount of entities added with streaming_add_entity.
+size_t streaming_get_entity_count(void);
+// Gets the `index`th entity added with streaming_add_entity while it is held
+// back. Returns 0 while it is in the scene, where it has to be looked up
+// instead, and once it has been removed. Indices change on every
+// streaming_update.
+const Entity *streaming_get_held_entity(size_t index);
+// Draws the terrain meshes of resident cells.
+void streaming_draw_terrain(void);
+// Gets the size of the terrain meshes of resident cells.
+size_t streaming_get_terrain_mesh_bytes(void);
+
+#endif
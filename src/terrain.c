@@ -1,7 +1,9 @@
 #include "terrain.h"
 
+#include "common.h"
 #include "lighting.h"
 #include "raycast.h"
+#include "scene_stats.h"
 #include <assert.h>
 #include <raylib.h>
 #include <raymath.h>
@@ -11,6 +13,21 @@
 
 Terrain terrain;
 
+// Makes a dirty tile bitmap for the current width with every tile set.
+static void reset_dirty_tiles(void) {
+    terrain.dirty_tiles_width =
+        (terrain.width + TERRAIN_DIRTY_TILE_SIZE - 1) / TERRAIN_DIRTY_TILE_SIZE;
+    size_t tile_count =
+        (size_t)terrain.dirty_tiles_width * terrain.dirty_tiles_width;
+    size_t size = max((tile_count + 7) / 8, 1);
+
+    free(terrain.dirty_tiles);
+    terrain.dirty_tiles = malloc(size);
+    if (!terrain.dirty_tiles)
+        abort();
+    memset(terrain.dirty_tiles, 0xff, size);
+}
+
 void terrain_init(uint32_t width) {
     uint32_t halfway = width / 2;
     uint32_t corners = width + 1;
@@ -26,6 +43,7 @@ void terrain_init(uint32_t width) {
     };
 
     terrain.material.shader = lighting_scene_get_terrain_shader();
+    reset_dirty_tiles();
 }
 
 BoundingBox terrain_get_bounds(void) {
@@ -41,7 +59,53 @@ BoundingBox terrain_get_bounds(void) {
     };
 }
 
-void terrain_set_height(uint32_t x, uint32_t y, float height);
+void terrain_set_height(uint32_t x, uint32_t y, float height) {
+    if (x >= terrain.width || y >= terrain.width)
+        return;
+    terrain.heights[(size_t)y * terrain.width + x] = height;
+    terrain_mark_dirty(x, y, 1, 1);
+}
+
+void terrain_set_texture_index(uint32_t x, uint32_t y, uint8_t index) {
+    if (x >= terrain.width || y >= terrain.width)
+        return;
+    terrain.texture_indices[(size_t)y * terrain.width + x] = index;
+    terrain_mark_dirty(x, y, 1, 1);
+}
+
+void terrain_mark_dirty(uint32_t x, uint32_t y, uint32_t width,
+                        uint32_t height) {
+    if (!terrain.dirty_tiles || !width || !height || x >= terrain.width ||
+        y >= terrain.width)
+        return;
+
+    uint32_t last_x = min((uint64_t)x + width, terrain.width) - 1;
+    uint32_t last_y = min((uint64_t)y + height, terrain.width) - 1;
+    for (uint32_t tile_y = y / TERRAIN_DIRTY_TILE_SIZE;
+         tile_y <= last_y / TERRAIN_DIRTY_TILE_SIZE; tile_y++) {
+        for (uint32_t tile_x = x / TERRAIN_DIRTY_TILE_SIZE;
+             tile_x <= last_x / TERRAIN_DIRTY_TILE_SIZE; tile_x++) {
+            size_t tile = (size_t)tile_y * terrain.dirty_tiles_width + tile_x;
+            terrain.dirty_tiles[tile / 8] |= 1 << (tile % 8);
+        }
+    }
+}
+
+int terrain_is_tile_dirty(uint32_t tile_x, uint32_t tile_y) {
+    if (!terrain.dirty_tiles || tile_x >= terrain.dirty_tiles_width ||
+        tile_y >= terrain.dirty_tiles_width)
+        return 0;
+    size_t tile = (size_t)tile_y * terrain.dirty_tiles_width + tile_x;
+    return (terrain.dirty_tiles[tile / 8] >> (tile % 8)) & 1;
+}
+
+void terrain_clear_dirty_tiles(void) {
+    if (!terrain.dirty_tiles)
+        return;
+    size_t tile_count =
+        (size_t)terrain.dirty_tiles_width * terrain.dirty_tiles_width;
+    memset(terrain.dirty_tiles, 0, (tile_count + 7) / 8);
+}
 
 void terrain_resize(uint32_t width) {
     assert(terrain.heights);
@@ -87,6 +151,33 @@ void terrain_resize(uint32_t width) {
     free(terrain.texture_indices);
     terrain.heights = new_heights;
     terrain.texture_indices = new_texture_indices;
+    reset_dirty_tiles();
+}
+
+void terrain_load_data(uint32_t width, const float *heights,
+                       const uint8_t *texture_indices) {
+    assert(width > 0);
+    size_t size = (size_t)width * width;
+
+    if (size != terrain.size) {
+        free(terrain.heights);
+        free(terrain.texture_indices);
+        terrain.heights = malloc(size * sizeof(float));
+        terrain.texture_indices = malloc(size);
+        if (!terrain.heights || !terrain.texture_indices)
+            abort();
+    }
+
+    uint32_t halfway = width / 2;
+    terrain.width = width;
+    terrain.size = size;
+    terrain.top_left_world_pos = (Vector2){-(float)halfway, -(float)halfway};
+
+    if (heights)
+        memcpy(terrain.heights, heights, size * sizeof(float));
+    if (texture_indices)
+        memcpy(terrain.texture_indices, texture_indices, size);
+    reset_dirty_tiles();
 }
 
 // Returns world space coordinates of data point `i` in terrain data, component
@@ -105,108 +196,130 @@ static inline Vector4 datapoint_position(size_t i) {
 }
 
 void terrain_draw(void) {
-    if (!terrain.mesh.vaoId)
+    terrain_draw_region_mesh(terrain.mesh);
+}
+
+void terrain_draw_region_mesh(Mesh mesh) {
+    if (!mesh.vaoId)
         return;
-    DrawMesh(terrain.mesh, terrain.material, MatrixTranslate(0, -0.02, 0));
+    DrawMesh(mesh, terrain.material, MatrixTranslate(0, -0.02, 0));
+    scene_stats_add_draw_calls(1);
 }
 
 void terrain_generate_mesh(void) {
-    if (terrain.mesh.vaoId)
-        UnloadMesh(terrain.mesh);
-
     uint32_t width_cells = terrain.width - 1;
-    uint64_t cell_count = width_cells * width_cells;
+    terrain_upload_mesh(
+        terrain_build_region_mesh(0, 0, width_cells, width_cells));
+}
 
-    terrain.mesh = (Mesh){0};
-    terrain.mesh.triangleCount = cell_count * 2;
-    terrain.mesh.vertexCount = terrain.mesh.triangleCount * 3;
-    terrain.mesh.vertices =
-        malloc(terrain.mesh.vertexCount * 3 * sizeof(float));
-    terrain.mesh.colors = malloc(terrain.mesh.vertexCount * 4 * sizeof(float));
-    memset(terrain.mesh.colors, 0xff,
-           terrain.mesh.vertexCount * 4 * sizeof(float));
-    terrain.mesh.texcoords =
-        malloc(terrain.mesh.vertexCount * 2 * sizeof(float));
-    terrain.mesh.normals = malloc(terrain.mesh.vertexCount * 3 * sizeof(float));
-
-    uint32_t x;
-    uint32_t y;
-    for (size_t i = 0; i < terrain.size; i++) {
-        x = i % terrain.width;
-        y = i / terrain.width;
+void terrain_upload_mesh(Mesh mesh) {
+    if (terrain.mesh.vaoId)
+        UnloadMesh(terrain.mesh);
 
-        if (x >= width_cells || y >= width_cells)
-            continue;
+    if (mesh.vertexCount)
+        UploadMesh(&mesh, false);
+    terrain.mesh = mesh;
+}
 
-        size_t quad = x + width_cells * y;
-        size_t quad_i = quad * 18;
-        uint8_t start_corner = 0;
-
-        if (y % 2 == 0)
-            start_corner = x % 2;
-        else
-            start_corner = 3 - (x % 2);
-
-        Vector4 corners[4] = {
-            datapoint_position(i),
-            datapoint_position(i + terrain.width),
-            datapoint_position(i + terrain.width + 1),
-            datapoint_position(i + 1),
-        };
-        Vector2 corner_uvs[4] = {
-            (Vector2){0, 0},
-            (Vector2){0, 1},
-            (Vector2){1, 1},
-            (Vector2){1, 0},
-        };
-
-        // Two triangles per cell / quad
-        for (uint8_t tri = 0; tri < 2; tri++) {
-            size_t triangle_i = quad_i + tri * 9;
-            for (uint8_t vert = 0; vert < 3; vert++) {
-                uint8_t corner = (start_corner + vert + tri * 2) % 4;
-
-                terrain.mesh.vertices[triangle_i + vert * 3 + 0] =
-                    corners[corner].x;
-                terrain.mesh.vertices[triangle_i + vert * 3 + 1] =
-                    corners[corner].y;
-                terrain.mesh.vertices[triangle_i + vert * 3 + 2] =
-                    corners[corner].z;
-
-                terrain.mesh.texcoords[quad * 12 + tri * 6 + vert * 2 + 0] =
-                    corner_uvs[corner].x * 0.5 + (x % 2) * 0.5;
-                terrain.mesh.texcoords[quad * 12 + tri * 6 + vert * 2 + 1] =
-                    corner_uvs[corner].y * 0.5 + (y % 2) * 0.5;
-
-                // Textures
-
-                terrain.mesh.colors[quad * 24 + tri * 12 + vert * 4 + 1] =
-                    (uint8_t)(corners[corner].w) % 10;
-            }
+Mesh terrain_generate_region_mesh(uint32_t left, uint32_t top, uint32_t width,
+                                  uint32_t height) {
+    Mesh mesh = terrain_build_region_mesh(left, top, width, height);
+    // Upload mesh data from CPU (RAM) to GPU (VRAM) memory
+    if (mesh.vertexCount)
+        UploadMesh(&mesh, false);
+    return mesh;
+}
 
-            // Normal vector
-            Vector3 *v1 =
-                (Vector3 *)(terrain.mesh.vertices + triangle_i + 0 * 3);
-            Vector3 *v2 =
-                (Vector3 *)(terrain.mesh.vertices + triangle_i + 1 * 3);
-            Vector3 *v3 =
-                (Vector3 *)(terrain.mesh.vertices + triangle_i + 2 * 3);
-
-            Vector3 triangle_normal = Vector3Normalize(Vector3CrossProduct(
-                Vector3Subtract(*v2, *v1), Vector3Subtract(*v3, *v1)));
-            for (uint8_t vert = 0; vert < 3; vert++) {
-                terrain.mesh.normals[triangle_i + vert * 3 + 0] =
-                    triangle_normal.x;
-                terrain.mesh.normals[triangle_i + vert * 3 + 1] =
-                    triangle_normal.y;
-                terrain.mesh.normals[triangle_i + vert * 3 + 2] =
-                    triangle_normal.z;
+Mesh terrain_build_region_mesh(uint32_t left, uint32_t top, uint32_t width,
+                               uint32_t height) {
+    uint32_t width_cells = terrain.width - 1;
+    if (left >= width_cells || top >= width_cells)
+        return (Mesh){0};
+    width = min(width, width_cells - left);
+    height = min(height, width_cells - top);
+    if (!width || !height)
+        return (Mesh){0};
+
+    uint64_t cell_count = (uint64_t)width * height;
+
+    Mesh mesh = {0};
+    mesh.triangleCount = cell_count * 2;
+    mesh.vertexCount = mesh.triangleCount * 3;
+    mesh.vertices = malloc(mesh.vertexCount * 3 * sizeof(float));
+    mesh.colors = malloc(mesh.vertexCount * 4 * sizeof(float));
+    memset(mesh.colors, 0xff, mesh.vertexCount * 4 * sizeof(float));
+    mesh.texcoords = malloc(mesh.vertexCount * 2 * sizeof(float));
+    mesh.normals = malloc(mesh.vertexCount * 3 * sizeof(float));
+
+    for (uint32_t region_y = 0; region_y < height; region_y++) {
+        for (uint32_t region_x = 0; region_x < width; region_x++) {
+            uint32_t x = left + region_x;
+            uint32_t y = top + region_y;
+            size_t i = x + (size_t)terrain.width * y;
+
+            size_t quad = region_x + (size_t)width * region_y;
+            size_t quad_i = quad * 18;
+            uint8_t start_corner = 0;
+
+            if (y % 2 == 0)
+                start_corner = x % 2;
+            else
+                start_corner = 3 - (x % 2);
+
+            Vector4 corners[4] = {
+                datapoint_position(i),
+                datapoint_position(i + terrain.width),
+                datapoint_position(i + terrain.width + 1),
+                datapoint_position(i + 1),
+            };
+            Vector2 corner_uvs[4] = {
+                (Vector2){0, 0},
+                (Vector2){0, 1},
+                (Vector2){1, 1},
+                (Vector2){1, 0},
+            };
+
+            // Two triangles per cell / quad
+            for (uint8_t tri = 0; tri < 2; tri++) {
+                size_t triangle_i = quad_i + tri * 9;
+                for (uint8_t vert = 0; vert < 3; vert++) {
+                    uint8_t corner = (start_corner + vert + tri * 2) % 4;
+
+                    mesh.vertices[triangle_i + vert * 3 + 0] =
+                        corners[corner].x;
+                    mesh.vertices[triangle_i + vert * 3 + 1] =
+                        corners[corner].y;
+                    mesh.vertices[triangle_i + vert * 3 + 2] =
+                        corners[corner].z;
+
+                    mesh.texcoords[quad * 12 + tri * 6 + vert * 2 + 0] =
+                        corner_uvs[corner].x * 0.5 + (x % 2) * 0.5;
+                    mesh.texcoords[quad * 12 + tri * 6 + vert * 2 + 1] =
+                        corner_uvs[corner].y * 0.5 + (y % 2) * 0.5;
+
+                    // Textures
+
+                    mesh.colors[quad * 24 + tri * 12 + vert * 4 + 1] =
+                        (uint8_t)(corners[corner].w) % 10;
+                }
+
+                // Normal vector
+                Vector3 *v1 = (Vector3 *)(mesh.vertices + triangle_i + 0 * 3);
+                Vector3 *v2 = (Vector3 *)(mesh.vertices + triangle_i + 1 * 3);
+                Vector3 *v3 = (Vector3 *)(mesh.vertices + triangle_i + 2 * 3);
+
+                Vector3 triangle_normal = Vector3Normalize(Vector3CrossProduct(
+                    Vector3Subtract(*v2, *v1), Vector3Subtract(*v3, *v1)));
+                for (uint8_t vert = 0; vert < 3; vert++) {
+                    mesh.normals[triangle_i + vert * 3 + 0] = triangle_normal.x;
+                    mesh.normals[triangle_i + vert * 3 + 1] = triangle_normal.y;
+                    mesh.normals[triangle_i + vert * 3 + 2] = triangle_normal.z;
+                }
             }
         }
     }
 
-    // Upload mesh data from CPU (RAM) to GPU (VRAM) memory
-    UploadMesh(&terrain.mesh, false);
+    return mesh;
 }
 
 void terrain_free(void) {
@@ -216,8 +329,11 @@ void terrain_free(void) {
         free(terrain.texture_indices);
     if (terrain.mesh.vaoId)
         UnloadMesh(terrain.mesh);
+    free(terrain.dirty_tiles);
     terrain.heights = 0;
     terrain.texture_indices = 0;
+    terrain.dirty_tiles = 0;
+    terrain.dirty_tiles_width = 0;
     terrain.mesh = (Mesh){0};
 }
 
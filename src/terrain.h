@@ -13,6 +13,8 @@
 #define TERRAIN_TEXTURE_TILE_DENSITY 2.0
 #define TERRAIN_HANDLE_RADIUS 11.0
 #define TERRAIN_MAX_TEXTURES 7
+// Side of the square tiles of data points changes are tracked in.
+#define TERRAIN_DIRTY_TILE_SIZE 32
 
 typedef struct {
     Vector2 top_left_world_pos;
@@ -22,6 +24,11 @@ typedef struct {
     size_t size;
     Material material;
     Mesh mesh;
+    // One bit per tile, set for tiles changed since the last
+    // terrain_clear_dirty_tiles.
+    uint8_t *dirty_tiles;
+    // Tiles along each side.
+    uint32_t dirty_tiles_width;
 } Terrain;
 
 extern Terrain terrain;
@@ -31,6 +38,17 @@ void terrain_free(void);
 
 // Sets a value in the heightmap at coordinates `x`, `y` to `height`.
 void terrain_set_height(uint32_t x, uint32_t y, float height);
+// Sets the texture index at coordinates `x`, `y` to `index`.
+void terrain_set_texture_index(uint32_t x, uint32_t y, uint8_t index);
+// Marks the tiles of the `width` by `height` data points starting from `x`,
+// `y` as changed. Call this after writing to the terrain data directly.
+void terrain_mark_dirty(uint32_t x, uint32_t y, uint32_t width,
+                        uint32_t height);
+// Returns 1 if the tile at `tile_x`, `tile_y` changed since the last
+// terrain_clear_dirty_tiles. Every tile is changed after the terrain is
+// initialized, resized or loaded.
+int terrain_is_tile_dirty(uint32_t tile_x, uint32_t tile_y);
+void terrain_clear_dirty_tiles(void);
 // Get bounding box for terrain.
 BoundingBox terrain_get_bounds(void);
 
@@ -38,13 +56,34 @@ BoundingBox terrain_get_bounds(void);
 // portion.
 void terrain_resize(uint32_t width);
 
+// Replaces the terrain data with `width` by `width` data points copied from
+// `heights` and `texture_indices`. If either is null that part of the data is
+// left uninitialized for the caller to fill in.
+void terrain_load_data(uint32_t width, const float *heights,
+                       const uint8_t *texture_indices);
+
 // Generates a GPU mesh from terrain height data.
 void terrain_generate_mesh(void);
+// Generates a GPU mesh of only the `width` by `height` grid cells starting from
+// cell `left`, `top`, clamped to the terrain. Returns an empty mesh if the
+// region is outside of the terrain. Unload the mesh with UnloadMesh.
+Mesh terrain_generate_region_mesh(uint32_t left, uint32_t top, uint32_t width,
+                                  uint32_t height);
+// Same as `terrain_generate_region_mesh` but the mesh is not uploaded to the
+// GPU, so this can run on a worker thread as long as the terrain data isn't
+// modified meanwhile.
+Mesh terrain_build_region_mesh(uint32_t left, uint32_t top, uint32_t width,
+                               uint32_t height);
+// Uploads a mesh of the whole terrain made with `terrain_build_region_mesh`
+// and makes it the terrain mesh, replacing the previous one.
+void terrain_upload_mesh(Mesh mesh);
 
 // Draws terrain mesh.
 //
 // NOTE: Generate terrain mesh with function terrain_generate_mesh.
 void terrain_draw(void);
+// Draws a mesh made with terrain_generate_region_mesh.
+void terrain_draw_region_mesh(Mesh mesh);
 
 // Loads texture into a shader location to be used for texture painting with
 // asset slot `slot`.
@@ -32,19 +32,22 @@ Texture texture_load_aseprite_texture(const char *filepath) {
 
 void texture_load_model_texture(const char *filepath, Model *model) {
     ImageData image_data = aseprite_load(filepath);
+    texture_load_model_texture_from_image_data(&image_data, model);
+    aseprite_image_data_free(&image_data);
+}
 
-    if (image_data.base_image.data) {
-        Texture texture = LoadTextureFromImage(image_data.base_image);
+void texture_load_model_texture_from_image_data(ImageData *image_data,
+                                                Model *model) {
+    if (image_data->base_image.data) {
+        Texture texture = LoadTextureFromImage(image_data->base_image);
         if (texture.id)
             model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = texture;
     }
 
-    if (image_data.unlit_data.data) {
-        Texture texture = LoadTextureFromImage(image_data.unlit_data);
+    if (image_data->unlit_data.data) {
+        Texture texture = LoadTextureFromImage(image_data->unlit_data);
         if (texture.id)
             model->materials[0].maps[MATERIAL_MAP_DIFFUSE + 1].texture =
                 texture;
     }
-
-    aseprite_image_data_free(&image_data);
 }
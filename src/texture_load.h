@@ -1,12 +1,17 @@
 #ifndef _TEXTURE_LOAD
 #define _TEXTURE_LOAD
 
+#include "aseprite_texture.h"
 #include <raylib.h>
 #include <stdint.h>
 
 // Loads an aseprite file corresponding to the model file `filepath` as a
 // texture to `model` if one exists.
 void texture_load_model_texture(const char *filepath, Model *model);
+// Uploads already decoded `image_data` as the textures of `model`. The image
+// data is left for the caller to free.
+void texture_load_model_texture_from_image_data(ImageData *image_data,
+                                                Model *model);
 // Load .aseprite file as a GPU texture.
 Texture texture_load_aseprite_texture(const char *filepath);
 
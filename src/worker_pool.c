@@ -0,0 +1,126 @@
+#include "worker_pool.h"
+
+#include "pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define MAX_THREADS 64
+
+typedef struct Job {
+    WorkerFunction function;
+    void *argument;
+    struct Job *next;
+} Job;
+
+static pthread_t threads[MAX_THREADS];
+static size_t thread_count = 0;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_available = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t all_done = PTHREAD_COND_INITIALIZER;
+
+// Jobs are allocated from a pool and queued as a singly linked list.
+static Pool job_pool = {0};
+static Job *queue_first = 0;
+static Job *queue_last = 0;
+// Jobs queued or running.
+static size_t jobs_unfinished = 0;
+static int is_stopping = 0;
+
+static void *work(void *_unused) {
+    (void)_unused;
+
+    pthread_mutex_lock(&lock);
+    while (1) {
+        while (!queue_first && !is_stopping)
+            pthread_cond_wait(&job_available, &lock);
+
+        if (!queue_first && is_stopping)
+            break;
+
+        Job *job = queue_first;
+        queue_first = job->next;
+        if (!queue_first)
+            queue_last = 0;
+
+        WorkerFunction function = job->function;
+        void *argument = job->argument;
+        pool_release(&job_pool, job);
+
+        pthread_mutex_unlock(&lock);
+        function(argument);
+        pthread_mutex_lock(&lock);
+
+        if (--jobs_unfinished == 0)
+            pthread_cond_broadcast(&all_done);
+    }
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+}
+
+void worker_pool_init(size_t count) {
+    if (thread_count)
+        return;
+
+    assert(count > 0);
+    if (count > MAX_THREADS)
+        count = MAX_THREADS;
+
+    job_pool = pool_init(sizeof(Job));
+    is_stopping = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (pthread_create(threads + i, 0, work, 0))
+            break;
+        thread_count++;
+    }
+    assert(thread_count);
+}
+
+int worker_pool_is_running(void) {
+    return thread_count > 0;
+}
+
+void worker_pool_submit(WorkerFunction function, void *argument) {
+    assert(thread_count);
+
+    pthread_mutex_lock(&lock);
+
+    Job *job = pool_allocate(&job_pool);
+    *job = (Job){.function = function, .argument = argument};
+    if (queue_last)
+        queue_last->next = job;
+    else
+        queue_first = job;
+    queue_last = job;
+    jobs_unfinished++;
+
+    pthread_cond_signal(&job_available);
+    pthread_mutex_unlock(&lock);
+}
+
+void worker_pool_wait(void) {
+    pthread_mutex_lock(&lock);
+    while (jobs_unfinished)
+        pthread_cond_wait(&all_done, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+void worker_pool_free(void) {
+    if (!thread_count)
+        return;
+
+    pthread_mutex_lock(&lock);
+    is_stopping = 1;
+    pthread_cond_broadcast(&job_available);
+    pthread_mutex_unlock(&lock);
+
+    for (size_t i = 0; i < thread_count; i++)
+        pthread_join(threads[i], 0);
+
+    thread_count = 0;
+    pool_free(&job_pool);
+}
@@ -0,0 +1,26 @@
+#ifndef _WORKER_POOL
+#define _WORKER_POOL
+
+/*
+A fixed set of worker threads that run submitted jobs in submission order.
+Used for CPU-side work such as file reading and decoding that should not stall
+the main thread. Jobs must not call into raylib functions that touch the GPU.
+*/
+
+#include <stddef.h>
+
+typedef void (*WorkerFunction)(void *argument);
+
+// Starts `thread_count` worker threads. Does nothing if the pool is already
+// running.
+void worker_pool_init(size_t thread_count);
+// Returns 1 if worker_pool_init has been called.
+int worker_pool_is_running(void);
+// Queues `function` to be called with `argument` on a worker thread.
+void worker_pool_submit(WorkerFunction function, void *argument);
+// Blocks until every job submitted so far has finished.
+void worker_pool_wait(void);
+// Waits for all jobs to finish and stops the worker threads.
+void worker_pool_free(void);
+
+#endif
@@ -0,0 +1,220 @@
+#include "unity.h"
+
+#include "bundle.h"
+#include "common.h"
+#include "filesystem.h"
+#include "string_vector.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_COUNT 5
+
+// Relative to the temporary directory, deliberately not in sorted order
+static const char *filenames[FILE_COUNT] = {
+    "skyboxes/sky.aseprite", "assets/b.glb", "assets/lod/c.glb",
+    "assets/a.glb", "assets/b.aseprite",
+};
+static const char *directories[] = {"assets/lod", "assets", "skyboxes"};
+
+static char directory[] = "/tmp/test_bundle_XXXXXX";
+static char paths[FILE_COUNT][MAX_PATH_LENGTH];
+static const char *path_pointers[FILE_COUNT];
+static char bundle_path[MAX_PATH_LENGTH];
+
+static void make_path(const char *name, char out_path[MAX_PATH_LENGTH]) {
+    snprintf(out_path, MAX_PATH_LENGTH, "%s/%s", directory, name);
+}
+
+// Contents of file `index`, each file a different size.
+static void fill_contents(size_t index, uint8_t *out_data, size_t *out_size) {
+    *out_size = 10 + index * 37;
+    for (size_t i = 0; i < *out_size; i++)
+        out_data[i] = index * 17 + i;
+}
+
+void setUp(void) {
+    strcpy(directory, "/tmp/test_bundle_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+
+    char path[MAX_PATH_LENGTH] = {0};
+    for (size_t i = ARRAY_LENGTH(directories); i > 0; i--) {
+        make_path(directories[i - 1], path);
+        TEST_ASSERT_EQUAL(0, mkdir(path, 0700));
+    }
+
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        uint8_t data[256] = {0};
+        size_t size = 0;
+        fill_contents(i, data, &size);
+        make_path(filenames[i], paths[i]);
+        path_pointers[i] = paths[i];
+
+        FILE *fp = fopen(paths[i], "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        TEST_ASSERT_EQUAL(1, fwrite(data, size, 1, fp));
+        fclose(fp);
+    }
+
+    make_path("test.bundle", bundle_path);
+}
+
+void tearDown(void) {
+    filesystem_unmount_bundle();
+    remove(bundle_path);
+    for (size_t i = 0; i < FILE_COUNT; i++)
+        remove(paths[i]);
+
+    char path[MAX_PATH_LENGTH] = {0};
+    for (size_t i = 0; i < ARRAY_LENGTH(directories); i++) {
+        make_path(directories[i], path);
+        rmdir(path);
+    }
+    rmdir(directory);
+}
+
+// Returns 1 on error.
+static int build_bundle(const char *const *filepaths, size_t count) {
+    FILE *fp = fopen(bundle_path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    int result = bundle_build(filepaths, count, fp);
+    fclose(fp);
+    return result;
+}
+
+void test_find_files(void) {
+    TEST_ASSERT_FALSE(build_bundle(path_pointers, FILE_COUNT));
+    Bundle bundle = {0};
+    TEST_ASSERT_FALSE(bundle_open(bundle_path, &bundle));
+    TEST_ASSERT_EQUAL(FILE_COUNT, bundle.entry_count);
+
+    for (size_t i = 0; i < FILE_COUNT; i++) {
+        uint8_t data[256] = {0};
+        size_t size = 0;
+        fill_contents(i, data, &size);
+
+        size_t bundled_size = 0;
+        const uint8_t *bundled = bundle_find(&bundle, paths[i], &bundled_size);
+        TEST_ASSERT_NOT_NULL(bundled);
+        TEST_ASSERT_EQUAL(size, bundled_size);
+        TEST_ASSERT_EQUAL_MEMORY(data, bundled, size);
+        TEST_ASSERT_EQUAL(0, (bundled - bundle.data) % BUNDLE_ALIGNMENT);
+    }
+
+    char path[MAX_PATH_LENGTH] = {0};
+    make_path("assets/a", path);
+    TEST_ASSERT_NULL(bundle_find(&bundle, path, 0));
+    make_path("assets/d.glb", path);
+    TEST_ASSERT_NULL(bundle_find(&bundle, path, 0));
+    bundle_close(&bundle);
+}
+
+void test_index_is_sorted(void) {
+    TEST_ASSERT_FALSE(build_bundle(path_pointers, FILE_COUNT));
+    Bundle bundle = {0};
+    TEST_ASSERT_FALSE(bundle_open(bundle_path, &bundle));
+
+    for (size_t i = 1; i < bundle.entry_count; i++)
+        TEST_ASSERT_LESS_THAN(0, strcmp(bundle_get_name(&bundle, i - 1),
+                                        bundle_get_name(&bundle, i)));
+
+    char path[MAX_PATH_LENGTH] = {0};
+    make_path("assets/", path);
+    size_t index = bundle_lower_bound(&bundle, path);
+    make_path("assets/a.glb", path);
+    TEST_ASSERT_EQUAL_STRING(path, bundle_get_name(&bundle, index));
+    make_path("zzz", path);
+    TEST_ASSERT_EQUAL(bundle.entry_count, bundle_lower_bound(&bundle, path));
+    bundle_close(&bundle);
+}
+
+void test_empty_bundle(void) {
+    TEST_ASSERT_FALSE(build_bundle(0, 0));
+    Bundle bundle = {0};
+    TEST_ASSERT_FALSE(bundle_open(bundle_path, &bundle));
+    TEST_ASSERT_EQUAL(0, bundle.entry_count);
+    TEST_ASSERT_NULL(bundle_find(&bundle, paths[0], 0));
+    bundle_close(&bundle);
+}
+
+void test_rejects_bad_input(void) {
+    const char *duplicates[] = {paths[0], paths[1], paths[0]};
+    TEST_ASSERT_TRUE(build_bundle(duplicates, ARRAY_LENGTH(duplicates)));
+
+    char path[MAX_PATH_LENGTH] = {0};
+    make_path("missing.glb", path);
+    const char *missing[] = {paths[0], path};
+    TEST_ASSERT_TRUE(build_bundle(missing, ARRAY_LENGTH(missing)));
+
+    make_path("assets", path);
+    const char *directory_path[] = {path};
+    TEST_ASSERT_TRUE(build_bundle(directory_path, 1));
+}
+
+void test_rejects_corrupted_index(void) {
+    TEST_ASSERT_FALSE(build_bundle(path_pointers, FILE_COUNT));
+    struct stat file_stat = {0};
+    TEST_ASSERT_EQUAL(0, stat(bundle_path, &file_stat));
+
+    // The last byte is the end of the last name
+    FILE *fp = fopen(bundle_path, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+    fseek(fp, file_stat.st_size - 2, SEEK_SET);
+    fputc('x', fp);
+    fclose(fp);
+
+    Bundle bundle = {0};
+    TEST_ASSERT_TRUE(bundle_open(bundle_path, &bundle));
+    TEST_ASSERT_NULL(bundle.data);
+
+    fp = fopen(bundle_path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    fputs("not a bundle", fp);
+    fclose(fp);
+    TEST_ASSERT_TRUE(bundle_open(bundle_path, &bundle));
+}
+
+void test_mounted_bundle(void) {
+    TEST_ASSERT_FALSE(build_bundle(path_pointers, FILE_COUNT));
+    TEST_ASSERT_FALSE(filesystem_mount_bundle(bundle_path));
+
+    // Listed from the bundle even once the loose files are gone
+    remove(paths[3]);
+    char path[MAX_PATH_LENGTH] = {0};
+    make_path("assets/", path);
+    StringVector list = stringvec_init();
+    get_basenames_with_suffix(path, &list, ".glb");
+    TEST_ASSERT_EQUAL(2, list.indices_used);
+    TEST_ASSERT_EQUAL_STRING("a", stringvec_get(&list, 0));
+    TEST_ASSERT_EQUAL_STRING("b", stringvec_get(&list, 1));
+
+    // Same without the trailing slash
+    stringvec_truncate(&list);
+    make_path("assets", path);
+    get_basenames_with_suffix(path, &list, ".aseprite");
+    TEST_ASSERT_EQUAL(1, list.indices_used);
+    TEST_ASSERT_EQUAL_STRING("b", stringvec_get(&list, 0));
+
+    size_t size = 0;
+    TEST_ASSERT_NOT_NULL(filesystem_get_bundled_file(paths[3], &size));
+    TEST_ASSERT_EQUAL(10 + 3 * 37, size);
+
+    filesystem_unmount_bundle();
+    TEST_ASSERT_NULL(filesystem_get_bundled_file(paths[3], &size));
+    stringvec_free(&list);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_find_files);
+    RUN_TEST(test_index_is_sorted);
+    RUN_TEST(test_empty_bundle);
+    RUN_TEST(test_rejects_bad_input);
+    RUN_TEST(test_rejects_corrupted_index);
+    RUN_TEST(test_mounted_bundle);
+    return UNITY_END();
+}
@@ -1,5 +1,6 @@
 #include "common.h"
 #include "unity.h"
+#include <math.h>
 #include <string.h>
 
 void setUp(void) {}
@@ -40,6 +41,131 @@ void test_has_suffix_true_on_equal_strings(void) {
     TEST_ASSERT_TRUE(has_suffix("somestring", "somestring"));
 }
 
+void test_bounding_box_transform_translates_and_scales(void) {
+    BoundingBox box = {{-1, -1, -1}, {1, 2, 1}};
+    Matrix transform = {0};
+    transform.m0 = 2;
+    transform.m5 = 1;
+    transform.m10 = 3;
+    transform.m15 = 1;
+    transform.m12 = 10;
+
+    BoundingBox result = bounding_box_transform(box, transform);
+    TEST_ASSERT_EQUAL_FLOAT(8, result.min.x);
+    TEST_ASSERT_EQUAL_FLOAT(12, result.max.x);
+    TEST_ASSERT_EQUAL_FLOAT(-1, result.min.y);
+    TEST_ASSERT_EQUAL_FLOAT(2, result.max.y);
+    TEST_ASSERT_EQUAL_FLOAT(-3, result.min.z);
+    TEST_ASSERT_EQUAL_FLOAT(3, result.max.z);
+}
+
+void test_bounding_box_transform_encloses_rotated_box(void) {
+    BoundingBox box = {{0, 0, 0}, {2, 1, 1}};
+    // 90 degrees around the Y axis, x becomes -z
+    Matrix transform = {0};
+    transform.m2 = -1;
+    transform.m5 = 1;
+    transform.m8 = 1;
+    transform.m15 = 1;
+
+    BoundingBox result = bounding_box_transform(box, transform);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.min.x);
+    TEST_ASSERT_EQUAL_FLOAT(1, result.max.x);
+    TEST_ASSERT_EQUAL_FLOAT(-2, result.min.z);
+    TEST_ASSERT_EQUAL_FLOAT(0, result.max.z);
+}
+
+void test_half_exact_values(void) {
+    TEST_ASSERT_EQUAL_HEX16(0x0000, float_to_half(0));
+    TEST_ASSERT_EQUAL_HEX16(0x8000, float_to_half(-0.0f));
+    TEST_ASSERT_EQUAL_HEX16(0x3c00, float_to_half(1));
+    TEST_ASSERT_EQUAL_HEX16(0xc000, float_to_half(-2));
+    TEST_ASSERT_EQUAL_HEX16(0x7bff, float_to_half(65504));
+    TEST_ASSERT_EQUAL_HEX16(0x0001, float_to_half(1.0f / (1 << 24)));
+    TEST_ASSERT_EQUAL_FLOAT(1, half_to_float(0x3c00));
+    TEST_ASSERT_EQUAL_FLOAT(-2, half_to_float(0xc000));
+    TEST_ASSERT_EQUAL_FLOAT(65504, half_to_float(0x7bff));
+}
+
+void test_half_rounds_to_nearest_even(void) {
+    // Halfway between 1 and the next half, 1 + 2^-10
+    TEST_ASSERT_EQUAL_HEX16(0x3c00, float_to_half(1 + 1.0f / 2048));
+    TEST_ASSERT_EQUAL_HEX16(0x3c02, float_to_half(1 + 3.0f / 2048));
+    TEST_ASSERT_EQUAL_HEX16(0x3c01, float_to_half(1 + 1.5f / 2048));
+    // Rounds up into the next exponent
+    TEST_ASSERT_EQUAL_HEX16(0x4000, float_to_half(1.99999f));
+}
+
+void test_half_out_of_range(void) {
+    TEST_ASSERT_EQUAL_HEX16(0x7c00, float_to_half(70000));
+    TEST_ASSERT_EQUAL_HEX16(0xfc00, float_to_half(-INFINITY));
+    TEST_ASSERT_EQUAL_HEX16(0x0000, float_to_half(1e-10f));
+    TEST_ASSERT_TRUE(isnan(half_to_float(float_to_half(NAN))));
+    TEST_ASSERT_TRUE(isinf(half_to_float(0x7c00)));
+}
+
+void test_half_roundtrip_every_value(void) {
+    for (uint32_t half = 0; half <= 0xffff; half++) {
+        // NaNs don't compare equal
+        if ((half & 0x7c00) == 0x7c00 && (half & 0x3ff))
+            continue;
+        TEST_ASSERT_EQUAL_HEX16(half, float_to_half(half_to_float(half)));
+    }
+}
+
+static void assert_matrix_within(Matrix expected, Matrix actual,
+                                 float delta) {
+    const float *a = &expected.m0;
+    const float *b = &actual.m0;
+    for (int i = 0; i < 16; i++)
+        TEST_ASSERT_FLOAT_WITHIN(delta, a[i], b[i]);
+}
+
+void test_matrix_decompose_roundtrip(void) {
+    // Unit quaternions with each component the largest in turn
+    Quaternion rotations[] = {
+        {0, 0, 0, 1},
+        {0.8f, 0.2f, -0.4f, 0.4f},
+        {-0.1f, 0.9f, 0.3f, 0.3f},
+        {0.5f, -0.5f, -0.5f, 0.5f},
+        {0.1f, 0.2f, -0.95f, 0.2f},
+    };
+    Vector3 position = {1, -2, 30};
+    Vector3 scale = {2, 0.5f, 3};
+
+    for (size_t i = 0; i < ARRAY_LENGTH(rotations); i++) {
+        Quaternion q = rotations[i];
+        float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        q = (Quaternion){q.x / length, q.y / length, q.z / length,
+                         q.w / length};
+        Matrix transform = matrix_compose(position, q, scale);
+
+        Vector3 out_position = {0};
+        Quaternion out_rotation = {0};
+        Vector3 out_scale = {0};
+        matrix_decompose(transform, &out_position, &out_rotation, &out_scale);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5, scale.x, out_scale.x);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5, scale.y, out_scale.y);
+        TEST_ASSERT_FLOAT_WITHIN(1e-5, scale.z, out_scale.z);
+        assert_matrix_within(
+            transform, matrix_compose(out_position, out_rotation, out_scale),
+            1e-5);
+    }
+}
+
+void test_matrix_decompose_mirrored(void) {
+    Matrix transform = matrix_compose((Vector3){0}, (Quaternion){0, 0, 0, 1},
+                                      (Vector3){-1, 2, 1});
+
+    Vector3 position = {0};
+    Quaternion rotation = {0};
+    Vector3 scale = {0};
+    matrix_decompose(transform, &position, &rotation, &scale);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, -1, scale.x);
+    assert_matrix_within(transform, matrix_compose(position, rotation, scale),
+                         1e-6);
+}
+
 int main(void) {
     UNITY_BEGIN();
 
@@ -48,6 +174,14 @@ int main(void) {
     RUN_TEST(test_strip_filename);
     RUN_TEST(test_has_suffix);
     RUN_TEST(test_has_suffix_true_on_equal_strings);
+    RUN_TEST(test_bounding_box_transform_translates_and_scales);
+    RUN_TEST(test_bounding_box_transform_encloses_rotated_box);
+    RUN_TEST(test_half_exact_values);
+    RUN_TEST(test_half_rounds_to_nearest_even);
+    RUN_TEST(test_half_out_of_range);
+    RUN_TEST(test_half_roundtrip_every_value);
+    RUN_TEST(test_matrix_decompose_roundtrip);
+    RUN_TEST(test_matrix_decompose_mirrored);
 
     return UNITY_END();
 }
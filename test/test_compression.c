@@ -0,0 +1,245 @@
+#include "unity.h"
+
+#include "compression.h"
+#include "general_buffer.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DATA_SIZE 4096
+
+static GeneralBuffer encoded;
+
+void setUp(void) {
+    encoded = genbuf_init();
+}
+
+void tearDown(void) {
+    genbuf_free(&encoded);
+}
+
+static void assert_lz_roundtrip(const uint8_t *data, size_t size) {
+    compression_lz_compress(data, size, &encoded);
+
+    uint8_t *decoded = malloc(size + 1);
+    TEST_ASSERT_EQUAL(0, compression_lz_decompress(encoded.data,
+                                                   encoded.data_size, decoded,
+                                                   size));
+    if (size > 0)
+        TEST_ASSERT_EQUAL_MEMORY(data, decoded, size);
+    free(decoded);
+}
+
+void test_varint_roundtrip(void) {
+    size_t values[] = {0, 1, 127, 128, 300, 1 << 20, SIZE_MAX};
+    for (size_t i = 0; i < 7; i++)
+        compression_write_varint(&encoded, values[i]);
+
+    const uint8_t *cursor = encoded.data;
+    const uint8_t *end = encoded.data + encoded.data_size;
+    for (size_t i = 0; i < 7; i++)
+        TEST_ASSERT_EQUAL_UINT64(values[i],
+                                 compression_read_varint(&cursor, end));
+    TEST_ASSERT_EQUAL_PTR(end, cursor);
+}
+
+void test_lz_empty(void) {
+    assert_lz_roundtrip(0, 0);
+}
+
+void test_lz_short_input(void) {
+    uint8_t data[] = {1, 2, 3};
+    assert_lz_roundtrip(data, sizeof data);
+}
+
+void test_lz_repeating_data_shrinks(void) {
+    uint8_t data[DATA_SIZE] = {0};
+    for (size_t i = 0; i < DATA_SIZE; i++)
+        data[i] = i % 13;
+
+    assert_lz_roundtrip(data, DATA_SIZE);
+    TEST_ASSERT_LESS_THAN(DATA_SIZE / 10, encoded.data_size);
+}
+
+void test_lz_random_data(void) {
+    uint8_t data[DATA_SIZE] = {0};
+    uint32_t state = 12345;
+    for (size_t i = 0; i < DATA_SIZE; i++) {
+        state = state * 1103515245 + 12345;
+        data[i] = state >> 16;
+    }
+
+    assert_lz_roundtrip(data, DATA_SIZE);
+}
+
+void test_lz_long_literals_and_matches(void) {
+    uint8_t data[DATA_SIZE] = {0};
+    // Unique bytes followed by a long run, both longer than a token can hold
+    for (size_t i = 0; i < 200; i++)
+        data[i] = i;
+    for (size_t i = 200; i < DATA_SIZE; i++)
+        data[i] = 7;
+
+    assert_lz_roundtrip(data, DATA_SIZE);
+}
+
+void test_lz_rejects_wrong_size(void) {
+    uint8_t data[64] = {0};
+    compression_lz_compress(data, sizeof data, &encoded);
+
+    uint8_t decoded[128] = {0};
+    TEST_ASSERT_EQUAL(1, compression_lz_decompress(encoded.data,
+                                                   encoded.data_size, decoded,
+                                                   32));
+    TEST_ASSERT_EQUAL(1, compression_lz_decompress(encoded.data,
+                                                   encoded.data_size, decoded,
+                                                   128));
+}
+
+void test_lz_rejects_bad_offset(void) {
+    // One literal followed by a match reaching 5 bytes back
+    uint8_t data[] = {0x10, 0xaa, 0x05, 0x00};
+    uint8_t decoded[16] = {0};
+    TEST_ASSERT_EQUAL(
+        1, compression_lz_decompress(data, sizeof data, decoded, 5));
+}
+
+void test_heights_roundtrip(void) {
+    uint32_t width = 65;
+    size_t count = (size_t)width * width;
+    float *heights = malloc(count * sizeof(float));
+    for (size_t i = 0; i < count; i++)
+        heights[i] = sinf((float)(i % width) * 0.1f) * 4.0f +
+                     (float)(i / width) * 0.25f;
+    heights[10] = -300.5f;
+    heights[11] = 1000.0f;
+
+    compression_encode_heights(heights, width, &encoded);
+    TEST_ASSERT_LESS_THAN(count * sizeof(float) / 2, encoded.data_size);
+
+    float *decoded = malloc(count * sizeof(float));
+    TEST_ASSERT_EQUAL(0, compression_decode_heights(encoded.data,
+                                                    encoded.data_size,
+                                                    decoded, width));
+    for (size_t i = 0; i < count; i++)
+        TEST_ASSERT_FLOAT_WITHIN(COMPRESSION_HEIGHT_STEP / 2, heights[i],
+                                 decoded[i]);
+
+    free(decoded);
+    free(heights);
+}
+
+void test_quantized_heights_are_exact(void) {
+    uint32_t width = 33;
+    size_t count = (size_t)width * width;
+    float heights[33 * 33] = {0};
+    for (size_t i = 0; i < count; i++)
+        heights[i] = (float)((int)(i * 7919) % 4001 - 2000) * 0.5f;
+
+    compression_encode_heights(heights, width, &encoded);
+    float decoded[33 * 33] = {0};
+    TEST_ASSERT_EQUAL(0, compression_decode_heights(encoded.data,
+                                                    encoded.data_size,
+                                                    decoded, width));
+    TEST_ASSERT_EQUAL_MEMORY(heights, decoded, sizeof heights);
+}
+
+void test_flat_heights_compress_well(void) {
+    uint32_t width = 129;
+    size_t count = (size_t)width * width;
+    float *heights = calloc(count, sizeof(float));
+
+    compression_encode_heights(heights, width, &encoded);
+    TEST_ASSERT_LESS_THAN(count / 100, encoded.data_size);
+
+    free(heights);
+}
+
+void test_rle_roundtrip(void) {
+    uint8_t data[DATA_SIZE] = {0};
+    for (size_t i = 0; i < DATA_SIZE; i++)
+        data[i] = (i / 300) % 4;
+    data[DATA_SIZE - 1] = 9;
+
+    compression_rle_encode(data, DATA_SIZE, &encoded);
+    TEST_ASSERT_LESS_THAN(64, encoded.data_size);
+
+    uint8_t decoded[DATA_SIZE] = {0};
+    TEST_ASSERT_EQUAL(0, compression_rle_decode(encoded.data,
+                                                encoded.data_size, decoded,
+                                                DATA_SIZE));
+    TEST_ASSERT_EQUAL_MEMORY(data, decoded, DATA_SIZE);
+}
+
+void test_rle_rejects_overflowing_run(void) {
+    uint8_t data[32] = {0};
+    compression_rle_encode(data, sizeof data, &encoded);
+
+    uint8_t decoded[16] = {0};
+    TEST_ASSERT_EQUAL(1, compression_rle_decode(encoded.data,
+                                                encoded.data_size, decoded,
+                                                sizeof decoded));
+}
+
+void test_quaternion_roundtrip(void) {
+    // Largest component in each position and negative
+    Quaternion rotations[] = {
+        {0, 0, 0, 1},           {0.9f, 0.1f, -0.3f, 0.2f},
+        {0.1f, -0.9f, 0.3f, 0}, {0.5f, 0.5f, -0.5f, -0.5f},
+        {0.2f, 0.3f, 0.1f, -0.9f},
+    };
+    for (size_t i = 0; i < 5; i++) {
+        Quaternion q = rotations[i];
+        float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        q = (Quaternion){q.x / length, q.y / length, q.z / length,
+                         q.w / length};
+
+        uint16_t components[3] = {0};
+        uint8_t largest = 0;
+        compression_encode_quaternion(q, components, &largest);
+        Quaternion decoded = compression_decode_quaternion(components, largest);
+
+        // Either the same or negated
+        float dot = q.x * decoded.x + q.y * decoded.y + q.z * decoded.z +
+                    q.w * decoded.w;
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 1, fabsf(dot));
+        float sign = dot < 0 ? -1 : 1;
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, q.x, decoded.x * sign);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, q.y, decoded.y * sign);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, q.z, decoded.z * sign);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, q.w, decoded.w * sign);
+    }
+}
+
+void test_quaternion_components_fit_in_bits(void) {
+    Quaternion q = {0.70710678f, -0.70710678f, 0, 0};
+    uint16_t components[3] = {0};
+    uint8_t largest = 0;
+    compression_encode_quaternion(q, components, &largest);
+    for (size_t i = 0; i < 3; i++)
+        TEST_ASSERT_LESS_THAN(1 << COMPRESSION_QUATERNION_BITS,
+                              components[i]);
+    TEST_ASSERT_LESS_THAN(4, largest);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_varint_roundtrip);
+    RUN_TEST(test_lz_empty);
+    RUN_TEST(test_lz_short_input);
+    RUN_TEST(test_lz_repeating_data_shrinks);
+    RUN_TEST(test_lz_random_data);
+    RUN_TEST(test_lz_long_literals_and_matches);
+    RUN_TEST(test_lz_rejects_wrong_size);
+    RUN_TEST(test_lz_rejects_bad_offset);
+    RUN_TEST(test_heights_roundtrip);
+    RUN_TEST(test_quantized_heights_are_exact);
+    RUN_TEST(test_flat_heights_compress_well);
+    RUN_TEST(test_rle_roundtrip);
+    RUN_TEST(test_rle_rejects_overflowing_run);
+    RUN_TEST(test_quaternion_roundtrip);
+    RUN_TEST(test_quaternion_components_fit_in_bits);
+    return UNITY_END();
+}
@@ -0,0 +1,97 @@
+#include "unity.h"
+
+#include "crc32c.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_check_value(void) {
+    const char *data = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(0xe3069283, crc32c_update(0, data, 9));
+    TEST_ASSERT_EQUAL_HEX32(0xe3069283, crc32c_update_software(0, data, 9));
+}
+
+void test_known_vectors(void) {
+    uint8_t zeros[32] = {0};
+    uint8_t ones[32] = {0};
+    uint8_t ascending[32] = {0};
+    memset(ones, 0xff, sizeof ones);
+    for (size_t i = 0; i < 32; i++)
+        ascending[i] = i;
+
+    // From RFC 3720, B.4
+    TEST_ASSERT_EQUAL_HEX32(0x8a9136aa, crc32c_update(0, zeros, 32));
+    TEST_ASSERT_EQUAL_HEX32(0x62a8ab43, crc32c_update(0, ones, 32));
+    TEST_ASSERT_EQUAL_HEX32(0x46dd794e, crc32c_update(0, ascending, 32));
+}
+
+void test_empty_data(void) {
+    TEST_ASSERT_EQUAL_HEX32(0, crc32c_update(0, "", 0));
+    TEST_ASSERT_EQUAL_HEX32(0x1234, crc32c_update(0x1234, "", 0));
+}
+
+void test_pieces_match_whole(void) {
+    uint8_t data[1000] = {0};
+    for (size_t i = 0; i < sizeof data; i++)
+        data[i] = i * 31 + 7;
+
+    uint32_t whole = crc32c_update(0, data, sizeof data);
+    uint32_t pieces = 0;
+    for (size_t i = 0; i < sizeof data; i += 37)
+        pieces = crc32c_update(pieces, data + i,
+                               i + 37 > sizeof data ? sizeof data - i : 37);
+    TEST_ASSERT_EQUAL_HEX32(whole, pieces);
+}
+
+void test_hardware_matches_software(void) {
+    uint8_t data[4099] = {0};
+    for (size_t i = 0; i < sizeof data; i++)
+        data[i] = i * 131 + (i >> 5);
+
+    // Unaligned starts and lengths
+    for (size_t start = 0; start < 9; start++) {
+        for (size_t size = 0; size < 70; size++)
+            TEST_ASSERT_EQUAL_HEX32(
+                crc32c_update_software(0, data + start, size),
+                crc32c_update(0, data + start, size));
+    }
+    TEST_ASSERT_EQUAL_HEX32(crc32c_update_software(0, data, sizeof data),
+                            crc32c_update(0, data, sizeof data));
+}
+
+void test_long_data(void) {
+    // Long enough for the interleaved blocks of the hardware version
+    static uint8_t data[100003];
+    for (size_t i = 0; i < sizeof data; i++)
+        data[i] = i * 131 + (i >> 7);
+
+    for (size_t start = 0; start < 3; start++) {
+        size_t sizes[] = {768, 769, 24576, 24576 + 800, sizeof data - start};
+        for (size_t i = 0; i < 5; i++)
+            TEST_ASSERT_EQUAL_HEX32(
+                crc32c_update_software(0, data + start, sizes[i]),
+                crc32c_update(0, data + start, sizes[i]));
+    }
+}
+
+void test_detects_bit_flip(void) {
+    uint8_t data[256] = {0};
+    uint32_t crc = crc32c_update(0, data, sizeof data);
+    data[100] ^= 0x10;
+    TEST_ASSERT_NOT_EQUAL(crc, crc32c_update(0, data, sizeof data));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_check_value);
+    RUN_TEST(test_known_vectors);
+    RUN_TEST(test_empty_data);
+    RUN_TEST(test_pieces_match_whole);
+    RUN_TEST(test_hardware_matches_software);
+    RUN_TEST(test_long_data);
+    RUN_TEST(test_detects_bit_flip);
+    return UNITY_END();
+}
@@ -0,0 +1,236 @@
+#include "unity.h"
+
+#include "assets.h"
+#include "common.h"
+#include "journal.h"
+#include "lighting.h"
+#include "scene.h"
+#include "terrain.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TERRAIN_WIDTH 64
+#define MEMORY_CAP (64 * 1024)
+
+static float original_heights[(TERRAIN_WIDTH + 1) * (TERRAIN_WIDTH + 1)];
+
+static char directory[] = "/tmp/test_journal_XXXXXX";
+static char asset_directory[MAX_PATH_LENGTH];
+static char asset_path[MAX_PATH_LENGTH];
+
+void setUp(void) {
+    journal_init(MEMORY_CAP);
+    terrain_init(TERRAIN_WIDTH);
+    for (size_t i = 0; i < terrain.size; i++)
+        terrain.heights[i] = (float)(i % 7);
+    memcpy(original_heights, terrain.heights, terrain.size * sizeof(float));
+
+    strcpy(directory, "/tmp/test_journal_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(asset_directory, MAX_PATH_LENGTH, "%s/", directory);
+    snprintf(asset_path, MAX_PATH_LENGTH, "%s/box.glb", directory);
+    FILE *fp = fopen(asset_path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    fclose(fp);
+    assets_fetch_all(asset_directory);
+    scene_init();
+}
+
+void tearDown(void) {
+    terrain_free();
+    journal_free();
+    scene_free();
+    lighting_scene_free();
+    remove(asset_path);
+    rmdir(directory);
+}
+
+static EntityHandle add_entity(float x) {
+    EntityHandle handle = 0;
+    TEST_ASSERT_FALSE(scene_add((Entity){.transform = MatrixTranslate(x, 0, 0)},
+                                &handle, asset_directory));
+    return handle;
+}
+
+// Moves entity `handle` to `x` and records the move.
+static void move_entity(EntityHandle handle, float x) {
+    Matrix before = scene_get_entity(handle)->transform;
+    Matrix after = MatrixTranslate(x, 0, 0);
+    scene_set_entity_transform(handle, after);
+    journal_record_transform(handle, before, after);
+}
+
+// Raises a square of terrain by `amount` and paints it with texture `index`.
+static void edit_terrain(uint32_t x, uint32_t y, uint32_t size, float amount,
+                         uint8_t index) {
+    journal_begin_terrain_edit(x, y, size, size);
+    for (uint32_t row = y; row < y + size; row++) {
+        for (uint32_t column = x; column < x + size; column++) {
+            terrain.heights[row * terrain.width + column] += amount;
+            terrain.texture_indices[row * terrain.width + column] = index;
+        }
+    }
+    journal_end_terrain_edit();
+}
+
+void test_terrain_edit_undo_and_redo(void) {
+    edit_terrain(10, 12, 8, 1.5, 3);
+    float edited = terrain.heights[13 * terrain.width + 11];
+    TEST_ASSERT_EQUAL(1, journal_get_undo_count());
+
+    JournalChanges changes = {0};
+    TEST_ASSERT_FALSE(journal_undo(&changes));
+    TEST_ASSERT_EQUAL_MEMORY(original_heights, terrain.heights,
+                             terrain.size * sizeof(float));
+    TEST_ASSERT_EQUAL(0, terrain.texture_indices[13 * terrain.width + 11]);
+    TEST_ASSERT_TRUE(changes.is_terrain_changed);
+    TEST_ASSERT_EQUAL(10, changes.terrain_x);
+    TEST_ASSERT_EQUAL(12, changes.terrain_y);
+    TEST_ASSERT_EQUAL(8, changes.terrain_width);
+
+    TEST_ASSERT_FALSE(journal_redo(0));
+    TEST_ASSERT_EQUAL_FLOAT(edited, terrain.heights[13 * terrain.width + 11]);
+    TEST_ASSERT_EQUAL(3, terrain.texture_indices[13 * terrain.width + 11]);
+}
+
+void test_unchanged_terrain_is_not_recorded(void) {
+    journal_begin_terrain_edit(0, 0, 16, 16);
+    journal_end_terrain_edit();
+    TEST_ASSERT_EQUAL(0, journal_get_undo_count());
+}
+
+void test_sparse_terrain_edit_is_compact(void) {
+    journal_begin_terrain_edit(0, 0, 64, 64);
+    terrain.heights[5 * terrain.width + 5] = 100;
+    journal_end_terrain_edit();
+
+    // One changed float out of 4096
+    TEST_ASSERT_LESS_THAN(256, journal_get_memory_usage());
+}
+
+void test_undo_and_redo_on_empty_journal_fail(void) {
+    TEST_ASSERT_TRUE(journal_undo(0));
+    TEST_ASSERT_TRUE(journal_redo(0));
+}
+
+void test_new_record_drops_redo(void) {
+    edit_terrain(0, 0, 4, 1, 1);
+    edit_terrain(8, 8, 4, 1, 1);
+    journal_undo(0);
+    TEST_ASSERT_EQUAL(1, journal_get_redo_count());
+
+    edit_terrain(16, 16, 4, 1, 1);
+    TEST_ASSERT_EQUAL(0, journal_get_redo_count());
+    TEST_ASSERT_EQUAL(2, journal_get_undo_count());
+}
+
+void test_group_is_undone_at_once(void) {
+    journal_begin_group();
+    edit_terrain(0, 0, 4, 1, 1);
+    edit_terrain(2, 2, 4, 2, 2);
+    journal_end_group();
+
+    JournalChanges changes = {0};
+    journal_undo(&changes);
+    TEST_ASSERT_EQUAL(2, changes.records_applied);
+    TEST_ASSERT_EQUAL(0, journal_get_undo_count());
+    TEST_ASSERT_EQUAL(6, changes.terrain_width);
+    TEST_ASSERT_EQUAL_MEMORY(original_heights, terrain.heights,
+                             terrain.size * sizeof(float));
+}
+
+void test_memory_cap_drops_oldest_records(void) {
+    // Every edit changes a lot of data so that the cap is hit quickly
+    for (size_t i = 0; i < 64; i++)
+        edit_terrain(0, 0, 48, 0.25, i);
+
+    TEST_ASSERT_LESS_OR_EQUAL(MEMORY_CAP, journal_get_memory_usage());
+    TEST_ASSERT_LESS_THAN(64, journal_get_undo_count());
+    TEST_ASSERT_GREATER_THAN(0, journal_get_undo_count());
+}
+
+void test_light_undo_and_redo(void) {
+    LightSourceHandle handle = 0;
+    LightSource light = {.intensity = 1, .color = {255, 0, 0, 255}};
+    lighting_scene_add_light(light, &handle);
+
+    LightSource changed = light;
+    changed.intensity = 4;
+    changed.position = (Vector3){1, 2, 3};
+    *lighting_scene_get_light(handle) = changed;
+    journal_record_light(handle, light, changed);
+
+    journal_undo(0);
+    TEST_ASSERT_EQUAL_MEMORY(&light, lighting_scene_get_light(handle),
+                             sizeof(LightSource));
+    journal_redo(0);
+    TEST_ASSERT_EQUAL_MEMORY(&changed, lighting_scene_get_light(handle),
+                             sizeof(LightSource));
+
+    lighting_scene_remove_light(handle);
+}
+
+void test_transform_undo_and_redo(void) {
+    EntityHandle handle = add_entity(1);
+    move_entity(handle, 2);
+
+    journal_undo(0);
+    TEST_ASSERT_EQUAL_FLOAT(1, scene_get_entity(handle)->transform.m12);
+    journal_redo(0);
+    TEST_ASSERT_EQUAL_FLOAT(2, scene_get_entity(handle)->transform.m12);
+}
+
+void test_undo_skips_removed_entity(void) {
+    EntityHandle handle = add_entity(1);
+    move_entity(handle, 2);
+    scene_remove(handle);
+
+    // Takes over the slot of the removed entity
+    TEST_ASSERT_EQUAL(handle, add_entity(9));
+    TEST_ASSERT_FALSE(journal_undo(0));
+    TEST_ASSERT_EQUAL_FLOAT(9, scene_get_entity(handle)->transform.m12);
+    TEST_ASSERT_FALSE(journal_redo(0));
+    TEST_ASSERT_EQUAL_FLOAT(9, scene_get_entity(handle)->transform.m12);
+}
+
+void test_undo_skips_destroyed_entity(void) {
+    EntityHandle handle = add_entity(1);
+    move_entity(handle, 2);
+    scene_remove(handle);
+
+    journal_undo(0);
+    TEST_ASSERT_EQUAL_FLOAT(2, scene_get_entity(handle)->transform.m12);
+}
+
+void test_undo_follows_compacted_entity(void) {
+    EntityHandle removed = add_entity(1);
+    EntityHandle handle = add_entity(5);
+    move_entity(handle, 6);
+    scene_remove(removed);
+    scene_compact(0);
+
+    journal_undo(0);
+    TEST_ASSERT_EQUAL_FLOAT(5, scene_get_entity(0)->transform.m12);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_terrain_edit_undo_and_redo);
+    RUN_TEST(test_transform_undo_and_redo);
+    RUN_TEST(test_undo_skips_removed_entity);
+    RUN_TEST(test_undo_skips_destroyed_entity);
+    RUN_TEST(test_undo_follows_compacted_entity);
+    RUN_TEST(test_unchanged_terrain_is_not_recorded);
+    RUN_TEST(test_sparse_terrain_edit_is_compact);
+    RUN_TEST(test_undo_and_redo_on_empty_journal_fail);
+    RUN_TEST(test_new_record_drops_redo);
+    RUN_TEST(test_group_is_undone_at_once);
+    RUN_TEST(test_memory_cap_drops_oldest_records);
+    RUN_TEST(test_light_undo_and_redo);
+
+    return UNITY_END();
+}
@@ -0,0 +1,104 @@
+#include "unity.h"
+
+#include "pool.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t id;
+    char name[40];
+} Element;
+
+Pool pool;
+
+void setUp(void) {
+    pool = pool_init(sizeof(Element));
+}
+
+void tearDown(void) {
+    pool_free(&pool);
+}
+
+void test_elements_do_not_overlap(void) {
+    Element *elements[300] = {0};
+    for (size_t i = 0; i < 300; i++) {
+        elements[i] = pool_allocate(&pool);
+        TEST_ASSERT_NOT_NULL(elements[i]);
+        elements[i]->id = i;
+        memset(elements[i]->name, (int)i, sizeof(elements[i]->name));
+    }
+
+    for (size_t i = 0; i < 300; i++) {
+        TEST_ASSERT_EQUAL(i, elements[i]->id);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)i, elements[i]->name[39]);
+    }
+}
+
+void test_addresses_stay_stable_when_growing(void) {
+    Element *first = pool_allocate(&pool);
+    first->id = 1234;
+
+    for (size_t i = 0; i < 10000; i++)
+        pool_allocate(&pool);
+
+    TEST_ASSERT_EQUAL(1234, first->id);
+    TEST_ASSERT_GREATER_THAN(1, pool.blocks_used);
+}
+
+void test_released_elements_are_reused(void) {
+    Element *a = pool_allocate(&pool);
+    Element *b = pool_allocate(&pool);
+    pool_release(&pool, a);
+    pool_release(&pool, b);
+
+    TEST_ASSERT_EQUAL_PTR(b, pool_allocate(&pool));
+    TEST_ASSERT_EQUAL_PTR(a, pool_allocate(&pool));
+    TEST_ASSERT_EQUAL(1, pool.blocks_used);
+}
+
+void test_elements_are_aligned(void) {
+    Pool small = pool_init(3);
+    TEST_ASSERT_GREATER_OR_EQUAL(sizeof(void *), small.element_size);
+
+    for (size_t i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL(0, (uintptr_t)pool_allocate(&pool) % 16);
+        TEST_ASSERT_EQUAL(0,
+                          (uintptr_t)pool_allocate(&small) % sizeof(void *));
+    }
+    pool_free(&small);
+}
+
+void test_cache_round_trip(void) {
+    PoolCache cache = {0};
+    Element *elements[100] = {0};
+
+    for (size_t i = 0; i < 100; i++)
+        elements[i] = pool_cache_allocate(&cache, &pool);
+    for (size_t i = 0; i < 100; i++)
+        pool_cache_release(&cache, &pool, elements[i]);
+
+    TEST_ASSERT_LESS_OR_EQUAL(POOL_CACHE_SIZE, cache.count);
+
+    pool_cache_flush(&cache, &pool);
+    TEST_ASSERT_EQUAL(0, cache.count);
+    TEST_ASSERT_NULL(cache.free_list);
+
+    // Everything handed back should be reused before the pool grows.
+    size_t blocks_used = pool.blocks_used;
+    for (size_t i = 0; i < 100; i++)
+        pool_allocate(&pool);
+    TEST_ASSERT_EQUAL(blocks_used, pool.blocks_used);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_elements_do_not_overlap);
+    RUN_TEST(test_addresses_stay_stable_when_growing);
+    RUN_TEST(test_released_elements_are_reused);
+    RUN_TEST(test_elements_are_aligned);
+    RUN_TEST(test_cache_round_trip);
+
+    return UNITY_END();
+}
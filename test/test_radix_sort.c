@@ -0,0 +1,88 @@
+#include "unity.h"
+
+#include "radix_sort.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define COUNT 10000
+
+static uint64_t keys[COUNT];
+static uint32_t values[COUNT];
+static uint64_t keys_scratch[COUNT];
+static uint32_t values_scratch[COUNT];
+static uint64_t original_keys[COUNT];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void test_sorts_random_keys(void) {
+    uint64_t state = 12345;
+    for (size_t i = 0; i < COUNT; i++) {
+        keys[i] = next_random(&state);
+        original_keys[i] = keys[i];
+        values[i] = i;
+    }
+
+    radix_sort_u64(keys, values, keys_scratch, values_scratch, COUNT);
+
+    for (size_t i = 1; i < COUNT; i++)
+        TEST_ASSERT_TRUE(keys[i - 1] <= keys[i]);
+    for (size_t i = 0; i < COUNT; i++)
+        TEST_ASSERT_EQUAL_UINT64(original_keys[values[i]], keys[i]);
+}
+
+void test_sort_is_stable(void) {
+    for (size_t i = 0; i < COUNT; i++) {
+        keys[i] = (COUNT - i) % 7;
+        values[i] = i;
+    }
+
+    radix_sort_u64(keys, values, keys_scratch, values_scratch, COUNT);
+
+    for (size_t i = 1; i < COUNT; i++) {
+        TEST_ASSERT_TRUE(keys[i - 1] <= keys[i]);
+        if (keys[i - 1] == keys[i])
+            TEST_ASSERT_TRUE(values[i - 1] < values[i]);
+    }
+}
+
+void test_sorts_keys_differing_only_in_high_bits(void) {
+    uint64_t input[] = {3ull << 60, 1ull << 60, 2ull << 60, 0};
+    uint32_t input_values[] = {3, 1, 2, 0};
+
+    radix_sort_u64(input, input_values, keys_scratch, values_scratch, 4);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT64((uint64_t)i << 60, input[i]);
+        TEST_ASSERT_EQUAL(i, input_values[i]);
+    }
+}
+
+void test_small_inputs(void) {
+    uint64_t one_key = 5;
+    uint32_t one_value = 1;
+    radix_sort_u64(&one_key, &one_value, keys_scratch, values_scratch, 1);
+    TEST_ASSERT_EQUAL_UINT64(5, one_key);
+
+    radix_sort_u64(0, 0, keys_scratch, values_scratch, 0);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sorts_random_keys);
+    RUN_TEST(test_sort_is_stable);
+    RUN_TEST(test_sorts_keys_differing_only_in_high_bits);
+    RUN_TEST(test_small_inputs);
+
+    return UNITY_END();
+}
@@ -0,0 +1,201 @@
+#include "unity.h"
+
+#include "assets.h"
+#include "common.h"
+#include "lighting.h"
+#include "render_queue.h"
+#include "scene.h"
+#include "scene_stats.h"
+#include "slotmap.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static char directory[] = "/tmp/test_render_queue_XXXXXX";
+static char asset_directory[MAX_PATH_LENGTH];
+
+static const char *asset_names[] = {"box", "cone", "tree"};
+#define ASSET_COUNT (sizeof asset_names / sizeof *asset_names)
+
+void setUp(void) {
+    strcpy(directory, "/tmp/test_render_queue_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(asset_directory, MAX_PATH_LENGTH, "%s/", directory);
+    for (size_t i = 0; i < ASSET_COUNT; i++) {
+        char asset_path[MAX_PATH_LENGTH];
+        snprintf(asset_path, MAX_PATH_LENGTH, "%s/%s.glb", directory,
+                 asset_names[i]);
+        FILE *fp = fopen(asset_path, "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        fclose(fp);
+    }
+
+    assets_fetch_all(asset_directory);
+    scene_init();
+}
+
+void tearDown(void) {
+    render_queue_free();
+    scene_free();
+    lighting_scene_free();
+    for (size_t i = 0; i < ASSET_COUNT; i++) {
+        char asset_path[MAX_PATH_LENGTH];
+        snprintf(asset_path, MAX_PATH_LENGTH, "%s/%s.glb", directory,
+                 asset_names[i]);
+        remove(asset_path);
+    }
+    rmdir(directory);
+}
+
+// Adds an entity of asset `name` at `x` on the X axis.
+static EntityHandle add_entity(const char *name, float x) {
+    Entity entity = {.transform = MatrixTranslate(x, 0, 0)};
+    TEST_ASSERT_FALSE(assets_get_handle(name, &entity.asset_handle));
+    EntityHandle handle = 0;
+    TEST_ASSERT_FALSE(scene_add(entity, &handle, asset_directory));
+    return handle;
+}
+
+// Gives the model of entity `handle` a shader and diffuse texture.
+static void set_material(EntityHandle handle, unsigned int shader_id,
+                         unsigned int texture_id) {
+    Model *model = scene_get_model(scene_get_entity(handle)->model_handle);
+    model->materials[0].shader.id = shader_id;
+    model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture.id = texture_id;
+}
+
+void test_key_fields_are_laid_out_from_shader_to_depth(void) {
+    TEST_ASSERT_EQUAL_HEX64(0xffull << 56,
+                            render_queue_make_key(0xff, 0, 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(0xffffull << 40,
+                            render_queue_make_key(0, 0xffff, 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(
+        0xffffull << 24,
+        render_queue_make_key(0, 0, slotmap_handle_make(0xffff, 3), 0));
+    TEST_ASSERT_EQUAL_HEX64(
+        0xffffffull, render_queue_make_key(0, 0, 0, RENDER_QUEUE_MAX_DEPTH));
+    TEST_ASSERT_EQUAL_HEX64(
+        UINT64_MAX, render_queue_make_key(0xff, 0xffff,
+                                          slotmap_handle_make(0xffff, 0),
+                                          RENDER_QUEUE_MAX_DEPTH));
+}
+
+void test_key_fields_are_truncated_to_their_bits(void) {
+    // Nothing spills into the next field up
+    TEST_ASSERT_EQUAL_HEX64(0x01ull << 56,
+                            render_queue_make_key(0x101, 0, 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(0x0001ull << 40,
+                            render_queue_make_key(0, 0x10001, 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(
+        0x0001ull << 24,
+        render_queue_make_key(0, 0, slotmap_handle_make(0x10001, 0), 0));
+
+    // Depth is clamped instead
+    TEST_ASSERT_EQUAL_HEX64(0, render_queue_make_key(0, 0, 0, -5));
+    TEST_ASSERT_EQUAL_HEX64(
+        0xffffffull,
+        render_queue_make_key(0, 0, 0, RENDER_QUEUE_MAX_DEPTH * 2));
+}
+
+void test_keys_order_by_shader_texture_model_then_depth(void) {
+    ModelHandle model_a = slotmap_handle_make(1, 0);
+    ModelHandle model_b = slotmap_handle_make(2, 0);
+    TEST_ASSERT_TRUE(render_queue_make_key(1, 0, model_a, 0) >
+                     render_queue_make_key(0, 0xffff, model_b, 100));
+    TEST_ASSERT_TRUE(render_queue_make_key(0, 1, model_a, 0) >
+                     render_queue_make_key(0, 0, model_b, 100));
+    TEST_ASSERT_TRUE(render_queue_make_key(0, 0, model_b, 0) >
+                     render_queue_make_key(0, 0, model_a, 100));
+    TEST_ASSERT_TRUE(render_queue_make_key(0, 0, model_a, 2) >
+                     render_queue_make_key(0, 0, model_a, 1));
+}
+
+void test_build_groups_by_material_and_model_front_to_back(void) {
+    EntityHandle far_box = add_entity("box", 30);
+    EntityHandle near_cone = add_entity("cone", 5);
+    EntityHandle near_box = add_entity("box", 10);
+    EntityHandle tree = add_entity("tree", 1);
+    EntityHandle far_cone = add_entity("cone", 20);
+    set_material(near_box, 2, 0);
+    set_material(near_cone, 1, 5);
+    set_material(tree, 1, 3);
+
+    render_queue_build((Camera3D){0});
+    const RenderQueue *queue = render_queue_get();
+    TEST_ASSERT_EQUAL(5, queue->items_used);
+
+    // Shader 1 with texture 3, then texture 5, then shader 2
+    EntityHandle expected[] = {tree, near_cone, far_cone, near_box, far_box};
+    for (size_t i = 0; i < 5; i++)
+        TEST_ASSERT_EQUAL(expected[i], queue->entities[i]);
+}
+
+void test_build_groups_models_sharing_a_material(void) {
+    EntityHandle far_box = add_entity("box", 30);
+    EntityHandle cone = add_entity("cone", 20);
+    EntityHandle near_box = add_entity("box", 10);
+    ModelHandle box_model = scene_get_entity(near_box)->model_handle;
+    ModelHandle cone_model = scene_get_entity(cone)->model_handle;
+    int is_box_first =
+        slotmap_handle_slot(box_model) < slotmap_handle_slot(cone_model);
+
+    render_queue_build((Camera3D){0});
+    const RenderQueue *queue = render_queue_get();
+    TEST_ASSERT_EQUAL(3, queue->items_used);
+
+    // The cone is not drawn between the boxes even though it is between them
+    size_t box_start = is_box_first ? 0 : 1;
+    TEST_ASSERT_EQUAL(near_box, queue->entities[box_start]);
+    TEST_ASSERT_EQUAL(far_box, queue->entities[box_start + 1]);
+    TEST_ASSERT_EQUAL(cone, queue->entities[is_box_first ? 2 : 0]);
+}
+
+// Draws the queue built from `camera` instanced, returns the draw calls made.
+static size_t draw_instanced(Camera3D camera) {
+    scene_stats_end_frame();
+    render_queue_build(camera);
+    render_queue_draw_instanced();
+    scene_stats_end_frame();
+    return scene_stats_get().draw_calls_last_frame;
+}
+
+void test_instanced_draw_is_one_call_per_model(void) {
+    lighting_scene_init_instancing("instanced.vs", "entity.fs");
+    for (size_t i = 0; i < 10; i++)
+        add_entity("box", i);
+    TEST_ASSERT_EQUAL(1, draw_instanced((Camera3D){0}));
+
+    for (size_t i = 0; i < 10; i++)
+        add_entity("cone", i);
+    TEST_ASSERT_EQUAL(2, draw_instanced((Camera3D){0}));
+}
+
+void test_short_runs_are_drawn_one_by_one(void) {
+    lighting_scene_init_instancing("instanced.vs", "entity.fs");
+    for (size_t i = 0; i < 10; i++)
+        add_entity("box", i);
+    // A single cone is drawn without instancing
+    add_entity("cone", 0);
+    TEST_ASSERT_EQUAL(2, draw_instanced((Camera3D){0}));
+}
+
+void test_draw_without_instancing_is_one_call_per_entity(void) {
+    for (size_t i = 0; i < 10; i++)
+        add_entity("box", i);
+    TEST_ASSERT_EQUAL(10, draw_instanced((Camera3D){0}));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_key_fields_are_laid_out_from_shader_to_depth);
+    RUN_TEST(test_key_fields_are_truncated_to_their_bits);
+    RUN_TEST(test_keys_order_by_shader_texture_model_then_depth);
+    RUN_TEST(test_build_groups_by_material_and_model_front_to_back);
+    RUN_TEST(test_build_groups_models_sharing_a_material);
+    RUN_TEST(test_instanced_draw_is_one_call_per_model);
+    RUN_TEST(test_short_runs_are_drawn_one_by_one);
+    RUN_TEST(test_draw_without_instancing_is_one_call_per_entity);
+    return UNITY_END();
+}
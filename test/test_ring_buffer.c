@@ -0,0 +1,159 @@
+#include "unity.h"
+
+#include "ring_buffer.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PRODUCER_COUNT 4
+#define ITEMS_PER_PRODUCER 50000
+
+typedef struct {
+    uint32_t producer;
+    uint32_t value;
+} Item;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void check_fifo(RingBufferKind kind) {
+    RingBuffer buf = ringbuf_init(kind, sizeof(int), 4);
+
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL(0, ringbuf_push(&buf, &i));
+
+    int extra = 123;
+    TEST_ASSERT_EQUAL(1, ringbuf_push(&buf, &extra));
+    TEST_ASSERT_EQUAL(4, ringbuf_count(&buf));
+
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, ringbuf_pop(&buf, &value));
+        TEST_ASSERT_EQUAL(i, value);
+    }
+    TEST_ASSERT_EQUAL(1, ringbuf_pop(&buf, &value));
+
+    ringbuf_free(&buf);
+}
+
+void test_fifo_single_producer(void) {
+    check_fifo(RINGBUF_SINGLE_PRODUCER);
+}
+
+void test_fifo_multi_producer(void) {
+    check_fifo(RINGBUF_MULTI_PRODUCER);
+}
+
+void test_capacity_is_rounded_up(void) {
+    RingBuffer buf = ringbuf_init(RINGBUF_SINGLE_PRODUCER, sizeof(int), 5);
+    TEST_ASSERT_EQUAL(8, buf.capacity);
+    ringbuf_free(&buf);
+}
+
+static void check_batches_wrap_around(RingBufferKind kind) {
+    RingBuffer buf = ringbuf_init(kind, sizeof(int), 8);
+    int in[6] = {0};
+    int out[8] = {0};
+    int next = 0;
+    int expected = 0;
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 6; i++)
+            in[i] = next++;
+        TEST_ASSERT_EQUAL(6, ringbuf_push_many(&buf, in, 6));
+
+        size_t popped = ringbuf_pop_many(&buf, out, 8);
+        TEST_ASSERT_EQUAL(6, popped);
+        for (size_t i = 0; i < popped; i++)
+            TEST_ASSERT_EQUAL(expected++, out[i]);
+    }
+
+    // Partial push when there is not enough space
+    TEST_ASSERT_EQUAL(6, ringbuf_push_many(&buf, in, 6));
+    TEST_ASSERT_EQUAL(2, ringbuf_push_many(&buf, in, 6));
+    TEST_ASSERT_EQUAL(0, ringbuf_push_many(&buf, in, 6));
+
+    ringbuf_free(&buf);
+}
+
+void test_batches_wrap_around_single_producer(void) {
+    check_batches_wrap_around(RINGBUF_SINGLE_PRODUCER);
+}
+
+void test_batches_wrap_around_multi_producer(void) {
+    check_batches_wrap_around(RINGBUF_MULTI_PRODUCER);
+}
+
+static RingBuffer shared_buf;
+
+static void *produce(void *arg) {
+    uint32_t producer = (uint32_t)(uintptr_t)arg;
+    Item batch[7] = {0};
+    uint32_t value = 0;
+
+    while (value < ITEMS_PER_PRODUCER) {
+        size_t count = 0;
+        while (count < 7 && value + count < ITEMS_PER_PRODUCER) {
+            batch[count] = (Item){.producer = producer, .value = value + count};
+            count++;
+        }
+
+        // Yield when full, the consumer might share the core
+        size_t pushed = 0;
+        while (pushed < count) {
+            size_t batch_pushed =
+                ringbuf_push_many(&shared_buf, batch + pushed, count - pushed);
+            if (!batch_pushed)
+                sched_yield();
+            pushed += batch_pushed;
+        }
+        value += count;
+    }
+
+    return 0;
+}
+
+void test_multiple_producers_keep_per_producer_order(void) {
+    shared_buf = ringbuf_init(RINGBUF_MULTI_PRODUCER, sizeof(Item), 256);
+
+    pthread_t threads[PRODUCER_COUNT];
+    for (uintptr_t i = 0; i < PRODUCER_COUNT; i++)
+        pthread_create(threads + i, 0, produce, (void *)i);
+
+    uint32_t next_expected[PRODUCER_COUNT] = {0};
+    size_t received = 0;
+    Item items[32] = {0};
+
+    while (received < PRODUCER_COUNT * ITEMS_PER_PRODUCER) {
+        size_t popped = ringbuf_pop_many(&shared_buf, items, 32);
+        if (!popped)
+            sched_yield();
+        for (size_t i = 0; i < popped; i++) {
+            TEST_ASSERT_LESS_THAN(PRODUCER_COUNT, items[i].producer);
+            TEST_ASSERT_EQUAL(next_expected[items[i].producer]++,
+                              items[i].value);
+        }
+        received += popped;
+    }
+
+    for (size_t i = 0; i < PRODUCER_COUNT; i++)
+        pthread_join(threads[i], 0);
+
+    TEST_ASSERT_EQUAL(0, ringbuf_count(&shared_buf));
+    ringbuf_free(&shared_buf);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fifo_single_producer);
+    RUN_TEST(test_fifo_multi_producer);
+    RUN_TEST(test_capacity_is_rounded_up);
+    RUN_TEST(test_batches_wrap_around_single_producer);
+    RUN_TEST(test_batches_wrap_around_multi_producer);
+    RUN_TEST(test_multiple_producers_keep_per_producer_order);
+
+    return UNITY_END();
+}
@@ -0,0 +1,443 @@
+#include "unity.h"
+
+#include "assets.h"
+#include "common.h"
+#include "lighting.h"
+#include "scene.h"
+#include "worker_pool.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static char directory[] = "/tmp/test_scene_XXXXXX";
+static char asset_directory[MAX_PATH_LENGTH];
+static const char *asset_names[] = {"box", "cone", "tree", "tree_lod1",
+                                    "tree_lod2"};
+#define ASSET_COUNT (sizeof asset_names / sizeof *asset_names)
+
+static EntityHandle removed[8];
+static size_t removed_count;
+static EntityHandle moved[8];
+static size_t moved_count;
+
+static void on_entity_removed(EntityHandle handle, void *user_data) {
+    (void)user_data;
+    removed[removed_count++] = handle;
+}
+
+static void on_entities_moved(const EntityHandle *handle_mapping, size_t count,
+                              void *user_data) {
+    (void)user_data;
+    memcpy(moved, handle_mapping, count * sizeof(EntityHandle));
+    moved_count = count;
+}
+
+static const SceneEntityListener listener = {
+    .entity_removed = on_entity_removed,
+    .entities_moved = on_entities_moved,
+};
+
+void setUp(void) {
+    strcpy(directory, "/tmp/test_scene_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(asset_directory, MAX_PATH_LENGTH, "%s/", directory);
+    for (size_t i = 0; i < ASSET_COUNT; i++) {
+        char asset_path[MAX_PATH_LENGTH];
+        snprintf(asset_path, MAX_PATH_LENGTH, "%s/%s.glb", directory,
+                 asset_names[i]);
+        FILE *fp = fopen(asset_path, "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        fclose(fp);
+    }
+
+    assets_fetch_all(asset_directory);
+    scene_init();
+    removed_count = 0;
+    moved_count = 0;
+    TEST_ASSERT_FALSE(scene_add_entity_listener(listener));
+}
+
+void tearDown(void) {
+    scene_remove_entity_listener(listener);
+    scene_free();
+    lighting_scene_free();
+    for (size_t i = 0; i < ASSET_COUNT; i++) {
+        char asset_path[MAX_PATH_LENGTH];
+        snprintf(asset_path, MAX_PATH_LENGTH, "%s/%s.glb", directory,
+                 asset_names[i]);
+        remove(asset_path);
+    }
+    rmdir(directory);
+}
+
+static AssetHandle get_asset(const char *name) {
+    AssetHandle handle = 0;
+    TEST_ASSERT_FALSE(assets_get_handle(name, &handle));
+    return handle;
+}
+
+// Adds an entity of asset `name` at the origin.
+static EntityHandle add_asset_entity(const char *name) {
+    Entity entity = {.asset_handle = get_asset(name),
+                     .transform = MatrixIdentity()};
+    EntityHandle handle = 0;
+    TEST_ASSERT_FALSE(scene_add(entity, &handle, asset_directory));
+    return handle;
+}
+
+// Returns 1 if a model of asset `name` is loaded.
+static int is_asset_loaded(const char *name) {
+    AssetHandle asset = get_asset(name);
+    for (size_t i = 0; i < scene_get_model_count(); i++)
+        if (scene_get_model_asset(scene_get_model_handle(i)) == asset)
+            return 1;
+    return 0;
+}
+
+static size_t get_model_cpu_bytes(void) {
+    size_t cpu_bytes = 0;
+    scene_get_model_memory_usage(&cpu_bytes, 0);
+    return cpu_bytes;
+}
+
+// Adds `count` entities at x = 0, 1, 2...
+static void add_entities(size_t count, EntityHandle *out_handles) {
+    for (size_t i = 0; i < count; i++) {
+        Entity entity = {.transform = MatrixTranslate(i, 0, 0)};
+        TEST_ASSERT_FALSE(scene_add(entity, out_handles + i, asset_directory));
+    }
+}
+
+void test_removed_slots_are_reused_last_removed_first(void) {
+    EntityHandle handles[4] = {0};
+    add_entities(4, handles);
+    for (size_t i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL(i, handles[i]);
+
+    scene_remove(1);
+    scene_remove(3);
+    TEST_ASSERT_EQUAL(2, removed_count);
+    TEST_ASSERT_EQUAL(1, removed[0]);
+    TEST_ASSERT_EQUAL(3, removed[1]);
+
+    EntityHandle reused[3] = {0};
+    add_entities(3, reused);
+    TEST_ASSERT_EQUAL(3, reused[0]);
+    TEST_ASSERT_EQUAL(1, reused[1]);
+    TEST_ASSERT_EQUAL(4, reused[2]);
+    TEST_ASSERT_EQUAL(5, scene_get_entity_count());
+}
+
+void test_reused_slot_gets_a_new_id(void) {
+    EntityHandle handle = 0;
+    add_entities(1, &handle);
+    uint64_t id = scene_get_entity(handle)->id;
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    TEST_ASSERT_NOT_NULL(scene_get_entity_by_id(handle, id));
+
+    scene_remove(handle);
+    TEST_ASSERT_NULL(scene_get_entity_by_id(handle, id));
+
+    EntityHandle reused = 0;
+    add_entities(1, &reused);
+    TEST_ASSERT_EQUAL(handle, reused);
+    TEST_ASSERT_NULL(scene_get_entity_by_id(handle, id));
+    TEST_ASSERT_NOT_NULL(
+        scene_get_entity_by_id(reused, scene_get_entity(reused)->id));
+}
+
+void test_compact_maps_old_handles_to_new(void) {
+    EntityHandle handles[5] = {0};
+    add_entities(5, handles);
+    uint64_t last_id = scene_get_entity(4)->id;
+    scene_remove(0);
+    scene_remove(3);
+
+    EntityHandle mapping[5] = {0};
+    TEST_ASSERT_EQUAL(2, scene_compact(mapping));
+    TEST_ASSERT_EQUAL(3, scene_get_entity_count());
+    TEST_ASSERT_EQUAL(SCENE_ENTITY_HANDLE_NONE, mapping[0]);
+    TEST_ASSERT_EQUAL(0, mapping[1]);
+    TEST_ASSERT_EQUAL(1, mapping[2]);
+    TEST_ASSERT_EQUAL(SCENE_ENTITY_HANDLE_NONE, mapping[3]);
+    TEST_ASSERT_EQUAL(2, mapping[4]);
+
+    // Entities keep their data and id when they move
+    TEST_ASSERT_EQUAL_FLOAT(4, scene_get_entity(2)->transform.m12);
+    TEST_ASSERT_NOT_NULL(scene_get_entity_by_id(2, last_id));
+
+    TEST_ASSERT_EQUAL(5, moved_count);
+    TEST_ASSERT_EQUAL_MEMORY(mapping, moved, sizeof mapping);
+
+    // Nothing is left to reuse
+    EntityHandle handle = 0;
+    add_entities(1, &handle);
+    TEST_ASSERT_EQUAL(3, handle);
+}
+
+void test_listeners_get_mapping_without_caller_mapping(void) {
+    EntityHandle handles[3] = {0};
+    add_entities(3, handles);
+    scene_remove(1);
+    TEST_ASSERT_EQUAL(1, scene_compact(0));
+    TEST_ASSERT_EQUAL(3, moved_count);
+    TEST_ASSERT_EQUAL(0, moved[0]);
+    TEST_ASSERT_EQUAL(SCENE_ENTITY_HANDLE_NONE, moved[1]);
+    TEST_ASSERT_EQUAL(1, moved[2]);
+}
+
+void test_removed_listener_is_not_called(void) {
+    EntityHandle handle = 0;
+    add_entities(1, &handle);
+    scene_remove_entity_listener(listener);
+    scene_remove(handle);
+    scene_compact(0);
+    TEST_ASSERT_EQUAL(0, removed_count);
+    TEST_ASSERT_EQUAL(0, moved_count);
+
+    // Added back for tearDown to remove
+    TEST_ASSERT_FALSE(scene_add_entity_listener(listener));
+}
+
+void test_world_bounds_follow_direct_transform_writes(void) {
+    EntityHandle handle = 0;
+    add_entities(1, &handle);
+    Entity *entity = scene_get_entity(handle);
+    TEST_ASSERT_EQUAL_FLOAT(0, scene_entity_get_world_bounds(entity).min.x);
+
+    entity->transform = MatrixTranslate(5, 0, 0);
+    TEST_ASSERT_EQUAL_FLOAT(5, scene_entity_get_world_bounds(entity).min.x);
+
+    scene_set_entity_transform(handle, MatrixTranslate(7, 0, 0));
+    TEST_ASSERT_EQUAL_FLOAT(7, scene_entity_get_world_bounds(entity).max.x);
+}
+
+void test_unused_models_are_evicted_oldest_first(void) {
+    EntityHandle box = add_asset_entity("box");
+    size_t model_bytes = get_model_cpu_bytes();
+    TEST_ASSERT_NOT_EQUAL(0, model_bytes);
+    EntityHandle cone = add_asset_entity("cone");
+    EntityHandle tree = add_asset_entity("tree");
+    TEST_ASSERT_EQUAL(3 * model_bytes, get_model_cpu_bytes());
+
+    // Unloaded only once over budget, least recently used first
+    scene_remove(box);
+    scene_remove(tree);
+    scene_remove(cone);
+    TEST_ASSERT_EQUAL(3, scene_get_model_count());
+
+    scene_set_model_memory_budget(2 * model_bytes, SIZE_MAX);
+    TEST_ASSERT_FALSE(is_asset_loaded("box"));
+    TEST_ASSERT_TRUE(is_asset_loaded("tree"));
+    TEST_ASSERT_TRUE(is_asset_loaded("cone"));
+    TEST_ASSERT_EQUAL(2 * model_bytes, get_model_cpu_bytes());
+
+    scene_set_model_memory_budget(model_bytes, SIZE_MAX);
+    TEST_ASSERT_FALSE(is_asset_loaded("tree"));
+    TEST_ASSERT_TRUE(is_asset_loaded("cone"));
+    TEST_ASSERT_EQUAL(model_bytes, get_model_cpu_bytes());
+}
+
+void test_models_in_use_are_never_evicted(void) {
+    add_asset_entity("box");
+    EntityHandle cone = add_asset_entity("cone");
+    add_asset_entity("cone");
+
+    scene_set_model_memory_budget(0, 0);
+    TEST_ASSERT_EQUAL(2, scene_get_model_count());
+
+    // Still used by the other cone
+    scene_remove(cone);
+    TEST_ASSERT_TRUE(is_asset_loaded("cone"));
+    TEST_ASSERT_TRUE(is_asset_loaded("box"));
+    TEST_ASSERT_EQUAL(2, scene_get_model_count());
+}
+
+void test_evicted_asset_is_loaded_again_when_added(void) {
+    scene_set_model_memory_budget(0, 0);
+    EntityHandle box = add_asset_entity("box");
+    ModelHandle model = scene_get_entity(box)->model_handle;
+    scene_remove(box);
+    TEST_ASSERT_FALSE(is_asset_loaded("box"));
+    TEST_ASSERT_NULL(scene_get_model(model));
+
+    box = add_asset_entity("box");
+    TEST_ASSERT_TRUE(is_asset_loaded("box"));
+    TEST_ASSERT_NOT_NULL(
+        scene_get_model(scene_get_entity(box)->model_handle));
+    TEST_ASSERT_NOT_EQUAL(0, get_model_cpu_bytes());
+}
+
+void test_async_loads_use_placeholder_until_finished(void) {
+    worker_pool_init(2);
+    scene_set_async_loading(1);
+    EntityHandle box = add_asset_entity("box");
+    EntityHandle cone = add_asset_entity("cone");
+    add_asset_entity("box");
+    TEST_ASSERT_EQUAL(2, scene_get_pending_load_count());
+
+    // Finished on the main thread only, so both are still loading
+    Entity *box_entity = scene_get_entity(box);
+    Entity *cone_entity = scene_get_entity(cone);
+    Model *placeholder = scene_entity_get_model(box_entity);
+    TEST_ASSERT_NOT_NULL(placeholder);
+    TEST_ASSERT_TRUE(scene_is_model_loading(box_entity->model_handle));
+    TEST_ASSERT_EQUAL_PTR(placeholder, scene_entity_get_model(cone_entity));
+
+    scene_finish_pending_loads();
+    TEST_ASSERT_EQUAL(0, scene_get_pending_load_count());
+    TEST_ASSERT_FALSE(scene_is_model_loading(box_entity->model_handle));
+    TEST_ASSERT_FALSE(scene_is_model_loading(cone_entity->model_handle));
+    TEST_ASSERT_NOT_EQUAL(placeholder, scene_entity_get_model(box_entity));
+    TEST_ASSERT_NOT_EQUAL(scene_entity_get_model(box_entity),
+                          scene_entity_get_model(cone_entity));
+    worker_pool_free();
+}
+
+void test_scene_free_drops_loads_in_flight(void) {
+    worker_pool_init(2);
+    scene_set_async_loading(1);
+    add_asset_entity("box");
+    add_asset_entity("cone");
+    add_asset_entity("tree");
+    TEST_ASSERT_EQUAL(3, scene_get_pending_load_count());
+
+    scene_free();
+    TEST_ASSERT_EQUAL(0, scene_get_pending_load_count());
+    worker_pool_free();
+
+    // Loads synchronously again
+    scene_init();
+    EntityHandle box = add_asset_entity("box");
+    TEST_ASSERT_EQUAL(0, scene_get_pending_load_count());
+    TEST_ASSERT_FALSE(
+        scene_is_model_loading(scene_get_entity(box)->model_handle));
+}
+
+void test_add_many_shares_one_model_per_asset(void) {
+    Entity entities[6] = {0};
+    for (size_t i = 0; i < 6; i++) {
+        entities[i].asset_handle = get_asset(i % 3 ? "box" : "cone");
+        entities[i].transform = MatrixTranslate(i, 0, 0);
+    }
+    EntityHandle handles[6] = {0};
+    TEST_ASSERT_FALSE(scene_add_many(entities, 6, handles, asset_directory));
+    TEST_ASSERT_EQUAL(6, scene_get_entity_count());
+    TEST_ASSERT_EQUAL(2, scene_get_model_count());
+
+    ModelHandle box_model = scene_get_entity(handles[1])->model_handle;
+    ModelHandle cone_model = scene_get_entity(handles[0])->model_handle;
+    TEST_ASSERT_NOT_EQUAL(box_model, cone_model);
+    for (size_t i = 0; i < 6; i++) {
+        Entity *entity = scene_get_entity(handles[i]);
+        TEST_ASSERT_EQUAL(i, handles[i]);
+        TEST_ASSERT_EQUAL(entities[i].asset_handle, entity->asset_handle);
+        TEST_ASSERT_EQUAL(i % 3 ? box_model : cone_model,
+                          entity->model_handle);
+    }
+
+    // Later adds share the model too
+    EntityHandle box = add_asset_entity("box");
+    TEST_ASSERT_EQUAL(box_model, scene_get_entity(box)->model_handle);
+    TEST_ASSERT_EQUAL(2, scene_get_model_count());
+}
+
+void test_add_many_fills_handles_in_order(void) {
+    EntityHandle first[4] = {0};
+    add_entities(4, first);
+    scene_remove(1);
+    scene_remove(2);
+
+    // Slots of removed entities come first, last removed first
+    Entity entities[3] = {0};
+    for (size_t i = 0; i < 3; i++)
+        entities[i].transform = MatrixTranslate(10 + i, 0, 0);
+    EntityHandle handles[3] = {0};
+    TEST_ASSERT_FALSE(scene_add_many(entities, 3, handles, asset_directory));
+    TEST_ASSERT_EQUAL(2, handles[0]);
+    TEST_ASSERT_EQUAL(1, handles[1]);
+    TEST_ASSERT_EQUAL(4, handles[2]);
+    for (size_t i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_FLOAT(10 + i,
+                                scene_get_entity(handles[i])->transform.m12);
+}
+
+// Updates levels of detail with the camera `distance` away from the origin
+// along the X axis, returns the level of entity `handle`.
+static size_t update_lods_at(float distance, EntityHandle handle) {
+    Camera3D camera = {.position = {distance, 0, 0}};
+    scene_update_lods(camera, asset_directory);
+    return scene_get_entity(handle)->lod_level;
+}
+
+// Returns 1 if entity `handle` is drawn with a model of asset `name`.
+static int is_drawn_with(EntityHandle handle, const char *name) {
+    ModelHandle model =
+        scene_entity_get_model_handle(scene_get_entity(handle));
+    return scene_get_model_asset(model) == get_asset(name);
+}
+
+void test_lod_level_follows_camera_distance(void) {
+    const float distances[] = {10, 20};
+    scene_set_lod_distances(distances, 2);
+    EntityHandle tree = add_asset_entity("tree");
+    EntityHandle box = add_asset_entity("box");
+
+    // Moving away needs to pass each distance by the hysteresis
+    TEST_ASSERT_EQUAL(0, update_lods_at(9, tree));
+    TEST_ASSERT_EQUAL(0, update_lods_at(10.5f, tree));
+    TEST_ASSERT_TRUE(is_drawn_with(tree, "tree"));
+    TEST_ASSERT_EQUAL(1, update_lods_at(11.5f, tree));
+    TEST_ASSERT_TRUE(is_drawn_with(tree, "tree_lod1"));
+    TEST_ASSERT_EQUAL(1, update_lods_at(21.5f, tree));
+    TEST_ASSERT_EQUAL(2, update_lods_at(23, tree));
+    TEST_ASSERT_TRUE(is_drawn_with(tree, "tree_lod2"));
+
+    // Jumps straight to the level of the distance
+    TEST_ASSERT_EQUAL(0, update_lods_at(1, tree));
+    TEST_ASSERT_EQUAL(2, update_lods_at(100, tree));
+
+    // Assets without levels of detail stay at full detail
+    TEST_ASSERT_EQUAL(0, scene_get_entity(box)->lod_level);
+    TEST_ASSERT_TRUE(is_drawn_with(box, "box"));
+}
+
+void test_lod_level_keeps_within_hysteresis(void) {
+    const float distances[] = {10, 20};
+    scene_set_lod_distances(distances, 2);
+    EntityHandle tree = add_asset_entity("tree");
+    TEST_ASSERT_EQUAL(2, update_lods_at(30, tree));
+
+    // Coming back needs to pass each distance by the hysteresis too
+    TEST_ASSERT_EQUAL(2, update_lods_at(19, tree));
+    TEST_ASSERT_EQUAL(2, update_lods_at(18.5f, tree));
+    TEST_ASSERT_EQUAL(1, update_lods_at(17.5f, tree));
+    TEST_ASSERT_EQUAL(1, update_lods_at(9.5f, tree));
+    TEST_ASSERT_EQUAL(1, update_lods_at(21, tree));
+    TEST_ASSERT_EQUAL(0, update_lods_at(8.5f, tree));
+    TEST_ASSERT_EQUAL(SLOTMAP_HANDLE_NULL,
+                      scene_get_entity(tree)->lod_model_handle);
+    TEST_ASSERT_TRUE(is_drawn_with(tree, "tree"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_removed_slots_are_reused_last_removed_first);
+    RUN_TEST(test_reused_slot_gets_a_new_id);
+    RUN_TEST(test_compact_maps_old_handles_to_new);
+    RUN_TEST(test_listeners_get_mapping_without_caller_mapping);
+    RUN_TEST(test_removed_listener_is_not_called);
+    RUN_TEST(test_world_bounds_follow_direct_transform_writes);
+    RUN_TEST(test_unused_models_are_evicted_oldest_first);
+    RUN_TEST(test_models_in_use_are_never_evicted);
+    RUN_TEST(test_evicted_asset_is_loaded_again_when_added);
+    RUN_TEST(test_async_loads_use_placeholder_until_finished);
+    RUN_TEST(test_scene_free_drops_loads_in_flight);
+    RUN_TEST(test_add_many_shares_one_model_per_asset);
+    RUN_TEST(test_add_many_fills_handles_in_order);
+    RUN_TEST(test_lod_level_follows_camera_distance);
+    RUN_TEST(test_lod_level_keeps_within_hysteresis);
+    return UNITY_END();
+}
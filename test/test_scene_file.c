@@ -0,0 +1,551 @@
+#include "unity.h"
+
+#include "assets.h"
+#include "common.h"
+#include "lighting.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "skyboxes.h"
+#include "terrain.h"
+#include "terrain_textures.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TERRAIN_WIDTH 8
+#define ENTITY_COUNT 6
+
+static char directory[] = "/tmp/test_scene_file_XXXXXX";
+static char asset_directory[MAX_PATH_LENGTH];
+static char asset_path[MAX_PATH_LENGTH];
+static char skybox_path[MAX_PATH_LENGTH];
+// Has no skyboxes or terrain textures
+static char empty_directory[MAX_PATH_LENGTH];
+static char scene_path[MAX_PATH_LENGTH];
+
+static void make_path(const char *name, char out_path[MAX_PATH_LENGTH]) {
+    snprintf(out_path, MAX_PATH_LENGTH, "%s/%s", directory, name);
+}
+
+static void create_file(const char *path) {
+    FILE *fp = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    fclose(fp);
+}
+
+// Starts an empty scene with one asset, one skybox and no terrain textures.
+static void init_scene(void) {
+    assets_fetch_all(asset_directory);
+    skyboxes_fetch_all(asset_directory);
+    terrain_textures_fetch_all(empty_directory);
+    scene_init();
+    terrain_init(TERRAIN_WIDTH);
+}
+
+static void free_scene(void) {
+    terrain_free();
+    scene_free();
+    lighting_scene_free();
+}
+
+void setUp(void) {
+    strcpy(directory, "/tmp/test_scene_file_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(asset_directory, MAX_PATH_LENGTH, "%s/", directory);
+    make_path("box.glb", asset_path);
+    make_path("sky.aseprite", skybox_path);
+    make_path("empty", empty_directory);
+    make_path("test.scene", scene_path);
+    create_file(asset_path);
+    create_file(skybox_path);
+    TEST_ASSERT_EQUAL(0, mkdir(empty_directory, 0700));
+
+    scene_file_set_terrain_compression(0);
+    scene_file_set_compact_entities(0);
+    init_scene();
+}
+
+void tearDown(void) {
+    free_scene();
+    remove(scene_path);
+    remove(asset_path);
+    remove(skybox_path);
+    rmdir(empty_directory);
+    rmdir(directory);
+}
+
+// Adds `count` entities at x = 0, 1, 2... and gives the terrain some shape.
+static void fill_scene(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Entity entity = {.transform = MatrixTranslate(i, 0, 0)};
+        TEST_ASSERT_FALSE(scene_add(entity, 0, asset_directory));
+    }
+    for (size_t i = 0; i < terrain.size; i++) {
+        terrain.heights[i] = i * 0.25f;
+        terrain.texture_indices[i] = i % 3;
+    }
+}
+
+static void store(void) {
+    FILE *fp = fopen(scene_path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    scene_file_store(fp);
+    fclose(fp);
+}
+
+// Loads the scene file into a fresh scene, only selecting parts of it if
+// `options` is set. Returns 1 on error.
+static int load_ex(const SceneFileLoadOptions *options) {
+    free_scene();
+    init_scene();
+    FILE *fp = fopen(scene_path, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+
+    // The skybox is not found so that its model isn't loaded, which would
+    // need a window. The scene keeps using the same skybox anyway.
+    skyboxes_fetch_all(empty_directory);
+    SceneFileLoadOptions all = {.verify_checksums = 1};
+    int result = scene_file_load_ex(fp, empty_directory, asset_directory,
+                                    options ? options : &all);
+    skyboxes_fetch_all(asset_directory);
+    fclose(fp);
+    return result;
+}
+
+static int load(void) {
+    return load_ex(0);
+}
+
+static size_t get_file_size(void) {
+    struct stat file_stat = {0};
+    TEST_ASSERT_EQUAL(0, stat(scene_path, &file_stat));
+    return file_stat.st_size;
+}
+
+// Writes the x position of every entity into `out_positions`, in handle
+// order. Returns the number of entities.
+static size_t get_positions(float *out_positions) {
+    size_t count = 0;
+    Entity *entity = 0;
+    for (EntityHandle handle = 0; (entity = scene_get_entity(handle));
+         handle++) {
+        if (!entity->is_destroyed)
+            out_positions[count++] = entity->transform.m12;
+    }
+    return count;
+}
+
+void test_appended_changes_load_back(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+    size_t stored_size = get_file_size();
+
+    scene_get_entity(1)->transform = MatrixTranslate(10, 0, 0);
+    scene_remove(2);
+    terrain_set_height(5, 0, -3);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_GREATER_THAN(stored_size, get_file_size());
+
+    TEST_ASSERT_FALSE(load());
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT - 1, get_positions(positions));
+    float expected[] = {0, 10, 3, 4, 5};
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, positions, ENTITY_COUNT - 1);
+    TEST_ASSERT_EQUAL_FLOAT(-3, terrain.heights[5]);
+    TEST_ASSERT_EQUAL_FLOAT(6 * 0.25f, terrain.heights[6]);
+    TEST_ASSERT_EQUAL(2, terrain.texture_indices[5]);
+}
+
+void test_unchanged_scene_appends_nothing(void) {
+    fill_scene(ENTITY_COUNT);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    size_t stored_size = get_file_size();
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_EQUAL(stored_size, get_file_size());
+}
+
+void test_loaded_scene_is_appended_to(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+    scene_get_entity(0)->transform = MatrixTranslate(20, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    size_t stored_size = get_file_size();
+
+    // Like opening the level in a new session, what was saved last is some
+    // other file
+    char other_path[MAX_PATH_LENGTH] = {0};
+    make_path("other.scene", other_path);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(other_path));
+    remove(other_path);
+
+    // Nothing changed since the load
+    TEST_ASSERT_FALSE(load());
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_EQUAL(stored_size, get_file_size());
+
+    // Only the moved entity is appended, not a new snapshot
+    scene_get_entity(3)->transform = MatrixTranslate(30, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    size_t appended_size = get_file_size() - stored_size;
+    TEST_ASSERT_GREATER_THAN(0, appended_size);
+    TEST_ASSERT_LESS_THAN(stored_size / 2, appended_size);
+
+    TEST_ASSERT_FALSE(load());
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, get_positions(positions));
+    float expected[] = {20, 1, 2, 30, 4, 5};
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, positions, ENTITY_COUNT);
+}
+
+void test_lossy_file_is_appended_to_after_load(void) {
+    scene_file_set_terrain_compression(1);
+    scene_file_set_compact_entities(1);
+    fill_scene(ENTITY_COUNT);
+    scene_get_entity(1)->transform =
+        MatrixMultiply(MatrixScale(2, 2, 2), MatrixTranslate(1, 0, 0));
+    terrain.heights[3] = 0.123456f;
+    store();
+    size_t stored_size = get_file_size();
+
+    // The loaded data is quantized, which isn't a change
+    TEST_ASSERT_FALSE(load());
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_EQUAL(stored_size, get_file_size());
+}
+
+void test_partial_load_is_not_appended_to(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+
+    SceneFileLoadOptions options = {.parts = SCENE_FILE_LOAD_ENTITIES};
+    TEST_ASSERT_FALSE(load_ex(&options));
+
+    // The terrain wasn't loaded, appending would lose it
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_FALSE(load());
+    TEST_ASSERT_EQUAL_FLOAT(0, terrain.heights[5]);
+}
+
+void test_incomplete_append_is_ignored(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+    scene_get_entity(0)->transform = MatrixTranslate(20, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    size_t committed_size = get_file_size();
+
+    scene_get_entity(1)->transform = MatrixTranslate(21, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_EQUAL(0, truncate(scene_path, get_file_size() - 3));
+
+    TEST_ASSERT_FALSE(load());
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, get_positions(positions));
+    TEST_ASSERT_EQUAL_FLOAT(20, positions[0]);
+    TEST_ASSERT_EQUAL_FLOAT(1, positions[1]);
+
+    // The torn save is overwritten by a snapshot rather than appended to
+    scene_get_entity(2)->transform = MatrixTranslate(22, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_LESS_OR_EQUAL(committed_size, get_file_size());
+    TEST_ASSERT_FALSE(load());
+    get_positions(positions);
+    TEST_ASSERT_EQUAL_FLOAT(22, positions[2]);
+}
+
+void test_compaction_drops_journal(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+    size_t stored_size = get_file_size();
+    for (size_t i = 0; i < 4; i++) {
+        scene_get_entity(i)->transform = MatrixTranslate(40 + i, 0, 0);
+        TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    }
+    TEST_ASSERT_GREATER_THAN(stored_size, get_file_size());
+
+    TEST_ASSERT_FALSE(scene_file_compact(scene_path));
+    TEST_ASSERT_FALSE(scene_file_finish_compaction());
+    TEST_ASSERT_EQUAL(stored_size, get_file_size());
+
+    scene_get_entity(5)->transform = MatrixTranslate(50, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_GREATER_THAN(stored_size, get_file_size());
+
+    TEST_ASSERT_FALSE(load());
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, get_positions(positions));
+    float expected[] = {40, 41, 42, 43, 4, 50};
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, positions, ENTITY_COUNT);
+}
+
+void test_scene_compaction_keeps_appending(void) {
+    fill_scene(ENTITY_COUNT);
+    scene_remove(1);
+    store();
+    size_t stored_size = get_file_size();
+
+    // Handles move down, the entities are still the ones in the file
+    TEST_ASSERT_EQUAL(1, scene_compact(0));
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_EQUAL(stored_size, get_file_size());
+
+    scene_get_entity(3)->transform = MatrixTranslate(60, 0, 0);
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_FALSE(load());
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT - 1, get_positions(positions));
+    float expected[] = {0, 2, 3, 60, 5};
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, positions, ENTITY_COUNT - 1);
+}
+
+// Writes a version 0 file with two entities of asset "box", one light, skybox
+// "sky" and terrain heights of 0.5 per data point.
+static void write_version_0_file(void) {
+    SceneFileAsset asset = {.name = "box"};
+    SceneFileLightingScene lighting_scene = {.ambient_color = RED};
+    SceneFileLightSource light = {.color = BLUE, .intensity = 2};
+    SceneFileEntity entities[2] = {
+        {.transform = MatrixTranslate(3, 0, 0)},
+        {.transform = MatrixTranslate(4, 0, 0), .is_static = 1},
+    };
+    SceneFileSkybox skybox = {.name = "sky"};
+    SceneFileTerrainInfo terrain_info = {.width = TERRAIN_WIDTH};
+    float heights[TERRAIN_WIDTH * TERRAIN_WIDTH] = {0};
+    uint8_t texture_indices[TERRAIN_WIDTH * TERRAIN_WIDTH] = {0};
+    for (size_t i = 0; i < ARRAY_LENGTH(heights); i++) {
+        heights[i] = i * 0.5f;
+        texture_indices[i] = 1;
+    }
+
+    SceneFileHeader header = {
+        .magic = SCENE_FILE_MAGIC,
+        .header_size = offsetof(SceneFileHeader, version),
+        .asset_count = 1,
+        .light_source_count = 1,
+        .entity_count = ARRAY_LENGTH(entities),
+        .lighting_scene_size = sizeof lighting_scene,
+        .asset_size = sizeof asset,
+        .light_source_size = sizeof light,
+        .entity_size = sizeof(SceneFileEntity),
+        .skybox_count = 1,
+        .skybox_size = sizeof skybox,
+        .terrain_info_size = sizeof terrain_info,
+        .terrain_heights_size = sizeof heights,
+        .terrain_texture_indices_size = sizeof texture_indices,
+    };
+
+    FILE *fp = fopen(scene_path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL(1, fwrite(&header, header.header_size, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(&asset, sizeof asset, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(&lighting_scene, sizeof lighting_scene, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(&light, sizeof light, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(entities, sizeof entities, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(&skybox, sizeof skybox, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(&terrain_info, sizeof terrain_info, 1, fp));
+    TEST_ASSERT_EQUAL(1, fwrite(heights, sizeof heights, 1, fp));
+    TEST_ASSERT_EQUAL(1,
+                      fwrite(texture_indices, sizeof texture_indices, 1, fp));
+    fclose(fp);
+}
+
+// Reads the section table of the scene file into `out_sections`, indexed by
+// type. Returns the number of sections.
+static size_t read_sections(SceneFileSection *out_sections) {
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT] = {0};
+    size_t count = 0;
+    FILE *fp = fopen(scene_path, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_FALSE(scene_file_read_sections(
+        fp, sections, SCENE_FILE_SECTION_TYPE_COUNT, &count));
+    fclose(fp);
+
+    memset(out_sections, 0,
+           SCENE_FILE_SECTION_TYPE_COUNT * sizeof(SceneFileSection));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_LESS_THAN(SCENE_FILE_SECTION_TYPE_COUNT, sections[i].type);
+        out_sections[sections[i].type] = sections[i];
+    }
+    return count;
+}
+
+// Flips a byte in the middle of section `type` of the scene file.
+static void corrupt_section(SceneFileSectionType type) {
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT] = {0};
+    read_sections(sections);
+    TEST_ASSERT_EQUAL(type, sections[type].type);
+    TEST_ASSERT_GREATER_THAN(0, sections[type].size);
+
+    FILE *fp = fopen(scene_path, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+    long offset = sections[type].offset + sections[type].size / 2;
+    TEST_ASSERT_EQUAL(0, fseek(fp, offset, SEEK_SET));
+    int byte = fgetc(fp);
+    TEST_ASSERT_EQUAL(0, fseek(fp, offset, SEEK_SET));
+    fputc(byte ^ 0xff, fp);
+    fclose(fp);
+}
+
+void test_version_0_file_loads(void) {
+    write_version_0_file();
+
+    // Sections follow the header in a fixed order
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT] = {0};
+    TEST_ASSERT_EQUAL(8, read_sections(sections));
+    TEST_ASSERT_EQUAL(offsetof(SceneFileHeader, version),
+                      sections[SCENE_FILE_SECTION_ASSETS].offset);
+    TEST_ASSERT_EQUAL(2, sections[SCENE_FILE_SECTION_ENTITIES].count);
+    SceneFileSection *last =
+        &sections[SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES];
+    TEST_ASSERT_EQUAL(get_file_size(), last->offset + last->size);
+
+    TEST_ASSERT_FALSE(load());
+    float positions[2] = {0};
+    TEST_ASSERT_EQUAL(2, get_positions(positions));
+    TEST_ASSERT_EQUAL_FLOAT(3, positions[0]);
+    TEST_ASSERT_EQUAL_FLOAT(4, positions[1]);
+    TEST_ASSERT_TRUE(scene_get_entity(1)->is_static);
+    AssetHandle asset_handle = scene_get_entity(0)->asset_handle;
+    TEST_ASSERT_EQUAL_STRING("box", assets_get_name(asset_handle));
+
+    TEST_ASSERT_EQUAL(1, lighting_scene_get_light_count());
+    LightSource *light =
+        lighting_scene_get_light(lighting_scene_get_light_handle(0));
+    TEST_ASSERT_EQUAL_FLOAT(2, light->intensity);
+    TEST_ASSERT_EQUAL(BLUE.b, light->color.b);
+    TEST_ASSERT_EQUAL(RED.r, lighting_scene_get_ambient_color().r);
+
+    TEST_ASSERT_EQUAL(TERRAIN_WIDTH, terrain.width);
+    TEST_ASSERT_EQUAL_FLOAT(5 * 0.5f, terrain.heights[5]);
+    TEST_ASSERT_EQUAL(1, terrain.texture_indices[5]);
+
+    // Its journal is never read, so it's rewritten as the current version
+    TEST_ASSERT_FALSE(scene_file_store_incremental(scene_path));
+    TEST_ASSERT_GREATER_THAN(8, read_sections(sections));
+    TEST_ASSERT_FALSE(load());
+    TEST_ASSERT_EQUAL(2, get_positions(positions));
+    TEST_ASSERT_EQUAL_FLOAT(5 * 0.5f, terrain.heights[5]);
+}
+
+void test_version_2_file_loads(void) {
+    fill_scene(ENTITY_COUNT);
+    lighting_scene_set_ambient_color(GREEN);
+    TEST_ASSERT_FALSE(lighting_scene_add_light(
+        (LightSource){.intensity = 3, .position = {1, 2, 3}}, 0));
+    store();
+
+    // Names are in the string table
+    SceneFileSection sections[SCENE_FILE_SECTION_TYPE_COUNT] = {0};
+    read_sections(sections);
+    TEST_ASSERT_EQUAL(SCENE_FILE_SECTION_STRINGS,
+                      sections[SCENE_FILE_SECTION_STRINGS].type);
+    TEST_ASSERT_EQUAL(1, sections[SCENE_FILE_SECTION_ASSET_NAMES].count);
+    TEST_ASSERT_EQUAL(1, sections[SCENE_FILE_SECTION_SKYBOX_NAMES].count);
+    TEST_ASSERT_EQUAL(0, sections[SCENE_FILE_SECTION_ASSETS].type);
+    TEST_ASSERT_EQUAL(0, sections[SCENE_FILE_SECTION_SKYBOXES].type);
+
+    TEST_ASSERT_FALSE(load());
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, get_positions(positions));
+    float expected[] = {0, 1, 2, 3, 4, 5};
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(expected, positions, ENTITY_COUNT);
+    TEST_ASSERT_EQUAL(GREEN.g, lighting_scene_get_ambient_color().g);
+    TEST_ASSERT_EQUAL(1, lighting_scene_get_light_count());
+    LightSource *light =
+        lighting_scene_get_light(lighting_scene_get_light_handle(0));
+    TEST_ASSERT_EQUAL_FLOAT(3, light->intensity);
+    TEST_ASSERT_EQUAL_FLOAT(2, light->position.y);
+    TEST_ASSERT_EQUAL_FLOAT(7 * 0.25f, terrain.heights[7]);
+    TEST_ASSERT_EQUAL(1, terrain.texture_indices[7]);
+}
+
+void test_partial_load_skips_other_sections(void) {
+    fill_scene(ENTITY_COUNT);
+    TEST_ASSERT_FALSE(lighting_scene_add_light((LightSource){0}, 0));
+    store();
+
+    // Sections that aren't needed are neither checked nor decoded
+    corrupt_section(SCENE_FILE_SECTION_TERRAIN_HEIGHTS);
+    SceneFileLoadOptions options = {
+        .parts = SCENE_FILE_LOAD_LIGHTS,
+        .verify_checksums = 1,
+    };
+    TEST_ASSERT_FALSE(load_ex(&options));
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(0, get_positions(positions));
+    TEST_ASSERT_EQUAL(1, lighting_scene_get_light_count());
+    TEST_ASSERT_EQUAL_FLOAT(0, terrain.heights[7]);
+
+    options.parts = SCENE_FILE_LOAD_ENTITIES;
+    TEST_ASSERT_FALSE(load_ex(&options));
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, get_positions(positions));
+    TEST_ASSERT_EQUAL(0, lighting_scene_get_light_count());
+    TEST_ASSERT_EQUAL_FLOAT(0, terrain.heights[7]);
+
+    // Nothing is loaded if a needed section is corrupted
+    options.parts = SCENE_FILE_LOAD_ENTITIES | SCENE_FILE_LOAD_TERRAIN;
+    TEST_ASSERT_TRUE(load_ex(&options));
+    TEST_ASSERT_EQUAL(0, get_positions(positions));
+}
+
+void test_partial_load_of_version_0_file(void) {
+    write_version_0_file();
+    SceneFileLoadOptions options = {.parts = SCENE_FILE_LOAD_TERRAIN};
+    TEST_ASSERT_FALSE(load_ex(&options));
+    float positions[2] = {0};
+    TEST_ASSERT_EQUAL(0, get_positions(positions));
+    TEST_ASSERT_EQUAL(0, lighting_scene_get_light_count());
+    TEST_ASSERT_EQUAL_FLOAT(5 * 0.5f, terrain.heights[5]);
+}
+
+void test_timed_load_leaves_scene_alone(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+    terrain.heights[5] = 99;
+
+    FILE *fp = fopen(scene_path, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    SceneFileLoadTimings timings = {0};
+    TEST_ASSERT_FALSE(scene_file_time_load(fp, &timings));
+    fclose(fp);
+    TEST_ASSERT_TRUE(timings.decode_entities > 0);
+    TEST_ASSERT_TRUE(timings.decode_terrain > 0);
+
+    float positions[ENTITY_COUNT] = {0};
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, get_positions(positions));
+    TEST_ASSERT_EQUAL_FLOAT(99, terrain.heights[5]);
+}
+
+void test_load_reports_timings(void) {
+    fill_scene(ENTITY_COUNT);
+    store();
+
+    SceneFileLoadTimings timings = {0};
+    SceneFileLoadOptions options = {.timings = &timings};
+    TEST_ASSERT_FALSE(load_ex(&options));
+    TEST_ASSERT_EQUAL(ENTITY_COUNT, scene_get_entity_count());
+    TEST_ASSERT_TRUE(timings.read_toc > 0);
+    TEST_ASSERT_TRUE(timings.decode_entities > 0);
+    TEST_ASSERT_TRUE(timings.decode_terrain > 0);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_appended_changes_load_back);
+    RUN_TEST(test_unchanged_scene_appends_nothing);
+    RUN_TEST(test_loaded_scene_is_appended_to);
+    RUN_TEST(test_lossy_file_is_appended_to_after_load);
+    RUN_TEST(test_partial_load_is_not_appended_to);
+    RUN_TEST(test_incomplete_append_is_ignored);
+    RUN_TEST(test_compaction_drops_journal);
+    RUN_TEST(test_scene_compaction_keeps_appending);
+    RUN_TEST(test_version_0_file_loads);
+    RUN_TEST(test_version_2_file_loads);
+    RUN_TEST(test_partial_load_skips_other_sections);
+    RUN_TEST(test_partial_load_of_version_0_file);
+    RUN_TEST(test_timed_load_leaves_scene_alone);
+    RUN_TEST(test_load_reports_timings);
+    return UNITY_END();
+}
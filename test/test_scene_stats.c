@@ -0,0 +1,73 @@
+#include "unity.h"
+
+#include "lighting.h"
+#include "scene.h"
+#include "scene_stats.h"
+#include <stddef.h>
+
+void setUp(void) {
+    scene_init();
+    scene_stats_end_frame();
+    scene_stats_end_frame();
+}
+
+void tearDown(void) {
+    scene_free();
+    lighting_scene_free();
+}
+
+void test_mesh_bytes_count_present_attributes(void) {
+    float vertices[9] = {0};
+    float normals[9] = {0};
+    unsigned short indices[3] = {0};
+    Mesh mesh = {
+        .vertexCount = 3,
+        .triangleCount = 1,
+        .vertices = vertices,
+        .normals = normals,
+        .indices = indices,
+    };
+
+    size_t vertex_bytes = 0;
+    size_t index_bytes = 0;
+    scene_stats_get_mesh_bytes(&mesh, &vertex_bytes, &index_bytes);
+    TEST_ASSERT_EQUAL(2 * 3 * 3 * sizeof(float), vertex_bytes);
+    TEST_ASSERT_EQUAL(3 * sizeof(unsigned short), index_bytes);
+}
+
+void test_default_texture_is_not_counted(void) {
+    Texture texture = {.id = 0, .width = 64, .height = 64};
+    TEST_ASSERT_EQUAL(0, scene_stats_get_texture_bytes(texture));
+}
+
+void test_draw_calls_are_reported_for_last_frame(void) {
+    scene_stats_add_draw_calls(3);
+    scene_stats_add_draw_calls(4);
+    TEST_ASSERT_EQUAL(0, scene_stats_get().draw_calls_last_frame);
+
+    scene_stats_end_frame();
+    TEST_ASSERT_EQUAL(7, scene_stats_get().draw_calls_last_frame);
+
+    scene_stats_end_frame();
+    TEST_ASSERT_EQUAL(0, scene_stats_get().draw_calls_last_frame);
+}
+
+void test_empty_scene_has_no_cost(void) {
+    SceneStats stats = scene_stats_get();
+    TEST_ASSERT_EQUAL(0, stats.entities_live);
+    TEST_ASSERT_EQUAL(0, stats.entities_destroyed);
+    TEST_ASSERT_EQUAL(0, stats.models);
+    TEST_ASSERT_EQUAL(0, stats.model_vertex_bytes);
+    TEST_ASSERT_EQUAL(0, stats.texture_bytes);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_mesh_bytes_count_present_attributes);
+    RUN_TEST(test_default_texture_is_not_counted);
+    RUN_TEST(test_draw_calls_are_reported_for_last_frame);
+    RUN_TEST(test_empty_scene_has_no_cost);
+
+    return UNITY_END();
+}
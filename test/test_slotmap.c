@@ -0,0 +1,115 @@
+#include "unity.h"
+
+#include "slotmap.h"
+#include <stddef.h>
+#include <stdint.h>
+
+SLOTMAP_DECLARE(int, IntSlotMap, intmap)
+SLOTMAP_IMPLEMENT(int, IntSlotMap, intmap)
+
+IntSlotMap map;
+
+void setUp(void) {
+    map = intmap_init();
+}
+
+void tearDown(void) {
+    intmap_free(&map);
+}
+
+void test_basic_functionality(void) {
+    SlotMapHandle a = intmap_insert(&map, 1);
+    SlotMapHandle b = intmap_insert(&map, 2);
+    SlotMapHandle c = intmap_insert(&map, 3);
+
+    TEST_ASSERT_NOT_EQUAL(SLOTMAP_HANDLE_NULL, a);
+    TEST_ASSERT_EQUAL(1, *intmap_get(&map, a));
+    TEST_ASSERT_EQUAL(2, *intmap_get(&map, b));
+    TEST_ASSERT_EQUAL(3, *intmap_get(&map, c));
+    TEST_ASSERT_EQUAL(3, map.data_used);
+}
+
+void test_null_handle_is_invalid(void) {
+    intmap_insert(&map, 1);
+    TEST_ASSERT_NULL(intmap_get(&map, SLOTMAP_HANDLE_NULL));
+    TEST_ASSERT_EQUAL(1, intmap_remove(&map, SLOTMAP_HANDLE_NULL));
+}
+
+void test_remove_keeps_other_handles_valid(void) {
+    SlotMapHandle a = intmap_insert(&map, 1);
+    SlotMapHandle b = intmap_insert(&map, 2);
+    SlotMapHandle c = intmap_insert(&map, 3);
+
+    TEST_ASSERT_EQUAL(0, intmap_remove(&map, a));
+
+    TEST_ASSERT_NULL(intmap_get(&map, a));
+    TEST_ASSERT_EQUAL(2, *intmap_get(&map, b));
+    TEST_ASSERT_EQUAL(3, *intmap_get(&map, c));
+    TEST_ASSERT_EQUAL(2, map.data_used);
+}
+
+void test_stale_handle_after_slot_reuse(void) {
+    SlotMapHandle a = intmap_insert(&map, 1);
+    intmap_remove(&map, a);
+    SlotMapHandle b = intmap_insert(&map, 2);
+
+    TEST_ASSERT_EQUAL(slotmap_handle_slot(a), slotmap_handle_slot(b));
+    TEST_ASSERT_NOT_EQUAL(a, b);
+    TEST_ASSERT_NULL(intmap_get(&map, a));
+    TEST_ASSERT_EQUAL(1, intmap_remove(&map, a));
+    TEST_ASSERT_EQUAL(2, *intmap_get(&map, b));
+}
+
+void test_dense_iteration(void) {
+    SlotMapHandle handles[10] = {0};
+    for (int i = 0; i < 10; i++)
+        handles[i] = intmap_insert(&map, i);
+
+    for (int i = 0; i < 10; i += 2)
+        intmap_remove(&map, handles[i]);
+
+    int sum = 0;
+    for (size_t i = 0; i < map.data_used; i++) {
+        sum += map.data[i];
+        SlotMapHandle handle = intmap_dense_handle(&map, i);
+        TEST_ASSERT_EQUAL(map.data[i], *intmap_get(&map, handle));
+
+        size_t index = 0;
+        TEST_ASSERT_EQUAL(0, intmap_dense_index(&map, handle, &index));
+        TEST_ASSERT_EQUAL(i, index);
+    }
+    TEST_ASSERT_EQUAL(1 + 3 + 5 + 7 + 9, sum);
+    TEST_ASSERT_EQUAL(SLOTMAP_HANDLE_NULL, intmap_dense_handle(&map, 5));
+}
+
+void test_zero_initialized_map(void) {
+    IntSlotMap zero_map = {0};
+    SlotMapHandle a = intmap_insert(&zero_map, 5);
+    SlotMapHandle b = intmap_insert(&zero_map, 6);
+    TEST_ASSERT_EQUAL(5, *intmap_get(&zero_map, a));
+    TEST_ASSERT_EQUAL(6, *intmap_get(&zero_map, b));
+    intmap_free(&zero_map);
+}
+
+void test_grow(void) {
+    SlotMapHandle handles[100] = {0};
+    for (int i = 0; i < 100; i++)
+        handles[i] = intmap_insert(&map, i * 2);
+
+    for (int i = 0; i < 100; i++)
+        TEST_ASSERT_EQUAL(i * 2, *intmap_get(&map, handles[i]));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_basic_functionality);
+    RUN_TEST(test_null_handle_is_invalid);
+    RUN_TEST(test_remove_keeps_other_handles_valid);
+    RUN_TEST(test_stale_handle_after_slot_reuse);
+    RUN_TEST(test_dense_iteration);
+    RUN_TEST(test_zero_initialized_map);
+    RUN_TEST(test_grow);
+
+    return UNITY_END();
+}
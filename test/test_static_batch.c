@@ -0,0 +1,139 @@
+#include "unity.h"
+
+#include "assets.h"
+#include "common.h"
+#include "lighting.h"
+#include "render_queue.h"
+#include "scene.h"
+#include "scene_stats.h"
+#include "static_batch.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static char directory[] = "/tmp/test_static_batch_XXXXXX";
+static char asset_directory[MAX_PATH_LENGTH];
+
+static const char *asset_names[] = {"box", "cone"};
+#define ASSET_COUNT (sizeof asset_names / sizeof *asset_names)
+
+void setUp(void) {
+    strcpy(directory, "/tmp/test_static_batch_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(asset_directory, MAX_PATH_LENGTH, "%s/", directory);
+    for (size_t i = 0; i < ASSET_COUNT; i++) {
+        char asset_path[MAX_PATH_LENGTH];
+        snprintf(asset_path, MAX_PATH_LENGTH, "%s/%s.glb", directory,
+                 asset_names[i]);
+        FILE *fp = fopen(asset_path, "wb");
+        TEST_ASSERT_NOT_NULL(fp);
+        fclose(fp);
+    }
+
+    assets_fetch_all(asset_directory);
+    scene_init();
+    static_batch_init();
+}
+
+void tearDown(void) {
+    static_batch_free();
+    render_queue_free();
+    scene_free();
+    lighting_scene_free();
+    for (size_t i = 0; i < ASSET_COUNT; i++) {
+        char asset_path[MAX_PATH_LENGTH];
+        snprintf(asset_path, MAX_PATH_LENGTH, "%s/%s.glb", directory,
+                 asset_names[i]);
+        remove(asset_path);
+    }
+    rmdir(directory);
+}
+
+// Adds an entity of asset `name` at `x` on the X axis.
+static EntityHandle add_entity(const char *name, float x, int is_static) {
+    Entity entity = {.transform = MatrixTranslate(x, 0, 0),
+                     .is_static = is_static};
+    TEST_ASSERT_FALSE(assets_get_handle(name, &entity.asset_handle));
+    EntityHandle handle = 0;
+    TEST_ASSERT_FALSE(scene_add(entity, &handle, asset_directory));
+    return handle;
+}
+
+void test_one_batch_per_region_and_material(void) {
+    add_entity("box", 1, 1);
+    add_entity("box", 2, 1);
+    add_entity("box", STATIC_BATCH_REGION_SIZE + 1, 1);
+    EntityHandle cone = add_entity("cone", 3, 1);
+
+    // Cones use a texture of their own
+    Model *model = scene_get_model(scene_get_entity(cone)->model_handle);
+    model->materials[0].maps[MATERIAL_MAP_DIFFUSE].texture.id = 7;
+
+    static_batch_update();
+    TEST_ASSERT_EQUAL(3, static_batch_get_batch_count());
+
+    static_batch_draw();
+    scene_stats_end_frame();
+    TEST_ASSERT_EQUAL(3, scene_stats_get().draw_calls_last_frame);
+}
+
+void test_regions_are_rebuilt_when_entities_change(void) {
+    add_entity("box", 1, 1);
+    EntityHandle far = add_entity("box", STATIC_BATCH_REGION_SIZE + 1, 1);
+    static_batch_update();
+    TEST_ASSERT_EQUAL(2, static_batch_get_batch_count());
+
+    scene_set_entity_transform(far, MatrixTranslate(2, 0, 0));
+    static_batch_update();
+    TEST_ASSERT_EQUAL(1, static_batch_get_batch_count());
+
+    scene_set_entity_static(far, 0);
+    scene_set_entity_transform(far, MatrixTranslate(-10, 0, -10));
+    static_batch_update();
+    TEST_ASSERT_EQUAL(1, static_batch_get_batch_count());
+
+    scene_set_entity_static(far, 1);
+    static_batch_update();
+    TEST_ASSERT_EQUAL(2, static_batch_get_batch_count());
+
+    scene_remove(far);
+    static_batch_update();
+    TEST_ASSERT_EQUAL(1, static_batch_get_batch_count());
+}
+
+void test_regions_follow_compaction(void) {
+    EntityHandle removed = add_entity("box", 1, 0);
+    add_entity("box", STATIC_BATCH_REGION_SIZE + 1, 1);
+    scene_remove(removed);
+    scene_compact(0);
+
+    // Moved from handle 1 to 0
+    scene_set_entity_transform(0, MatrixTranslate(1, 0, 0));
+    static_batch_update();
+    TEST_ASSERT_EQUAL(1, static_batch_get_batch_count());
+    scene_remove(0);
+    static_batch_update();
+    TEST_ASSERT_EQUAL(0, static_batch_get_batch_count());
+}
+
+void test_static_entities_are_left_out_of_render_queue(void) {
+    add_entity("box", 1, 1);
+    add_entity("box", 2, 1);
+    add_entity("box", 3, 0);
+    add_entity("cone", 4, 0);
+
+    render_queue_build((Camera3D){0});
+    render_queue_draw();
+    scene_stats_end_frame();
+    TEST_ASSERT_EQUAL(2, scene_stats_get().draw_calls_last_frame);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_batch_per_region_and_material);
+    RUN_TEST(test_regions_are_rebuilt_when_entities_change);
+    RUN_TEST(test_regions_follow_compaction);
+    RUN_TEST(test_static_entities_are_left_out_of_render_queue);
+    return UNITY_END();
+}
@@ -0,0 +1,284 @@
+#include "unity.h"
+
+#include "assets.h"
+#include "common.h"
+#include "lighting.h"
+#include "scene.h"
+#include "streaming.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CELL_SIZE 10.0
+#define LOAD_RADIUS 30.0
+#define UNLOAD_RADIUS 40.0
+
+static size_t loads = 0;
+static size_t unloads = 0;
+static size_t peak_resident = 0;
+
+// Only set up by tests streaming entities into the scene
+static int is_scene_initialized = 0;
+static char directory[] = "/tmp/test_streaming_XXXXXX";
+static char asset_directory[MAX_PATH_LENGTH];
+static char asset_path[MAX_PATH_LENGTH];
+
+static void count_load(StreamingCell cell, void *user_data) {
+    (void)cell;
+    (void)user_data;
+    loads++;
+}
+
+static void count_unload(StreamingCell cell, void *user_data) {
+    (void)cell;
+    (void)user_data;
+    unloads++;
+}
+
+static void init(size_t max_loads_per_update) {
+    streaming_init((StreamingSettings){
+        .cell_size = CELL_SIZE,
+        .load_radius = LOAD_RADIUS,
+        .unload_radius = UNLOAD_RADIUS,
+        .max_loads_per_update = max_loads_per_update,
+        .load_cell = count_load,
+        .unload_cell = count_unload,
+    });
+}
+
+static void update(Vector3 camera_position) {
+    streaming_update(camera_position);
+    if (streaming_get_resident_count() > peak_resident)
+        peak_resident = streaming_get_resident_count();
+}
+
+void setUp(void) {
+    loads = 0;
+    unloads = 0;
+    peak_resident = 0;
+}
+
+void tearDown(void) {
+    streaming_free();
+    if (!is_scene_initialized)
+        return;
+    scene_free();
+    lighting_scene_free();
+    remove(asset_path);
+    rmdir(directory);
+    is_scene_initialized = 0;
+}
+
+// Enables streaming of entities into an empty scene, with one asset to use.
+static void init_scene(void) {
+    strcpy(directory, "/tmp/test_streaming_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(asset_directory, MAX_PATH_LENGTH, "%s/", directory);
+    snprintf(asset_path, MAX_PATH_LENGTH, "%s/box.glb", directory);
+    FILE *fp = fopen(asset_path, "wb");
+    TEST_ASSERT_NOT_NULL(fp);
+    fclose(fp);
+
+    assets_fetch_all(asset_directory);
+    scene_init();
+    is_scene_initialized = 1;
+    streaming_init(streaming_scene_settings(CELL_SIZE, LOAD_RADIUS,
+                                            UNLOAD_RADIUS, 0, asset_directory));
+}
+
+static size_t count_live_entities(void) {
+    size_t count = 0;
+    for (EntityHandle handle = 0; handle < scene_get_entity_count(); handle++)
+        count += !scene_get_entity(handle)->is_destroyed;
+    return count;
+}
+
+// Returns the handle of the live entity at `x`, `z`.
+static EntityHandle find_entity(float x, float z) {
+    for (EntityHandle handle = 0; handle < scene_get_entity_count(); handle++) {
+        Entity *entity = scene_get_entity(handle);
+        if (!entity->is_destroyed && entity->transform.m12 == x &&
+            entity->transform.m14 == z)
+            return handle;
+    }
+    TEST_FAIL_MESSAGE("entity not found");
+    return 0;
+}
+
+void test_loads_cells_within_load_radius(void) {
+    init(0);
+    update((Vector3){5, 0, 5});
+
+    TEST_ASSERT_TRUE(streaming_is_cell_resident((StreamingCell){0, 0}));
+    TEST_ASSERT_TRUE(streaming_is_cell_resident((StreamingCell){3, 0}));
+    TEST_ASSERT_TRUE(streaming_is_cell_resident((StreamingCell){-2, -2}));
+    TEST_ASSERT_FALSE(streaming_is_cell_resident((StreamingCell){4, 0}));
+    TEST_ASSERT_FALSE(streaming_is_cell_resident((StreamingCell){3, 3}));
+    TEST_ASSERT_EQUAL(loads, streaming_get_resident_count());
+}
+
+void test_budget_limits_loads_per_update(void) {
+    init(4);
+    update((Vector3){5, 0, 5});
+
+    TEST_ASSERT_EQUAL(4, loads);
+    TEST_ASSERT_TRUE(streaming_is_cell_resident((StreamingCell){0, 0}));
+
+    for (size_t i = 0; i < 100; i++)
+        update((Vector3){5, 0, 5});
+    TEST_ASSERT_TRUE(streaming_is_cell_resident((StreamingCell){3, 0}));
+    TEST_ASSERT_EQUAL(loads, streaming_get_resident_count());
+}
+
+void test_hysteresis_prevents_reloading_at_cell_borders(void) {
+    init(0);
+    update((Vector3){9.5, 0, 5});
+    size_t initial_loads = loads;
+
+    for (size_t i = 0; i < 100; i++)
+        update((Vector3){i % 2 ? 9.5 : 10.5, 0, 5});
+
+    TEST_ASSERT_EQUAL(0, unloads);
+    // Only cells newly within range on the far side get loaded, once
+    TEST_ASSERT_LESS_OR_EQUAL(initial_loads + 7, loads);
+}
+
+void test_camera_path_keeps_residency_bounded(void) {
+    init(8);
+
+    // Fly in a long straight line and back diagonally
+    for (float t = 0; t < 2000; t += 1.5)
+        update((Vector3){t, 0, 0});
+    for (float t = 2000; t > -2000; t -= 1.5)
+        update((Vector3){t, 0, t * 0.5f});
+
+    // Every cell within the unload radius at once, plus one row of slack for
+    // cells touched by the square around the camera cell.
+    size_t side = 2 * (size_t)(UNLOAD_RADIUS / CELL_SIZE) + 2;
+    TEST_ASSERT_LESS_OR_EQUAL(side * side, peak_resident);
+    TEST_ASSERT_GREATER_THAN(0, unloads);
+    TEST_ASSERT_EQUAL(loads - unloads, streaming_get_resident_count());
+}
+
+void test_free_unloads_all_cells(void) {
+    init(0);
+    update((Vector3){0, 0, 0});
+    size_t resident = streaming_get_resident_count();
+
+    streaming_free();
+    TEST_ASSERT_EQUAL(resident, unloads);
+    TEST_ASSERT_FALSE(streaming_is_enabled());
+}
+
+void test_edits_are_kept_when_cell_unloads(void) {
+    init_scene();
+    streaming_add_entity((Entity){.transform = MatrixTranslate(5, 0, 5)});
+    update((Vector3){5, 0, 5});
+    TEST_ASSERT_EQUAL(1, count_live_entities());
+    TEST_ASSERT_NULL(streaming_get_held_entity(0));
+
+    scene_set_entity_transform(find_entity(5, 5), MatrixTranslate(6, 2, 5));
+    update((Vector3){500, 0, 500});
+    TEST_ASSERT_EQUAL(0, count_live_entities());
+    const Entity *held = streaming_get_held_entity(0);
+    TEST_ASSERT_NOT_NULL(held);
+    TEST_ASSERT_EQUAL_FLOAT(2, held->transform.m13);
+
+    update((Vector3){5, 0, 5});
+    Entity *entity = scene_get_entity(find_entity(6, 5));
+    TEST_ASSERT_EQUAL_FLOAT(2, entity->transform.m13);
+}
+
+void test_removed_entity_stays_removed(void) {
+    init_scene();
+    streaming_add_entity((Entity){.transform = MatrixTranslate(5, 0, 5)});
+    update((Vector3){5, 0, 5});
+    scene_remove(find_entity(5, 5));
+
+    // Reuses the slot of the removed entity, unloading must not touch it
+    EntityHandle handle = 0;
+    TEST_ASSERT_FALSE(scene_add(
+        (Entity){.transform = MatrixTranslate(7, 0, 7)}, &handle,
+        asset_directory));
+    update((Vector3){500, 0, 500});
+    TEST_ASSERT_EQUAL(1, count_live_entities());
+    TEST_ASSERT_EQUAL(handle, find_entity(7, 7));
+    TEST_ASSERT_NULL(streaming_get_held_entity(0));
+
+    update((Vector3){5, 0, 5});
+    TEST_ASSERT_EQUAL(1, count_live_entities());
+}
+
+void test_removal_finds_entity_after_streamed_entities_sort(void) {
+    init_scene();
+    update((Vector3){5, 0, 5});
+
+    // Loaded right away against cell order, then sorted by the next load
+    streaming_add_entity((Entity){.transform = MatrixTranslate(25, 0, 5)});
+    streaming_add_entity((Entity){.transform = MatrixTranslate(15, 0, 5)});
+    streaming_add_entity((Entity){.transform = MatrixTranslate(5, 0, 5)});
+    TEST_ASSERT_EQUAL(3, count_live_entities());
+    update((Vector3){15, 0, 5});
+
+    scene_remove(find_entity(25, 5));
+    update((Vector3){500, 0, 500});
+    TEST_ASSERT_EQUAL(0, count_live_entities());
+
+    update((Vector3){5, 0, 5});
+    TEST_ASSERT_EQUAL(2, count_live_entities());
+    find_entity(5, 5);
+    find_entity(15, 5);
+}
+
+void test_compaction_keeps_streamed_entities(void) {
+    init_scene();
+    EntityHandle handle = 0;
+    TEST_ASSERT_FALSE(scene_add(
+        (Entity){.transform = MatrixTranslate(900, 0, 900)}, &handle,
+        asset_directory));
+    streaming_add_entity((Entity){.transform = MatrixTranslate(5, 0, 5)});
+    update((Vector3){5, 0, 5});
+    TEST_ASSERT_EQUAL(1, find_entity(5, 5));
+
+    scene_remove(handle);
+    scene_compact(0);
+    TEST_ASSERT_EQUAL(0, find_entity(5, 5));
+
+    update((Vector3){500, 0, 500});
+    TEST_ASSERT_EQUAL(0, count_live_entities());
+    TEST_ASSERT_NOT_NULL(streaming_get_held_entity(0));
+}
+
+void test_entity_moved_to_resident_cell_stays_loaded(void) {
+    init_scene();
+    streaming_add_entity((Entity){.transform = MatrixTranslate(5, 0, 5)});
+    update((Vector3){5, 0, 5});
+
+    // Cell 0, 0 unloads at x 50 while cell 8, 0 is near
+    scene_set_entity_transform(find_entity(5, 5), MatrixTranslate(85, 0, 5));
+    update((Vector3){65, 0, 5});
+    TEST_ASSERT_FALSE(streaming_is_cell_resident((StreamingCell){0, 0}));
+    TEST_ASSERT_EQUAL(1, count_live_entities());
+
+    update((Vector3){500, 0, 500});
+    TEST_ASSERT_EQUAL(0, count_live_entities());
+    TEST_ASSERT_EQUAL_FLOAT(85, streaming_get_held_entity(0)->transform.m12);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_loads_cells_within_load_radius);
+    RUN_TEST(test_budget_limits_loads_per_update);
+    RUN_TEST(test_hysteresis_prevents_reloading_at_cell_borders);
+    RUN_TEST(test_camera_path_keeps_residency_bounded);
+    RUN_TEST(test_free_unloads_all_cells);
+    RUN_TEST(test_edits_are_kept_when_cell_unloads);
+    RUN_TEST(test_removed_entity_stays_removed);
+    RUN_TEST(test_removal_finds_entity_after_streamed_entities_sort);
+    RUN_TEST(test_compaction_keeps_streamed_entities);
+    RUN_TEST(test_entity_moved_to_resident_cell_stays_loaded);
+
+    return UNITY_END();
+}
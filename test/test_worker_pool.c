@@ -0,0 +1,72 @@
+#include "unity.h"
+
+#include "worker_pool.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define JOB_COUNT 1000
+
+static atomic_size_t counter;
+static size_t results[JOB_COUNT];
+
+void setUp(void) {
+    atomic_init(&counter, 0);
+    worker_pool_init(4);
+}
+
+void tearDown(void) {
+    worker_pool_free();
+}
+
+static void increment(void *argument) {
+    (void)argument;
+    atomic_fetch_add(&counter, 1);
+}
+
+static void square(void *argument) {
+    size_t *result = argument;
+    size_t index = result - results;
+    *result = index * index;
+}
+
+void test_runs_every_job(void) {
+    for (size_t i = 0; i < JOB_COUNT; i++)
+        worker_pool_submit(increment, 0);
+
+    worker_pool_wait();
+    TEST_ASSERT_EQUAL(JOB_COUNT, atomic_load(&counter));
+}
+
+void test_jobs_get_their_argument(void) {
+    for (size_t i = 0; i < JOB_COUNT; i++)
+        worker_pool_submit(square, results + i);
+
+    worker_pool_wait();
+    for (size_t i = 0; i < JOB_COUNT; i++)
+        TEST_ASSERT_EQUAL(i * i, results[i]);
+}
+
+void test_free_finishes_queued_jobs(void) {
+    for (size_t i = 0; i < JOB_COUNT; i++)
+        worker_pool_submit(increment, 0);
+
+    worker_pool_free();
+    TEST_ASSERT_EQUAL(JOB_COUNT, atomic_load(&counter));
+    TEST_ASSERT_FALSE(worker_pool_is_running());
+}
+
+void test_wait_without_jobs_returns(void) {
+    worker_pool_wait();
+    TEST_ASSERT_TRUE(worker_pool_is_running());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_runs_every_job);
+    RUN_TEST(test_jobs_get_their_argument);
+    RUN_TEST(test_free_finishes_queued_jobs);
+    RUN_TEST(test_wait_without_jobs_returns);
+
+    return UNITY_END();
+}
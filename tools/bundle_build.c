@@ -0,0 +1,34 @@
+#include "bundle.h"
+#include <stdio.h>
+
+// Packs the files given on the command line into an asset bundle, to be
+// mounted with `filesystem_mount_bundle`. Files are found in the bundle by
+// their path as given, so run it from the directory the game runs in:
+//
+//     bundle_build game.bundle assets/*.glb assets/*.aseprite skyboxes/*
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s bundle [file...]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *fp = fopen(argv[1], "wb");
+    if (!fp) {
+        fprintf(stderr, "ERROR: could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    size_t count = argc - 2;
+    int result = bundle_build((const char *const *)argv + 2, count, fp);
+    if (fclose(fp))
+        result = 1;
+    if (result) {
+        fprintf(stderr, "ERROR: could not build %s\n", argv[1]);
+        remove(argv[1]);
+        return 1;
+    }
+
+    printf("%zu files packed into %s\n", count, argv[1]);
+    return 0;
+}
@@ -0,0 +1,314 @@
+#include "scene_file.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Prints what a scene file contains and how long loading it takes, without
+// opening a window. Exits with 1 if the file is invalid, corrupted or takes
+// longer to load than the budget given with -b.
+
+#define USAGE                                                                  \
+    "usage: %s [-n iterations] [-b budget_ms] [-a top_assets] file\n"          \
+    "  -n  times to run the load phases, 10 by default\n"                      \
+    "  -b  fail if the mean load time is over this many milliseconds\n"        \
+    "  -a  number of most used assets to list, 10 by default\n"
+#define BAR_WIDTH 40
+
+static const char *section_names[] = {
+    [SCENE_FILE_SECTION_ASSETS] = "assets",
+    [SCENE_FILE_SECTION_LIGHTING_SCENE] = "lighting scene",
+    [SCENE_FILE_SECTION_LIGHT_SOURCES] = "light sources",
+    [SCENE_FILE_SECTION_ENTITIES] = "entities",
+    [SCENE_FILE_SECTION_SKYBOXES] = "skyboxes",
+    [SCENE_FILE_SECTION_TERRAIN_INFO] = "terrain info",
+    [SCENE_FILE_SECTION_TERRAIN_HEIGHTS] = "terrain heights",
+    [SCENE_FILE_SECTION_TERRAIN_TEXTURE_INDICES] = "terrain texture indices",
+    [SCENE_FILE_SECTION_STRINGS] = "strings",
+    [SCENE_FILE_SECTION_ASSET_NAMES] = "asset names",
+    [SCENE_FILE_SECTION_COMPACT_ENTITIES] = "compact entities",
+    [SCENE_FILE_SECTION_SKYBOX_NAMES] = "skybox names",
+    [SCENE_FILE_SECTION_TERRAIN_TEXTURE_NAMES] = "terrain texture names",
+};
+
+typedef struct {
+    const char *name;
+    size_t offset;
+} Phase;
+
+// Fields of SceneFileLoadTimings in the order the loader runs them
+static const Phase phases[] = {
+    {"open", offsetof(SceneFileLoadTimings, open)},
+    {"read toc", offsetof(SceneFileLoadTimings, read_toc)},
+    {"verify checksums", offsetof(SceneFileLoadTimings, verify_checksums)},
+    {"decode assets", offsetof(SceneFileLoadTimings, decode_assets)},
+    {"decode entities", offsetof(SceneFileLoadTimings, decode_entities)},
+    {"decode terrain", offsetof(SceneFileLoadTimings, decode_terrain)},
+};
+#define PHASE_COUNT (sizeof phases / sizeof phases[0])
+
+static inline double get_phase(const SceneFileLoadTimings *timings,
+                               size_t phase) {
+    return *(const double *)((const uint8_t *)timings + phases[phase].offset);
+}
+
+static void print_header(const SceneFileInspection *inspection) {
+    const SceneFileHeader *header = &inspection->header;
+    printf("header\n");
+    printf("  version              %u\n", header->version);
+    printf("  file size            %zu bytes\n", inspection->file_size);
+    printf("  header size          %u bytes\n", header->header_size);
+    printf("  compressed terrain   %s\n",
+           header->flags.compressed_terrain ? "yes" : "no");
+    printf("  checksums            %s\n",
+           header->flags.has_checksums ? "yes" : "no");
+    printf("  section table        %u sections of %u bytes at %llu\n",
+           header->section_count, header->section_size,
+           (unsigned long long)header->section_table_offset);
+}
+
+// Returns the number of corrupted sections.
+static size_t print_sections(const SceneFileInspection *inspection) {
+    size_t corrupted_count = 0;
+    printf("\nsections\n");
+    printf("  %-24s %10s %10s %8s %7s %9s  %s\n", "type", "offset", "size",
+           "count", "record", "share", "checksum");
+    for (size_t type = 1; type < SCENE_FILE_SECTION_TYPE_COUNT; type++) {
+        const SceneFileSection *section = &inspection->sections[type];
+        if (section->type != type)
+            continue;
+
+        const char *checksum = "-";
+        if (inspection->header.flags.has_checksums)
+            checksum = inspection->is_section_corrupted[type] ? "CORRUPTED"
+                                                              : "ok";
+        corrupted_count += inspection->is_section_corrupted[type];
+        printf("  %-24s %10llu %10llu %8llu %7u %8.1f%%  %s\n",
+               section_names[type], (unsigned long long)section->offset,
+               (unsigned long long)section->size,
+               (unsigned long long)section->count, section->record_size,
+               100.0 * (double)section->size / (double)inspection->file_size,
+               checksum);
+    }
+
+    printf("\njournal\n");
+    printf("  size                 %zu bytes\n", inspection->journal_size);
+    printf("  records              %zu\n", inspection->journal_record_count);
+    if (inspection->incomplete_journal_size)
+        printf("  incomplete           %zu bytes at the end\n",
+               inspection->incomplete_journal_size);
+    return corrupted_count;
+}
+
+static const SceneFileInspection *sorted_inspection;
+
+// Sorts asset indices by the number of entities using the asset, descending.
+static int compare_asset_use(const void *a, const void *b) {
+    size_t count_a = sorted_inspection->asset_entity_counts[*(size_t *)a];
+    size_t count_b = sorted_inspection->asset_entity_counts[*(size_t *)b];
+    return (count_a < count_b) - (count_a > count_b);
+}
+
+static void print_bar(size_t value, size_t max_value) {
+    size_t length = max_value ? value * BAR_WIDTH / max_value : 0;
+    if (value && !length)
+        length = 1;
+    for (size_t i = 0; i < length; i++)
+        putchar('#');
+    putchar('\n');
+}
+
+static void print_contents(const SceneFileInspection *inspection,
+                           size_t top_asset_count) {
+    printf("\ncontents\n");
+    printf("  assets               %zu\n", inspection->asset_count);
+    printf("  entities             %zu\n", inspection->entity_count);
+    printf("  static               %zu\n", inspection->static_entity_count);
+    printf("  ignoring raycasts    %zu\n",
+           inspection->ignore_raycast_entity_count);
+    if (inspection->invalid_entity_count)
+        printf("  with invalid asset   %zu\n",
+               inspection->invalid_entity_count);
+    printf("  terrain width        %u\n", inspection->terrain_width);
+    if (inspection->asset_count == 0)
+        return;
+
+    size_t *order = malloc(inspection->asset_count * sizeof(size_t));
+    if (!order)
+        abort();
+    for (size_t i = 0; i < inspection->asset_count; i++)
+        order[i] = i;
+    sorted_inspection = inspection;
+    qsort(order, inspection->asset_count, sizeof(size_t), compare_asset_use);
+
+    size_t max_count = inspection->asset_entity_counts[order[0]];
+    size_t shown_count = top_asset_count < inspection->asset_count
+                             ? top_asset_count
+                             : inspection->asset_count;
+    printf("\nentities per asset, %zu most used\n", shown_count);
+    for (size_t i = 0; i < shown_count; i++) {
+        size_t count = inspection->asset_entity_counts[order[i]];
+        printf("  %-32.32s %8zu ", inspection->assets[order[i]].name, count);
+        print_bar(count, max_count);
+    }
+
+    // Bucket 0 holds unused assets, bucket n those used by 2^(n-1) to 2^n - 1
+    // entities
+    size_t buckets[66] = {0};
+    size_t bucket_count = 1;
+    for (size_t i = 0; i < inspection->asset_count; i++) {
+        size_t bucket = 0;
+        for (size_t count = inspection->asset_entity_counts[i]; count;
+             count >>= 1)
+            bucket++;
+        buckets[bucket]++;
+        if (bucket + 1 > bucket_count)
+            bucket_count = bucket + 1;
+    }
+
+    size_t max_bucket = 0;
+    for (size_t i = 0; i < bucket_count; i++) {
+        if (buckets[i] > max_bucket)
+            max_bucket = buckets[i];
+    }
+
+    printf("\nassets by number of entities using them\n");
+    for (size_t i = 0; i < bucket_count; i++) {
+        if (!buckets[i])
+            continue;
+        char range[48] = "unused";
+        if (i == 1)
+            snprintf(range, sizeof range, "1");
+        else if (i > 1)
+            snprintf(range, sizeof range, "%zu-%zu", (size_t)1 << (i - 1),
+                     ((size_t)1 << (i - 1)) * 2 - 1);
+        printf("  %-32s %8zu ", range, buckets[i]);
+        print_bar(buckets[i], max_bucket);
+    }
+
+    free(order);
+}
+
+// Returns 1 if a load failed.
+static int print_timings(FILE *fp, size_t iterations, double *out_mean) {
+    double sums[PHASE_COUNT] = {0};
+    double mins[PHASE_COUNT] = {0};
+    double maxes[PHASE_COUNT] = {0};
+    double total_min = 0;
+    double total_max = 0;
+
+    for (size_t iteration = 0; iteration < iterations; iteration++) {
+        SceneFileLoadTimings timings = {0};
+        if (scene_file_time_load(fp, &timings))
+            return 1;
+
+        double total = 0;
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            double seconds = get_phase(&timings, i);
+            total += seconds;
+            sums[i] += seconds;
+            if (iteration == 0 || seconds < mins[i])
+                mins[i] = seconds;
+            if (iteration == 0 || seconds > maxes[i])
+                maxes[i] = seconds;
+        }
+        if (iteration == 0 || total < total_min)
+            total_min = total;
+        if (iteration == 0 || total > total_max)
+            total_max = total;
+    }
+
+    double total_sum = 0;
+    for (size_t i = 0; i < PHASE_COUNT; i++)
+        total_sum += sums[i];
+
+    printf("\nload phases, %zu iterations\n", iterations);
+    printf("  %-24s %10s %10s %10s %7s\n", "phase", "mean ms", "min ms",
+           "max ms", "share");
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        printf("  %-24s %10.3f %10.3f %10.3f %6.1f%%\n", phases[i].name,
+               sums[i] / (double)iterations * 1e3, mins[i] * 1e3,
+               maxes[i] * 1e3,
+               total_sum > 0 ? 100.0 * sums[i] / total_sum : 0.0);
+    }
+    printf("  %-24s %10.3f %10.3f %10.3f %6.1f%%\n", "total",
+           total_sum / (double)iterations * 1e3, total_min * 1e3,
+           total_max * 1e3, 100.0);
+
+    *out_mean = total_sum / (double)iterations;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t iterations = 10;
+    size_t top_asset_count = 10;
+    double budget = 0;
+
+    int option = 0;
+    while ((option = getopt(argc, argv, "n:b:a:")) != -1) {
+        switch (option) {
+        case 'n':
+            iterations = strtoul(optarg, 0, 10);
+            break;
+        case 'b':
+            budget = strtod(optarg, 0) * 1e-3;
+            break;
+        case 'a':
+            top_asset_count = strtoul(optarg, 0, 10);
+            break;
+        default:
+            fprintf(stderr, USAGE, argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || iterations == 0) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+
+    const char *filepath = argv[optind];
+    FILE *fp = fopen(filepath, "rb");
+    if (!fp) {
+        fprintf(stderr, "ERROR: could not open %s\n", filepath);
+        return 1;
+    }
+
+    SceneFileInspection inspection = {0};
+    if (scene_file_inspect(fp, &inspection)) {
+        fprintf(stderr, "ERROR: %s is not a valid scene file\n", filepath);
+        fclose(fp);
+        return 1;
+    }
+
+    print_header(&inspection);
+    int result = 0;
+    if (print_sections(&inspection)) {
+        fprintf(stderr, "ERROR: %s has corrupted sections\n", filepath);
+        result = 1;
+    }
+    print_contents(&inspection, top_asset_count);
+    if (inspection.invalid_entity_count) {
+        fprintf(stderr, "ERROR: %s has entities with invalid assets\n",
+                filepath);
+        result = 1;
+    }
+    scene_file_inspection_free(&inspection);
+
+    double mean = 0;
+    if (!result && print_timings(fp, iterations, &mean)) {
+        fprintf(stderr, "ERROR: loading %s failed\n", filepath);
+        result = 1;
+    }
+    if (!result && budget > 0 && mean > budget) {
+        fprintf(stderr,
+                "ERROR: mean load time %.3f ms is over the budget of %.3f "
+                "ms\n",
+                mean * 1e3, budget * 1e3);
+        result = 1;
+    }
+
+    fclose(fp);
+    return result;
+}